@@ -1,41 +1,71 @@
 #include "bsp_nucleo_h503.h"
 #include "utility.h"
+#include "boot.h"
 #include "tx_api.h"
 
+static void _BSP_CacheInit(void);
 static void _BSP_SystemClockConfig(void);
 static void _BSP_ErrorHandler(void);
 static void _BSP_GPIO_Init(void);
 static void _BSP_FDCAN_Init(void);
 static void _BSP_UART_Init(void);
+#if defined(MANTICORE_LATENCY)
+static void _BSP_LatencyTimerInit(void);
+#endif
 
-static const uint16_t BSP_CLK_DELAY_MS = 500;
-static const uint16_t BSP_DELAY_MS = 1000;
+// VOSRDY takes a few microseconds, give up long before the watchdog would
+static const uint32_t BSP_VOS_TIMEOUT_SPINS = 100000;
 
 UART_HandleTypeDef ConsoleUart;
 
 void BSP_Init(void)
 {
     HAL_Init();
+    BootMark(BOOT_PHASE_HAL);
+    _BSP_CacheInit();
     _BSP_SystemClockConfig();
-    tx_thread_sleep(BSP_CLK_DELAY_MS);
-    
+    BootMark(BOOT_PHASE_CLOCK);
+
+    // HAL waits on every ready flag, no settling delays are needed before the heartbeat
     _BSP_GPIO_Init();
     _BSP_FDCAN_Init();
     _BSP_UART_Init();
-    tx_thread_sleep(BSP_DELAY_MS);
+#if defined(MANTICORE_LATENCY)
+    _BSP_LatencyTimerInit();
+#endif
+    BootMark(BOOT_PHASE_BSP);
+}
+
+// Flash runs with 5 wait states at 250 MHz, the cache hides them for code and constants
+static void _BSP_CacheInit(void)
+{
+    // Internal flash needs no remap region, those map external memory. The H503 has no DCACHE
+    if (HAL_ICACHE_ConfigAssociativityMode(ICACHE_2WAYS) != HAL_OK)
+    {
+        _BSP_ErrorHandler();
+    }
+
+    if (HAL_ICACHE_Enable() != HAL_OK)
+    {
+        _BSP_ErrorHandler();
+    }
 }
 
 static void _BSP_SystemClockConfig(void)
 {
     RCC_OscInitTypeDef RCC_OscInitStruct = {0};
     RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+    uint32_t spins = 0;
 
     // Configure the main internal regulator output voltage
     __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE0);
 
     while( !__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY) ) 
     {
-        // NOP
+        if (++spins > BSP_VOS_TIMEOUT_SPINS)
+        {
+            _BSP_ErrorHandler();
+        }
     }
 
     // Initializes the RCC Oscillators according to the specified parameters in the RCC_OscInitTypeDef structure.
@@ -214,6 +244,16 @@ static void _BSP_UART_Init(void)
 #endif
 }
 
+#if defined(MANTICORE_LATENCY)
+// TIM6 is the latency harness timer source, latency.c owns its configuration. Same priority as FDCAN.
+static void _BSP_LatencyTimerInit(void)
+{
+    __HAL_RCC_TIM6_CLK_ENABLE();
+    HAL_NVIC_SetPriority(TIM6_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(TIM6_IRQn);
+}
+#endif
+
 static void _BSP_ErrorHandler(void)
 {
     __disable_irq();
@@ -3,13 +3,22 @@
 #include "stm32h5xx_it.h"
 #include "stm32h5xx_hal.h"
 #include "tx_api.h"
+#include "bno055_flash.h"
+#include "latency.h"
 #include "mcan.h"
+#include "memory_layout.h"
+#include "sysmon.h"
+#include "trace.h"
 
 extern UART_HandleTypeDef ConsoleUart;
 
 void SysTick_Handler(void)
 {
+  SYSMON_ISR_ENTER();
+  TRACE_ISR_ENTER();
   _tx_timer_interrupt();
+  TRACE_ISR_EXIT();
+  SYSMON_ISR_EXIT();
 }
 
 uint32_t HAL_GetTick(void)
@@ -17,12 +26,58 @@ uint32_t HAL_GetTick(void)
   return _tx_time_get();
 }
 
-void FDCAN1_IT0_IRQHandler(void)
+// Hands the stacked frame to the handlers that can recover, a flash double ECC error on a calibration record read
+static void NMI_Handler_Frame(uint32_t *frame) __attribute__((used));
+
+__attribute__((naked)) void NMI_Handler(void)
+{
+  __asm volatile(
+    "tst lr, #4              \n"
+    "ite eq                  \n"
+    "mrseq r0, msp           \n"
+    "mrsne r0, psp           \n"
+    "b NMI_Handler_Frame     \n");
+}
+
+static void NMI_Handler_Frame(uint32_t *frame)
+{
+  if(BNO055_Flash_ECC_NMI(frame))
+  {
+    return;
+  }
+
+  while(1)
+  {
+  }
+}
+
+MANTICORE_RAMFUNC void FDCAN1_IT0_IRQHandler(void)
 {
+    LATENCY_ISR_ENTER(LAT_SRC_FDCAN);
+    SYSMON_ISR_ENTER();
+    TRACE_ISR_ENTER();
     HAL_FDCAN_IRQHandler(MCAN_GetFDCAN_Handle());
+    TRACE_ISR_EXIT();
+    SYSMON_ISR_EXIT();
 }
 
 void USART3_IRQHandler(void)
 {
+  LATENCY_ISR_ENTER(LAT_SRC_UART);
+  SYSMON_ISR_ENTER();
+  TRACE_ISR_ENTER();
   HAL_UART_IRQHandler(&ConsoleUart);
-}
\ No newline at end of file
+  TRACE_ISR_EXIT();
+  SYSMON_ISR_EXIT();
+}
+
+#if defined(MANTICORE_LATENCY)
+MANTICORE_RAMFUNC void TIM6_IRQHandler(void)
+{
+    SYSMON_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    LatencyTimerIRQHandler();
+    TRACE_ISR_EXIT();
+    SYSMON_ISR_EXIT();
+}
+#endif
\ No newline at end of file
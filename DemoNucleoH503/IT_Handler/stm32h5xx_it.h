@@ -13,5 +13,6 @@ void SysTick_Handler(void);
 void _tx_timer_interrupt(void);
 void FDCAN1_IT0_IRQHandler(void);
 void USART3_IRQHandler(void);
+void TIM6_IRQHandler(void);
 
 #endif /* __STM32H5xx_IT_H */
\ No newline at end of file
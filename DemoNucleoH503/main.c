@@ -1,7 +1,13 @@
 #include "bsp_nucleo_h503.h"
 #include "tx_api.h"
 #include "mcan.h"
+#include "mcan_rpc.h"
 #include "console.h"
+#include "telemetry.h"
+#include "sysmon.h"
+#include "boot.h"
+#include "latency.h"
+#include "trace.h"
 
 // Main Thread
 #define THREAD_MAIN_STACK_SIZE 2048
@@ -19,13 +25,31 @@ void thread_blink(ULONG ctx);
 
 static const uint16_t HEARTBEAT_DELAY_MS = 1000;
 static uint8_t heartbeatData[] = {0xDE, 0xCA, 0xFF, 0xC0, 0xFF, 0xEE, 0xCA, 0xFE};
-static bool heartbeatFlag = false;
+static bool heartbeatFlag = true;
+
+// RPC Methods
+#define RPC_METHOD_HEARTBEAT 0
+static MCAN_RPC_STATUS rpc_heartbeat(MCAN_DEV caller, const uint8_t req[], uint8_t reqLen, uint8_t resp[], uint8_t *respLen);
+
+// Deferred Init Stages, run after the heartbeat is on the bus
+#define THREAD_BOOT_PRIORITY 8
+static bool boot_sysmon(void);
+static bool boot_console(void);
+static bool boot_telemetry(void);
+#if defined(MANTICORE_LATENCY)
+#define THREAD_LATENCY_PRIORITY 3
+static bool boot_latency(void);
+#endif
+#if defined(MANTICORE_TRACE)
+static bool boot_trace(void);
+#endif
 
 // Serial Console Testing
 extern UART_HandleTypeDef ConsoleUart;
 
 int main(void)
 {
+       BootMark(BOOT_PHASE_MAIN);
        tx_kernel_enter();
    }
 
@@ -58,15 +82,31 @@ void tx_application_define(void *first_unused_memory)
 
 void thread_main(ULONG ctx)
 {
-    bool heartbeatFlagPrevious = false;
+    bool heartbeatFlagPrevious = heartbeatFlag;
+
+    BootMark(BOOT_PHASE_KERNEL);
 
     // Init BSP
     BSP_Init();
 
-    // Init App Layer
+    // Init App Layer, only what the heartbeat and the RPC server need
     MCAN_Init( FDCAN1, DEV_ALL, MCAN_ENABLE);
+    BootMark(BOOT_PHASE_MCAN);
+    McanRpcInit();
+    McanRpcRegister(RPC_METHOD_HEARTBEAT, rpc_heartbeat);
+    MCAN_EnableHeartBeats(HEARTBEAT_DELAY_MS, heartbeatData);
 
-    ConsoleInit(&ConsoleUart);
+    // Everything else comes up behind the heartbeat
+    BootDefer("sysmon", boot_sysmon);
+#if defined(MANTICORE_LATENCY)
+    BootDefer("latency", boot_latency);
+#endif
+    BootDefer("console", boot_console);
+    BootDefer("telemetry", boot_telemetry);
+#if defined(MANTICORE_TRACE)
+    BootDefer("trace", boot_trace);
+#endif
+    BootStartDeferred(THREAD_BOOT_PRIORITY);
     
     while( true )
     {
@@ -100,10 +140,54 @@ void thread_blink(ULONG ctx)
     }
 }
 
-void MCAN_Rx_Handler( sMCAN_Message mcanRxMessage )
+static bool boot_sysmon(void)
+{
+    return SysmonInit();
+}
+
+#if defined(MANTICORE_LATENCY)
+// Timer source on TIM6, the BSP has clocked it and set its priority
+static bool boot_latency(void)
 {
-    if ( mcanRxMessage.mcanID.MCAN_RX_Device == DEV_DEBUG )
+    return LatencyInit(TIM6, THREAD_LATENCY_PRIORITY);
+}
+#endif
+
+// Console reports the boot so far, "boot" shows it again once every stage is done
+static bool boot_console(void)
+{
+    static char report[BOOT_REPORT_SIZE];
+
+    ConsoleInit(&ConsoleUart);
+    return ConsoleWrite(report, BootFormatReport(report, sizeof(report), false));
+}
+
+// Shares the console UART, so it follows the console stage
+static bool boot_telemetry(void)
+{
+    return TelemetryInit();
+}
+
+#if defined(MANTICORE_TRACE)
+// The BSP only brings up the ST-LINK VCP UART, so trace shares it with the console.
+// Console text is dropped while a trace packet is on the wire, "trace stop" before reading it.
+static bool boot_trace(void)
+{
+    return TraceInit(&ConsoleUart);
+}
+#endif
+
+// Heartbeat enable, replies with the state it was in
+static MCAN_RPC_STATUS rpc_heartbeat(MCAN_DEV caller, const uint8_t req[], uint8_t reqLen, uint8_t resp[], uint8_t *respLen)
+{
+    if ( reqLen != 1 )
     {
-        heartbeatFlag = (bool) mcanRxMessage.mcanData[0];
-    } 
-}
\ No newline at end of file
+        return MCAN_RPC_BAD_REQUEST;
+    }
+
+    resp[0] = (uint8_t) heartbeatFlag;
+    *respLen = 1;
+    heartbeatFlag = (bool) req[0];
+
+    return MCAN_RPC_OK;
+}
@@ -1,30 +1,73 @@
 #include "bsp_nucleo_h563.h"
 #include "utility.h"
+#include "boot.h"
 
+static void _BSP_CacheInit(void);
 static void _BSP_SystemClockConfig(void);
 static inline void _BSP_PeriphInit(void);
 static void _BSP_ErrorHandler(void);
 static void _BSP_GPIO_Init(void);
 static void _BSP_FDCAN_Init(void);
+#if defined(MANTICORE_LATENCY)
+static void _BSP_LatencyTimerInit(void);
+#endif
+
+// VOSRDY takes a few microseconds, give up long before the watchdog would
+static const uint32_t BSP_VOS_TIMEOUT_SPINS = 100000;
 
 void BSP_Init(void)
 {
     HAL_Init();
+    BootMark(BOOT_PHASE_HAL);
+    _BSP_CacheInit();
     _BSP_SystemClockConfig();
+    BootMark(BOOT_PHASE_CLOCK);
     _BSP_PeriphInit();
+    BootMark(BOOT_PHASE_BSP);
+}
+
+// Flash runs with 5 wait states at 250 MHz, the cache hides them for code and constants
+static void _BSP_CacheInit(void)
+{
+    static DCACHE_HandleTypeDef hdcache = {0};
+
+    // Internal flash needs no remap region, those map external memory
+    if (HAL_ICACHE_ConfigAssociativityMode(ICACHE_2WAYS) != HAL_OK)
+    {
+        _BSP_ErrorHandler();
+    }
+
+    if (HAL_ICACHE_Enable() != HAL_OK)
+    {
+        _BSP_ErrorHandler();
+    }
+
+    // DCACHE1 only serves the FMC and OCTOSPI ranges, SRAM is never cached
+    __HAL_RCC_DCACHE1_CLK_ENABLE();
+    hdcache.Instance = DCACHE1;
+    hdcache.Init.ReadBurstType = DCACHE_READ_BURST_WRAP;
+
+    if (HAL_DCACHE_Init(&hdcache) != HAL_OK)
+    {
+        _BSP_ErrorHandler();
+    }
 }
 
 static void _BSP_SystemClockConfig(void)
 {
     RCC_OscInitTypeDef RCC_OscInitStruct = {0};
     RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+    uint32_t spins = 0;
 
     // Configure the main internal regulator output voltage
     __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE0);
 
     while( !__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY) ) 
     {
-        // NOP
+        if (++spins > BSP_VOS_TIMEOUT_SPINS)
+        {
+            _BSP_ErrorHandler();
+        }
     }
 
     // Initializes the RCC Oscillators according to the specified parameters in the RCC_OscInitTypeDef structure.
@@ -67,6 +110,9 @@ static inline void _BSP_PeriphInit(void)
 {
     _BSP_GPIO_Init();
     _BSP_FDCAN_Init();
+#if defined(MANTICORE_LATENCY)
+    _BSP_LatencyTimerInit();
+#endif
 }
 
 static void _BSP_GPIO_Init(void)
@@ -142,6 +188,16 @@ static void _BSP_FDCAN_Init(void)
 #endif 
 }
 
+#if defined(MANTICORE_LATENCY)
+// TIM6 is the latency harness timer source, latency.c owns its configuration. Same priority as FDCAN.
+static void _BSP_LatencyTimerInit(void)
+{
+    __HAL_RCC_TIM6_CLK_ENABLE();
+    HAL_NVIC_SetPriority(TIM6_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(TIM6_IRQn);
+}
+#endif
+
 static void _BSP_ErrorHandler(void)
 {
     __disable_irq();
@@ -12,6 +12,7 @@ void PendSV_Handler(void);
 void SysTick_Handler(void);
 void FDCAN1_IT0_IRQHandler(void);
 void FDCAN2_IT0_IRQHandler(void);
+void TIM6_IRQHandler(void);
 void _tx_timer_interrupt(void);
 
 #endif /* __STM32H5xx_IT_H */
\ No newline at end of file
@@ -2,23 +2,32 @@
 #include "tx_api.h"
 #include "mcan.h"
 #include "bno055.h"
+#include "boot.h"
+#include "latency.h"
 
 // Main Thread
 #define THREAD_MAIN_STACK_SIZE 512
 static TX_THREAD stThreadMain;
 static uint8_t auThreadMainStack[THREAD_MAIN_STACK_SIZE];
 
-static bool heartbeatFlag = false;
+#if defined(MANTICORE_LATENCY)
+#define THREAD_LATENCY_PRIORITY 3
+#endif
+
+static bool heartbeatFlag = true;
 static uint8_t heartbeatData[] = { 0xDE, 0xCA, 0XF, 0xC0, 0xFF, 0xEE, 0xCA, 0xFE};
 
 void thread_main(ULONG ctx);
 
 int main(void)
 {
+    BootMark(BOOT_PHASE_MAIN);
+
     /* Initialize BSP */
     BSP_Init();
 
     MCAN_Init( FDCAN2, DEV_COMPUTE, MCAN_ENABLE );
+    BootMark(BOOT_PHASE_MCAN);
 
     tx_kernel_enter();
    }
@@ -40,7 +49,17 @@ void tx_application_define(void *first_unused_memory)
 
 void thread_main(ULONG ctx)
 {
-    bool heartbeatFlagPrevious = false;
+    bool heartbeatFlagPrevious = heartbeatFlag;
+
+    BootMark(BOOT_PHASE_KERNEL);
+
+    // Heartbeat before anything slower comes up
+    MCAN_EnableHeartBeats(1000, heartbeatData);
+
+#if defined(MANTICORE_LATENCY)
+    // Timer source on TIM6, the BSP has clocked it and set its priority
+    LatencyInit(TIM6, THREAD_LATENCY_PRIORITY);
+#endif
 
     while( true )
     {
@@ -0,0 +1,218 @@
+#include <stdint.h>
+
+#include "ahrs.h"
+#include "bno055.h"
+
+// Static Variables
+static bool _ahrsCreated = false;
+static volatile bool _ahrsRunning = false;
+static BNO055_Dev_t *_ahrsDev;
+static TX_SEMAPHORE _ahrsTrigger;
+static TX_TIMER _ahrsTimer;
+static sAhrsFilter _ahrsFilter;
+static uint32_t _ahrsOutputDivider = 1;
+static sAhrsOutput _ahrsOutput;
+static volatile sAhrsStats _ahrsStats;
+
+// AHRS Thread
+#define THREAD_AHRS_STACK_SIZE 1024
+static TX_THREAD stThreadAhrs;
+static uint8_t auThreadAhrsStack[THREAD_AHRS_STACK_SIZE];
+static void thread_ahrs(ULONG ctx);
+
+// Static Function Declarations
+static void _ahrsCreate(void);
+static void _ahrsTimerExpired(ULONG ctx);
+static void _ahrsPublish(ULONG timestamp);
+
+
+// Static Function Definitions
+static void _ahrsCreate(void)
+{
+    if(_ahrsCreated)
+    {
+        return;
+    }
+
+    tx_semaphore_create(&_ahrsTrigger, "ahrs_trigger", 0);
+    tx_timer_create(&_ahrsTimer, "ahrs_timer", _ahrsTimerExpired, 0,
+                    AHRS_DEFAULT_SAMPLE_MS, AHRS_DEFAULT_SAMPLE_MS, TX_NO_ACTIVATE);
+
+    tx_thread_create( &stThreadAhrs,
+        "thread_ahrs",
+        thread_ahrs,
+        0,
+        auThreadAhrsStack,
+        THREAD_AHRS_STACK_SIZE,
+        AHRS_THREAD_PRIORITY,
+        AHRS_THREAD_PRIORITY,
+        0,
+        TX_AUTO_START);
+
+    _ahrsCreated = true;
+}
+
+static void _ahrsTimerExpired(ULONG ctx)
+{
+    if(!_ahrsRunning)
+    {
+        return;
+    }
+
+    if(tx_semaphore_ceiling_put(&_ahrsTrigger, 1) != TX_SUCCESS)
+    {
+        _ahrsStats.triggersDropped++;
+    }
+}
+
+static void _ahrsPublish(ULONG timestamp)
+{
+    TX_INTERRUPT_SAVE_AREA
+    sAhrsEuler euler;
+    uint32_t start;
+
+    start = DWT->CYCCNT;
+    AhrsQuatToEuler(&_ahrsFilter.q, &euler);
+    _ahrsStats.eulerCycles = DWT->CYCCNT - start;
+
+    // Small enough to copy with interrupts off, readers never see a torn sample
+    TX_DISABLE
+    _ahrsOutput.q = _ahrsFilter.q;
+    _ahrsOutput.euler = euler;
+    _ahrsOutput.sequence++;
+    _ahrsOutput.timestamp = timestamp;
+    TX_RESTORE
+}
+
+
+// Public Functions
+bool AhrsStart(BNO055_Dev_t *dev, uint32_t sample_MS, uint32_t output_MS)
+{
+    AhrsStop();
+    _ahrsCreate();
+
+    if(sample_MS == 0)
+    {
+        sample_MS = AHRS_DEFAULT_SAMPLE_MS;
+    }
+    if(output_MS < sample_MS)
+    {
+        output_MS = sample_MS;
+    }
+    _ahrsDev = dev;
+
+    // Fusion off, sensors at bandwidths above the sample rate
+    if(BNO055_Set_Sensor_Config(dev, BNO055_ACC_RANGE_4G | BNO055_ACC_BW_250HZ,
+                                BNO055_GYRO_RANGE_2000DPS | BNO055_GYRO_BW_523HZ) != BNO055_SUCCESS)
+    {
+        return false;
+    }
+    if(BNO055_Set_OP_Mode(dev, AMG) != BNO055_SUCCESS)
+    {
+        return false;
+    }
+
+    // Filter steps are timed on the DWT cycle counter
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if defined(MANTICORE_AHRS_CORDIC) && defined(CORDIC)
+    __HAL_RCC_CORDIC_CLK_ENABLE();
+#endif
+
+    AhrsFilterInit(&_ahrsFilter, _ahrsFilter.beta > 0.0f ? _ahrsFilter.beta : AHRS_DEFAULT_BETA,
+                   (float) sample_MS / 1000.0f);
+    _ahrsOutputDivider = output_MS / sample_MS;
+    _ahrsRunning = true;
+
+    tx_timer_change(&_ahrsTimer, sample_MS, sample_MS);
+    return tx_timer_activate(&_ahrsTimer) == TX_SUCCESS;
+}
+
+void AhrsStop(void)
+{
+    _ahrsRunning = false;
+
+    if(_ahrsCreated)
+    {
+        tx_timer_deactivate(&_ahrsTimer);
+    }
+}
+
+// Takes effect on the next filter step
+void AhrsSetGain(float beta)
+{
+    _ahrsFilter.beta = beta;
+}
+
+bool AhrsGetLatest(sAhrsOutput *output)
+{
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    *output = _ahrsOutput;
+    TX_RESTORE
+
+    return output->sequence != 0;
+}
+
+void AhrsGetStats(sAhrsStats *stats)
+{
+    stats->updates         = _ahrsStats.updates;
+    stats->readErrors      = _ahrsStats.readErrors;
+    stats->triggersDropped = _ahrsStats.triggersDropped;
+    stats->updateCycles    = _ahrsStats.updateCycles;
+    stats->updateCyclesMax = _ahrsStats.updateCyclesMax;
+    stats->eulerCycles     = _ahrsStats.eulerCycles;
+}
+
+
+// Threads
+static void thread_ahrs(ULONG ctx)
+{
+    BNO055_Raw_AMG_t raw;
+    float gyro[3], accel[3], mag[3];
+    uint32_t start, cycles;
+    uint32_t steps = 0;
+    ULONG timestamp;
+
+    while(true)
+    {
+        tx_semaphore_get(&_ahrsTrigger, TX_WAIT_FOREVER);
+        timestamp = tx_time_get();
+
+        if(BNO055_Get_Raw_AMG(_ahrsDev, &raw) != BNO055_SUCCESS)
+        {
+            _ahrsStats.readErrors++;
+            continue;
+        }
+
+        // Accel and mag are normalised by the filter, raw LSBs need no scaling
+        accel[0] = raw.accel.x;
+        accel[1] = raw.accel.y;
+        accel[2] = raw.accel.z;
+        mag[0] = raw.mag.x;
+        mag[1] = raw.mag.y;
+        mag[2] = raw.mag.z;
+        gyro[0] = raw.gyro.x * AHRS_GYRO_RAD_PER_LSB;
+        gyro[1] = raw.gyro.y * AHRS_GYRO_RAD_PER_LSB;
+        gyro[2] = raw.gyro.z * AHRS_GYRO_RAD_PER_LSB;
+
+        start = DWT->CYCCNT;
+        AhrsFilterUpdate(&_ahrsFilter, gyro, accel, mag);
+        cycles = DWT->CYCCNT - start;
+
+        _ahrsStats.updates++;
+        _ahrsStats.updateCycles = cycles;
+        if(cycles > _ahrsStats.updateCyclesMax)
+        {
+            _ahrsStats.updateCyclesMax = cycles;
+        }
+
+        if(++steps >= _ahrsOutputDivider)
+        {
+            steps = 0;
+            _ahrsPublish(timestamp);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef __AHRS_H
+#define __AHRS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+#include "bno055.h"
+#include "ahrs_filter.h"
+
+/*********************************************************************************
+    Software AHRS on raw BNO055 data.
+
+    The BNO055 runs in AMG mode with its own fusion off; a service thread reads
+    raw accel, mag and gyro on every timer tick and runs the Madgwick filter in
+    ahrs_filter.c at that rate, bypassing the 100 Hz limit of the NDOF output.
+    Euler angles are only computed at the output rate, so the trig cost is paid
+    per published sample rather than per filter step.
+
+    The sampler owns its BNO055 while running, do not run it with the IMU
+    sampler on the same device. Each filter step is timed with the DWT cycle
+    counter and the figures are reported by AhrsGetStats.
+***********************************************************************************/
+
+#define AHRS_DEFAULT_SAMPLE_MS    2       // Gyro at 523 Hz bandwidth, accel at 250 Hz
+#define AHRS_DEFAULT_OUTPUT_MS    10
+#ifndef AHRS_THREAD_PRIORITY
+#define AHRS_THREAD_PRIORITY      8
+#endif
+
+typedef struct
+{
+    sAhrsQuat q;
+    sAhrsEuler euler;
+    uint32_t sequence;              // Output number, 1 for the first output
+    ULONG timestamp;                // Tick of the filter step that produced it
+} sAhrsOutput;
+
+typedef struct
+{
+    uint32_t updates;               // Filter steps run
+    uint32_t readErrors;            // Raw reads that failed, the step is skipped
+    uint32_t triggersDropped;       // Ticks that arrived while a step was in flight
+    uint32_t updateCycles;          // Last filter step
+    uint32_t updateCyclesMax;
+    uint32_t eulerCycles;           // Last quaternion to Euler conversion
+} sAhrsStats;
+
+// Start after BNO055_Mount and BNO055_Init. Switches dev to AMG with fast sensor bandwidths.
+bool AhrsStart(BNO055_Dev_t *dev, uint32_t sample_MS, uint32_t output_MS);
+void AhrsStop(void);
+void AhrsSetGain(float beta);
+
+// Returns false until the first output is published
+bool AhrsGetLatest(sAhrsOutput *output);
+void AhrsGetStats(sAhrsStats *stats);
+
+#endif /* __AHRS_H */
@@ -0,0 +1,170 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "ahrs_filter.h"
+
+// The H503 has no CORDIC, builds for it keep the libm path
+#if defined(MANTICORE_AHRS_CORDIC)
+#include "stm32h5xx_hal.h"
+#include "stm32h5xx_ll_cordic.h"
+#if defined(CORDIC)
+#define AHRS_CORDIC
+#endif
+#endif
+
+// Static Function Declarations
+static inline float _invNorm(float sumSquares);
+#if defined(AHRS_CORDIC)
+static inline float _cordicAtan2(float y, float x);
+#endif
+
+
+// Static Function Definitions
+// VSQRT and VDIV are both correctly rounded, unlike the bit-trick inverse square root
+static inline float _invNorm(float sumSquares)
+{
+    return 1.0f / sqrtf(sumSquares);
+}
+
+#if defined(AHRS_CORDIC)
+// PHASE takes x then y in q1.31 and returns atan2(y, x) / pi. Arguments are
+// halved so the modulus of any unit vector stays in range.
+static inline float _cordicAtan2(float y, float x)
+{
+    LL_CORDIC_WriteData(CORDIC, (uint32_t) (int32_t) (x * 1073741824.0f));
+    LL_CORDIC_WriteData(CORDIC, (uint32_t) (int32_t) (y * 1073741824.0f));
+    return (float) (int32_t) LL_CORDIC_ReadData(CORDIC) * (3.14159265f / 2147483648.0f);
+}
+#endif
+
+
+// Public Functions
+void AhrsFilterInit(sAhrsFilter *filter, float beta, float dt)
+{
+    filter->q.w = 1.0f;
+    filter->q.x = 0.0f;
+    filter->q.y = 0.0f;
+    filter->q.z = 0.0f;
+    filter->beta = beta;
+    filter->dt = dt;
+}
+
+void AhrsFilterUpdate(sAhrsFilter *filter, const float gyro[3], const float accel[3], const float mag[3])
+{
+    float q0 = filter->q.w, q1 = filter->q.x, q2 = filter->q.y, q3 = filter->q.z;
+    float ax = accel[0], ay = accel[1], az = accel[2];
+    float qDot0, qDot1, qDot2, qDot3;
+    float s0, s1, s2, s3;
+    float norm;
+
+    // Rate of change from the gyro
+    qDot0 = 0.5f * (-q1 * gyro[0] - q2 * gyro[1] - q3 * gyro[2]);
+    qDot1 = 0.5f * ( q0 * gyro[0] + q2 * gyro[2] - q3 * gyro[1]);
+    qDot2 = 0.5f * ( q0 * gyro[1] - q1 * gyro[2] + q3 * gyro[0]);
+    qDot3 = 0.5f * ( q0 * gyro[2] + q1 * gyro[1] - q2 * gyro[0]);
+
+    // Free fall or a dropped sample, integrate the gyro alone
+    if(ax != 0.0f || ay != 0.0f || az != 0.0f)
+    {
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+        float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+        float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+        float fa1, fa2, fa3;
+
+        norm = _invNorm(ax * ax + ay * ay + az * az);
+        ax *= norm;
+        ay *= norm;
+        az *= norm;
+
+        // Gravity residuals, each appears in several gradient terms so they are formed once
+        fa1 = 2.0f * (q1q3 - q0q2) - ax;
+        fa2 = 2.0f * (q0q1 + q2q3) - ay;
+        fa3 = 1.0f - 2.0f * (q1q1 + q2q2) - az;
+
+        s0 = -_2q2 * fa1 + _2q1 * fa2;
+        s1 =  _2q3 * fa1 + _2q0 * fa2 - 4.0f * q1 * fa3;
+        s2 = -_2q0 * fa1 + _2q3 * fa2 - 4.0f * q2 * fa3;
+        s3 =  _2q1 * fa1 + _2q2 * fa2;
+
+        if(mag != NULL && (mag[0] != 0.0f || mag[1] != 0.0f || mag[2] != 0.0f))
+        {
+            float mx = mag[0], my = mag[1], mz = mag[2];
+            float q0q0 = q0 * q0;
+            float hx, hy, _2bx, _2bz, _4bx, _4bz;
+            float fm1, fm2, fm3;
+
+            norm = _invNorm(mx * mx + my * my + mz * mz);
+            mx *= norm;
+            my *= norm;
+            mz *= norm;
+
+            // Earth field direction, rotated into the x-z plane
+            hx = mx * (q0q0 + q1q1 - q2q2 - q3q3) + 2.0f * my * (q1q2 - q0q3) + 2.0f * mz * (q0q2 + q1q3);
+            hy = 2.0f * mx * (q0q3 + q1q2) + my * (q0q0 - q1q1 + q2q2 - q3q3) + 2.0f * mz * (q2q3 - q0q1);
+            _2bx = sqrtf(hx * hx + hy * hy);
+            _2bz = 2.0f * mx * (q1q3 - q0q2) + 2.0f * my * (q0q1 + q2q3) + mz * (q0q0 - q1q1 - q2q2 + q3q3);
+            _4bx = 2.0f * _2bx;
+            _4bz = 2.0f * _2bz;
+
+            fm1 = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+            fm2 = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+            fm3 = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+            s0 += -_2bz * q2 * fm1 + (-_2bx * q3 + _2bz * q1) * fm2 + _2bx * q2 * fm3;
+            s1 +=  _2bz * q3 * fm1 + ( _2bx * q2 + _2bz * q0) * fm2 + (_2bx * q3 - _4bz * q1) * fm3;
+            s2 += (-_4bx * q2 - _2bz * q0) * fm1 + (_2bx * q1 + _2bz * q3) * fm2 + (_2bx * q0 - _4bz * q2) * fm3;
+            s3 += (-_4bx * q3 + _2bz * q1) * fm1 + (-_2bx * q0 + _2bz * q2) * fm2 + _2bx * q1 * fm3;
+        }
+
+        // Gradient step, skipped at the exact optimum where the gradient vanishes
+        norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if(norm > 0.0f)
+        {
+            norm = filter->beta * _invNorm(norm);
+            qDot0 -= norm * s0;
+            qDot1 -= norm * s1;
+            qDot2 -= norm * s2;
+            qDot3 -= norm * s3;
+        }
+    }
+
+    q0 += qDot0 * filter->dt;
+    q1 += qDot1 * filter->dt;
+    q2 += qDot2 * filter->dt;
+    q3 += qDot3 * filter->dt;
+
+    norm = _invNorm(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    filter->q.w = q0 * norm;
+    filter->q.x = q1 * norm;
+    filter->q.y = q2 * norm;
+    filter->q.z = q3 * norm;
+}
+
+void AhrsQuatToEuler(const sAhrsQuat *q, sAhrsEuler *euler)
+{
+    float sinPitch = 2.0f * (q->w * q->y - q->z * q->x);
+
+    // Rounding can push the sine just past one at +-90 degrees pitch
+    if(sinPitch > 1.0f)
+    {
+        sinPitch = 1.0f;
+    }
+    else if(sinPitch < -1.0f)
+    {
+        sinPitch = -1.0f;
+    }
+
+#if defined(AHRS_CORDIC)
+    LL_CORDIC_Config(CORDIC, LL_CORDIC_FUNCTION_PHASE, LL_CORDIC_PRECISION_6CYCLES, LL_CORDIC_SCALE_0,
+                     LL_CORDIC_NBWRITE_2, LL_CORDIC_NBREAD_1, LL_CORDIC_INSIZE_32BITS, LL_CORDIC_OUTSIZE_32BITS);
+
+    euler->roll  = _cordicAtan2(2.0f * (q->w * q->x + q->y * q->z), 1.0f - 2.0f * (q->x * q->x + q->y * q->y));
+    euler->pitch = _cordicAtan2(sinPitch, sqrtf(1.0f - sinPitch * sinPitch));
+    euler->yaw   = _cordicAtan2(2.0f * (q->w * q->z + q->x * q->y), 1.0f - 2.0f * (q->y * q->y + q->z * q->z));
+#else
+    euler->roll  = atan2f(2.0f * (q->w * q->x + q->y * q->z), 1.0f - 2.0f * (q->x * q->x + q->y * q->y));
+    euler->pitch = asinf(sinPitch);
+    euler->yaw   = atan2f(2.0f * (q->w * q->z + q->x * q->y), 1.0f - 2.0f * (q->y * q->y + q->z * q->z));
+#endif
+}
@@ -0,0 +1,58 @@
+#ifndef __AHRS_FILTER_H
+#define __AHRS_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+    Madgwick gradient descent AHRS.
+
+    Pure single precision C with no HAL or RTOS dependency, so the same file
+    builds for the target and for a host replay of recorded raw samples. The
+    update uses only + - * / and sqrtf, all correctly rounded IEEE operations,
+    so the quaternion state matches bit for bit between target and host as
+    long as both build without FMA contraction (-ffp-contract=off, set by the
+    AHRS library) and without -ffast-math.
+
+    Accel and mag are normalised inside the update, so they may be fed in any
+    consistent unit, raw BNO055 LSBs included. Only the gyro needs rad/s.
+
+    Euler angles are derived on demand. With MANTICORE_AHRS_CORDIC on parts
+    that have the coprocessor (H563, not H503) the three arctangents run on
+    CORDIC instead of libm; that path is target only and not bit exact with
+    the host. Normalisation stays on VSQRT, which beats a CORDIC round trip.
+***********************************************************************************/
+
+#define AHRS_DEFAULT_BETA        0.1f
+#define AHRS_GYRO_RAD_PER_LSB    (3.14159265f / 180.0f / 16.0f)     // Raw BNO055 gyro, 16 LSB per dps
+
+typedef struct
+{
+    float w;
+    float x;
+    float y;
+    float z;
+} sAhrsQuat;
+
+typedef struct
+{
+    float roll;                     // rad, about x
+    float pitch;                    // rad, about y
+    float yaw;                      // rad, about z
+} sAhrsEuler;
+
+typedef struct
+{
+    sAhrsQuat q;
+    float beta;                     // Gradient step gain, higher trusts accel/mag more
+    float dt;                       // Sample period in seconds
+} sAhrsFilter;
+
+void AhrsFilterInit(sAhrsFilter *filter, float beta, float dt);
+
+// gyro in rad/s. mag may be NULL, or all zero when no new reading, for a 6 axis update
+void AhrsFilterUpdate(sAhrsFilter *filter, const float gyro[3], const float accel[3], const float mag[3]);
+
+void AhrsQuatToEuler(const sAhrsQuat *q, sAhrsEuler *euler);
+
+#endif /* __AHRS_FILTER_H */
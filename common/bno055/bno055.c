@@ -5,36 +5,161 @@
  *      Author: baske
  */
 
+#include <string.h>
+
 #include "bno055.h"
 #include "bno055_regs.h"
+#include "bno055_flash.h"
+#include "fixmath.h"
+#include "prof.h"
 
-I2C_HandleTypeDef* BNO055_I2C;
+_Static_assert(BNO055_SNAPSHOT_LEN <= BNO055_READ_BUF_LEN, "Snapshot does not fit the device read buffer");
 
-typedef struct{
+/* Mounted buses, the HAL callbacks find the bus of a finished read here */
+static BNO055_Bus_t* busList = NULL;
+static uint8_t busCount = 0;
 
-	BNO055_OPERATION_MODE currentMode;
-	uint8_t currentPage;
+/* Calibration records of all devices share the NVDATA sector */
+static TX_MUTEX flashLock;
 
-} BNO055_STATE;
+static void BNO055_Bus_Cancel(BNO055_Bus_t* bus, BNO055_Dev_t* dev);
+static void BNO055_Bus_Aborted(BNO055_Bus_t* bus);
 
-BNO055_STATE state;
+/*
+ * Take the bus for a blocking register access. Burst reads already queued finish
+ * first, and none can queue while the lock is held
+ */
+static void BNO055_Bus_Acquire(BNO055_Bus_t* bus){
+
+	TX_INTERRUPT_SAVE_AREA
+	BNO055_Dev_t* active;
+	uint8_t aborting;
+
+	tx_mutex_get(&bus->lock, TX_WAIT_FOREVER);
+
+	while(1){
+		TX_DISABLE
+		active = bus->active;
+		aborting = bus->aborting;
+		bus->idleWaiting = (active != NULL || aborting);
+		TX_RESTORE
+
+		if(active == NULL && !aborting)
+			return;
+
+		/* A read that outlives the timeout is stuck, drop it. An abort that never completes is given up */
+		if(tx_semaphore_get(&bus->idle, BNO055_READ_TIMEOUT) != TX_SUCCESS){
+			if(active != NULL)
+				BNO055_Bus_Cancel(bus, active);
+			else
+				BNO055_Bus_Aborted(bus);
+		}
+	}
+}
 
-#ifdef BNO055_HARDWARE_RESET
+static inline void BNO055_Bus_Release(BNO055_Bus_t* bus){
+	tx_mutex_put(&bus->lock);
+}
 
-uint32_t Reset_Port = 0;
-uint16_t Reset_Pin = 0;
+/*
+ * Start the oldest queued burst read. Runs with interrupts disabled or from the
+ * completion interrupt, a read the HAL refuses fails and the next one is tried
+ */
+static void BNO055_Bus_Next(BNO055_Bus_t* bus){
 
-#endif
+	BNO055_Dev_t* dev;
+	HAL_StatusTypeDef error;
+
+	while((dev = bus->pending) != NULL){
+		bus->pending = dev->nextPending;
+		if(bus->pending == NULL)
+			bus->pendingTail = NULL;
+		bus->active = dev;
+
+		/* One transaction, DMA when the handle has a RX channel */
+		if(bus->i2c->hdmarx != NULL)
+			error = HAL_I2C_Mem_Read_DMA(bus->i2c, dev->addr<<1, BNO055_SNAPSHOT_START, I2C_MEMADD_SIZE_8BIT, dev->readBuf, dev->readLen);
+		else
+			error = HAL_I2C_Mem_Read_IT(bus->i2c, dev->addr<<1, BNO055_SNAPSHOT_START, I2C_MEMADD_SIZE_8BIT, dev->readBuf, dev->readLen);
+
+		if(error == HAL_OK)
+			return;
+
+		bus->active = NULL;
+		dev->readStatus = error;
+		tx_semaphore_put(&dev->readDone);
+	}
+
+	bus->active = NULL;
+
+	if(bus->idleWaiting){
+		bus->idleWaiting = 0;
+		tx_semaphore_put(&bus->idle);
+	}
+}
+
+/*
+ * Take a read that timed out off the bus or out of the queue
+ */
+static void BNO055_Bus_Cancel(BNO055_Bus_t* bus, BNO055_Dev_t* dev){
+
+	TX_INTERRUPT_SAVE_AREA
+	BNO055_Dev_t* prev = NULL;
+	BNO055_Dev_t* cursor;
+
+	TX_DISABLE
+
+	/* The handle stays in the abort state until its callback, the next read starts from there */
+	if(bus->active == dev){
+		bus->active = NULL;
+		bus->aborting = 1;
+		if(HAL_I2C_Master_Abort_IT(bus->i2c, dev->addr<<1) != HAL_OK)
+			BNO055_Bus_Aborted(bus);
+	}
+	else{
+		for(cursor = bus->pending; cursor != NULL; prev = cursor, cursor = cursor->nextPending){
+			if(cursor != dev)
+				continue;
+			if(prev == NULL)
+				bus->pending = dev->nextPending;
+			else
+				prev->nextPending = dev->nextPending;
+			if(bus->pendingTail == dev)
+				bus->pendingTail = prev;
+			break;
+		}
+	}
+
+	TX_RESTORE
+}
+
+/*
+ * The abort of a cancelled read completed, or was refused because the transfer had ended
+ */
+static void BNO055_Bus_Aborted(BNO055_Bus_t* bus){
+
+	TX_INTERRUPT_SAVE_AREA
+
+	TX_DISABLE
+	if(bus->aborting){
+		bus->aborting = 0;
+		BNO055_Bus_Next(bus);
+	}
+	TX_RESTORE
+}
 
 /*
  * Local Read Function to BNO055
  */
-static inline HAL_StatusTypeDef BNO055_Read(uint8_t reg, uint8_t* buf, uint8_t len){
+static inline HAL_StatusTypeDef BNO055_Read(BNO055_Dev_t* dev, uint8_t reg, uint8_t* buf, uint8_t len){
 
+	PROF_SCOPE(PROF_BNO055_READ);
 	HAL_StatusTypeDef error;
 
-	error = HAL_I2C_Master_Transmit(BNO055_I2C, BNO055_I2C_ADDR<<1, &reg, 1, BNO055_WRITE_TIMEOUT);
-	error |= HAL_I2C_Master_Receive(BNO055_I2C, BNO055_I2C_ADDR<<1, buf, len, BNO055_READ_TIMEOUT);
+	BNO055_Bus_Acquire(dev->bus);
+	error = HAL_I2C_Master_Transmit(dev->bus->i2c, dev->addr<<1, &reg, 1, BNO055_WRITE_TIMEOUT);
+	error |= HAL_I2C_Master_Receive(dev->bus->i2c, dev->addr<<1, buf, len, BNO055_READ_TIMEOUT);
+	BNO055_Bus_Release(dev->bus);
 
 	return error;
 
@@ -43,375 +168,915 @@ static inline HAL_StatusTypeDef BNO055_Read(uint8_t reg, uint8_t* buf, uint8_t l
 /*
  * Local Write Function to BNO055
  */
-static inline HAL_StatusTypeDef BNO055_Write(uint8_t reg, uint8_t data){
+static inline HAL_StatusTypeDef BNO055_Write(BNO055_Dev_t* dev, uint8_t reg, uint8_t data){
 
 	HAL_StatusTypeDef error;
 	uint8_t transmitBuf[2] = {reg, data};
 
-	error = HAL_I2C_Master_Transmit(BNO055_I2C, BNO055_I2C_ADDR<<1, transmitBuf, sizeof(transmitBuf), BNO055_WRITE_TIMEOUT);
+	BNO055_Bus_Acquire(dev->bus);
+	error = HAL_I2C_Master_Transmit(dev->bus->i2c, dev->addr<<1, transmitBuf, sizeof(transmitBuf), BNO055_WRITE_TIMEOUT);
+	BNO055_Bus_Release(dev->bus);
 
 	return error;
 
 }
 
 /*
- * Simple Error Check Function
+ * Local Burst Write Function to BNO055
  */
-static inline void BNO055_ERROR_HANDLE(HAL_StatusTypeDef error){
-	if(error != HAL_OK){
-		//HAL_GPIO_WritePin(LD2_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
-		while(1);
-	}
+static inline HAL_StatusTypeDef BNO055_Write_Block(BNO055_Dev_t* dev, uint8_t reg, const uint8_t* data, uint8_t len){
+
+	HAL_StatusTypeDef error;
+	uint8_t transmitBuf[BNO055_CALIB_LEN + 1];
+
+	if(len > BNO055_CALIB_LEN)
+		return HAL_ERROR;
+
+	transmitBuf[0] = reg;
+	memcpy(&transmitBuf[1], data, len);
+
+	BNO055_Bus_Acquire(dev->bus);
+	error = HAL_I2C_Master_Transmit(dev->bus->i2c, dev->addr<<1, transmitBuf, len + 1, BNO055_WRITE_TIMEOUT);
+	BNO055_Bus_Release(dev->bus);
+
+	return error;
+
+}
+
+/*
+ * Calibration record key, stable as long as buses are mounted in the same order
+ */
+static inline uint8_t BNO055_Calib_Key(const BNO055_Dev_t* dev){
+	return (uint8_t) ((dev->bus->index << 1) | (dev->addr & 0x01U));
+}
+
+/*
+ * Yield to other threads while the sensor settles, must be called from a thread
+ */
+static inline void BNO055_Sleep(uint32_t ms){
+	tx_thread_sleep(ms);
+}
+
+/*
+ * Mode switch time from the datasheet, entering CONFIG takes longer than leaving it
+ */
+static inline uint32_t BNO055_Mode_Switch_Delay(BNO055_OPERATION_MODE newMode){
+	return (newMode == CONFIG) ? BNO055_ANY_TO_CONFIG_MS : BNO055_CONFIG_TO_ANY_MS;
+}
+
+static inline void BNO055_Init_Enter(BNO055_Dev_t* dev, BNO055_INIT_STATE newState){
+	dev->initState = newState;
+	dev->initStart = tx_time_get();
+}
+
+static inline BNO055_ERROR BNO055_Init_Fail(BNO055_Dev_t* dev, BNO055_ERROR result){
+	dev->initState = BNO055_INIT_FAILED;
+	dev->initResult = result;
+	return result;
 }
 
 /**
  * Check Current Mode and Page 
  * Set Current Mode and Page to new mode and poge
- * Updates state struct instance
+ * Updates the device state
  */
-static inline void BNO055_STATUS_CHECK_AND_SET(BNO055_STATE* currState, BNO055_OPERATION_MODE newMode, uint8_t newPage){
+static inline BNO055_ERROR BNO055_STATUS_CHECK_AND_SET(BNO055_Dev_t* dev, BNO055_OPERATION_MODE newMode, uint8_t newPage){
 
 	HAL_StatusTypeDef error;
 
 	/* Check and Set Current Mode to new Mode */
-	if(currState->currentMode != newMode){
-		error = BNO055_Write(BNO055_OPR_MODE, newMode);
-		BNO055_ERROR_HANDLE(error);
-		currState->currentMode = newMode;
-		HAL_Delay(20);
+	if(dev->currentMode != newMode){
+		error = BNO055_Write(dev, BNO055_OPR_MODE, newMode);
+		if(error != HAL_OK)
+			return BNO055_I2C_ERROR;
+		dev->currentMode = newMode;
+		BNO055_Sleep(BNO055_Mode_Switch_Delay(newMode));
 	}
 
 	/* Check and Set current page to new page */
-	if(currState->currentPage != newPage){
-		error = BNO055_Write(BNO055_PAGE_ID, newPage);
-		BNO055_ERROR_HANDLE(error);
-		currState->currentPage = newPage;
-		HAL_Delay(20);
+	if(dev->currentPage != newPage){
+		error = BNO055_Write(dev, BNO055_PAGE_ID, newPage);
+		if(error != HAL_OK)
+			return BNO055_I2C_ERROR;
+		dev->currentPage = newPage;
 	}
+
+	return BNO055_SUCCESS;
+}
+
+/*
+ * Decode little endian signed 16 bit sensor words. Scales are compile-time
+ * constants, so the reciprocal folds and each word costs one multiply.
+ */
+static inline float BNO055_Parse_Word(const uint8_t* buf, float scale){
+	return (int16_t)((buf[1]<<8) | buf[0]) * (1.0f / scale);
+}
+
+static inline void BNO055_Parse_Axis(const uint8_t* buf, float scale, BNO055_Axis_Vec_t* vec){
+	vec->x = BNO055_Parse_Word(&buf[0], scale);
+	vec->y = BNO055_Parse_Word(&buf[2], scale);
+	vec->z = BNO055_Parse_Word(&buf[4], scale);
 }
 
 /*
- * Allow User to Mount I2C Handle
+ * Allow User to Mount an I2C bus, once per bus
  */
-void BNO055_I2C_Mount(I2C_HandleTypeDef* i2c){
-	BNO055_I2C = i2c;
+void BNO055_Bus_Mount(BNO055_Bus_t* bus, I2C_HandleTypeDef* i2c){
+
+	if(busCount == 0)
+		tx_mutex_create(&flashLock, "bno055_flash", TX_INHERIT);
+
+	bus->i2c = i2c;
+	bus->index = busCount++;
+	bus->idleWaiting = 0;
+	bus->active = NULL;
+	bus->aborting = 0;
+	bus->pending = NULL;
+	bus->pendingTail = NULL;
+	tx_mutex_create(&bus->lock, "bno055_bus", TX_INHERIT);
+	tx_semaphore_create(&bus->idle, "bno055_bus_idle", 0);
+
+	bus->next = busList;
+	busList = bus;
+}
+
+/*
+ * Allow User to Mount a device on a mounted bus
+ */
+void BNO055_Mount(BNO055_Dev_t* dev, BNO055_Bus_t* bus, uint8_t addr){
+
+	dev->bus = bus;
+	dev->addr = addr;
+	dev->currentMode = CONFIG;
+	dev->currentPage = BNO055_PAGE_0;
+	dev->initState = BNO055_INIT_IDLE;
+	dev->initResult = BNO055_SUCCESS;
+	dev->initBooting = 0;
+	dev->calibRestored = 0;
+	dev->readLen = 0;
+	dev->nextPending = NULL;
+
+#ifdef BNO055_HARDWARE_RESET
+	dev->resetPort = 0;
+	dev->resetPin = 0;
+#endif
+
+	tx_semaphore_create(&dev->readDone, "bno055_read", 0);
 }
 
 #ifdef BNO055_HARDWARE_RESET
 
-void BNO055_HW_Reset_Mount(uint32_t GPIO_Port, uint16_t GPIO_Pin){
-	Reset_Port = GPIO_Port;
-	Reset_Pin = GPIO_Pin;
+void BNO055_HW_Reset_Mount(BNO055_Dev_t* dev, uint32_t GPIO_Port, uint16_t GPIO_Pin){
+	dev->resetPort = GPIO_Port;
+	dev->resetPin = GPIO_Pin;
 }
 
 #endif
 
-BNO055_ERROR BNO055_Init(void){
+BNO055_ERROR BNO055_Init_Start(BNO055_Dev_t* dev){
+
+	if(dev->bus == NULL || dev->bus->i2c == NULL)
+		return BNO055_Init_Fail(dev, BNO055_I2C_ERROR);
+
+	dev->initResult = BNO055_SUCCESS;
+	dev->initBooting = 0;
+	BNO055_Init_Enter(dev, BNO055_INIT_PROBE);
+
+	return BNO055_SUCCESS;
+}
+
+BNO055_ERROR BNO055_Init_Poll(BNO055_Dev_t* dev, uint32_t* waitMs){
 
 	HAL_StatusTypeDef error;
 	uint8_t ID_Check = 0;
+	ULONG elapsed = tx_time_get() - dev->initStart;
+
+	*waitMs = 0;
+
+	switch(dev->initState){
+
+		case BNO055_INIT_PROBE:
+		case BNO055_INIT_RESET_WAIT:
+
+			/* The chip NACKs until it has booted, keep polling the Chip ID until the deadline */
+			error = BNO055_Read(dev, BNO055_CHIP_ID, &ID_Check, 1);
+			if(error == HAL_OK && ID_Check != BNO055_EXPECTED_ID)
+				return BNO055_Init_Fail(dev, BNO055_NOT_DETECTED);
+
+			/*
+			 * A chip that NACKed the probe has just left power on reset and is in its reset state.
+			 * Only one that answered straight away, e.g. after an MCU-only reset, needs a reset of its own.
+			 */
+			if(error == HAL_OK){
+				BNO055_Init_Enter(dev, (dev->initState == BNO055_INIT_PROBE && !dev->initBooting) ? BNO055_INIT_RESET : BNO055_INIT_CONFIGURE);
+				return BNO055_BUSY;
+			}
+
+			dev->initBooting = 1;
 
-	/* Read Chip ID Register to see if BNO055 is detected*/
-	error = BNO055_Read(BNO055_CHIP_ID, &ID_Check, 1);
-	BNO055_ERROR_HANDLE(error);
-	if(ID_Check != BNO055_EXPECTED_ID)
-		return BNO055_NOT_DETECTED;
+			if(dev->initState == BNO055_INIT_PROBE && elapsed >= BNO055_BOOT_TIMEOUT_MS)
+				return BNO055_Init_Fail(dev, BNO055_NOT_DETECTED);
 
-	/* Software Reset Module */
-	error = BNO055_Write(BNO055_SYS_TRIGGER, BNO055_SYS_RESET);
-	BNO055_ERROR_HANDLE(error);
-	HAL_Delay(700);													//Necessary Delay when Soft Reset
+			if(dev->initState == BNO055_INIT_RESET_WAIT && elapsed >= BNO055_RESET_TIMEOUT_MS)
+				return BNO055_Init_Fail(dev, BNO055_TIMEOUT);
+
+			*waitMs = BNO055_POLL_MS;
+			return BNO055_BUSY;
+
+		case BNO055_INIT_RESET:
+
+		#ifdef BNO055_HARDWARE_RESET
+			/* Hardware Reset Module */
+			HAL_GPIO_WritePin((GPIO_TypeDef*) (uintptr_t) dev->resetPort, dev->resetPin, GPIO_PIN_RESET);
+			BNO055_Init_Enter(dev, BNO055_INIT_RESET_RELEASE);
+			*waitMs = BNO055_HW_RESET_PULSE_MS;
+		#else
+			/* Software Reset Module */
+			error = BNO055_Write(dev, BNO055_SYS_TRIGGER, BNO055_SYS_RESET);
+			if(error != HAL_OK)
+				return BNO055_Init_Fail(dev, BNO055_I2C_ERROR);
+			BNO055_Init_Enter(dev, BNO055_INIT_RESET_WAIT);
+			*waitMs = BNO055_RESET_MIN_MS;
+		#endif
+			return BNO055_BUSY;
 
-	/* Hardware Reset Module */
 	#ifdef BNO055_HARDWARE_RESET
-		HAL_GPIO_WritePin(Reset_Port, Reset_Pin, GPIO_PIN_RESET);
-		HAL_Delay(20);
-		HAL_GPIO_WritePin(Reset_Port, Reset_Pin, GPIO_PIN_SET);
+		case BNO055_INIT_RESET_RELEASE:
+
+			HAL_GPIO_WritePin((GPIO_TypeDef*) (uintptr_t) dev->resetPort, dev->resetPin, GPIO_PIN_SET);
+			BNO055_Init_Enter(dev, BNO055_INIT_RESET_WAIT);
+			*waitMs = BNO055_RESET_MIN_MS;
+			return BNO055_BUSY;
 	#endif
 
-	/* Set Register Page to 0 and Clear System Trigger*/
-	error = BNO055_Write(BNO055_PAGE_ID, BNO055_PAGE_0);
-	BNO055_ERROR_HANDLE(error);
-	state.currentPage = BNO055_PAGE_0;
-	HAL_Delay(20);
+		case BNO055_INIT_CONFIGURE:
 
-	/* Set BNO055 Operation Mode to CONFIG MODE*/
-	error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_CONFIG);
-	BNO055_ERROR_HANDLE(error);
-	state.currentMode = CONFIG;
+			/* Set Register Page to 0 and Clear System Trigger*/
+			error = BNO055_Write(dev, BNO055_PAGE_ID, BNO055_PAGE_0);
+			if(error != HAL_OK)
+				return BNO055_Init_Fail(dev, BNO055_I2C_ERROR);
+			dev->currentPage = BNO055_PAGE_0;
 
-	/* Necessary Delay to Set Operation Mode */
-	HAL_Delay(10);
+			/* Set BNO055 Operation Mode to CONFIG MODE*/
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_CONFIG);
+			if(error != HAL_OK)
+				return BNO055_Init_Fail(dev, BNO055_I2C_ERROR);
+			dev->currentMode = CONFIG;
 
-	return BNO055_SUCCESS;
+			BNO055_Init_Enter(dev, BNO055_INIT_SETTLE);
+			*waitMs = BNO055_ANY_TO_CONFIG_MS;
+			return BNO055_BUSY;
+
+		case BNO055_INIT_SETTLE:
+
+			/* Restore the last stored calibration profile, fusion is trustworthy almost immediately */
+			dev->calibRestored = 0;
+			{
+				uint8_t profile[BNO055_CALIB_LEN];
+				uint8_t found;
 
+				tx_mutex_get(&flashLock, TX_WAIT_FOREVER);
+				found = BNO055_Flash_Load(BNO055_Calib_Key(dev), profile);
+				tx_mutex_put(&flashLock);
+
+				if(found){
+					error = BNO055_Write_Block(dev, BNO055_CALIB_START, profile, BNO055_CALIB_LEN);
+					if(error != HAL_OK)
+						return BNO055_Init_Fail(dev, BNO055_I2C_ERROR);
+					dev->calibRestored = 1;
+				}
+			}
+
+			BNO055_Init_Enter(dev, BNO055_INIT_DONE);
+			return BNO055_SUCCESS;
+
+		case BNO055_INIT_DONE:
+			return BNO055_SUCCESS;
+
+		case BNO055_INIT_FAILED:
+			return dev->initResult;
+
+		default:
+			return BNO055_Init_Fail(dev, BNO055_NOT_DETECTED);
+	}
 }
 
-BNO055_ERROR BNO055_Set_Unit(BNO055_ACCEL_GRAV_UNIT accUnit, BNO055_ANGULAR_RATE_UNIT angRateUnit, BNO055_EULER_UNIT eulerUnit, BNO055_TEMP_UNIT tempUnit){
+BNO055_ERROR BNO055_Init(BNO055_Dev_t* dev){
+
+	BNO055_ERROR status;
+	uint32_t waitMs;
+
+	/* Run the bring-up state machine, sleeping between steps so other threads keep running */
+	status = BNO055_Init_Start(dev);
+	while(status == BNO055_SUCCESS || status == BNO055_BUSY){
+		status = BNO055_Init_Poll(dev, &waitMs);
+		if(status != BNO055_BUSY)
+			break;
+		BNO055_Sleep(waitMs);
+	}
+
+	return status;
+
+}
+
+BNO055_ERROR BNO055_Set_Unit(BNO055_Dev_t* dev, BNO055_ACCEL_GRAV_UNIT accUnit, BNO055_ANGULAR_RATE_UNIT angRateUnit, BNO055_EULER_UNIT eulerUnit, BNO055_TEMP_UNIT tempUnit){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 
 	/* Makes sure BNO055 is in CONFIG mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, CONFIG, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, CONFIG, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Set Unit */
 	uint8_t temp = accUnit | angRateUnit | eulerUnit | tempUnit;
-	error = BNO055_Write(BNO055_UNIT_SEL, temp);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Write(dev, BNO055_UNIT_SEL, temp);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	return BNO055_SUCCESS;
 }
 
-BNO055_ERROR BNO055_Set_OP_Mode(BNO055_OPERATION_MODE op){
+BNO055_ERROR BNO055_Set_OP_Mode(BNO055_Dev_t* dev, BNO055_OPERATION_MODE op){
 
 	HAL_StatusTypeDef error;
 
 	/* Make sure BNO055 is on Page 0 */
-	if(state.currentPage != BNO055_PAGE_0){
-		error = BNO055_Write(BNO055_PAGE_ID, BNO055_PAGE_0);
-		BNO055_ERROR_HANDLE(error);
-		state.currentPage = BNO055_PAGE_0;
-		HAL_Delay(20);
+	if(dev->currentPage != BNO055_PAGE_0){
+		error = BNO055_Write(dev, BNO055_PAGE_ID, BNO055_PAGE_0);
+		if(error != HAL_OK)
+			return BNO055_I2C_ERROR;
+		dev->currentPage = BNO055_PAGE_0;
 	}
 
 	switch(op){
+		case CONFIG:
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_CONFIG);
+			break;
+
 		case ACC_ONLY:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_ACCONLY);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_ACCONLY);
 			break;
 
 		case MAG_ONLY:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_MAGONLY);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_MAGONLY);
 			break;
 
 		case GYRO_ONLY:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_GRYOONLY);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_GRYOONLY);
 			break;
 
 		case ACC_MAG:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_ACCMAG);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_ACCMAG);
 			break;
 
 		case ACC_GYRO:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_ACCGYRO);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_ACCGYRO);
 			break;
 
 		case MAG_GYRO:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_MAGGRYO);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_MAGGRYO);
+			break;
+
+		case AMG:
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_AMG);
 			break;
 
 		case IMU:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_IMU);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_IMU);
 			break;
 
 		case COMPASS:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_COMPASS);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_COMPASS);
 			break;
 
 		case M4G:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_M4G);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_M4G);
 			break;
 
 		case NDOF_FMC_OFF:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_NDOF_FMC);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_NDOF_FMC);
 			break;
 
 		case NDOF:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_NDOF);
+			error = BNO055_Write(dev, BNO055_OPR_MODE, OPR_MODE_NDOF);
 			break;
 
 		default:
-			error = BNO055_Write(BNO055_OPR_MODE, OPR_MODE_CONFIG);
-			break;
+			/* Unknown mode, leave the chip and currentMode as they are */
+			return BNO055_INVALID_ARG;
 	}
 
-	BNO055_ERROR_HANDLE(error);
-	state.currentMode = op;
-	HAL_Delay(10);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
+	dev->currentMode = op;
+	BNO055_Sleep(BNO055_Mode_Switch_Delay(op));
 	return BNO055_SUCCESS;
 }
 
-BNO055_ERROR BNO055_Set_Axis(const BNO055_AXIS_CONFIG_t* axesConfig){
+BNO055_ERROR BNO055_Set_Axis(BNO055_Dev_t* dev, const BNO055_AXIS_CONFIG_t* axesConfig){
 	
-	HAL_StatusTypeDef error; 
+	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 
 	/* Makes sure BNO055 is in CONFIG mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, CONFIG, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, CONFIG, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Configure Axis based on Axis Config Struct */
 	uint8_t temp = (axesConfig->x << BNO055_X_AXIS_OFFSET) |
 				   (axesConfig->y << BNO055_Y_AXIS_OFFSET) |
 				   (axesConfig->z << BNO055_Z_AXIS_OFFSET);
 
-	error = BNO055_Write(BNO055_AXIS_MAP_CONFIG, temp);
-	BNO055_ERROR_HANDLE(error);
-	HAL_Delay(10);
+	error = BNO055_Write(dev, BNO055_AXIS_MAP_CONFIG, temp);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	return BNO055_SUCCESS;
 }
 
-BNO055_ERROR BNO055_Calibrate(void){
+BNO055_ERROR BNO055_Set_Sensor_Config(BNO055_Dev_t* dev, uint8_t accConfig, uint8_t gyroConfig0){
+
+	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
+
+	/* Sensor configs live on page 1 and only apply outside the fusion modes */
+	status = BNO055_STATUS_CHECK_AND_SET(dev, CONFIG, BNO055_PAGE_1);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	error = BNO055_Write(dev, BNO055_ACC_CONFIG, accConfig);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
+
+	error = BNO055_Write(dev, BNO055_GYRO_CONFIG_0, gyroConfig0);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
+
+	return BNO055_STATUS_CHECK_AND_SET(dev, CONFIG, BNO055_PAGE_0);
+}
+
+BNO055_ERROR BNO055_Get_Calib_Status(BNO055_Dev_t* dev, uint8_t* calibStat){
+
+	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
+
+	/* Status reads stay in the current mode, calibration only progresses in fusion modes */
+	status = BNO055_STATUS_CHECK_AND_SET(dev, dev->currentMode, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	error = BNO055_Read(dev, BNO055_CALIB_STAT, calibStat, 1);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	return BNO055_SUCCESS;
+}
+
+BNO055_ERROR BNO055_Calibrate(BNO055_Dev_t* dev){
+
+	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
+	BNO055_OPERATION_MODE fusionMode = dev->currentMode;
+	uint8_t calibStat;
+	uint8_t profile[BNO055_CALIB_LEN];
+	uint8_t stored[BNO055_CALIB_LEN];
+
+	status = BNO055_Get_Calib_Status(dev, &calibStat);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	if(calibStat != BNO055_CALIB_FULL)
+		return BNO055_BUSY;
+
+	/* The profile registers only hold valid data in CONFIG mode */
+	status = BNO055_STATUS_CHECK_AND_SET(dev, CONFIG, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	error = BNO055_Read(dev, BNO055_CALIB_START, profile, BNO055_CALIB_LEN);
 
+	status = BNO055_STATUS_CHECK_AND_SET(dev, fusionMode, BNO055_PAGE_0);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	/* Skip the flash write when nothing changed */
+	tx_mutex_get(&flashLock, TX_WAIT_FOREVER);
+	if(!BNO055_Flash_Load(BNO055_Calib_Key(dev), stored) || memcmp(stored, profile, BNO055_CALIB_LEN) != 0)
+		error = BNO055_Flash_Save(BNO055_Calib_Key(dev), profile);
+	tx_mutex_put(&flashLock);
+
+	if(error != HAL_OK)
+		return BNO055_FLASH_ERROR;
+
+	return BNO055_SUCCESS;
+
+}
+
+uint8_t BNO055_Calib_Restored(const BNO055_Dev_t* dev){
+	return dev->calibRestored;
 }
 
-BNO055_ERROR BNO055_Get_Accel(BNO055_Axis_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Accel(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[6];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Accel LSB and MSB data of all axes */
-	error = BNO055_Read(BNO055_ACC_DATA_X_LSB, tempBuf, 6);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_ACC_DATA_X_LSB, tempBuf, 6);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data into Struct */
-	vec->x = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BN0055_ACCEL_MS2_SCALE;
-	vec->y = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BN0055_ACCEL_MS2_SCALE;
-	vec->z = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BN0055_ACCEL_MS2_SCALE;
+	BNO055_Parse_Axis(tempBuf, BN0055_ACCEL_MS2_SCALE, vec);
 
 	return BNO055_SUCCESS;
 
 }
 
-BNO055_ERROR BNO055_Get_Gyro(BNO055_Axis_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Gyro(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[6];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Gyro LSB and MSB data of all axes */
-	error = BNO055_Read(BNO055_GYR_DATA_X_LSB, tempBuf, 6);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_GYR_DATA_X_LSB, tempBuf, 6);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data into Vector Struct */
-	vec->x = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BNO055_GYRO_DPS_SCALE;
-	vec->y = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BNO055_GYRO_DPS_SCALE;
-	vec->z = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BNO055_GYRO_DPS_SCALE;
+	BNO055_Parse_Axis(tempBuf, BNO055_GYRO_DPS_SCALE, vec);
 
 	return BNO055_SUCCESS;
 
 }
 
-BNO055_ERROR BNO055_Get_Mag(BNO055_Axis_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Mag(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[6];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Mag LSB and MSB data of all axes */
-	error = BNO055_Read(BNO055_MAG_DATA_X_LSB, tempBuf, 6);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_MAG_DATA_X_LSB, tempBuf, 6);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data into Vector Struct */
-	vec->x = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BNO055_MAG_SCALE;
-	vec->y = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BNO055_MAG_SCALE;
-	vec->z = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BNO055_MAG_SCALE;
+	BNO055_Parse_Axis(tempBuf, BNO055_MAG_SCALE, vec);
 
 	return BNO055_SUCCESS;
 
 }
 
-BNO055_ERROR BNO055_Get_Linear_Accel(BNO055_Axis_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Linear_Accel(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[6];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Linear Acceleration LSB and MSB data of all axes */
-	error = BNO055_Read(BNO055_LIA_DATA_X_LSB, tempBuf, 6);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_LIA_DATA_X_LSB, tempBuf, 6);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data into Vector Struct */
-	vec->x = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BNO055_LIN_ACCEL_MS2_SCALE;
-	vec->y = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BNO055_LIN_ACCEL_MS2_SCALE;
-	vec->z = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BNO055_LIN_ACCEL_MS2_SCALE;
+	BNO055_Parse_Axis(tempBuf, BNO055_LIN_ACCEL_MS2_SCALE, vec);
 
 	return BNO055_SUCCESS;
 
 }
 
-BNO055_ERROR BNO055_Get_Gravity_Vec(BNO055_Axis_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Gravity_Vec(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[6];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Gravity LSB and MSB data of all axes */
-	error = BNO055_Read(BNO055_GRV_DATA_X_LSB, tempBuf, 6);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_GRV_DATA_X_LSB, tempBuf, 6);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data into Vector Struct */
-	vec->x = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BNO055_GRAV_MG2_SCALE;
-	vec->y = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BNO055_GRAV_MG2_SCALE;
-	vec->z = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BNO055_GRAV_MG2_SCALE;
+	BNO055_Parse_Axis(tempBuf, BNO055_GRAV_MG2_SCALE, vec);
 
 	return BNO055_SUCCESS;
 
 }
 
-BNO055_ERROR BNO055_Get_Temp(uint8_t temp){
+BNO055_ERROR BNO055_Get_Temp(BNO055_Dev_t* dev, uint8_t temp){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Temperature data */
-	error = BNO055_Read(BNO055_TEMP, &temp, 1);
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_TEMP, &temp, 1);
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	return BNO055_SUCCESS;
 
 }
 
-BNO055_ERROR BNO055_Get_Euler_Vec(BNO055_Axis_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Euler_Vec(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[6];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Euler Vector Data LSB and MSB */
-	error = BNO055_Read(BNO055_EUL_HEADING_LSB, tempBuf, sizeof(tempBuf));
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_EUL_HEADING_LSB, tempBuf, sizeof(tempBuf));
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data Into Euler Vector Struct */
-	vec->x = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BNO055_EULER_DEGREE_SCALE;
-	vec->y = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BNO055_EULER_DEGREE_SCALE;
-	vec->z = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BNO055_EULER_DEGREE_SCALE;
+	BNO055_Parse_Axis(tempBuf, BNO055_EULER_DEGREE_SCALE, vec);
 
 	return BNO055_SUCCESS;
 }
 
-BNO055_ERROR BNO055_Get_Quaternion(BNO055_Quad_Vec_t* vec){
+BNO055_ERROR BNO055_Get_Quaternion(BNO055_Dev_t* dev, BNO055_Quad_Vec_t* vec){
 
 	HAL_StatusTypeDef error;
+	BNO055_ERROR status;
 	uint8_t tempBuf[8];
 
 	/* Makes sure BNO055 is in NDOF mode and Page 0 */
-	BNO055_STATUS_CHECK_AND_SET(&state, NDOF, BNO055_PAGE_0);
+	status = BNO055_STATUS_CHECK_AND_SET(dev, NDOF, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
 
 	/* Grab Quaternion Vector LSB and MSB data */
-	error = BNO055_Read(BNO055_QUA_DATA_W_LSB, tempBuf, sizeof(tempBuf));
-	BNO055_ERROR_HANDLE(error);
+	error = BNO055_Read(dev, BNO055_QUA_DATA_W_LSB, tempBuf, sizeof(tempBuf));
+	if(error != HAL_OK)
+		return BNO055_I2C_ERROR;
 
 	/* Parse Data Into Quad Vector Struct */
-	vec->w = (int16_t)((tempBuf[1]<<8) | tempBuf[0]) / BNO055_QUATERNION_SCALE;
-	vec->x = (int16_t)((tempBuf[3]<<8) | tempBuf[2]) / BNO055_QUATERNION_SCALE;
-	vec->y = (int16_t)((tempBuf[5]<<8) | tempBuf[4]) / BNO055_QUATERNION_SCALE;
-	vec->z = (int16_t)((tempBuf[7]<<8) | tempBuf[6]) / BNO055_QUATERNION_SCALE;
+	vec->w = BNO055_Parse_Word(&tempBuf[0], BNO055_QUATERNION_SCALE);
+	vec->x = BNO055_Parse_Word(&tempBuf[2], BNO055_QUATERNION_SCALE);
+	vec->y = BNO055_Parse_Word(&tempBuf[4], BNO055_QUATERNION_SCALE);
+	vec->z = BNO055_Parse_Word(&tempBuf[6], BNO055_QUATERNION_SCALE);
+
+	return BNO055_SUCCESS;
+}
+
+/*
+ * Queue a burst read of len bytes from ACC_DATA_X_LSB into the device buffer
+ */
+static BNO055_ERROR BNO055_Read_Block_Start(BNO055_Dev_t* dev, BNO055_OPERATION_MODE mode, uint8_t len){
+
+	TX_INTERRUPT_SAVE_AREA
+	BNO055_Bus_t* bus = dev->bus;
+	BNO055_ERROR status;
+
+	/* One read in flight per device */
+	if(dev->readLen != 0)
+		return BNO055_BUSY;
+
+	/* Makes sure BNO055 is in the requested mode and Page 0 */
+	status = BNO055_STATUS_CHECK_AND_SET(dev, mode, BNO055_PAGE_0);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	/* Drop a completion left over from a transfer that timed out */
+	while(tx_semaphore_get(&dev->readDone, TX_NO_WAIT) == TX_SUCCESS);
+
+	dev->readLen = len;
+	dev->readStatus = HAL_OK;
+	dev->nextPending = NULL;
+
+	/* Behind the reads of other devices on the bus, started right away if it is idle */
+	tx_mutex_get(&bus->lock, TX_WAIT_FOREVER);
+	TX_DISABLE
+	if(bus->pendingTail != NULL)
+		bus->pendingTail->nextPending = dev;
+	else
+		bus->pending = dev;
+	bus->pendingTail = dev;
+	if(bus->active == NULL && !bus->aborting)
+		BNO055_Bus_Next(bus);
+	TX_RESTORE
+	tx_mutex_put(&bus->lock);
+
+	return BNO055_SUCCESS;
+}
+
+/*
+ * Sleep until the completion or error callback of the queued read
+ */
+static BNO055_ERROR BNO055_Read_Block_Wait(BNO055_Dev_t* dev){
+
+	PROF_SCOPE(PROF_BNO055_BURST);
+	UINT waitStatus;
+
+	if(dev->readLen == 0)
+		return BNO055_I2C_ERROR;
+
+	waitStatus = tx_semaphore_get(&dev->readDone, BNO055_READ_TIMEOUT);
+	if(waitStatus != TX_SUCCESS)
+		BNO055_Bus_Cancel(dev->bus, dev);
+
+	dev->readLen = 0;
+
+	if(waitStatus != TX_SUCCESS || dev->readStatus != HAL_OK)
+		return BNO055_I2C_ERROR;
+
+	return BNO055_SUCCESS;
+}
+
+BNO055_ERROR BNO055_Snapshot_Start(BNO055_Dev_t* dev){
+	return BNO055_Read_Block_Start(dev, NDOF, BNO055_SNAPSHOT_LEN);
+}
+
+BNO055_ERROR BNO055_Snapshot_Wait(BNO055_Dev_t* dev, BNO055_Snapshot_t* snapshot){
+
+	BNO055_ERROR status;
+	const uint8_t* buf = dev->readBuf;
+
+	status = BNO055_Read_Block_Wait(dev);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	/* Parse the block, offsets are relative to ACC_DATA_X_LSB */
+	BNO055_Parse_Axis(&buf[BNO055_ACC_DATA_X_LSB - BNO055_SNAPSHOT_START], BN0055_ACCEL_MS2_SCALE, &snapshot->accel);
+	BNO055_Parse_Axis(&buf[BNO055_MAG_DATA_X_LSB - BNO055_SNAPSHOT_START], BNO055_MAG_SCALE, &snapshot->mag);
+	BNO055_Parse_Axis(&buf[BNO055_GYR_DATA_X_LSB - BNO055_SNAPSHOT_START], BNO055_GYRO_DPS_SCALE, &snapshot->gyro);
+	BNO055_Parse_Axis(&buf[BNO055_EUL_HEADING_LSB - BNO055_SNAPSHOT_START], BNO055_EULER_DEGREE_SCALE, &snapshot->euler);
+	BNO055_Parse_Axis(&buf[BNO055_LIA_DATA_X_LSB - BNO055_SNAPSHOT_START], BNO055_LIN_ACCEL_MS2_SCALE, &snapshot->linearAccel);
+	BNO055_Parse_Axis(&buf[BNO055_GRV_DATA_X_LSB - BNO055_SNAPSHOT_START], BNO055_GRAV_MG2_SCALE, &snapshot->gravity);
+
+	snapshot->quaternion.w = BNO055_Parse_Word(&buf[BNO055_QUA_DATA_W_LSB - BNO055_SNAPSHOT_START], BNO055_QUATERNION_SCALE);
+	snapshot->quaternion.x = BNO055_Parse_Word(&buf[BNO055_QUA_DATA_X_LSB - BNO055_SNAPSHOT_START], BNO055_QUATERNION_SCALE);
+	snapshot->quaternion.y = BNO055_Parse_Word(&buf[BNO055_QUA_DATA_Y_LSB - BNO055_SNAPSHOT_START], BNO055_QUATERNION_SCALE);
+	snapshot->quaternion.z = BNO055_Parse_Word(&buf[BNO055_QUA_DATA_Z_LSB - BNO055_SNAPSHOT_START], BNO055_QUATERNION_SCALE);
+
+	snapshot->temp = (int8_t) buf[BNO055_TEMP - BNO055_SNAPSHOT_START];
+
+	return BNO055_SUCCESS;
+}
+
+BNO055_ERROR BNO055_Raw_Snapshot_Wait(BNO055_Dev_t* dev, BNO055_Raw_Snapshot_t* raw){
+
+	BNO055_ERROR status;
+
+	status = BNO055_Read_Block_Wait(dev);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	/* Registers are little endian like the core, the word block copies straight across */
+	memcpy(raw->words, dev->readBuf, sizeof(raw->words));
+	raw->temp = (int8_t) dev->readBuf[BNO055_TEMP - BNO055_SNAPSHOT_START];
 
 	return BNO055_SUCCESS;
-}
\ No newline at end of file
+}
+
+BNO055_ERROR BNO055_Get_Snapshot(BNO055_Dev_t* dev, BNO055_Snapshot_t* snapshot){
+
+	BNO055_ERROR status;
+
+	status = BNO055_Snapshot_Start(dev);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	return BNO055_Snapshot_Wait(dev, snapshot);
+}
+
+BNO055_ERROR BNO055_Get_Raw_Snapshot(BNO055_Dev_t* dev, BNO055_Raw_Snapshot_t* raw){
+
+	BNO055_ERROR status;
+
+	status = BNO055_Snapshot_Start(dev);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	return BNO055_Raw_Snapshot_Wait(dev, raw);
+}
+
+BNO055_ERROR BNO055_Get_Raw_AMG(BNO055_Dev_t* dev, BNO055_Raw_AMG_t* raw){
+
+	BNO055_ERROR status;
+
+	status = BNO055_Read_Block_Start(dev, AMG, BNO055_AMG_LEN);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	status = BNO055_Read_Block_Wait(dev);
+	if(status != BNO055_SUCCESS)
+		return status;
+
+	memcpy(raw, dev->readBuf, sizeof(*raw));
+
+	return BNO055_SUCCESS;
+}
+
+/*
+ * Q16.16 conversion, per word multipliers and shifts in register order
+ */
+static const q15_t q16Mult[BNO055_RAW_WORDS] = {
+	BNO055_Q16_MULT_ACCEL, BNO055_Q16_MULT_ACCEL, BNO055_Q16_MULT_ACCEL,
+	BNO055_Q16_MULT_MAG, BNO055_Q16_MULT_MAG, BNO055_Q16_MULT_MAG,
+	BNO055_Q16_MULT_GYRO, BNO055_Q16_MULT_GYRO, BNO055_Q16_MULT_GYRO,
+	BNO055_Q16_MULT_EULER, BNO055_Q16_MULT_EULER, BNO055_Q16_MULT_EULER,
+	BNO055_Q16_MULT_QUATERNION, BNO055_Q16_MULT_QUATERNION, BNO055_Q16_MULT_QUATERNION, BNO055_Q16_MULT_QUATERNION,
+	BNO055_Q16_MULT_LIN_ACCEL, BNO055_Q16_MULT_LIN_ACCEL, BNO055_Q16_MULT_LIN_ACCEL,
+	BNO055_Q16_MULT_GRAVITY, BNO055_Q16_MULT_GRAVITY, BNO055_Q16_MULT_GRAVITY
+};
+
+static const uint8_t q16Shift[BNO055_RAW_WORDS] = {
+	BNO055_Q16_SHIFT_ACCEL, BNO055_Q16_SHIFT_ACCEL, BNO055_Q16_SHIFT_ACCEL,
+	BNO055_Q16_SHIFT_MAG, BNO055_Q16_SHIFT_MAG, BNO055_Q16_SHIFT_MAG,
+	BNO055_Q16_SHIFT_GYRO, BNO055_Q16_SHIFT_GYRO, BNO055_Q16_SHIFT_GYRO,
+	BNO055_Q16_SHIFT_EULER, BNO055_Q16_SHIFT_EULER, BNO055_Q16_SHIFT_EULER,
+	BNO055_Q16_SHIFT_QUATERNION, BNO055_Q16_SHIFT_QUATERNION, BNO055_Q16_SHIFT_QUATERNION, BNO055_Q16_SHIFT_QUATERNION,
+	BNO055_Q16_SHIFT_LIN_ACCEL, BNO055_Q16_SHIFT_LIN_ACCEL, BNO055_Q16_SHIFT_LIN_ACCEL,
+	BNO055_Q16_SHIFT_GRAVITY, BNO055_Q16_SHIFT_GRAVITY, BNO055_Q16_SHIFT_GRAVITY
+};
+
+void BNO055_Raw_To_Q16(const BNO055_Raw_Snapshot_t* raw, BNO055_Q16_Snapshot_t* out){
+
+	/* Two raw words per load on the DSP extension */
+	FixVecMulShiftQ15(raw->words, q16Mult, q16Shift, out->words, BNO055_RAW_WORDS);
+
+	out->temp = (int32_t) raw->temp << 16;
+}
+
+/*
+ * HAL I2C callbacks, wake the thread waiting on the read and start the next one on the bus
+ */
+static void BNO055_Read_Done(I2C_HandleTypeDef* hi2c, HAL_StatusTypeDef status){
+
+	BNO055_Bus_t* bus;
+	BNO055_Dev_t* dev;
+
+	for(bus = busList; bus != NULL; bus = bus->next){
+		dev = bus->active;
+		if(bus->i2c != hi2c || dev == NULL)
+			continue;
+
+		bus->active = NULL;
+		dev->readStatus = status;
+		tx_semaphore_put(&dev->readDone);
+		BNO055_Bus_Next(bus);
+		return;
+	}
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c){
+	BNO055_Read_Done(hi2c, HAL_OK);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c){
+	BNO055_Read_Done(hi2c, HAL_ERROR);
+}
+
+void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef* hi2c){
+
+	BNO055_Bus_t* bus;
+
+	for(bus = busList; bus != NULL; bus = bus->next){
+		if(bus->i2c == hi2c)
+			BNO055_Bus_Aborted(bus);
+	}
+}
@@ -6,10 +6,16 @@
 #include <stdlib.h>
 
 #include "stm32h5xx_hal.h"
+#include "tx_api.h"
 
 typedef enum{
 	BNO055_SUCCESS        = 0U,
 	BNO055_NOT_DETECTED   = 1U,
+	BNO055_I2C_ERROR      = 2U,
+	BNO055_TIMEOUT        = 3U,
+	BNO055_BUSY           = 4U,		// Init in progress or not yet calibrated, poll again
+	BNO055_FLASH_ERROR    = 5U,
+	BNO055_INVALID_ARG    = 6U,
 } BNO055_ERROR;
 
 typedef enum{
@@ -67,32 +73,237 @@ typedef struct{
 	float z;
 } BNO055_Quad_Vec_t;
 
+/* Every data register of one sample, decoded from a single burst read */
+typedef struct{
+	BNO055_Axis_Vec_t accel;
+	BNO055_Axis_Vec_t mag;
+	BNO055_Axis_Vec_t gyro;
+	BNO055_Axis_Vec_t euler;
+	BNO055_Quad_Vec_t quaternion;
+	BNO055_Axis_Vec_t linearAccel;
+	BNO055_Axis_Vec_t gravity;
+	int8_t temp;
+} BNO055_Snapshot_t;
+
+/* Raw register words, LSB scaling per BNO055_Q16_* in bno055_regs.h */
+typedef struct{
+	int16_t x;
+	int16_t y;
+	int16_t z;
+} BNO055_Raw_Vec_t;
+
+typedef struct{
+	int16_t w;
+	int16_t x;
+	int16_t y;
+	int16_t z;
+} BNO055_Raw_Quad_t;
+
+#define BNO055_RAW_WORDS	22
+
+/* Snapshot as read from the device, no float work. Fields are in register order so the
+   same data can be walked as words, or as word pairs for packed 16 bit arithmetic */
+typedef struct{
+	union{
+		struct{
+			BNO055_Raw_Vec_t accel;
+			BNO055_Raw_Vec_t mag;
+			BNO055_Raw_Vec_t gyro;
+			BNO055_Raw_Vec_t euler;
+			BNO055_Raw_Quad_t quaternion;
+			BNO055_Raw_Vec_t linearAccel;
+			BNO055_Raw_Vec_t gravity;
+		};
+		int16_t words[BNO055_RAW_WORDS];
+		uint32_t pairs[BNO055_RAW_WORDS / 2];
+	};
+	int8_t temp;
+} BNO055_Raw_Snapshot_t;
+
+/* Raw sensor words of the non-fusion modes, in register order */
+typedef struct{
+	BNO055_Raw_Vec_t accel;
+	BNO055_Raw_Vec_t mag;
+	BNO055_Raw_Vec_t gyro;
+} BNO055_Raw_AMG_t;
+
+/* Q16.16 fixed point in the default units */
+typedef struct{
+	int32_t x;
+	int32_t y;
+	int32_t z;
+} BNO055_Q16_Vec_t;
+
+typedef struct{
+	int32_t w;
+	int32_t x;
+	int32_t y;
+	int32_t z;
+} BNO055_Q16_Quad_t;
+
+typedef struct{
+	union{
+		struct{
+			BNO055_Q16_Vec_t accel;
+			BNO055_Q16_Vec_t mag;
+			BNO055_Q16_Vec_t gyro;
+			BNO055_Q16_Vec_t euler;
+			BNO055_Q16_Quad_t quaternion;
+			BNO055_Q16_Vec_t linearAccel;
+			BNO055_Q16_Vec_t gravity;
+		};
+		int32_t words[BNO055_RAW_WORDS];
+	};
+	int32_t temp;
+} BNO055_Q16_Snapshot_t;
+
 typedef struct{
 	BNO055_AXIS x;
 	BNO055_AXIS y;
 	BNO055_AXIS z;
 } BNO055_AXIS_CONFIG_t;
 
+/* Fields for BNO055_Set_Sensor_Config, OR a range with a bandwidth. Power on is 4G / 62.5 Hz and 2000 dps / 32 Hz */
+#define BNO055_ACC_RANGE_2G			0x00U
+#define BNO055_ACC_RANGE_4G			0x01U
+#define BNO055_ACC_RANGE_8G			0x02U
+#define BNO055_ACC_RANGE_16G		0x03U
+#define BNO055_ACC_BW_62_5HZ		(0x03U << 2)
+#define BNO055_ACC_BW_125HZ			(0x04U << 2)
+#define BNO055_ACC_BW_250HZ			(0x05U << 2)
+#define BNO055_ACC_BW_500HZ			(0x06U << 2)
+
+#define BNO055_GYRO_RANGE_2000DPS	0x00U
+#define BNO055_GYRO_RANGE_1000DPS	0x01U
+#define BNO055_GYRO_RANGE_500DPS	0x02U
+#define BNO055_GYRO_BW_523HZ		(0x00U << 3)
+#define BNO055_GYRO_BW_230HZ		(0x01U << 3)
+#define BNO055_GYRO_BW_116HZ		(0x02U << 3)
+#define BNO055_GYRO_BW_47HZ			(0x03U << 3)
+#define BNO055_GYRO_BW_32HZ			(0x07U << 3)
+
 //#define BNO055_HARDWARE_RESET
 
-void BNO055_I2C_Mount(I2C_HandleTypeDef* i2c);
+/* Bring-up sequence of one device, advanced by BNO055_Init_Poll */
+typedef enum{
+	BNO055_INIT_IDLE,
+	BNO055_INIT_PROBE,			// Wait for the chip to answer, reset it only if it was already up
+	BNO055_INIT_RESET,
+#ifdef BNO055_HARDWARE_RESET
+	BNO055_INIT_RESET_RELEASE,
+#endif
+	BNO055_INIT_RESET_WAIT,		// Poll the chip ID until the reset completes
+	BNO055_INIT_CONFIGURE,
+	BNO055_INIT_SETTLE,
+	BNO055_INIT_DONE,
+	BNO055_INIT_FAILED
+} BNO055_INIT_STATE;
+
+struct BNO055_Dev;
+
+/* Burst read buffer per device, holds every data register from ACC_DATA_X_LSB to TEMP */
+#define BNO055_READ_BUF_LEN		48
+
+/*
+ * One I2C bus shared by any number of devices. Register accesses hold the bus
+ * lock; burst reads queue on the bus and the completion interrupt starts the
+ * next one, so reads of several devices go out back-to-back. Separate buses
+ * run in parallel. Fields are managed by the driver.
+ */
+typedef struct BNO055_Bus{
+	I2C_HandleTypeDef* i2c;
+	uint8_t index;						// Mount order, part of the calibration record key
+	TX_MUTEX lock;
+	TX_SEMAPHORE idle;					// Put when the read queue drains and a register access waits
+	volatile uint8_t idleWaiting;
+	struct BNO055_Dev* volatile active;	// Burst read on the wire
+	volatile uint8_t aborting;			// A cancelled read is being aborted, the queue waits for the abort callback
+	struct BNO055_Dev* pending;			// Queued behind it, oldest first
+	struct BNO055_Dev* pendingTail;
+	struct BNO055_Bus* next;
+} BNO055_Bus_t;
+
+/* One BNO055 at address BNO055_I2C_ADDR_LO or BNO055_I2C_ADDR_HI. Fields are managed by the driver */
+typedef struct BNO055_Dev{
+	BNO055_Bus_t* bus;
+	uint8_t addr;
+	BNO055_OPERATION_MODE currentMode;
+	uint8_t currentPage;
+
+	BNO055_INIT_STATE initState;
+	BNO055_ERROR initResult;
+	ULONG initStart;
+	uint8_t initBooting;				// The probe saw a NACK, the chip is fresh out of power on reset
+	uint8_t calibRestored;				// Init wrote a stored calibration profile back
+
+#ifdef BNO055_HARDWARE_RESET
+	uint32_t resetPort;
+	uint16_t resetPin;
+#endif
+
+	/* Burst read state, the buffer is the DMA target */
+	TX_SEMAPHORE readDone;
+	volatile HAL_StatusTypeDef readStatus;
+	uint8_t readLen;
+	struct BNO055_Dev* nextPending;
+	uint8_t readBuf[BNO055_READ_BUF_LEN] __attribute__((aligned(32)));
+} BNO055_Dev_t;
+
+/* Register the bus once, then every device on it. addr is the 7 bit address */
+void BNO055_Bus_Mount(BNO055_Bus_t* bus, I2C_HandleTypeDef* i2c);
+void BNO055_Mount(BNO055_Dev_t* dev, BNO055_Bus_t* bus, uint8_t addr);
 
 #ifdef BNO055_HARDWARE_RESET
-	void BNO055_HW_Reset_Mount(uint32_t GPIO_Port, uint16_t GPIO_Pin);
+	void BNO055_HW_Reset_Mount(BNO055_Dev_t* dev, uint32_t GPIO_Port, uint16_t GPIO_Pin);
 #endif
 
-BNO055_ERROR BNO055_Init(void);
-BNO055_ERROR BNO055_Set_Unit(BNO055_ACCEL_GRAV_UNIT accUnit, BNO055_ANGULAR_RATE_UNIT angRateUnit, BNO055_EULER_UNIT eulerUnit, BNO055_TEMP_UNIT tempUnit);
-BNO055_ERROR BNO055_Set_OP_Mode(BNO055_OPERATION_MODE op);
-BNO055_ERROR BNO055_Set_Axis(const BNO055_AXIS_CONFIG_t* axis_struct);
-BNO055_ERROR BNO055_Calibrate(void);
-BNO055_ERROR BNO055_Get_Accel(BNO055_Axis_Vec_t* vec);
-BNO055_ERROR BNO055_Get_Gyro(BNO055_Axis_Vec_t* vec);
-BNO055_ERROR BNO055_Get_Mag(BNO055_Axis_Vec_t* vec);
-BNO055_ERROR BNO055_Get_Linear_Accel(BNO055_Axis_Vec_t* vec);
-BNO055_ERROR BNO055_Get_Gravity_Vec(BNO055_Axis_Vec_t* vec);
-BNO055_ERROR BNO055_Get_Temp(uint8_t temp);
-BNO055_ERROR BNO055_Get_Euler_Vec(BNO055_Axis_Vec_t* vec);
-BNO055_ERROR BNO055_Get_Quaternion(BNO055_Quad_Vec_t* vec);
+/* Blocks the calling thread through ThreadX sleeps, never spins. A missing IMU returns an error */
+BNO055_ERROR BNO055_Init(BNO055_Dev_t* dev);
+
+/* Stepwise init for callers that run their own loop: poll until it stops returning
+   BNO055_BUSY, waiting at least *waitMs between calls. Devices can be brought up side by side */
+BNO055_ERROR BNO055_Init_Start(BNO055_Dev_t* dev);
+BNO055_ERROR BNO055_Init_Poll(BNO055_Dev_t* dev, uint32_t* waitMs);
+BNO055_ERROR BNO055_Set_Unit(BNO055_Dev_t* dev, BNO055_ACCEL_GRAV_UNIT accUnit, BNO055_ANGULAR_RATE_UNIT angRateUnit, BNO055_EULER_UNIT eulerUnit, BNO055_TEMP_UNIT tempUnit);
+BNO055_ERROR BNO055_Set_OP_Mode(BNO055_Dev_t* dev, BNO055_OPERATION_MODE op);
+BNO055_ERROR BNO055_Set_Axis(BNO055_Dev_t* dev, const BNO055_AXIS_CONFIG_t* axis_struct);
+/* ACC_CONFIG and GYR_CONFIG_0 (range and bandwidth), used by AMG and the other non-fusion modes */
+BNO055_ERROR BNO055_Set_Sensor_Config(BNO055_Dev_t* dev, uint8_t accConfig, uint8_t gyroConfig0);
+/* CALIB_STAT, two bits each for SYS, GYR, ACC and MAG, 3 is fully calibrated */
+BNO055_ERROR BNO055_Get_Calib_Status(BNO055_Dev_t* dev, uint8_t* calibStat);
+
+/* Once every sensor reports full calibration, stores the offsets and radii to flash for
+   BNO055_Init to restore on the next boot. Returns BNO055_BUSY until then; call it every
+   few seconds from a thread while running in a fusion mode. Each device keeps its own profile */
+BNO055_ERROR BNO055_Calibrate(BNO055_Dev_t* dev);
+
+/* True when init restored a stored calibration profile */
+uint8_t BNO055_Calib_Restored(const BNO055_Dev_t* dev);
+BNO055_ERROR BNO055_Get_Accel(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec);
+BNO055_ERROR BNO055_Get_Gyro(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec);
+BNO055_ERROR BNO055_Get_Mag(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec);
+BNO055_ERROR BNO055_Get_Linear_Accel(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec);
+BNO055_ERROR BNO055_Get_Gravity_Vec(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec);
+BNO055_ERROR BNO055_Get_Temp(BNO055_Dev_t* dev, uint8_t temp);
+BNO055_ERROR BNO055_Get_Euler_Vec(BNO055_Dev_t* dev, BNO055_Axis_Vec_t* vec);
+BNO055_ERROR BNO055_Get_Quaternion(BNO055_Dev_t* dev, BNO055_Quad_Vec_t* vec);
+
+/* One DMA transaction for all data registers, the calling thread sleeps until it completes */
+BNO055_ERROR BNO055_Get_Snapshot(BNO055_Dev_t* dev, BNO055_Snapshot_t* snapshot);
+
+/* Same transaction without float decoding, for fixed point consumers */
+BNO055_ERROR BNO055_Get_Raw_Snapshot(BNO055_Dev_t* dev, BNO055_Raw_Snapshot_t* raw);
+
+/* Split snapshot read for sampling several devices at once: start every device, then wait on
+   each. Reads on one bus run back-to-back from the completion interrupt, buses run in parallel */
+BNO055_ERROR BNO055_Snapshot_Start(BNO055_Dev_t* dev);
+BNO055_ERROR BNO055_Snapshot_Wait(BNO055_Dev_t* dev, BNO055_Snapshot_t* snapshot);
+BNO055_ERROR BNO055_Raw_Snapshot_Wait(BNO055_Dev_t* dev, BNO055_Raw_Snapshot_t* raw);
+
+/* Accel, mag and gyro words in AMG mode, switching to it if needed. Feeds software fusion */
+BNO055_ERROR BNO055_Get_Raw_AMG(BNO055_Dev_t* dev, BNO055_Raw_AMG_t* raw);
+
+/* Whole snapshot to Q16.16 with the fixmath widening kernel, two words per load on cores with the DSP extension */
+void BNO055_Raw_To_Q16(const BNO055_Raw_Snapshot_t* raw, BNO055_Q16_Snapshot_t* out);
 
 #endif /* INC_BNO055_H_ */
\ No newline at end of file
@@ -0,0 +1,217 @@
+/*
+ * bno055_flash.c
+ *
+ *  Calibration profile records in the NVDATA sector
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "bno055_flash.h"
+
+#define BNO055_CALIB_MAGIC		0x434F4E42UL		// "BNOC"
+#define BNO055_CALIB_ERASED		0xFFFFFFFFUL
+#define BNO055_CALIB_NO_DEVICE	0xFFU				// Written before records had a key, belongs to device 0
+
+/* Two flash quad-words, the H5 programming unit */
+typedef struct{
+	uint32_t magic;
+	uint8_t profile[BNO055_CALIB_LEN];
+	uint8_t device;
+	uint8_t reserved;
+	uint32_t crc;
+} BNO055_Calib_Record_t;
+
+_Static_assert(sizeof(BNO055_Calib_Record_t) % 16U == 0U, "Calibration record must be whole quad-words");
+
+/* From the linker script */
+extern uint32_t _snvdata[];
+extern uint32_t _envdata[];
+
+#define BNO055_RECORDS		((const BNO055_Calib_Record_t*) _snvdata)
+#define BNO055_RECORD_MAX	(((uintptr_t) _envdata - (uintptr_t) _snvdata) / sizeof(BNO055_Calib_Record_t))
+
+/* Set while records are read, and by BNO055_Flash_ECC_NMI when one of those reads failed ECC */
+static volatile uint8_t eccProbe = 0;
+static volatile uint8_t eccFault = 0;
+
+#if defined(__linux__)
+/* The host build has no ECC, a load never faults */
+static uint32_t BNO055_Flash_Load_Word(const uint32_t* addr){
+
+	return *(const volatile uint32_t*) addr;
+}
+#else
+/*
+ * A single 16-bit load at a known address, so BNO055_Flash_ECC_NMI can step over it when a
+ * double ECC error raises the NMI on the load itself
+ */
+extern const uint16_t bno055_flash_load_insn[];
+
+__attribute__((naked, noinline)) static uint32_t BNO055_Flash_Load_Word(const uint32_t* addr){
+
+	__asm volatile(
+		"bno055_flash_load_insn:	\n"
+		"	ldr.n r0, [r0]			\n"
+		"	bx lr					\n");
+}
+
+uint8_t BNO055_Flash_ECC_NMI(uint32_t* frame){
+
+	if(!eccProbe || !__HAL_FLASH_GET_FLAG(FLASH_FLAG_ECCD))
+		return 0;
+
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ECCD);
+	eccFault = 1;
+
+	/* Stacked PC still on the load, it would fault again on return. Past it, the value is discarded */
+	if(frame[6] == (uint32_t) (uintptr_t) bno055_flash_load_insn)
+		frame[6] += 2U;
+
+	return 1;
+}
+#endif
+
+/*
+ * Copies words out of flash. Returns 0 when any of them failed ECC, a quad-word torn by a
+ * reset during programming
+ */
+static uint8_t BNO055_Flash_Read(const void* src, void* dst, uint32_t len){
+
+	const uint32_t* from = (const uint32_t*) src;
+	uint32_t* to = (uint32_t*) dst;
+
+	eccFault = 0;
+	eccProbe = 1;
+	for(uint32_t i = 0; i < len / sizeof(uint32_t); i++)
+		to[i] = BNO055_Flash_Load_Word(&from[i]);
+	eccProbe = 0;
+
+	return !eccFault;
+}
+
+/*
+ * CRC-32 (zlib) over the record up to the CRC field. A bitwise loop is plenty for
+ * 28 bytes and leaves the hardware CRC unit to the telemetry link
+ */
+static uint32_t BNO055_Flash_CRC(const BNO055_Calib_Record_t* record){
+
+	const uint8_t* buf = (const uint8_t*) record;
+	uint32_t crc = 0xFFFFFFFFUL;
+
+	for(uint32_t i = 0; i < offsetof(BNO055_Calib_Record_t, crc); i++){
+		crc ^= buf[i];
+		for(uint8_t bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1UL));
+	}
+
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+/*
+ * Index of the first never-written record, BNO055_RECORD_MAX when the sector is full
+ */
+static uint32_t BNO055_Flash_Free_Slot(void){
+
+	uint32_t slot;
+	uint32_t magic;
+
+	/* A magic that fails ECC was being programmed, the slot is taken */
+	for(slot = 0; slot < BNO055_RECORD_MAX; slot++){
+		if(BNO055_Flash_Read(&BNO055_RECORDS[slot].magic, &magic, sizeof(magic)) && magic == BNO055_CALIB_ERASED)
+			break;
+	}
+
+	return slot;
+}
+
+static HAL_StatusTypeDef BNO055_Flash_Erase(void){
+
+	FLASH_EraseInitTypeDef erase;
+	uint32_t offset = (uint32_t) (uintptr_t) _snvdata - FLASH_BASE;
+	uint32_t sectorError;
+
+	erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+	erase.Banks = (offset >= FLASH_BANK_SIZE) ? FLASH_BANK_2 : FLASH_BANK_1;
+	erase.Sector = (offset % FLASH_BANK_SIZE) / FLASH_SECTOR_SIZE;
+	erase.NbSectors = 1;
+
+	return HAL_FLASHEx_Erase(&erase, &sectorError);
+}
+
+/*
+ * Copies the newest valid record of the device below slot end, returns 0 when there is none
+ */
+static uint8_t BNO055_Flash_Find(uint8_t device, uint32_t end, BNO055_Calib_Record_t* record){
+
+	/* Newest first, skipping records torn by a reset during programming: failed ECC or bad CRC */
+	while(end-- > 0){
+		if(!BNO055_Flash_Read(&BNO055_RECORDS[end], record, sizeof(*record)))
+			continue;
+		if(record->device != device && !(device == 0 && record->device == BNO055_CALIB_NO_DEVICE))
+			continue;
+		if(record->magic == BNO055_CALIB_MAGIC && record->crc == BNO055_Flash_CRC(record))
+			return 1;
+	}
+
+	return 0;
+}
+
+uint8_t BNO055_Flash_Load(uint8_t device, uint8_t profile[BNO055_CALIB_LEN]){
+
+	BNO055_Calib_Record_t record;
+
+	if(!BNO055_Flash_Find(device, BNO055_Flash_Free_Slot(), &record))
+		return 0;
+
+	memcpy(profile, record.profile, BNO055_CALIB_LEN);
+	return 1;
+}
+
+HAL_StatusTypeDef BNO055_Flash_Save(uint8_t device, const uint8_t profile[BNO055_CALIB_LEN]){
+
+	/* The new record first, then the profiles of other devices when the sector has to be erased */
+	static BNO055_Calib_Record_t records[BNO055_FLASH_DEVICES] __attribute__((aligned(16)));
+	HAL_StatusTypeDef error = HAL_OK;
+	uint32_t slot = BNO055_Flash_Free_Slot();
+	uint32_t count = 1;
+	uint32_t address;
+
+	if(device >= BNO055_FLASH_DEVICES)
+		return HAL_ERROR;
+
+	memset(&records[0], 0xFF, sizeof(records[0]));
+	records[0].magic = BNO055_CALIB_MAGIC;
+	memcpy(records[0].profile, profile, BNO055_CALIB_LEN);
+	records[0].device = device;
+	records[0].crc = BNO055_Flash_CRC(&records[0]);
+
+	if(slot >= BNO055_RECORD_MAX){
+		for(uint8_t other = 0; other < BNO055_FLASH_DEVICES; other++){
+			if(other != device && BNO055_Flash_Find(other, slot, &records[count]))
+				count++;
+		}
+	}
+
+	HAL_FLASH_Unlock();
+
+	if(slot >= BNO055_RECORD_MAX){
+		error = BNO055_Flash_Erase();
+		slot = 0;
+	}
+
+	address = (uint32_t) (uintptr_t) &BNO055_RECORDS[slot];
+	for(uint32_t i = 0; error == HAL_OK && i < count * sizeof(records[0]); i += 16U)
+		error = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, address + i, (uint32_t) (uintptr_t) records + i);
+
+	HAL_FLASH_Lock();
+
+	/* ICACHE also serves data reads from flash, drop lines holding the old contents */
+	if(READ_BIT(ICACHE->CR, ICACHE_CR_EN))
+		HAL_ICACHE_Invalidate();
+
+	if(error != HAL_OK)
+		return error;
+
+	return (memcmp(&BNO055_RECORDS[slot], records, count * sizeof(records[0])) == 0) ? HAL_OK : HAL_ERROR;
+}
@@ -0,0 +1,33 @@
+
+#ifndef BNO055_FLASH_H_
+#define BNO055_FLASH_H_
+
+#include <stdint.h>
+
+#include "stm32h5xx_hal.h"
+#include "bno055_regs.h"
+
+/*
+ * Calibration profile storage in the NVDATA flash sector reserved by the linker script.
+ * Records are appended until the sector is full, so the sector is erased once per
+ * 256 saves rather than on every save. Each record carries a device key and the newest
+ * record of a device with a good CRC wins. The latest profile of every other device is
+ * carried over when the sector is erased.
+ */
+
+/* Device keys kept across a sector erase */
+#define BNO055_FLASH_DEVICES	8U
+
+/* Returns 1 and fills profile when a valid record is stored for the device */
+uint8_t BNO055_Flash_Load(uint8_t device, uint8_t profile[BNO055_CALIB_LEN]);
+
+HAL_StatusTypeDef BNO055_Flash_Save(uint8_t device, const uint8_t profile[BNO055_CALIB_LEN]);
+
+/*
+ * A double ECC error on a flash read raises the NMI. Call this from NMI_Handler with the
+ * stacked exception frame; it returns 1 when the error hit a calibration record read, which
+ * then skips the record as torn, and 0 when the NMI is someone else's
+ */
+uint8_t BNO055_Flash_ECC_NMI(uint32_t* frame);
+
+#endif /* BNO055_FLASH_H_ */
@@ -8,6 +8,27 @@
 #define BNO055_READ_TIMEOUT 	100
 #define BNO055_WRITE_TIMEOUT 	100
 
+/* Bring-up and mode switch timing (datasheet section 1.2 and table 3-6), in ms */
+#define BNO055_POLL_MS				10
+#define BNO055_BOOT_TIMEOUT_MS		1000		// Power on to first I2C response
+#define BNO055_RESET_MIN_MS			400			// Chip ID is not polled before this
+#define BNO055_RESET_TIMEOUT_MS		1000
+#define BNO055_HW_RESET_PULSE_MS	20
+#define BNO055_CONFIG_TO_ANY_MS		7
+#define BNO055_ANY_TO_CONFIG_MS		19
+
+/* Contiguous data block read by BNO055_Get_Snapshot, ACC_DATA_X_LSB through TEMP */
+#define BNO055_SNAPSHOT_START	BNO055_ACC_DATA_X_LSB
+#define BNO055_SNAPSHOT_LEN		(BNO055_TEMP - BNO055_ACC_DATA_X_LSB + 1U)
+
+/* Accel, mag and gyro words only, read by BNO055_Get_Raw_AMG */
+#define BNO055_AMG_LEN			(BNO055_GYR_DATA_Z_MSB - BNO055_ACC_DATA_X_LSB + 1U)
+
+/* Calibration profile, ACC_OFFSET_X_LSB through MAG_RADIUS_MSB. Only readable and writable in CONFIG mode */
+#define BNO055_CALIB_START		BNO055_ACC_OFFSET_X_LSB
+#define BNO055_CALIB_LEN		(BNO055_MAG_RADIUS_MSB - BNO055_ACC_OFFSET_X_LSB + 1U)
+#define BNO055_CALIB_FULL		0xFFU		// SYS, GYR, ACC and MAG all at 3 in CALIB_STAT
+
 #define BNO055_PAGE_0			0x00U
 #define BNO055_PAGE_1			0x01U
 
@@ -166,6 +187,23 @@
 #define BNO055_EULER_DEGREE_SCALE	(16.0f)
 #define BNO055_EULER_RADIAN_SCALE	(900.0f)
 
-#define BNO055_QUATERNION_SCALE		(0x4000f)
+#define BNO055_QUATERNION_SCALE		(16384.0f)		// 2^14 LSB per unit
+
+/* Raw to Q16.16 for the default units (m/s^2, uT, dps, degrees), q16 = (raw * MULT) >> SHIFT.
+   65536 / 100 is not integral, so accel family words carry 5 extra bits (0.002% error) */
+#define BNO055_Q16_MULT_ACCEL		(20972)		// 65536 / 100 << 5
+#define BNO055_Q16_SHIFT_ACCEL		(5U)
+#define BNO055_Q16_MULT_MAG			(4096)		// 65536 / 16
+#define BNO055_Q16_SHIFT_MAG		(0U)
+#define BNO055_Q16_MULT_GYRO		(4096)		// 65536 / 16
+#define BNO055_Q16_SHIFT_GYRO		(0U)
+#define BNO055_Q16_MULT_EULER		(4096)		// 65536 / 16
+#define BNO055_Q16_SHIFT_EULER		(0U)
+#define BNO055_Q16_MULT_QUATERNION	(4)			// 65536 / 16384
+#define BNO055_Q16_SHIFT_QUATERNION	(0U)
+#define BNO055_Q16_MULT_LIN_ACCEL	BNO055_Q16_MULT_ACCEL
+#define BNO055_Q16_SHIFT_LIN_ACCEL	BNO055_Q16_SHIFT_ACCEL
+#define BNO055_Q16_MULT_GRAVITY		BNO055_Q16_MULT_ACCEL
+#define BNO055_Q16_SHIFT_GRAVITY	BNO055_Q16_SHIFT_ACCEL
 
 #endif /* BNO055_REGS_H_ */
\ No newline at end of file
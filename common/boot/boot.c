@@ -0,0 +1,399 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "boot.h"
+#include "memory_layout.h"
+#include "tx_api.h"
+
+#if defined(__linux__)
+#include <time.h>
+#else
+#include "stm32h5xx.h"
+#endif
+
+#define BOOT_MAGIC              0xB0075EC5UL
+
+// Reset selects HSI/2 and SystemInit removes the divider. The H503 startup copies RAM before SystemInit, the H563 after.
+#if defined(__linux__)
+#define BOOT_STARTUP_CLOCK_HZ   1000000UL
+#elif defined(STM32H503xx)
+#define BOOT_STARTUP_CLOCK_HZ   (HSI_VALUE / 2U)
+#else
+#define BOOT_STARTUP_CLOCK_HZ   HSI_VALUE
+#endif
+
+// Static Data Types
+typedef struct
+{
+    uint32_t magic;
+    uint32_t bootCount;
+    uint32_t reached;
+    uint32_t cycles[BOOT_PHASE_COUNT];
+    uint32_t clockHz[BOOT_PHASE_COUNT];     // Core clock from the mark to the next one
+} sBootRecord;
+
+typedef struct
+{
+    BootStageFunc func;
+    sBootStage info;
+} sBootStageEntry;
+
+// Static Variables
+static const char *_phaseNames[BOOT_PHASE_COUNT] =
+{
+    "copy", "zero", "main", "hal", "clock", "bsp", "kernel", "mcan", "heartbeat", "ready",
+};
+
+// [0] is this boot, [1] the boot before the last reset
+static sBootRecord _records[2] MANTICORE_NOINIT;
+
+static sBootStageEntry _stages[BOOT_STAGE_MAX];
+static uint8_t _stageCount = 0;
+static bool _deferredStarted = false;
+
+// Deferred Init Thread
+#define THREAD_BOOT_STACK_SIZE 2048
+static TX_THREAD stThreadBoot;
+static uint8_t auThreadBootStack[THREAD_BOOT_STACK_SIZE];
+static void thread_boot(ULONG ctx);
+
+// Static Function Declarations
+static uint32_t _cycles(void);
+static uint32_t _coreClock(void);
+static void _newRecord(uint32_t now);
+static uint32_t _phaseUs(const sBootRecord *record, BOOT_PHASE phase);
+static BOOT_PHASE _lastBefore(const sBootRecord *record, uint32_t cycles);
+
+
+// Time sources
+#if defined(__linux__)
+
+// Linux port: microseconds since BootMark(BOOT_PHASE_MAIN), there is no startup code to stamp a reset
+uint32_t BootResetCycles[2];
+static uint64_t _epoch_US = 0;
+
+static uint32_t _cycles(void)
+{
+    struct timespec now;
+    uint64_t us;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    us = ((uint64_t) now.tv_sec * 1000000ULL) + ((uint64_t) now.tv_nsec / 1000ULL);
+    if(_epoch_US == 0)
+    {
+        _epoch_US = us;
+    }
+
+    return (uint32_t) (us - _epoch_US);
+}
+
+static uint32_t _coreClock(void)
+{
+    return 1000000UL;
+}
+
+#else
+
+// Stamped by the startup code, see startup_stm32h5xxx.s
+extern uint32_t BootResetCycles[2];
+
+// Started at reset by the startup code
+static uint32_t _cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+static uint32_t _coreClock(void)
+{
+    return SystemCoreClock;
+}
+
+#endif
+
+
+// Static Function Definitions
+static void _newRecord(uint32_t now)
+{
+    uint32_t bootCount = 0;
+
+    if(_records[0].magic == BOOT_MAGIC)
+    {
+        _records[1] = _records[0];
+        bootCount = _records[0].bootCount;
+    }
+    else
+    {
+        _records[1].magic = 0;
+    }
+
+    memset(&_records[0], 0, sizeof(_records[0]));
+    _records[0].bootCount = bootCount + 1;
+
+#if !defined(__linux__)
+    // Up to main the core runs from HSI, SystemCoreClock has not caught up with SystemInit yet
+    SystemCoreClockUpdate();
+    _records[0].cycles[BOOT_PHASE_COPY] = BootResetCycles[0];
+    _records[0].clockHz[BOOT_PHASE_COPY] = BOOT_STARTUP_CLOCK_HZ;
+    _records[0].cycles[BOOT_PHASE_ZERO] = BootResetCycles[1];
+    _records[0].clockHz[BOOT_PHASE_ZERO] = HSI_VALUE;
+    _records[0].reached = (1UL << BOOT_PHASE_COPY) | (1UL << BOOT_PHASE_ZERO);
+#endif
+
+    _records[0].cycles[BOOT_PHASE_MAIN] = now;
+    _records[0].clockHz[BOOT_PHASE_MAIN] = _coreClock();
+    _records[0].reached |= 1UL << BOOT_PHASE_MAIN;
+    _records[0].magic = BOOT_MAGIC;
+}
+
+// Latest reached phase stamped at or before cycles, BOOT_PHASE_COUNT when there is none
+static BOOT_PHASE _lastBefore(const sBootRecord *record, uint32_t cycles)
+{
+    BOOT_PHASE last = BOOT_PHASE_COUNT;
+
+    for(uint8_t phase = 0; phase < BOOT_PHASE_COUNT; phase++)
+    {
+        if((record->reached & (1UL << phase)) && record->cycles[phase] <= cycles &&
+           (last == BOOT_PHASE_COUNT || record->cycles[phase] >= record->cycles[last]))
+        {
+            last = (BOOT_PHASE) phase;
+        }
+    }
+
+    return last;
+}
+
+// Boards mark phases in different orders, so each interval is walked back through the marks before it
+static uint32_t _phaseUs(const sBootRecord *record, BOOT_PHASE phase)
+{
+    uint64_t us = 0;
+    uint32_t cycles = record->cycles[phase];
+    uint32_t clockHz = BOOT_STARTUP_CLOCK_HZ;
+    BOOT_PHASE prev;
+
+    if(cycles == 0)
+    {
+        return 0;
+    }
+
+    prev = _lastBefore(record, cycles - 1);
+    if(prev != BOOT_PHASE_COUNT)
+    {
+        us = _phaseUs(record, prev);
+        clockHz = record->clockHz[prev];
+        cycles -= record->cycles[prev];
+    }
+
+    return (uint32_t) (us + ((uint64_t) cycles * 1000000ULL) / clockHz);
+}
+
+
+// Public Functions
+void BootMark(BOOT_PHASE phase)
+{
+    TX_INTERRUPT_SAVE_AREA
+    uint32_t now = _cycles();
+
+    if(phase >= BOOT_PHASE_COUNT)
+    {
+        return;
+    }
+
+    TX_DISABLE
+    if(phase == BOOT_PHASE_MAIN)
+    {
+        _newRecord(now);
+    }
+    else if(_records[0].magic == BOOT_MAGIC && !(_records[0].reached & (1UL << phase)))
+    {
+        _records[0].cycles[phase] = now;
+        _records[0].clockHz[phase] = _coreClock();
+        _records[0].reached |= 1UL << phase;
+    }
+    TX_RESTORE
+}
+
+bool BootDefer(const char *name, BootStageFunc func)
+{
+    if(name == NULL || func == NULL || _deferredStarted || _stageCount >= BOOT_STAGE_MAX)
+    {
+        return false;
+    }
+
+    _stages[_stageCount].func = func;
+    _stages[_stageCount].info.name = name;
+    _stages[_stageCount].info.state = BOOT_STAGE_PENDING;
+    _stages[_stageCount].info.start_US = 0;
+    _stages[_stageCount].info.duration_US = 0;
+    _stageCount++;
+
+    return true;
+}
+
+bool BootStartDeferred(UINT priority)
+{
+    if(_deferredStarted)
+    {
+        return false;
+    }
+
+    _deferredStarted = true;
+
+    return tx_thread_create( &stThreadBoot,
+        "thread_boot",
+        thread_boot,
+        0,
+        auThreadBootStack,
+        THREAD_BOOT_STACK_SIZE,
+        priority,
+        priority,
+        0,
+        TX_AUTO_START) == TX_SUCCESS;
+}
+
+uint32_t BootCyclesToUs(uint32_t cycles)
+{
+    BOOT_PHASE prev;
+
+    if(_records[0].magic != BOOT_MAGIC)
+    {
+        return 0;
+    }
+
+    prev = _lastBefore(&_records[0], cycles);
+    if(prev == BOOT_PHASE_COUNT)
+    {
+        return 0;
+    }
+
+    return _phaseUs(&_records[0], prev) +
+           (uint32_t) (((uint64_t) (cycles - _records[0].cycles[prev]) * 1000000ULL) / _records[0].clockHz[prev]);
+}
+
+bool BootGetTimes(sBootTimes *times, bool previous)
+{
+    const sBootRecord *record = &_records[previous ? 1 : 0];
+
+    if(times == NULL || record->magic != BOOT_MAGIC)
+    {
+        return false;
+    }
+
+    memset(times, 0, sizeof(*times));
+    times->bootCount = record->bootCount;
+    times->reached = record->reached;
+
+    for(uint8_t phase = 0; phase < BOOT_PHASE_COUNT; phase++)
+    {
+        if(record->reached & (1UL << phase))
+        {
+            times->at_US[phase] = _phaseUs(record, (BOOT_PHASE) phase);
+        }
+    }
+
+    return true;
+}
+
+uint8_t BootGetStages(sBootStage stages[], uint8_t maxStages)
+{
+    uint8_t count = 0;
+
+    for(; count < _stageCount && count < maxStages; count++)
+    {
+        stages[count] = _stages[count].info;
+    }
+
+    return count;
+}
+
+const char *BootPhaseName(BOOT_PHASE phase)
+{
+    return (phase < BOOT_PHASE_COUNT) ? _phaseNames[phase] : "?";
+}
+
+uint16_t BootFormatReport(char buff[], uint16_t size, bool previous)
+{
+    static const char *stateNames[] = { "pending", "running", "ok", "failed" };
+    sBootTimes times;
+    int len = 0;
+    uint32_t last_US = 0;
+
+    if(buff == NULL || size == 0)
+    {
+        return 0;
+    }
+
+    if(!BootGetTimes(&times, previous))
+    {
+        return (uint16_t) snprintf(buff, size, "No boot record\r\n");
+    }
+
+    len = snprintf(buff, size, "Boot %lu, ms since reset\r\n%-10s %10s %10s\r\n",
+                   (unsigned long) times.bootCount, "phase", "at", "delta");
+
+    // Phases in the order this board reached them
+    for(uint8_t done = 0; done < BOOT_PHASE_COUNT && len > 0 && len < size; done++)
+    {
+        BOOT_PHASE next = BOOT_PHASE_COUNT;
+
+        for(uint8_t phase = 0; phase < BOOT_PHASE_COUNT; phase++)
+        {
+            if((times.reached & (1UL << phase)) &&
+               (next == BOOT_PHASE_COUNT || times.at_US[phase] < times.at_US[next]))
+            {
+                next = (BOOT_PHASE) phase;
+            }
+        }
+
+        if(next == BOOT_PHASE_COUNT)
+        {
+            break;
+        }
+
+        len += snprintf(&buff[len], size - len, "%-10s %6lu.%03lu %6lu.%03lu\r\n", BootPhaseName(next),
+                        (unsigned long) (times.at_US[next] / 1000UL), (unsigned long) (times.at_US[next] % 1000UL),
+                        (unsigned long) ((times.at_US[next] - last_US) / 1000UL),
+                        (unsigned long) ((times.at_US[next] - last_US) % 1000UL));
+        last_US = times.at_US[next];
+        times.reached &= ~(1UL << next);
+    }
+
+    // Stages only exist for this boot
+    for(uint8_t i = 0; !previous && i < _stageCount && len > 0 && len < size; i++)
+    {
+        const sBootStage *stage = &_stages[i].info;
+
+        len += snprintf(&buff[len], size - len, "  %-12s %6lu.%03lu %6lu.%03lu %s\r\n", stage->name,
+                        (unsigned long) (stage->start_US / 1000UL), (unsigned long) (stage->start_US % 1000UL),
+                        (unsigned long) (stage->duration_US / 1000UL), (unsigned long) (stage->duration_US % 1000UL),
+                        stateNames[stage->state]);
+    }
+
+    if(len < 0)
+    {
+        return 0;
+    }
+
+    return (len >= size) ? (uint16_t) (size - 1) : (uint16_t) len;
+}
+
+
+// Threads
+static void thread_boot(ULONG ctx)
+{
+    (void) ctx;
+
+    for(uint8_t i = 0; i < _stageCount; i++)
+    {
+        uint32_t start = _cycles();
+        bool ok;
+
+        _stages[i].info.start_US = BootCyclesToUs(start);
+        _stages[i].info.state = BOOT_STAGE_RUNNING;
+        ok = _stages[i].func();
+        _stages[i].info.duration_US = BootCyclesToUs(_cycles()) - _stages[i].info.start_US;
+        _stages[i].info.state = ok ? BOOT_STAGE_OK : BOOT_STAGE_FAILED;
+    }
+
+    BootMark(BOOT_PHASE_READY);
+}
@@ -0,0 +1,89 @@
+#ifndef __BOOT_H
+#define __BOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tx_api.h"
+
+/*********************************************************************************
+    Boot profiler and deferred init stages.
+
+    The startup code starts the DWT cycle counter at reset and stamps the end
+    of the RAM copy and zero loops. BootMark stamps the later phases. Marks are
+    kept in .noinit RAM, so the record of the previous boot survives a reset
+    and is still there when BootMark(BOOT_PHASE_MAIN) starts a new one.
+
+    Each interval is converted to time at the core clock in effect at its
+    start. The counter wraps after ~17 s at 250 MHz, which is the longest boot
+    that can be timed.
+
+    Slow bring-up (IMUs, motors, calibration loads) goes into deferred stages.
+    They run in order on a low priority thread started by BootStartDeferred,
+    so the module is on MCAN with its heartbeat running while they settle.
+    BOOT_PHASE_READY is marked once the last stage returns.
+***********************************************************************************/
+
+#define BOOT_STAGE_MAX          8
+#define BOOT_REPORT_SIZE        768     // Enough for every phase and stage
+
+typedef enum
+{
+    BOOT_PHASE_COPY,                    // Startup copy loops done, stamped by the startup code
+    BOOT_PHASE_ZERO,                    // .bss zeroed, stamped by the startup code
+    BOOT_PHASE_MAIN,                    // main entered, starts a new record
+    BOOT_PHASE_HAL,                     // HAL_Init done
+    BOOT_PHASE_CLOCK,                   // PLL running, flash latency set
+    BOOT_PHASE_BSP,                     // Board peripherals initialized
+    BOOT_PHASE_KERNEL,                  // ThreadX running
+    BOOT_PHASE_MCAN,                    // MCAN_Init done
+    BOOT_PHASE_HEARTBEAT,               // First heartbeat queued for transmission
+    BOOT_PHASE_READY,                   // Last deferred stage finished
+    BOOT_PHASE_COUNT,
+} BOOT_PHASE;
+
+typedef enum
+{
+    BOOT_STAGE_PENDING,
+    BOOT_STAGE_RUNNING,
+    BOOT_STAGE_OK,
+    BOOT_STAGE_FAILED,
+} BOOT_STAGE_STATE;
+
+// Runs on the deferred init thread and may block. Return false on failure, later stages still run.
+typedef bool (*BootStageFunc)(void);
+
+typedef struct
+{
+    const char *name;
+    BOOT_STAGE_STATE state;
+    uint32_t start_US;                  // Since reset
+    uint32_t duration_US;
+} sBootStage;
+
+typedef struct
+{
+    uint32_t bootCount;                 // Boots since the record was last lost to power off
+    uint32_t reached;                   // Bit per BOOT_PHASE
+    uint32_t at_US[BOOT_PHASE_COUNT];   // Since reset, valid where reached
+} sBootTimes;
+
+// Safe from any context, phases after BOOT_PHASE_MAIN are stamped once per boot
+void BootMark(BOOT_PHASE phase);
+
+// Deferred stages, registered before BootStartDeferred
+bool BootDefer(const char *name, BootStageFunc func);
+bool BootStartDeferred(UINT priority);
+
+// Microseconds since reset for a time stamp taken with DWT->CYCCNT
+uint32_t BootCyclesToUs(uint32_t cycles);
+
+// previous = false for this boot, true for the boot before the last reset. False when there is no record.
+bool BootGetTimes(sBootTimes *times, bool previous);
+uint8_t BootGetStages(sBootStage stages[], uint8_t maxStages);
+const char *BootPhaseName(BOOT_PHASE phase);
+
+// Renders phases and stages as console text, returns the length written
+uint16_t BootFormatReport(char buff[], uint16_t size, bool previous);
+
+#endif /* __BOOT_H */
@@ -4,7 +4,10 @@
 #include <stdarg.h>
 
 #include "console.h"
+#include "latency.h"
 #include "native_commands.h"
+#include "prof.h"
+#include "remote_console.h"
 #include "stm32h5xx_hal.h"
 #include "tx_api.h"
 
@@ -15,8 +18,8 @@ static UART_HandleTypeDef * _ConsoleUart;
 static char ConsoleOutBuff[CONSOLE_MAX_CHAR];
 static TX_MUTEX ConsoleOutBuffMutex;
 
-#define MAX_COMMANDS 10
-#define MAX_COMMAND_ARGS 11
+#define MAX_COMMANDS 16
+#define MAX_COMMAND_ARGS CONSOLE_MAX_ARGS
 #define ARG_STRING_BUFF_SIZE 30
 #define COMM_HELP_SPACING 15
 static uint8_t registeredCommands = 0;
@@ -33,12 +36,19 @@ static const char DEL = 127;
 static const char BACKSPACE = '\b';
 static const char CTRL_C = '\003';
 static const char NULL_CHAR = '\0';
-static const uint8_t IN_CHAR_SLEEP = 50;
 
 static bool enableLogging = false;
 
-static volatile char UART_RxChar;
-static volatile bool newChar = false;
+static volatile uint8_t _uartRxByte;
+static volatile char UART_RxChar;               // Last character received, for Ctrl-C detection
+
+// Input ring, filled by the UART ISR and ConsoleInjectInput, drained by the console thread
+#define CONSOLE_IN_RING_SIZE 64                 // Power of two
+static volatile char _inRing[CONSOLE_IN_RING_SIZE];
+static volatile uint8_t _inHead = 0;
+static volatile uint8_t _inTail = 0;
+static TX_EVENT_FLAGS_GROUP _inEvent;          // Set on every push, the console thread blocks on it
+#define CONSOLE_IN_FLAG 0x1
 
 // Console Thread
 #define THREAD_CONSOLE_STACK_SIZE 4096
@@ -59,6 +69,8 @@ ConsoleComm_t *_getCommand(void);                       // [BLOCKING] process in
 void _initArgvBuff(void);
 void _exeComm(ConsoleComm_t *comm);                 // Execute command
 int8_t _findCommIndex(char commName[]);                  // Find command in the commArr by name
+static bool _inRingPush(char inChar);               // Caller excludes other producers
+static bool _inRingPop(char *inChar);
 
 void _consoleUnlock(void)
 {
@@ -143,16 +155,49 @@ void _exeComm(ConsoleComm_t *comm)
     comm->command(argvBuff);
 }
 
+static bool _inRingPush(char inChar)
+{
+    uint8_t next = (_inHead + 1) & (CONSOLE_IN_RING_SIZE - 1);
+
+    if(next == _inTail)
+    {
+        return false;
+    }
+
+    _inRing[_inHead] = inChar;
+    _inHead = next;
+    UART_RxChar = inChar;
+
+    return true;
+}
+
+static bool _inRingPop(char *inChar)
+{
+    if(_inTail == _inHead)
+    {
+        return false;
+    }
+
+    *inChar = _inRing[_inTail];
+    _inTail = (_inTail + 1) & (CONSOLE_IN_RING_SIZE - 1);
+
+    return true;
+}
+
 // Global Functions
 void ConsoleInit(UART_HandleTypeDef * ConsoleUart)
 {
     _ConsoleUart = ConsoleUart;
 
+    // Serializes every writer of the console UART
+    tx_mutex_create(&ConsoleOutBuffMutex, "console_out_mutex", TX_INHERIT);
+    tx_event_flags_create(&_inEvent, "console_in_event");
+
     // Initialize buffers
     _initArgvBuff();
 
     // Start UART Rx interrupts
-    HAL_UART_Receive_IT(_ConsoleUart, &UART_RxChar, sizeof(char)); 
+    HAL_UART_Receive_IT(_ConsoleUart, (uint8_t *) &_uartRxByte, sizeof(char)); 
 
     tx_thread_create( &stThreadConsole, 
         "thread_console", 
@@ -171,31 +216,58 @@ void ConsoleInit(UART_HandleTypeDef * ConsoleUart)
 // Char functions
 char ConsoleInChar(void)
 {
-    // Loiter until new character 
-    while(!newChar)
+    char inChar;
+    ULONG flags;
+
+    // Block until a push, the flag may be left over from a character already read
+    LATENCY_WAIT(LAT_SRC_UART);
+    while(!_inRingPop(&inChar))
     {
-        tx_thread_sleep(IN_CHAR_SLEEP);
+        tx_event_flags_get(&_inEvent, CONSOLE_IN_FLAG, TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
     }
+    LATENCY_WAKE(LAT_SRC_UART);
 
     // If delete or backspace, print a backspace
-    if(UART_RxChar == DEL || UART_RxChar == BACKSPACE)
+    if(inChar == DEL || inChar == BACKSPACE)
     {
         ConsolePrint("%c", BACKSPACE);
         ConsolePrint(" ");
         ConsolePrint("%c", BACKSPACE);
-        UART_RxChar = BACKSPACE;
+        inChar = BACKSPACE;
     }
-    else if(UART_RxChar == CTRL_C)
+    else if(inChar != CTRL_C)
     {
-        UART_RxChar = CTRL_C;
+        ConsolePrint("%c", inChar);
     }
-    else
+
+    return inChar;
+}
+
+// Nonblocking read without echo, for commands that forward raw keystrokes
+bool ConsoleReadRaw(char *inChar)
+{
+    return _inRingPop(inChar);
+}
+
+// Queue characters as if they were typed on the console UART
+uint16_t ConsoleInjectInput(const char buff[], uint16_t len)
+{
+    TX_INTERRUPT_SAVE_AREA
+    uint16_t accepted = 0;
+
+    TX_DISABLE
+    while(accepted < len && _inRingPush(buff[accepted]))
+    {
+        accepted++;
+    }
+    TX_RESTORE
+
+    if(accepted > 0)
     {
-        ConsolePrint("%c", UART_RxChar);
+        tx_event_flags_set(&_inEvent, CONSOLE_IN_FLAG, TX_OR);
     }
 
-    newChar = false;
-    return UART_RxChar;
+    return accepted;
 }
 
 // Nonblocking ctrl C detection
@@ -322,6 +394,7 @@ void ConsoleClear(void)
 
 bool ConsolePrint(char message[], ...)
 {
+    PROF_SCOPE(PROF_CONSOLE_PRINT);
     va_list ap;
     uint8_t messageLen = strlen(message);
     uint8_t constructedMessageLen;
@@ -355,6 +428,7 @@ bool ConsolePrint(char message[], ...)
 
     // Print
     HAL_UART_Transmit(_ConsoleUart, (uint8_t *) ConsoleOutBuff, constructedMessageLen, HAL_MAX_DELAY);
+    RemoteConsoleOutput(ConsoleOutBuff, constructedMessageLen);
     
     // Release console buff mutex    
     tx_mutex_put(&ConsoleOutBuffMutex);                  // exit critical section
@@ -362,9 +436,40 @@ bool ConsolePrint(char message[], ...)
     return true;
 }
 
+// Write a pre-rendered buffer in one transmit, skipping the format path
+bool ConsoleWrite(const char buff[], uint16_t len)
+{
+    if(len == 0)
+    {
+        return true;
+    }
+
+    tx_mutex_get(&ConsoleOutBuffMutex, TX_WAIT_FOREVER);
+    HAL_UART_Transmit(_ConsoleUart, (uint8_t *) buff, len, HAL_MAX_DELAY);
+    RemoteConsoleOutput(buff, len);
+    tx_mutex_put(&ConsoleOutBuffMutex);
+
+    return true;
+}
+
+// Local UART only, for binary frames and output that already came from a remote console
+bool ConsoleWriteRaw(const char buff[], uint16_t len)
+{
+    if(len == 0)
+    {
+        return true;
+    }
+
+    tx_mutex_get(&ConsoleOutBuffMutex, TX_WAIT_FOREVER);
+    HAL_UART_Transmit(_ConsoleUart, (uint8_t *) buff, len, HAL_MAX_DELAY);
+    tx_mutex_put(&ConsoleOutBuffMutex);
+
+    return true;
+}
+
 bool ConsoleRegisterComm(ConsoleComm_t * command)
 {
-    if( registeredCommands == MAX_COMMANDS - 1)
+    if( command == NULL || registeredCommands >= MAX_COMMANDS)
     {
         return false;
     }
@@ -411,7 +516,7 @@ void thread_console(ULONG ctx)
         {
             ConsolePrint("Invalid Command!");
         }
-        else if ( _argIndex != newCommand->argumentCount)
+        else if ( newCommand->argumentCount != CONSOLE_VARIADIC_ARGS && _argIndex != newCommand->argumentCount)
         {
             ConsolePrint("Invalid argument Count. %s has %d arguments.", newCommand->name, newCommand->argumentCount);
         }
@@ -424,8 +529,20 @@ void thread_console(ULONG ctx)
     }
 }
 
+__weak bool ConsoleBinaryRxByte(uint8_t rxByte)
+{
+    return false;
+}
+
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) 
 {
-    newChar = true;
-    HAL_UART_Receive_IT(_ConsoleUart, &UART_RxChar, sizeof(char)); 
+    // Bytes claimed by a binary channel never reach the text console
+    if(!ConsoleBinaryRxByte(_uartRxByte))
+    {
+        _inRingPush((char) _uartRxByte);
+        LATENCY_SIGNAL(LAT_SRC_UART);
+        tx_event_flags_set(&_inEvent, CONSOLE_IN_FLAG, TX_OR);
+    }
+
+    HAL_UART_Receive_IT(_ConsoleUart, (uint8_t *) &_uartRxByte, sizeof(char)); 
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 #define CONSOLE_NAME_MAX_CHAR 25
 #define CONSOLE_HELP_MAX_CHAR 50
+#define CONSOLE_MAX_ARGS 11
+#define CONSOLE_VARIADIC_ARGS 0xFF   // argumentCount for commands that validate their own arguments
 
 typedef enum
 {
@@ -28,6 +30,7 @@ typedef struct
 void ConsoleInit(UART_HandleTypeDef *ConsoleUart);
 
 char ConsoleInChar(void);
+bool ConsoleReadRaw(char *inChar);                                  // Nonblocking, no echo
 bool ConsoleDetectCtrlC(void);
 char ConsoleInCharFilter(char charFilter[], uint8_t filterSize);    // Wait for input char in filter
 
@@ -37,7 +40,16 @@ void ConsoleInString(char inString[], uint8_t stringMaxLen);
 void ConsoleClear(void);
 bool ConsolePrint(char message[], ...);
 bool ConsoleLog(LOG_PRI pri, char message[], ...);
+bool ConsoleWrite(const char buff[], uint16_t len);                 // Unformatted write of a pre-rendered buffer
+bool ConsoleWriteRaw(const char buff[], uint16_t len);              // Same, but never mirrored to a remote console session
 
 bool ConsoleRegisterComm(ConsoleComm_t *command);
 
+// Queue input as if typed on the console UART, returns the number of characters accepted
+uint16_t ConsoleInjectInput(const char buff[], uint16_t len);
+
+// Called from the UART ISR for every received byte. Return true to claim the byte
+// for a binary protocol sharing the console UART, false to pass it to the console.
+__weak bool ConsoleBinaryRxByte(uint8_t rxByte);
+
 #endif
\ No newline at end of file
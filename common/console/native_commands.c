@@ -1,21 +1,94 @@
 #include "native_commands.h"
+#include "boot.h"
 #include "console.h"
+#include "latency.h"
 #include "mcan.h"
+#include "mcan_rpc.h"
+#include "prof.h"
+#include "remote_console.h"
+#include "sysmon.h"
+#include "trace.h"
 #include "tx_api.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define UINT29_MAX 2 << 28
 #define PRI_FIELD_MAX 15
 #define CAT_FIELD_MAX 19
 #define DEV_FIELD_MAX 19
 
+#define DUMP_DATA_BYTES 8
+#define CAPTURE_RING_SIZE 32                // Must be a power of two
+#define CAPTURE_RING_MASK (CAPTURE_RING_SIZE - 1)
+#define DUMP_OUT_BUFF_SIZE 512
+#define DUMP_LINE_MAX_CHAR 120
+#define DUMP_CAPTURE_FLAG 0x1
+
+#define TOP_OUT_BUFF_SIZE 2048
+#define TOP_DEFAULT_PERIOD_MS 1000
+#define TOP_MIN_PERIOD_MS 100
+#define TOP_POLL_MS 10
+
+#define REMOTE_POLL_MS 5
+
+// Static Data Types
+typedef struct
+{
+    const char *name;
+    ULONG mask;
+} sTraceClass;
+
+typedef struct
+{
+    sMCAN_ID mcanID;
+    uint8_t data[DUMP_DATA_BYTES];
+} sCaptureEntry;
+
+typedef struct
+{
+    uint8_t priMask;                        // Bit per MCAN_PRI
+    uint8_t catMask;                        // Bit per MCAN_CAT
+    MCAN_DEV txMask;
+    MCAN_DEV rxMask;
+    MCAN_DEV devMask;                       // Either sender or receiver
+    uint32_t summaryPeriod;                 // 0 = print every frame
+} sDumpFilter;
+
+typedef void (*DumpRender)(const sCaptureEntry *entry, char **out);
+
 // Static Variables
-static bool _newRxMessage = false;
-static sMCAN_Message _mcanRxMessage = {0};
 static const uint8_t COMMAND_DELAY = 2;
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+static const sTraceClass TRACE_CLASSES[] = {
+    {"all",      TX_TRACE_ALL_EVENTS | TX_TRACE_USER_EVENTS},
+    {"internal", TX_TRACE_INTERNAL_EVENTS},
+    {"thread",   TX_TRACE_THREAD_EVENTS},
+    {"flags",    TX_TRACE_EVENT_FLAGS_EVENTS},
+    {"mutex",    TX_TRACE_MUTEX_EVENTS},
+    {"queue",    TX_TRACE_QUEUE_EVENTS},
+    {"sema",     TX_TRACE_SEMAPHORE_EVENTS},
+    {"timer",    TX_TRACE_TIMER_EVENTS},
+    {"time",     TX_TRACE_TIME_EVENTS},
+    {"block",    TX_TRACE_BLOCK_POOL_EVENTS},
+    {"byte",     TX_TRACE_BYTE_POOL_EVENTS},
+    {"user",     TX_TRACE_USER_EVENTS},
+};
+static const char *THREAD_STATE_NAMES[] = {
+    "READY", "DONE", "TERM", "SUSP", "SLEEP", "QUEUE", "SEMA", "EVENT",
+    "BLOCK", "BYTE", "IO", "FILE", "TCPIP", "MUTEX", "PRIO",
+};
+
+// Capture ring, filled from the FDCAN ISR and drained by the dump commands
+static sCaptureEntry _captureRing[CAPTURE_RING_SIZE];
+static volatile uint32_t _captureHead = 0;
+static volatile uint32_t _captureTail = 0;
+static volatile uint32_t _captureDropped = 0;
+static volatile bool _captureEnabled = false;
+static TX_EVENT_FLAGS_GROUP _captureEvent;
 
 // Static Function Declarations
 static void _helloWorld(char *argv[]);
@@ -23,6 +96,26 @@ static void _candump(char *argv[]);
 static void _cansend(char *argv[]);
 static void _mcandump(char *argv[]);
 static void _mcansend(char *argv[]);
+static void _top(char *argv[]);
+static void _trace(char *argv[]);
+static void _remote(char *argv[]);
+static void _rpc(char *argv[]);
+static void _boot(char *argv[]);
+static void _prof(char *argv[]);
+static void _printProf(PROF_ID id, const sProfStats *stats);
+static void _latency(char *argv[]);
+static void _printLatency(const char *load);
+static void _latencyConsoleLoad(void);
+static void _latencyCanFloodLoad(void);
+
+static void _captureStart(void);
+static void _captureStop(void);
+static bool _captureRead(sCaptureEntry *entry);
+static bool _parseDumpFilter(char *argv[], sDumpFilter *filter);
+static bool _filterMatch(const sDumpFilter *filter, const sCaptureEntry *entry);
+static void _dumpLoop(char *argv[], DumpRender render);
+static void _renderCandump(const sCaptureEntry *entry, char **out);
+static void _renderMcandump(const sCaptureEntry *entry, char **out);
 
 // Static Data Structions
 ConsoleComm_t _commHelloWorld = {
@@ -34,8 +127,8 @@ ConsoleComm_t _commHelloWorld = {
 
 ConsoleComm_t _commCandump = {
     "candump",
-    "View raw received CAN message",
-    1,
+    "Raw CAN dump [pri= cat= tx= rx= dev= summary=]",
+    CONSOLE_VARIADIC_ARGS,
     _candump,
 };
 
@@ -48,8 +141,8 @@ ConsoleComm_t _commCansend = {
 
 ConsoleComm_t _commMcandump = {
     "mcandump",
-    "View decoded MCAN messages",
-    1,
+    "MCAN dump [pri= cat= tx= rx= dev= summary=]",
+    CONSOLE_VARIADIC_ARGS,
     _mcandump,
 };
 
@@ -61,43 +154,472 @@ ConsoleComm_t _commMcansend = {
 };
 
 
+ConsoleComm_t _commTop = {
+    "top",
+    "Thread CPU, ISR, idle and stack usage [period_ms]",
+    CONSOLE_VARIADIC_ARGS,
+    _top,
+};
+
+ConsoleComm_t _commTrace = {
+    "trace",
+    "ThreadX trace: start [class..] | stop | stats",
+    CONSOLE_VARIADIC_ARGS,
+    _trace,
+};
+
+ConsoleComm_t _commRemote = {
+    "remote",
+    "Console on another module over MCAN: dev | stats",
+    2,
+    _remote,
+};
+
+ConsoleComm_t _commRpc = {
+    "rpc",
+    "MCAN call: dev method [hex bytes..] | stats",
+    CONSOLE_VARIADIC_ARGS,
+    _rpc,
+};
+
+ConsoleComm_t _commBoot = {
+    "boot",
+    "Boot phase and init stage times [prev]",
+    CONSOLE_VARIADIC_ARGS,
+    _boot,
+};
+
+ConsoleComm_t _commProf = {
+    "prof",
+    "PROF_SCOPE probes, us: [dev] | reset",
+    CONSOLE_VARIADIC_ARGS,
+    _prof,
+};
+
+ConsoleComm_t _commLatency = {
+    "latency",
+    "ISR latency, ns: [run [seconds] | reset]",
+    CONSOLE_VARIADIC_ARGS,
+    _latency,
+};
+
+
 // Static Function Definitions
 static void _helloWorld(char *argv[])
 {
     ConsolePrint("Hello world!");
 }
 
-static void _candump(char *argv[])
+// Fast formatters, each returns the advanced write pointer
+static inline char *_appendHex(char *out, uint32_t value, uint8_t digits)
+{
+    for(int8_t i = digits - 1; i >= 0; i--)
+    {
+        out[i] = HEX_DIGITS[value & 0xF];
+        value >>= 4;
+    }
+
+    return out + digits;
+}
+
+static inline char *_appendDec(char *out, uint32_t value, uint8_t minDigits)
+{
+    char digits[10];
+    uint8_t len = 0;
+
+    do
+    {
+        digits[len++] = '0' + (value % 10);
+        value /= 10;
+    } while(value != 0);
+
+    while(len < minDigits)
+    {
+        digits[len++] = '0';
+    }
+
+    while(len > 0)
+    {
+        *out++ = digits[--len];
+    }
+
+    return out;
+}
+
+static inline char *_appendStr(char *out, const char *str)
 {
-    uint32_t CanID = 0;
+    while(*str != '\0')
+    {
+        *out++ = *str++;
+    }
+
+    return out;
+}
+
+static inline char *_appendPadded(char *out, const char *str, uint8_t width)
+{
+    uint8_t len = 0;
+
+    while(str[len] != '\0' && len < width)
+    {
+        *out++ = str[len++];
+    }
+
+    while(len++ < width)
+    {
+        *out++ = ' ';
+    }
+
+    return out;
+}
+
+static inline char *_appendPayload(char *out, const uint8_t data[DUMP_DATA_BYTES])
+{
+    *out++ = '[';
+    out = _appendDec(out, DUMP_DATA_BYTES, 1);
+    *out++ = ']';
+    *out++ = ' ';
+
+    for(uint8_t i = 0; i < DUMP_DATA_BYTES; i++)
+    {
+        out = _appendHex(out, data[i], 2);
+        *out++ = ' ';
+    }
+
+    *out++ = '\r';
+    *out++ = '\n';
+
+    return out;
+}
+
+// Case insensitive match of an argument against an MCAN name, with or without its "XXX_" prefix
+static bool _matchName(const char *arg, const char *name)
+{
+    const char *shortName = strchr(name, '_');
+
+    for(uint8_t pass = 0; pass < 2; pass++)
+    {
+        const char *a = arg;
+        const char *n = (pass == 0) ? name : shortName + 1;
+
+        if(pass == 1 && shortName == NULL)
+        {
+            break;
+        }
+
+        while(*a != '\0' && *n != '\0' && (*a | 0x20) == (*n | 0x20))
+        {
+            a++;
+            n++;
+        }
+
+        if(*a == '\0' && *n == '\0')
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Parses a comma separated value list into a bitmask, returns false on an unknown value
+static bool _parseMask(char *list, uint8_t count, const char *(*toString)(uint32_t index), uint32_t *mask)
+{
+    char *save = NULL;
+    char *value = strtok_r(list, ",", &save);
+
+    *mask = 0;
+    while(value != NULL)
+    {
+        bool found = false;
+
+        for(uint8_t i = 0; i < count; i++)
+        {
+            if(_matchName(value, toString(i)))
+            {
+                *mask |= 1UL << i;
+                found = true;
+                break;
+            }
+        }
+
+        if(!found)
+        {
+            ConsolePrint("Unknown filter value: %s \r\n", value);
+            return false;
+        }
+
+        value = strtok_r(NULL, ",", &save);
+    }
+
+    return *mask != 0;
+}
+
+static const char *_priIndexString(uint32_t index) { return MCAN_Pri_String((MCAN_PRI) index); }
+static const char *_catIndexString(uint32_t index) { return MCAN_Cat_String((MCAN_CAT) index); }
+static const char *_devIndexString(uint32_t index) { return MCAN_Dev_String((MCAN_DEV) (1UL << index)); }
+
+/*********************************************************************************
+    Parses dump filter expressions of the form key=value[,value...]
+
+        pri=     message priority       (EMERGENCY, ERROR, WARNING, DEBUG)
+        cat=     message category       (COMMAND, RESPONSE, HEARTBEAT, ...)
+        tx=      sending device         (POWER, COMPUTE, DEBUG, ...)
+        rx=      receiving device
+        dev=     sending or receiving device
+        summary= print per-priority counts every N ms instead of every frame
+
+    Names may be given with or without their PRI_/CAT_/DEV_ prefix.
+***********************************************************************************/
+static bool _parseDumpFilter(char *argv[], sDumpFilter *filter)
+{
+    uint32_t mask = 0;
+
+    filter->priMask = 0xFF;
+    filter->catMask = 0xFF;
+    filter->txMask  = DEV_ALL;
+    filter->rxMask  = DEV_ALL;
+    filter->devMask = DEV_ALL;
+    filter->summaryPeriod = 0;
+
+    for(uint8_t i = 1; i < CONSOLE_MAX_ARGS && argv[i][0] != '\0'; i++)
+    {
+        char *value = strchr(argv[i], '=');
+        if(value == NULL)
+        {
+            ConsolePrint("Invalid filter: %s \r\n", argv[i]);
+            return false;
+        }
+        *value++ = '\0';
+
+        if(strcmp(argv[i], "pri") == 0)
+        {
+            if(!_parseMask(value, MCAN_PRI_COUNT, _priIndexString, &mask))
+                return false;
+            filter->priMask = mask;
+        }
+        else if(strcmp(argv[i], "cat") == 0)
+        {
+            if(!_parseMask(value, MCAN_CAT_COUNT, _catIndexString, &mask))
+                return false;
+            filter->catMask = mask;
+        }
+        else if(strcmp(argv[i], "tx") == 0 || strcmp(argv[i], "rx") == 0 || strcmp(argv[i], "dev") == 0)
+        {
+            if(!_parseMask(value, MCAN_DEV_COUNT, _devIndexString, &mask))
+                return false;
+
+            if(argv[i][0] == 't')
+                filter->txMask = mask;
+            else if(argv[i][0] == 'r')
+                filter->rxMask = mask;
+            else
+                filter->devMask = mask;
+        }
+        else if(strcmp(argv[i], "summary") == 0)
+        {
+            filter->summaryPeriod = strtoul(value, NULL, 10);
+            if(filter->summaryPeriod == 0)
+            {
+                ConsolePrint("Invalid summary period! \r\n");
+                return false;
+            }
+        }
+        else
+        {
+            ConsolePrint("Unknown filter key: %s \r\n", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool _filterMatch(const sDumpFilter *filter, const sCaptureEntry *entry)
+{
+    const sMCAN_ID *id = &entry->mcanID;
+
+    if((filter->priMask & (1U << id->MCAN_PRIORITY)) == 0)
+        return false;
+
+    if((filter->catMask & (1U << id->MCAN_CAT)) == 0)
+        return false;
+
+    if((id->MCAN_TX_Device & filter->txMask) == 0 || (id->MCAN_RX_Device & filter->rxMask) == 0)
+        return false;
+
+    return ((id->MCAN_TX_Device | id->MCAN_RX_Device) & filter->devMask) != 0;
+}
+
+// Capture ring functions
+static void _captureStart(void)
+{
+    _captureTail = _captureHead;
+    _captureDropped = 0;
+    _captureEnabled = true;
+}
+
+static void _captureStop(void)
+{
+    _captureEnabled = false;
+}
+
+static bool _captureRead(sCaptureEntry *entry)
+{
+    uint32_t tail = _captureTail;
+
+    if(tail == _captureHead)
+    {
+        return false;
+    }
+
+    *entry = _captureRing[tail & CAPTURE_RING_MASK];
+    _captureTail = tail + 1;
+
+    return true;
+}
+
+static void _renderCandump(const sCaptureEntry *entry, char **out)
+{
+    uint32_t canID = 0;
+    char *p = *out;
+
+    MCAN_Conv_ID_To_Uint32((sMCAN_ID *) &entry->mcanID, &canID);
+    p = _appendHex(p, canID, 8);
+    p = _appendStr(p, "   ");
+    p = _appendPayload(p, entry->data);
+
+    *out = p;
+}
+
+static void _renderMcandump(const sCaptureEntry *entry, char **out)
+{
+    const sMCAN_ID *id = &entry->mcanID;
+    char *p = *out;
+
+    p = _appendDec(p, id->MCAN_TimeStamp, 4);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = _appendPadded(p, MCAN_Pri_String(id->MCAN_PRIORITY), PRI_FIELD_MAX);
+    *p++ = ' ';
+    p = _appendPadded(p, MCAN_Cat_String(id->MCAN_CAT), CAT_FIELD_MAX);
+    p = _appendStr(p, " TX_");
+    p = _appendPadded(p, MCAN_Dev_String(id->MCAN_TX_Device), DEV_FIELD_MAX - 3);
+    p = _appendStr(p, " RX_");
+    p = _appendPadded(p, MCAN_Dev_String(id->MCAN_RX_Device), DEV_FIELD_MAX - 3);
+    *p++ = ' ';
+    p = _appendPayload(p, entry->data);
+
+    *out = p;
+}
+
+static void _renderSummary(uint32_t period, const uint32_t priCount[MCAN_PRI_COUNT], uint32_t dropped, char **out)
+{
+    static const char *const priLabel[MCAN_PRI_COUNT] = { " EMRG=", " ERR=", " WARN=", " DBG=" };
+    uint32_t total = 0;
+    char *p = *out;
+
+    for(uint8_t i = 0; i < MCAN_PRI_COUNT; i++)
+    {
+        total += priCount[i];
+    }
+
+    p = _appendStr(p, "[summary] frames=");
+    p = _appendDec(p, total, 1);
+    p = _appendStr(p, " per ");
+    p = _appendDec(p, period, 1);
+    p = _appendStr(p, "ms drop=");
+    p = _appendDec(p, dropped, 1);
+
+    for(uint8_t i = 0; i < MCAN_PRI_COUNT; i++)
+    {
+        p = _appendStr(p, priLabel[i]);
+        p = _appendDec(p, priCount[i], 1);
+    }
+
+    *p++ = '\r';
+    *p++ = '\n';
+
+    *out = p;
+}
+
+// Shared body of candump and mcandump, batches rendered lines into a single console write
+static void _dumpLoop(char *argv[], DumpRender render)
+{
+    static char outBuff[DUMP_OUT_BUFF_SIZE];
+    sDumpFilter filter;
+    sCaptureEntry entry;
+    uint32_t priCount[MCAN_PRI_COUNT] = {0};
+    uint32_t reportedDrops = 0;
+    uint32_t lastSummary;
+    ULONG flags;
+
+    if(!_parseDumpFilter(argv, &filter))
+    {
+        return;
+    }
+
+    _captureStart();
+    lastSummary = tx_time_get();
+
     while(true)
     {
-        if(_newRxMessage)
+        char *out = outBuff;
+
+        // Drain the ring, flushing whenever another line might not fit
+        while(_captureRead(&entry))
         {
-            // Print ID
-            MCAN_Conv_ID_To_Uint32(&(_mcanRxMessage.mcanID), &CanID );
-            ConsolePrint("%08X ", CanID);  
+            if(!_filterMatch(&filter, &entry))
+            {
+                continue;
+            }
 
-            // Print Payload
-            ConsolePrint("  [8] ");
-            for(uint8_t i = 0; i < 8; i++)
+            if(filter.summaryPeriod != 0)
             {
-                ConsolePrint ("%02X ", _mcanRxMessage.mcanData[i]);
-            } 
+                priCount[entry.mcanID.MCAN_PRIORITY]++;
+                continue;
+            }
+
+            render(&entry, &out);
 
-            ConsolePrint("\r\n");
+            if(out - outBuff > DUMP_OUT_BUFF_SIZE - DUMP_LINE_MAX_CHAR)
+            {
+                ConsoleWrite(outBuff, out - outBuff);
+                out = outBuff;
+            }
+        }
 
-            _newRxMessage = false;
+        if(filter.summaryPeriod != 0 && (tx_time_get() - lastSummary) >= filter.summaryPeriod)
+        {
+            _renderSummary(filter.summaryPeriod, priCount, _captureDropped - reportedDrops, &out);
+            reportedDrops = _captureDropped;
+            memset(priCount, 0, sizeof(priCount));
+            lastSummary = tx_time_get();
         }
 
+        ConsoleWrite(outBuff, out - outBuff);
+
         // exit if control C is detected
         if(ConsoleDetectCtrlC())
         {
             break;
         }
 
-        tx_thread_sleep(COMMAND_DELAY);
+        // Sleep until the ISR signals a new frame
+        tx_event_flags_get(&_captureEvent, DUMP_CAPTURE_FLAG, TX_OR_CLEAR, &flags, COMMAND_DELAY);
     }
+
+    _captureStop();
+
+    if(_captureDropped != 0)
+    {
+        ConsolePrint("%lu frames dropped \r\n", (unsigned long) _captureDropped);
+    }
+}
+
+static void _candump(char *argv[])
+{
+    _dumpLoop(argv, _renderCandump);
 }
 
 static void _cansend(char *argv[])
@@ -139,80 +661,505 @@ static void _cansend(char *argv[])
 
 static void _mcandump(char *argv[])
 {
-    static const uint8_t priFieldMax = PRI_FIELD_MAX;
-    static char priField[PRI_FIELD_MAX] = {0};
-    priField[PRI_FIELD_MAX-1] = NULL;
-   
-    static const uint8_t catFieldMax = CAT_FIELD_MAX;
-    static char catField[CAT_FIELD_MAX] = {0};
-    catField[CAT_FIELD_MAX-1] = NULL;
-
-    static const uint8_t devFieldMax = DEV_FIELD_MAX;
-    static char rxDevField[DEV_FIELD_MAX] = "RX_";
-    rxDevField[DEV_FIELD_MAX-1] = NULL;
-
-    static char txDevField[DEV_FIELD_MAX] = "TX_";
-    txDevField[DEV_FIELD_MAX-1] = NULL;
-    
+    _dumpLoop(argv, _renderMcandump);
+}
+
+static void _mcansend(char *argv[])
+{
+    return;
+}
+
+// Renders one sysmon sample, percentages are printed from permille with one decimal
+static uint16_t _renderTop(char *out, uint16_t outSize, const sSysmonThread threads[], const sSysmonSummary *summary)
+{
+    int len;
+
+    len = snprintf(out, outSize,
+        "\033[H\033[J"
+        "top - %lu ms  threads %u  isr %u.%u%%  idle %u.%u%%  ctx %lu  preempt %lu (irq %lu)\r\n\r\n"
+        "NAME                PRI STATE   CPU%%   STACK/SIZE   USE   RUNS  PREEMPT\r\n",
+        (unsigned long) (summary->interval_US / 1000), summary->threadCount,
+        summary->isrPermille / 10, summary->isrPermille % 10,
+        summary->idlePermille / 10, summary->idlePermille % 10,
+        (unsigned long) summary->contextSwitches, (unsigned long) summary->preemptions,
+        (unsigned long) summary->interruptPreemptions);
+
+    for(uint8_t i = 0; i < summary->threadCount && len < outSize; i++)
+    {
+        const sSysmonThread *t = &threads[i];
+        const char *state = (t->state < sizeof(THREAD_STATE_NAMES) / sizeof(THREAD_STATE_NAMES[0])) ? THREAD_STATE_NAMES[t->state] : "?";
+        uint32_t stackUse = (t->stackSize != 0) ? (t->stackHighWater * 100) / t->stackSize : 0;
+
+        len += snprintf(out + len, outSize - len, "%-19.19s %3u %-6s %3u.%u%%  %5lu/%-5lu  %3lu%%  %5lu  %7lu\r\n",
+            t->name, t->priority, state, t->cpuPermille / 10, t->cpuPermille % 10,
+            (unsigned long) t->stackHighWater, (unsigned long) t->stackSize, (unsigned long) stackUse,
+            (unsigned long) t->resumptions, (unsigned long) t->preemptions);
+    }
+
+    if(!summary->timeValid && len < outSize)
+    {
+        len += snprintf(out + len, outSize - len, "\r\nCPU time unavailable, ThreadX built without execution profiling\r\n");
+    }
+
+    return (len < outSize) ? len : outSize - 1;
+}
+
+// Refreshes in place until Ctrl-C, the first sample primes the per-thread deltas
+static void _top(char *argv[])
+{
+    static char outBuff[TOP_OUT_BUFF_SIZE];
+    static sSysmonThread threads[SYSMON_MAX_THREADS];
+    sSysmonSummary summary;
+    uint32_t period = TOP_DEFAULT_PERIOD_MS;
+
+    if(argv[1][0] != '\0')
+    {
+        period = strtoul(argv[1], NULL, 10);
+
+        if(period < TOP_MIN_PERIOD_MS)
+        {
+            ConsolePrint("Period must be at least %u ms \r\n", TOP_MIN_PERIOD_MS);
+            return;
+        }
+    }
+
+    SysmonSample(threads, SYSMON_MAX_THREADS, &summary);
+    ConsoleWrite("\033[2J", 4);
+
     while(true)
     {
-        if(_newRxMessage)
+        uint32_t start = tx_time_get();
+
+        while((tx_time_get() - start) < period)
         {
-            // Construct Priority
-            sprintf(priField, "%-*s", priFieldMax, MCAN_Pri_String(_mcanRxMessage.mcanID.MCAN_PRIORITY));
+            // exit if control C is detected
+            if(ConsoleDetectCtrlC())
+            {
+                ConsolePrint("\r\n");
+                return;
+            }
 
-            // Construct Category
-            sprintf(catField, "%-*s", catFieldMax, MCAN_Cat_String(_mcanRxMessage.mcanID.MCAN_CAT));
+            tx_thread_sleep(TOP_POLL_MS);
+        }
 
-            // Construct ID
-            
-            sprintf(txDevField + 3, "%-*s", devFieldMax-3, MCAN_Dev_String(_mcanRxMessage.mcanID.MCAN_TX_Device));
-            sprintf(rxDevField + 3, "%-*s", devFieldMax-3, MCAN_Dev_String(_mcanRxMessage.mcanID.MCAN_RX_Device));
+        SysmonSample(threads, SYSMON_MAX_THREADS, &summary);
+        ConsoleWrite(outBuff, _renderTop(outBuff, sizeof(outBuff), threads, &summary));
+    }
+}
 
-            // Print message
-            ConsolePrint("%04d  %s %s %s %s", _mcanRxMessage.mcanID.MCAN_TimeStamp, priField, catField, txDevField, rxDevField);  
+// Event classes default to TRACE_EVENTS_DEFAULT when none are named
+static void _trace(char *argv[])
+{
+    sTraceStats stats;
+    ULONG mask = 0;
 
-            // Print Payload
-            ConsolePrint("[8] ");
-            for(uint8_t i = 0; i < 8; i++)
+    if(strcmp(argv[1], "stop") == 0)
+    {
+        TraceStop();
+        return;
+    }
+
+    if(strcmp(argv[1], "stats") == 0)
+    {
+        TraceGetStats(&stats);
+        ConsolePrint("%s  sent %lu  lost %lu  packets %lu \r\n", stats.running ? "running" : "stopped",
+            (unsigned long) stats.entriesSent, (unsigned long) stats.entriesLost, (unsigned long) stats.packetsSent);
+        return;
+    }
+
+    if(strcmp(argv[1], "start") != 0)
+    {
+        ConsolePrint("Usage: trace start [all internal thread flags mutex queue sema timer time block byte user] | stop | stats \r\n");
+        return;
+    }
+
+    for(uint8_t i = 2; i < CONSOLE_MAX_ARGS && argv[i][0] != '\0'; i++)
+    {
+        bool found = false;
+
+        for(uint8_t c = 0; c < sizeof(TRACE_CLASSES) / sizeof(TRACE_CLASSES[0]); c++)
+        {
+            if(_matchName(argv[i], TRACE_CLASSES[c].name))
             {
-                ConsolePrint ("%02X ", _mcanRxMessage.mcanData[i]);
-            } 
+                mask |= TRACE_CLASSES[c].mask;
+                found = true;
+                break;
+            }
+        }
 
-            ConsolePrint("\r\n");
+        if(!found)
+        {
+            ConsolePrint("Unknown trace class: %s \r\n", argv[i]);
+            return;
+        }
+    }
 
-            _newRxMessage = false;
- 
+    if(!TraceStart((mask != 0) ? mask : TRACE_EVENTS_DEFAULT))
+    {
+        ConsolePrint("Trace unavailable, build with -DMANTICORE_TRACE=ON and call TraceInit \r\n");
+    }
+}
+
+// Keystrokes are forwarded raw, the remote end echoes. Ctrl-] detaches.
+static void _remote(char *argv[])
+{
+    sRemoteConsoleStats stats;
+    MCAN_DEV peer = 0;
+    bool detach = false;
+    char inChar;
+
+    if(strcmp(argv[1], "stats") == 0)
+    {
+        RemoteConsoleGetStats(&stats);
+        ConsolePrint("sent %lu  received %lu  lost %lu  dropped %lu bytes \r\n",
+            (unsigned long) stats.framesSent, (unsigned long) stats.framesReceived,
+            (unsigned long) stats.framesLost, (unsigned long) stats.bytesDropped);
+        return;
+    }
+
+    for(uint8_t i = 0; i < MCAN_DEV_COUNT; i++)
+    {
+        if(_matchName(argv[1], MCAN_Dev_String((MCAN_DEV) (1 << i))))
+        {
+            peer = (MCAN_DEV) (1 << i);
+            break;
         }
+    }
 
-        // exit if control C is detected
-        if(ConsoleDetectCtrlC())
+    if(peer == 0)
+    {
+        ConsolePrint("Unknown device: %s \r\n", argv[1]);
+        return;
+    }
+
+    if(!RemoteConsoleAttach(peer))
+    {
+        ConsolePrint("Unable to attach to %s, call RemoteConsoleInit \r\n", MCAN_Dev_String(peer));
+        return;
+    }
+
+    ConsolePrint("Attached to %s, Ctrl-] to detach \r\n\r\n", MCAN_Dev_String(peer));
+
+    while(!detach && RemoteConsoleAttached())
+    {
+        while(ConsoleReadRaw(&inChar))
+        {
+            if(inChar == REMOTE_CONSOLE_DETACH_CHAR)
+            {
+                detach = true;
+                break;
+            }
+
+            RemoteConsoleInput(&inChar, 1);
+        }
+
+        tx_thread_sleep(REMOTE_POLL_MS);
+    }
+
+    RemoteConsoleDetach();
+    ConsolePrint("\r\n\r\n%s %s", detach ? "Detached from" : "Session closed by", MCAN_Dev_String(peer));
+}
+
+// One blocking call with the default options, or the per method round trip percentiles
+static void _rpc(char *argv[])
+{
+    sMcanRpcMethodStats methodStats;
+    sMcanRpcStats stats;
+    sMcanRpcOptions options = { PRI_WARNING, MCAN_RPC_TIMEOUT_MS, 0 };
+    uint8_t req[MCAN_RPC_DATA_MAX];
+    uint8_t resp[MCAN_RPC_DATA_MAX];
+    uint8_t reqLen = 0;
+    uint8_t respLen = 0;
+    MCAN_RPC_STATUS status;
+    MCAN_DEV peer = 0;
+    unsigned long method;
+    char *endPtr;
+    ULONG start;
+
+    if(strcmp(argv[1], "stats") == 0)
+    {
+        McanRpcGetStats(&stats);
+        ConsolePrint("served %lu  replayed %lu  late %lu  lost %lu \r\n",
+            (unsigned long) stats.served, (unsigned long) stats.replayed,
+            (unsigned long) stats.lateReplies, (unsigned long) stats.framesLost);
+        ConsolePrint("ISR to thread wake  min %lu  mean %lu  max %lu cycles \r\n",
+            (unsigned long) stats.wakeCyclesMin, (unsigned long) stats.wakeCyclesMean,
+            (unsigned long) stats.wakeCyclesMax);
+
+        for(uint8_t m = 0; m < MCAN_RPC_METHOD_MAX; m++)
+        {
+            if(McanRpcGetMethodStats(m, &methodStats) && methodStats.calls > 0)
+            {
+                ConsolePrint("method %2u  calls %lu  timeouts %lu  retries %lu  errors %lu  p50 %lu  p90 %lu  p99 %lu  max %lu us \r\n",
+                    m, (unsigned long) methodStats.calls, (unsigned long) methodStats.timeouts,
+                    (unsigned long) methodStats.retries, (unsigned long) methodStats.errors,
+                    (unsigned long) methodStats.p50_US, (unsigned long) methodStats.p90_US,
+                    (unsigned long) methodStats.p99_US, (unsigned long) methodStats.max_US);
+            }
+        }
+        return;
+    }
+
+    for(uint8_t i = 0; i < MCAN_DEV_COUNT; i++)
+    {
+        if(_matchName(argv[1], MCAN_Dev_String((MCAN_DEV) (1 << i))))
+        {
+            peer = (MCAN_DEV) (1 << i);
+            break;
+        }
+    }
+
+    method = strtoul(argv[2], &endPtr, 0);
+    if(peer == 0 || *endPtr != '\0' || endPtr == argv[2] || method >= MCAN_RPC_METHOD_MAX)
+    {
+        ConsolePrint("Usage: rpc dev method [hex bytes..] | stats \r\n");
+        return;
+    }
+
+    for(uint8_t i = 3; i < CONSOLE_MAX_ARGS && argv[i][0] != '\0'; i++)
+    {
+        unsigned long data = strtoul(argv[i], &endPtr, 16);
+
+        if(*endPtr != '\0' || data > UINT8_MAX)
+        {
+            ConsolePrint("Invalid byte: %s \r\n", argv[i]);
+            return;
+        }
+
+        req[reqLen++] = (uint8_t) data;
+    }
+
+    start = tx_time_get();
+    status = McanRpcCall(peer, (uint8_t) method, req, reqLen, resp, &respLen, &options);
+
+    ConsolePrint("status 0x%02X after %lu ms, reply [%u]", status, (unsigned long) (tx_time_get() - start), respLen);
+    for(uint8_t i = 0; i < respLen; i++)
+    {
+        ConsolePrint(" %02X", resp[i]);
+    }
+    ConsolePrint(" \r\n");
+}
+
+// This boot, or the one before the last reset from .noinit RAM
+static void _boot(char *argv[])
+{
+    static char report[BOOT_REPORT_SIZE];
+    bool previous = (strcmp(argv[1], "prev") == 0);
+
+    if(argv[1][0] != '\0' && !previous)
+    {
+        ConsolePrint("Usage: boot [prev] \r\n");
+        return;
+    }
+
+    ConsoleWrite(report, BootFormatReport(report, sizeof(report), previous));
+}
+
+// Ticks to microseconds with two decimals, ticksPerUs is the sampling device's
+static void _printProf(PROF_ID id, const sProfStats *stats)
+{
+    const uint32_t values[] = { stats->min, stats->mean, stats->p50, stats->p90, stats->p99, stats->max };
+    uint32_t ticksPerUs = (stats->ticksPerUs > 0) ? stats->ticksPerUs : 1;
+
+    ConsolePrint("%-14s %8lu", ProfName(id), (unsigned long) stats->count);
+    for(uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        uint64_t hundredths = ((uint64_t) values[i] * 100ULL) / ticksPerUs;
+
+        ConsolePrint(" %7lu.%02lu", (unsigned long) (hundredths / 100ULL), (unsigned long) (hundredths % 100ULL));
+    }
+    ConsolePrint(" \r\n");
+}
+
+// This device's probes, or another module's through MCAN_RPC_METHOD_PROF
+static void _prof(char *argv[])
+{
+    sMcanRpcOptions options = { PRI_DEBUG, MCAN_RPC_TIMEOUT_MS, 0 };
+    uint8_t resp[MCAN_RPC_DATA_MAX];
+    uint8_t respLen = 0;
+    sProfStats stats;
+    MCAN_DEV peer = 0;
+
+    if(strcmp(argv[1], "reset") == 0)
+    {
+        ProfReset();
+        return;
+    }
+
+    for(uint8_t i = 0; argv[1][0] != '\0' && i < MCAN_DEV_COUNT; i++)
+    {
+        if(_matchName(argv[1], MCAN_Dev_String((MCAN_DEV) (1 << i))))
         {
+            peer = (MCAN_DEV) (1 << i);
             break;
         }
+    }
 
-        tx_thread_sleep(COMMAND_DELAY);
+    if(argv[1][0] != '\0' && peer == 0)
+    {
+        ConsolePrint("Usage: prof [dev] | reset \r\n");
+        return;
+    }
+
+    ConsolePrint("%-14s %8s %10s %10s %10s %10s %10s %10s \r\n", "probe", "count", "min", "mean", "p50", "p90", "p99", "max");
+    for(uint8_t id = 0; id < PROF_ID_COUNT; id++)
+    {
+        uint8_t req = id;
+
+        if(peer == 0 && ProfGet((PROF_ID) id, &stats))
+        {
+            _printProf((PROF_ID) id, &stats);
+        }
+        else if(peer != 0 &&
+                McanRpcCall(peer, MCAN_RPC_METHOD_PROF, &req, 1, resp, &respLen, &options) == MCAN_RPC_OK &&
+                ProfUnpack(resp, respLen, &stats))
+        {
+            _printProf((PROF_ID) id, &stats);
+        }
+        else
+        {
+            ConsolePrint("%-14s %8s \r\n", ProfName((PROF_ID) id), "n/a");
+        }
     }
 }
 
-static void _mcansend(char *argv[])
+// One comma separated row per source and stage, the format tools/latency/latency_bench.py parses
+static void _printLatency(const char *load)
 {
-    return;
+    sLatencyStats stats;
+
+    for(uint8_t src = 0; src < LAT_SRC_COUNT; src++)
+    {
+        for(uint8_t stage = 0; stage < LAT_STAGE_COUNT; stage++)
+        {
+            if(LatencyGet((LAT_SRC) src, (LAT_STAGE) stage, &stats) && stats.count > 0)
+            {
+                ConsolePrint("lat,%s,%s,%s,%lu,%lu,%lu,%lu,%lu,%lu\r\n", load, LatencySourceName((LAT_SRC) src),
+                             LatencyStageName((LAT_STAGE) stage), (unsigned long) stats.count,
+                             (unsigned long) stats.min_NS, (unsigned long) stats.p50_NS, (unsigned long) stats.p90_NS,
+                             (unsigned long) stats.p99_NS, (unsigned long) stats.max_NS);
+            }
+        }
+    }
+}
+
+// Every load scenario in order, or the samples recorded since the last reset
+static void _latency(char *argv[])
+{
+    uint32_t seconds = LATENCY_RUN_MS_DEFAULT / 1000;
+
+    if(strcmp(argv[1], "reset") == 0)
+    {
+        LatencyReset();
+        return;
+    }
+    else if(argv[1][0] != '\0' && strcmp(argv[1], "run") != 0)
+    {
+        ConsolePrint("Usage: latency [run [seconds] | reset] \r\n");
+        return;
+    }
+
+    ConsolePrint("lat,load,source,stage,count,min_ns,p50_ns,p90_ns,p99_ns,max_ns\r\n");
+
+    if(argv[1][0] == '\0')
+    {
+        _printLatency("live");
+        return;
+    }
+
+    if(argv[2][0] != '\0')
+    {
+        seconds = strtoul(argv[2], NULL, 10);
+    }
+
+    for(uint8_t load = 0; load < LAT_LOAD_COUNT; load++)
+    {
+        if(LatencyRun((LAT_LOAD) load, seconds * 1000))
+        {
+            _printLatency(LatencyLoadName((LAT_LOAD) load));
+        }
+        else
+        {
+            ConsolePrint("lat,%s,skipped\r\n", LatencyLoadName((LAT_LOAD) load));
+        }
+    }
+
+    ConsolePrint("latency done\r\n");
+}
+
+// Blocking UART TX through the console mutex
+static void _latencyConsoleLoad(void)
+{
+    ConsolePrint("latency load 0123456789abcdef0123456789abcdef0123456789abcdef\r\n");
+}
+
+// Full FD frames to every module, queued as soon as the TX FIFO drains
+static void _latencyCanFloodLoad(void)
+{
+    static const uint8_t data[64] = { 0 };
+
+    if(MCAN_TxFifoIdle())
+    {
+        MCAN_TX_FD(PRI_DEBUG, CAT_DEBUG, DEV_ALL, data, sizeof(data));
+    }
 }
 
 
 // Command Registration
 void ConsoleRegisterNativeCommands(void)
 {
-    ConsoleRegisterComm(&_commHelloWorld);
-    ConsoleRegisterComm(&_commCandump);
-    ConsoleRegisterComm(&_commCansend);
-    ConsoleRegisterComm(&_commMcandump);
+    tx_event_flags_create(&_captureEvent, "capture_event");
+
+    ConsoleComm_t *commands[] = {
+        &_commHelloWorld,
+        &_commCandump,
+        &_commCansend,
+        &_commMcandump,
+        &_commTop,
+        &_commTrace,
+        &_commRemote,
+        &_commRpc,
+        &_commBoot,
+        &_commProf,
+        &_commLatency,
+    };
+
+    // A full command table drops commands silently otherwise, say which ones
+    for(uint8_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+    {
+        if(!ConsoleRegisterComm(commands[i]))
+        {
+            ConsolePrint("Command table full, %s not registered \r\n", commands[i]->name);
+        }
+    }
+
+    LatencySetLoad(LAT_LOAD_CONSOLE, _latencyConsoleLoad);
+    LatencySetLoad(LAT_LOAD_CAN_FLOOD, _latencyCanFloodLoad);
 }
 
-// Called when CAN message is received
+// Called when CAN message is received, from ISR context or from the MCAN TX path
 void MCAN_RX_GetLatest( sMCAN_Message mcanRxMessage )
 {
-    _newRxMessage = true;
-    _mcanRxMessage = mcanRxMessage;
+    TX_INTERRUPT_SAVE_AREA
+
+    if(!_captureEnabled)
+    {
+        return;
+    }
+
+    TX_DISABLE
+    if(_captureHead - _captureTail >= CAPTURE_RING_SIZE)
+    {
+        _captureDropped++;
+        TX_RESTORE
+        return;
+    }
+
+    sCaptureEntry *entry = &_captureRing[_captureHead & CAPTURE_RING_MASK];
+    entry->mcanID = mcanRxMessage.mcanID;
+    memcpy(entry->data, mcanRxMessage.mcanData, DUMP_DATA_BYTES);
+    _captureHead++;
+    TX_RESTORE
+
+    tx_event_flags_set(&_captureEvent, DUMP_CAPTURE_FLAG, TX_OR);
 }
\ No newline at end of file
@@ -0,0 +1,488 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "remote_console.h"
+#include "console.h"
+#include "mcan.h"
+#include "tx_api.h"
+
+#define RC_RING_SIZE        256     // Must be a power of two
+#define RC_RX_QUEUE_SIZE    8       // Must be a power of two
+#define RC_POLL_MS          2
+#define RC_TX_WAIT_MS       100     // Longest wait for an idle TX FIFO before a control frame
+#define RC_OUTPUT_WAIT_MS   50      // Longest a console writer waits for ring space
+#define RC_EVENT_RX         0x1
+#define RC_EVENT_TX         0x2
+
+// Static Data Types
+typedef struct
+{
+    uint8_t data[RC_RING_SIZE];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile ULONG firstTick;       // When the oldest pending byte was written
+} sRemoteRing;
+
+typedef struct
+{
+    volatile MCAN_DEV peer;         // 0 when no session is open
+    uint8_t txSeq;
+    uint8_t rxSeq;
+    volatile ULONG lastTick;        // Server: last frame heard, client: last frame sent
+    sRemoteRing ring;               // Server: console output, client: keystrokes
+} sRemoteSession;
+
+typedef struct
+{
+    MCAN_DEV peer;
+    uint8_t frame[REMOTE_CONSOLE_FRAME_MAX];
+} sRemoteRxFrame;
+
+// Static Variables
+static bool _remoteReady = false;
+static sRemoteSession _server;
+static sRemoteSession _client;
+static volatile bool _clientClosed = false;
+static volatile sRemoteConsoleStats _stats;
+
+static sRemoteRxFrame _rxQueue[RC_RX_QUEUE_SIZE];
+static volatile uint8_t _rxHead = 0;
+static volatile uint8_t _rxTail = 0;
+static TX_EVENT_FLAGS_GROUP _remoteEvent;
+
+// Remote Console Thread
+#define THREAD_REMOTE_CONSOLE_STACK_SIZE 1024
+static TX_THREAD stThreadRemoteConsole;
+static uint8_t auThreadRemoteConsoleStack[THREAD_REMOTE_CONSOLE_STACK_SIZE];
+static void thread_remote_console(ULONG ctx);
+
+// Static Function Declarations
+static void _ringReset(sRemoteRing *ring);
+static uint16_t _ringCount(const sRemoteRing *ring);
+static uint16_t _ringWrite(sRemoteRing *ring, const uint8_t data[], uint16_t len);
+static uint16_t _ringRead(sRemoteRing *ring, uint8_t data[], uint16_t maxLen);
+static bool _sendFrame(MCAN_DEV peer, REMOTE_FRAME type, uint8_t seq, const uint8_t data[], uint8_t len);
+static bool _sendControl(MCAN_DEV peer, REMOTE_FRAME type);
+static bool _flush(sRemoteSession *session, REMOTE_FRAME type, ULONG now);
+static void _checkSeq(sRemoteSession *session, uint8_t seq);
+static void _receive(const sRemoteRxFrame *rx, ULONG now);
+static bool _rxHandler(const sMCAN_Message *mcanRxMessage);
+
+
+// Static Function Definitions
+static void _ringReset(sRemoteRing *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+static uint16_t _ringCount(const sRemoteRing *ring)
+{
+    return (ring->head - ring->tail) & (RC_RING_SIZE - 1);
+}
+
+// Single producer, the console output mutex serializes server writers
+static uint16_t _ringWrite(sRemoteRing *ring, const uint8_t data[], uint16_t len)
+{
+    uint16_t head = ring->head;
+    uint16_t written = 0;
+
+    if(head == ring->tail)
+    {
+        ring->firstTick = tx_time_get();
+    }
+
+    while(written < len && ((head + 1) & (RC_RING_SIZE - 1)) != ring->tail)
+    {
+        ring->data[head] = data[written++];
+        head = (head + 1) & (RC_RING_SIZE - 1);
+    }
+
+    ring->head = head;
+    return written;
+}
+
+static uint16_t _ringRead(sRemoteRing *ring, uint8_t data[], uint16_t maxLen)
+{
+    uint16_t tail = ring->tail;
+    uint16_t read = 0;
+
+    while(read < maxLen && tail != ring->head)
+    {
+        data[read++] = ring->data[tail];
+        tail = (tail + 1) & (RC_RING_SIZE - 1);
+    }
+
+    ring->tail = tail;
+    return read;
+}
+
+static bool _sendFrame(MCAN_DEV peer, REMOTE_FRAME type, uint8_t seq, const uint8_t data[], uint8_t len)
+{
+    uint8_t frame[REMOTE_CONSOLE_FRAME_MAX];
+
+    frame[0] = (uint8_t) type;
+    frame[1] = seq;
+    frame[2] = len;
+    if(len > 0)
+    {
+        memcpy(&frame[REMOTE_CONSOLE_HEADER_SIZE], data, len);
+    }
+
+    // Lowest priority and category so tunnel frames always lose arbitration
+    if(!MCAN_TX_FD(PRI_DEBUG, CAT_DEBUG, peer, frame, REMOTE_CONSOLE_HEADER_SIZE + len))
+    {
+        return false;
+    }
+
+    _stats.framesSent++;
+    return true;
+}
+
+// OPEN and CLOSE are unsequenced and wait for the TX FIFO to drain
+static bool _sendControl(MCAN_DEV peer, REMOTE_FRAME type)
+{
+    for(ULONG waited = 0; !MCAN_TxFifoIdle(); waited += RC_POLL_MS)
+    {
+        if(waited >= RC_TX_WAIT_MS)
+        {
+            return false;
+        }
+
+        tx_thread_sleep(RC_POLL_MS);
+    }
+
+    return _sendFrame(peer, type, 0, NULL, 0);
+}
+
+// Send one frame once a full frame is pending or the oldest byte has waited REMOTE_CONSOLE_FLUSH_MS
+static bool _flush(sRemoteSession *session, REMOTE_FRAME type, ULONG now)
+{
+    uint8_t data[REMOTE_CONSOLE_DATA_MAX];
+    uint16_t pending = _ringCount(&session->ring);
+    MCAN_DEV peer = session->peer;
+    uint16_t len;
+
+    if(pending == 0 || peer == 0)
+    {
+        return false;
+    }
+
+    if(pending < REMOTE_CONSOLE_DATA_MAX && (now - session->ring.firstTick) < REMOTE_CONSOLE_FLUSH_MS)
+    {
+        return false;
+    }
+
+    // The TX FIFO sends in order, never queue ahead of other traffic
+    if(!MCAN_TxFifoIdle())
+    {
+        return false;
+    }
+
+    len = _ringRead(&session->ring, data, sizeof(data));
+    if(!_sendFrame(peer, type, session->txSeq, data, (uint8_t) len))
+    {
+        _stats.bytesDropped += len;
+        return false;
+    }
+
+    session->txSeq++;
+    return true;
+}
+
+static void _checkSeq(sRemoteSession *session, uint8_t seq)
+{
+    if(seq != session->rxSeq)
+    {
+        _stats.framesLost += (uint8_t) (seq - session->rxSeq);
+    }
+
+    session->rxSeq = seq + 1;
+}
+
+static void _receive(const sRemoteRxFrame *rx, ULONG now)
+{
+    REMOTE_FRAME type = (REMOTE_FRAME) rx->frame[0];
+    uint8_t seq = rx->frame[1];
+    uint8_t len = rx->frame[2];
+    const uint8_t *data = &rx->frame[REMOTE_CONSOLE_HEADER_SIZE];
+
+    _stats.framesReceived++;
+
+    switch(type)
+    {
+        case REMOTE_FRAME_OPEN:
+
+            // One client at a time, turn others away
+            if(_server.peer != 0 && _server.peer != rx->peer)
+            {
+                _sendControl(rx->peer, REMOTE_FRAME_CLOSE);
+                break;
+            }
+
+            _ringReset(&_server.ring);
+            _server.txSeq = 0;
+            _server.rxSeq = 0;
+            _server.lastTick = now;
+            _server.peer = rx->peer;
+            break;
+
+        case REMOTE_FRAME_INPUT:
+        case REMOTE_FRAME_KEEPALIVE:
+
+            if(rx->peer != _server.peer)
+            {
+                break;
+            }
+
+            _checkSeq(&_server, seq);
+            _server.lastTick = now;
+            _stats.bytesDropped += len - ConsoleInjectInput((const char *) data, len);
+            break;
+
+        case REMOTE_FRAME_OUTPUT:
+
+            if(rx->peer != _client.peer || _clientClosed)
+            {
+                break;
+            }
+
+            _checkSeq(&_client, seq);
+            ConsoleWriteRaw((const char *) data, len);
+            break;
+
+        case REMOTE_FRAME_CLOSE:
+
+            if(rx->peer == _server.peer)
+            {
+                _server.peer = 0;
+            }
+
+            if(rx->peer == _client.peer)
+            {
+                _clientClosed = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// FDCAN RX ISR, claims well formed tunnel frames addressed to this device only
+static bool _rxHandler(const sMCAN_Message *mcanRxMessage)
+{
+    const uint8_t *frame = mcanRxMessage->mcanData;
+    uint8_t next = (_rxHead + 1) & (RC_RX_QUEUE_SIZE - 1);
+
+    if(mcanRxMessage->mcanID.MCAN_RX_Device != MCAN_GetDevice() ||
+       frame[0] < REMOTE_FRAME_OPEN || frame[0] > REMOTE_FRAME_KEEPALIVE ||
+       frame[2] > REMOTE_CONSOLE_DATA_MAX)
+    {
+        return false;
+    }
+
+    if(next == _rxTail)
+    {
+        _stats.framesLost++;
+        return true;
+    }
+
+    _rxQueue[_rxHead].peer = mcanRxMessage->mcanID.MCAN_TX_Device;
+    memcpy(_rxQueue[_rxHead].frame, frame, REMOTE_CONSOLE_FRAME_MAX);
+    _rxHead = next;
+
+    tx_event_flags_set(&_remoteEvent, RC_EVENT_RX, TX_OR);
+    return true;
+}
+
+
+// Public Functions
+bool RemoteConsoleInit(void)
+{
+    if(_remoteReady)
+    {
+        return true;
+    }
+
+    memset(&_server, 0, sizeof(_server));
+    memset(&_client, 0, sizeof(_client));
+
+    tx_event_flags_create(&_remoteEvent, "remote_console_event");
+
+    tx_thread_create( &stThreadRemoteConsole,
+        "thread_remote_console",
+        thread_remote_console,
+        0,
+        auThreadRemoteConsoleStack,
+        THREAD_REMOTE_CONSOLE_STACK_SIZE,
+        7,
+        7,
+        0,
+        TX_AUTO_START);
+
+    if(!MCAN_RegisterCatHandler(CAT_DEBUG, _rxHandler))
+    {
+        return false;
+    }
+
+    _remoteReady = true;
+    return true;
+}
+
+void RemoteConsoleOutput(const char buff[], uint16_t len)
+{
+    TX_THREAD *caller = tx_thread_identify();
+    ULONG waited = 0;
+    uint16_t written = 0;
+
+    if(!_remoteReady || _server.peer == 0)
+    {
+        return;
+    }
+
+    while(true)
+    {
+        written += _ringWrite(&_server.ring, (const uint8_t *) buff + written, len - written);
+        if(written == len)
+        {
+            break;
+        }
+
+        // Ring full, give the session thread a chance to drain it
+        if(caller == NULL || caller == &stThreadRemoteConsole || waited >= RC_OUTPUT_WAIT_MS)
+        {
+            _stats.bytesDropped += len - written;
+            break;
+        }
+
+        tx_event_flags_set(&_remoteEvent, RC_EVENT_TX, TX_OR);
+        tx_thread_sleep(RC_POLL_MS);
+        waited += RC_POLL_MS;
+    }
+
+    if(_ringCount(&_server.ring) >= REMOTE_CONSOLE_DATA_MAX)
+    {
+        tx_event_flags_set(&_remoteEvent, RC_EVENT_TX, TX_OR);
+    }
+}
+
+bool RemoteConsoleAttach(MCAN_DEV peer)
+{
+    // Exactly one device, other than this one
+    if(!_remoteReady || _client.peer != 0 || peer == 0 ||
+       (peer & (peer - 1)) != 0 || peer == MCAN_GetDevice())
+    {
+        return false;
+    }
+
+    _ringReset(&_client.ring);
+    _client.txSeq = 0;
+    _client.rxSeq = 0;
+    _clientClosed = false;
+
+    if(!_sendControl(peer, REMOTE_FRAME_OPEN))
+    {
+        return false;
+    }
+
+    _client.lastTick = tx_time_get();
+    _client.peer = peer;
+
+    return true;
+}
+
+bool RemoteConsoleAttached(void)
+{
+    return _client.peer != 0 && !_clientClosed;
+}
+
+uint16_t RemoteConsoleInput(const char buff[], uint16_t len)
+{
+    uint16_t written;
+
+    if(!RemoteConsoleAttached())
+    {
+        return 0;
+    }
+
+    written = _ringWrite(&_client.ring, (const uint8_t *) buff, len);
+    _stats.bytesDropped += len - written;
+
+    if(_ringCount(&_client.ring) >= REMOTE_CONSOLE_DATA_MAX)
+    {
+        tx_event_flags_set(&_remoteEvent, RC_EVENT_TX, TX_OR);
+    }
+
+    return written;
+}
+
+void RemoteConsoleDetach(void)
+{
+    MCAN_DEV peer = _client.peer;
+
+    _client.peer = 0;
+    if(peer != 0 && !_clientClosed)
+    {
+        _sendControl(peer, REMOTE_FRAME_CLOSE);
+    }
+}
+
+void RemoteConsoleGetStats(sRemoteConsoleStats *stats)
+{
+    stats->framesSent     = _stats.framesSent;
+    stats->framesReceived = _stats.framesReceived;
+    stats->framesLost     = _stats.framesLost;
+    stats->bytesDropped   = _stats.bytesDropped;
+}
+
+
+// Threads
+static void thread_remote_console(ULONG ctx)
+{
+    sRemoteRxFrame rx;
+    ULONG flags;
+    ULONG now;
+
+    while(true)
+    {
+        tx_event_flags_get(&_remoteEvent, RC_EVENT_RX | RC_EVENT_TX, TX_OR_CLEAR, &flags, RC_POLL_MS);
+        now = tx_time_get();
+
+        while(_rxTail != _rxHead)
+        {
+            rx = _rxQueue[_rxTail];
+            _rxTail = (_rxTail + 1) & (RC_RX_QUEUE_SIZE - 1);
+            _receive(&rx, now);
+        }
+
+        // Server: drop a silent client, otherwise batch console output back to it
+        if(_server.peer != 0)
+        {
+            if((now - _server.lastTick) > REMOTE_CONSOLE_TIMEOUT_MS)
+            {
+                _server.peer = 0;
+            }
+            else
+            {
+                _flush(&_server, REMOTE_FRAME_OUTPUT, now);
+            }
+        }
+
+        // Client: forward keystrokes, keep the session alive when idle
+        MCAN_DEV clientPeer = _client.peer;
+        if(clientPeer != 0 && !_clientClosed)
+        {
+            if(_flush(&_client, REMOTE_FRAME_INPUT, now))
+            {
+                _client.lastTick = now;
+            }
+            else if((now - _client.lastTick) >= REMOTE_CONSOLE_KEEPALIVE_MS && MCAN_TxFifoIdle() &&
+                    _sendFrame(clientPeer, REMOTE_FRAME_KEEPALIVE, _client.txSeq, NULL, 0))
+            {
+                _client.txSeq++;
+                _client.lastTick = now;
+            }
+        }
+    }
+}
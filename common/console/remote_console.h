@@ -0,0 +1,66 @@
+#ifndef __REMOTE_CONSOLE_H
+#define __REMOTE_CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mcan.h"
+
+/*********************************************************************************
+    Remote console sessions tunnelled over MCAN.
+
+    A client opens a session on another module's console; keystrokes travel as
+    INPUT frames and the server's console output comes back as OUTPUT frames.
+    Output is batched into CAN FD frames, a frame leaves when it is full or
+    REMOTE_CONSOLE_FLUSH_MS after its first byte was written.
+
+    Tunnel frames are PRI_DEBUG / CAT_DEBUG so they lose arbitration to all other
+    traffic, and are only queued when the TX FIFO is empty so they never sit
+    ahead of a more urgent frame. The server ends a session when the client is
+    silent for REMOTE_CONSOLE_TIMEOUT_MS; idle clients send KEEPALIVE frames.
+
+    Frame payload:
+        [type u8][seq u8][len u8][data len bytes]
+***********************************************************************************/
+
+#define REMOTE_CONSOLE_FRAME_MAX      64
+#define REMOTE_CONSOLE_HEADER_SIZE    3
+#define REMOTE_CONSOLE_DATA_MAX       (REMOTE_CONSOLE_FRAME_MAX - REMOTE_CONSOLE_HEADER_SIZE)
+
+#define REMOTE_CONSOLE_FLUSH_MS       10
+#define REMOTE_CONSOLE_KEEPALIVE_MS   500
+#define REMOTE_CONSOLE_TIMEOUT_MS     2000
+#define REMOTE_CONSOLE_DETACH_CHAR    '\035'    // Ctrl-]
+
+typedef enum
+{
+    REMOTE_FRAME_OPEN      = 0x01,
+    REMOTE_FRAME_CLOSE     = 0x02,
+    REMOTE_FRAME_INPUT     = 0x03,
+    REMOTE_FRAME_OUTPUT    = 0x04,
+    REMOTE_FRAME_KEEPALIVE = 0x05,
+} REMOTE_FRAME;
+
+typedef struct
+{
+    uint32_t framesSent;
+    uint32_t framesReceived;
+    uint32_t framesLost;        // Sequence gaps seen by this end
+    uint32_t bytesDropped;      // Ring overflow or failed transmission
+} sRemoteConsoleStats;
+
+// Claims tunnel frames from MCAN and starts the session thread. Call after MCAN_Init and ConsoleInit.
+bool RemoteConsoleInit(void);
+
+// Server side: mirrors console output to the attached client, called by the console output path
+void RemoteConsoleOutput(const char buff[], uint16_t len);
+
+// Client side
+bool RemoteConsoleAttach(MCAN_DEV peer);
+bool RemoteConsoleAttached(void);                                   // False once the server closes the session
+uint16_t RemoteConsoleInput(const char buff[], uint16_t len);      // Returns the number of characters queued
+void RemoteConsoleDetach(void);
+
+void RemoteConsoleGetStats(sRemoteConsoleStats *stats);
+
+#endif /* __REMOTE_CONSOLE_H */
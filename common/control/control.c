@@ -0,0 +1,216 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "control.h"
+#include "utility.h"
+
+typedef struct
+{
+    const char *name;
+    ControlLoopFn loop;
+    void *context;
+    uint32_t rate_HZ;
+    uint32_t divider;               // Ticks per run
+    uint32_t countdown;             // Ticks to the next run
+    uint32_t periodCycles;          // Overrun budget
+    sControlLoopStats stats;
+} sControlLoop;
+
+// Static Variables
+static TIM_HandleTypeDef *_controlTimer;
+static uint32_t _controlTick_HZ = 0;
+static volatile bool _controlRunning = false;
+static sControlLoop _controlLoops[CONTROL_MAX_LOOPS];
+static uint8_t _controlLoopCount = 0;
+static volatile sControlStats _controlStats;
+
+// Static Function Declarations
+static void _controlTick(void);
+
+
+// Static Function Definitions
+static void _controlTick(void)
+{
+    uint32_t tickStart = DWT->CYCCNT;
+    uint32_t start, cycles;
+
+    for(uint8_t i = 0; i < _controlLoopCount; i++)
+    {
+        sControlLoop *loop = &_controlLoops[i];
+
+        if(--loop->countdown != 0)
+        {
+            continue;
+        }
+        loop->countdown = loop->divider;
+
+        start = DWT->CYCCNT;
+        loop->loop(loop->context);
+        cycles = DWT->CYCCNT - start;
+
+        loop->stats.runs++;
+        loop->stats.cycles = cycles;
+        if(cycles > loop->stats.cyclesMax)
+        {
+            loop->stats.cyclesMax = cycles;
+        }
+        if(cycles > loop->periodCycles)
+        {
+            loop->stats.overruns++;
+        }
+    }
+
+    // HAL cleared the update flag before the callback, set again means a tick was lost
+    if(__HAL_TIM_GET_FLAG(_controlTimer, TIM_FLAG_UPDATE))
+    {
+        _controlStats.tickOverruns++;
+    }
+
+    cycles = DWT->CYCCNT - tickStart;
+    _controlStats.ticks++;
+    _controlStats.tickCycles = cycles;
+    if(cycles > _controlStats.tickCyclesMax)
+    {
+        _controlStats.tickCyclesMax = cycles;
+    }
+}
+
+
+// Public Functions
+bool ControlInit(TIM_HandleTypeDef *tim)
+{
+    if(tim == NULL || _controlRunning)
+    {
+        return false;
+    }
+
+    _controlTimer = tim;
+    _controlTick_HZ = Get_Freq(HAL_RCC_GetSysClockFreq(), tim->Init.Prescaler, __HAL_TIM_GET_AUTORELOAD(tim));
+    _controlLoopCount = 0;
+    ControlResetStats();
+
+    // Loop runs are timed on the DWT cycle counter
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    return _controlTick_HZ != 0;
+}
+
+int8_t ControlRegister(const char *name, ControlLoopFn loop, void *context, uint32_t rate_HZ, uint32_t phase)
+{
+    sControlLoop *entry;
+    uint32_t divider;
+
+    if(_controlRunning || loop == NULL || _controlLoopCount >= CONTROL_MAX_LOOPS)
+    {
+        return -1;
+    }
+    if(rate_HZ == 0 || rate_HZ > _controlTick_HZ || _controlTick_HZ % rate_HZ != 0)
+    {
+        return -1;
+    }
+
+    divider = _controlTick_HZ / rate_HZ;
+    if(phase >= divider)
+    {
+        return -1;
+    }
+
+    entry = &_controlLoops[_controlLoopCount];
+    memset(entry, 0, sizeof(*entry));
+    entry->name = name;
+    entry->loop = loop;
+    entry->context = context;
+    entry->rate_HZ = rate_HZ;
+    entry->divider = divider;
+    entry->countdown = phase + 1;
+    entry->periodCycles = SystemCoreClock / rate_HZ;
+    entry->stats.name = name;
+    entry->stats.rate_HZ = rate_HZ;
+
+    return (int8_t) _controlLoopCount++;
+}
+
+bool ControlStart(void)
+{
+    if(_controlTimer == NULL || _controlRunning)
+    {
+        return false;
+    }
+
+    _controlRunning = true;
+    __HAL_TIM_SET_COUNTER(_controlTimer, 0);
+    if(HAL_TIM_Base_Start_IT(_controlTimer) != HAL_OK)
+    {
+        _controlRunning = false;
+        return false;
+    }
+
+    return true;
+}
+
+void ControlStop(void)
+{
+    if(_controlRunning)
+    {
+        HAL_TIM_Base_Stop_IT(_controlTimer);
+        _controlRunning = false;
+    }
+}
+
+bool ControlGetLoopStats(uint8_t id, sControlLoopStats *stats)
+{
+    TX_INTERRUPT_SAVE_AREA
+
+    if(id >= _controlLoopCount)
+    {
+        return false;
+    }
+
+    TX_DISABLE
+    *stats = _controlLoops[id].stats;
+    TX_RESTORE
+    return true;
+}
+
+void ControlGetStats(sControlStats *stats)
+{
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    stats->tick_HZ       = _controlTick_HZ;
+    stats->ticks         = _controlStats.ticks;
+    stats->tickOverruns  = _controlStats.tickOverruns;
+    stats->tickCycles    = _controlStats.tickCycles;
+    stats->tickCyclesMax = _controlStats.tickCyclesMax;
+    stats->loopCount     = _controlLoopCount;
+    stats->running       = _controlRunning;
+    TX_RESTORE
+}
+
+void ControlResetStats(void)
+{
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    _controlStats.ticks = 0;
+    _controlStats.tickOverruns = 0;
+    _controlStats.tickCycles = 0;
+    _controlStats.tickCyclesMax = 0;
+    for(uint8_t i = 0; i < _controlLoopCount; i++)
+    {
+        _controlLoops[i].stats.runs = 0;
+        _controlLoops[i].stats.overruns = 0;
+        _controlLoops[i].stats.cycles = 0;
+        _controlLoops[i].stats.cyclesMax = 0;
+    }
+    TX_RESTORE
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    if(htim == _controlTimer && _controlRunning)
+    {
+        _controlTick();
+    }
+}
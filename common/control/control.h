@@ -0,0 +1,66 @@
+#ifndef __CONTROL_H
+#define __CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+#include "pid.h"
+
+/*********************************************************************************
+    Fixed-rate control loop scheduler.
+
+    A hardware timer set up by the BSP gives the base tick. Its update
+    interrupt runs every registered loop that is due, in registration order,
+    inside the interrupt. A loop rate must divide the tick rate exactly, so
+    every loop runs on its nominal period with no drift and no jitter beyond
+    the interrupt latency. Loops that share a rate can be staggered by phase.
+
+    The module owns HAL_TIM_PeriodElapsedCallback. The BSP enables the timer
+    interrupt and calls HAL_TIM_IRQHandler from its handler, at a priority
+    above the ThreadX tick.
+
+    Every run is timed with the DWT cycle counter. A loop overruns when one
+    run takes longer than its period. A tick overruns when the next update
+    is flagged before the tick finishes, and that update is lost.
+***********************************************************************************/
+
+#define CONTROL_MAX_LOOPS    8
+
+typedef void (*ControlLoopFn)(void *context);
+
+typedef struct
+{
+    const char *name;
+    uint32_t rate_HZ;
+    uint32_t runs;
+    uint32_t overruns;              // Runs longer than the loop period
+    uint32_t cycles;                // Last run
+    uint32_t cyclesMax;
+} sControlLoopStats;
+
+typedef struct
+{
+    uint32_t tick_HZ;
+    uint32_t ticks;
+    uint32_t tickOverruns;          // Ticks that ran into the next update
+    uint32_t tickCycles;            // Last tick, all loops that ran and the dispatch
+    uint32_t tickCyclesMax;
+    uint8_t loopCount;
+    bool running;
+} sControlStats;
+
+// tim runs in up-counting mode, its update rate is the base tick
+bool ControlInit(TIM_HandleTypeDef *tim);
+// Returns the loop id, or -1 when the scheduler is running, full or rate_HZ does not divide
+// the tick rate. phase delays the first run by that many ticks, below the loop's divider.
+int8_t ControlRegister(const char *name, ControlLoopFn loop, void *context, uint32_t rate_HZ, uint32_t phase);
+bool ControlStart(void);
+void ControlStop(void);
+
+bool ControlGetLoopStats(uint8_t id, sControlLoopStats *stats);
+void ControlGetStats(sControlStats *stats);
+void ControlResetStats(void);
+
+#endif /* __CONTROL_H */
@@ -0,0 +1,201 @@
+#include <stddef.h>
+
+#include "pid.h"
+#include "fixmath.h"
+
+// Static Function Declarations
+static inline float _clampf(float x, float lo, float hi);
+static inline int32_t _clamp32(int64_t x, int32_t lo, int32_t hi);
+static inline int64_t _mulQ31(int32_t gain, int32_t x, uint8_t gainShift);
+static bool _configValid(const sPidConfig *config);
+
+
+// Static Function Definitions
+static inline float _clampf(float x, float lo, float hi)
+{
+    return (x > hi) ? hi : ((x < lo) ? lo : x);
+}
+
+static inline int32_t _clamp32(int64_t x, int32_t lo, int32_t hi)
+{
+    return (x > hi) ? hi : ((x < lo) ? lo : (int32_t) x);
+}
+
+// Gains carry 2^-gainShift so gains up to 2^30 fit a q1.31. Terms stay wide until the
+// output clamp, a proportional term beyond full scale can still be pulled back by the others
+static inline int64_t _mulQ31(int32_t gain, int32_t x, uint8_t gainShift)
+{
+    return ((int64_t) gain * x) >> (31 - gainShift);
+}
+
+static bool _configValid(const sPidConfig *config)
+{
+    return config != NULL && config->dt > 0.0f && config->tauD >= 0.0f && config->outMin < config->outMax;
+}
+
+
+// Public Functions
+bool PidInit(sPid *pid, const sPidConfig *config)
+{
+    if(!_configValid(config))
+    {
+        return false;
+    }
+
+    pid->kp = config->kp;
+    pid->kiDt = config->ki * config->dt;
+    pid->kdDt = config->kd / config->dt;
+    pid->alphaD = config->dt / (config->tauD + config->dt);
+    pid->outMin = config->outMin;
+    pid->outMax = config->outMax;
+    PidReset(pid);
+    return true;
+}
+
+void PidReset(sPid *pid)
+{
+    pid->integral = 0.0f;
+    pid->derivative = 0.0f;
+    pid->prevMeasurement = 0.0f;
+    pid->output = 0.0f;
+    pid->primed = false;
+    pid->saturated = false;
+}
+
+float PidUpdate(sPid *pid, float setpoint, float measurement)
+{
+    float error = setpoint - measurement;
+    float integral = _clampf(pid->integral + pid->kiDt * error, pid->outMin, pid->outMax);
+    float output;
+
+    // Derivative on measurement, low passed
+    if(pid->primed)
+    {
+        pid->derivative += pid->alphaD * (pid->kdDt * (pid->prevMeasurement - measurement) - pid->derivative);
+    }
+    pid->prevMeasurement = measurement;
+    pid->primed = true;
+
+    output = pid->kp * error + integral + pid->derivative;
+
+    // Saturate, and only keep integration that pulls the output back into range
+    pid->saturated = true;
+    if(output > pid->outMax)
+    {
+        output = pid->outMax;
+        if(integral > pid->integral)
+        {
+            integral = pid->integral;
+        }
+    }
+    else if(output < pid->outMin)
+    {
+        output = pid->outMin;
+        if(integral < pid->integral)
+        {
+            integral = pid->integral;
+        }
+    }
+    else
+    {
+        pid->saturated = false;
+    }
+
+    pid->integral = integral;
+    pid->output = output;
+    return output;
+}
+
+bool PidQ31Init(sPidQ31 *pid, const sPidConfig *config)
+{
+    float kiDt, kdDt, maxGain, scale;
+    uint8_t shift = 0;
+
+    if(!_configValid(config) || config->outMin < -1.0f || config->outMax > 1.0f)
+    {
+        return false;
+    }
+
+    kiDt = config->ki * config->dt;
+    kdDt = config->kd / config->dt;
+
+    // Smallest shift that brings every gain below one
+    maxGain = (config->kp < 0.0f) ? -config->kp : config->kp;
+    maxGain = (kiDt > maxGain) ? kiDt : ((-kiDt > maxGain) ? -kiDt : maxGain);
+    maxGain = (kdDt > maxGain) ? kdDt : ((-kdDt > maxGain) ? -kdDt : maxGain);
+    scale = 1.0f;
+    while(maxGain >= scale)
+    {
+        if(++shift > 30)
+        {
+            return false;
+        }
+        scale *= 2.0f;
+    }
+
+    pid->gainShift = shift;
+    pid->kp = PID_FLOAT_TO_Q31(config->kp / scale);
+    pid->kiDt = PID_FLOAT_TO_Q31(kiDt / scale);
+    pid->kdDt = PID_FLOAT_TO_Q31(kdDt / scale);
+    pid->alphaD = PID_FLOAT_TO_Q31(config->dt / (config->tauD + config->dt));
+    pid->outMin = PID_FLOAT_TO_Q31(config->outMin);
+    pid->outMax = PID_FLOAT_TO_Q31(config->outMax);
+    PidQ31Reset(pid);
+    return true;
+}
+
+void PidQ31Reset(sPidQ31 *pid)
+{
+    pid->integral = 0;
+    pid->derivative = 0;
+    pid->prevMeasurement = 0;
+    pid->output = 0;
+    pid->primed = false;
+    pid->saturated = false;
+}
+
+int32_t PidQ31Update(sPidQ31 *pid, int32_t setpoint, int32_t measurement)
+{
+    int32_t error = FixSatQ31((int64_t) setpoint - measurement);
+    int32_t integral = _clamp32((int64_t) pid->integral + _mulQ31(pid->kiDt, error, pid->gainShift), pid->outMin, pid->outMax);
+    int32_t target;
+    int64_t output;
+
+    // Derivative on measurement, low passed
+    if(pid->primed)
+    {
+        target = FixSatQ31(_mulQ31(pid->kdDt, FixSatQ31((int64_t) pid->prevMeasurement - measurement), pid->gainShift));
+        pid->derivative = FixSatQ31(pid->derivative + (((int64_t) pid->alphaD * ((int64_t) target - pid->derivative)) >> 31));
+    }
+    pid->prevMeasurement = measurement;
+    pid->primed = true;
+
+    output = _mulQ31(pid->kp, error, pid->gainShift) + integral + pid->derivative;
+
+    // Saturate, and only keep integration that pulls the output back into range
+    pid->saturated = true;
+    if(output > pid->outMax)
+    {
+        output = pid->outMax;
+        if(integral > pid->integral)
+        {
+            integral = pid->integral;
+        }
+    }
+    else if(output < pid->outMin)
+    {
+        output = pid->outMin;
+        if(integral < pid->integral)
+        {
+            integral = pid->integral;
+        }
+    }
+    else
+    {
+        pid->saturated = false;
+    }
+
+    pid->integral = integral;
+    pid->output = (int32_t) output;
+    return pid->output;
+}
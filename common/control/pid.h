@@ -0,0 +1,89 @@
+#ifndef __PID_H
+#define __PID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+    PI-D controller block.
+
+    Proportional and integral act on the error. The derivative acts on the
+    measurement only, so setpoint steps do not kick the output, and it runs
+    through a first order low pass with time constant tauD. The output is
+    clamped to [outMin, outMax]. Anti-windup is conditional integration: an
+    error that would push a saturated output further into its limit is not
+    integrated, and the integral itself never leaves the output range.
+
+    Two arithmetic flavours share one configuration:
+      float  sPid,    PidInit / PidUpdate
+      Q31    sPidQ31, PidQ31Init / PidQ31Update, signals are q1.31 fractions of
+             full scale and the update is integer only with saturating adds
+
+    Pure C with no HAL or RTOS dependency, so the same file builds for the
+    target and for the host harness in tools/control. The float update uses
+    only + - * /, so it matches bit for bit between target and host as long
+    as both build without FMA contraction (-ffp-contract=off, set by the
+    Control library). The Q31 update is integer only and always matches.
+***********************************************************************************/
+
+typedef struct
+{
+    float kp;
+    float ki;                       // Per second
+    float kd;                       // Seconds
+    float dt;                       // Update period in seconds
+    float tauD;                     // Derivative filter time constant in seconds, 0 for none
+    float outMin;
+    float outMax;
+} sPidConfig;
+
+typedef struct
+{
+    float kp;
+    float kiDt;
+    float kdDt;                     // kd / dt
+    float alphaD;                   // Derivative filter weight of the new sample
+    float outMin;
+    float outMax;
+    float integral;
+    float derivative;
+    float prevMeasurement;
+    float output;
+    bool primed;                    // prevMeasurement holds a sample
+    bool saturated;                 // Last output was clamped
+} sPid;
+
+typedef struct
+{
+    int32_t kp;                     // Gains in q1.31 scaled by 2^-gainShift
+    int32_t kiDt;
+    int32_t kdDt;
+    int32_t alphaD;
+    int32_t outMin;
+    int32_t outMax;
+    int32_t integral;
+    int32_t derivative;
+    int32_t prevMeasurement;
+    int32_t output;
+    uint8_t gainShift;
+    bool primed;
+    bool saturated;
+} sPidQ31;
+
+#define PID_Q31_ONE           2147483647
+#define PID_FLOAT_TO_Q31(x)   ((int32_t) ((x) >= 1.0f ? PID_Q31_ONE : ((x) <= -1.0f ? (-PID_Q31_ONE - 1) : (x) * 2147483648.0f)))
+#define PID_Q31_TO_FLOAT(x)   ((float) (x) * (1.0f / 2147483648.0f))
+
+// Returns false on a non positive dt or an empty output range
+bool PidInit(sPid *pid, const sPidConfig *config);
+// Clears the integral and derivative state, the next update takes no derivative
+void PidReset(sPid *pid);
+float PidUpdate(sPid *pid, float setpoint, float measurement);
+
+// outMin and outMax are fractions of full scale. Returns false when they are out of
+// [-1, 1] or a gain is too large for a q1.31 with up to 30 bits of gain shift
+bool PidQ31Init(sPidQ31 *pid, const sPidConfig *config);
+void PidQ31Reset(sPidQ31 *pid);
+int32_t PidQ31Update(sPidQ31 *pid, int32_t setpoint, int32_t measurement);
+
+#endif /* __PID_H */
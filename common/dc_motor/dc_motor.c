@@ -1,187 +1,394 @@
-/*
- *  motor.c
- *
- *  V1: Main implementation of DC Motor & Actuator control functions
- *  V2: Main implementation of Servo Motor control function
- * 
- *  Created on: Jan 11, 2023
- *      Author: Jackie Huynh & Michelle Tran
- * 
- */
-
-#include <math.h>
-#include <stdlib.h>
-#include <stdint.h>
-
-#include "dc_motor.h"
-#include "utility.h"
-#include "stm32h5xx_hal.h"
-
-// #define STM32F446
-
-static int32_t currEncodeCnt    = 0;
-static int16_t currAngle        = 0;
-
-//DC Motor Functions
-DCMotor_Error DCMotor_Init(DCMotor_Instance_t* dcMotor){
-
-    HAL_StatusTypeDef error;
-
-    /* Assert Param */
-    if(dcMotor == NULL)
-        return DC_MOTOR_INSTANCE_ERR;
-    else if(dcMotor->config == NULL)
-        return DC_MOTOR_INSTANCE_ERR;
-
-    /* Calculate Min and Max counter value based on user config */
-    dcMotor->Min_Cnt = __HAL_TIM_GET_AUTORELOAD(dcMotor->DC_Timer) * (float)(dcMotor->config->Min_Speed / 100.0);
-    dcMotor->Max_Cnt = __HAL_TIM_GET_AUTORELOAD(dcMotor->DC_Timer) * (float)(dcMotor->config->Max_Speed / 100.0);
-
-    /* Start PWM Signal */
-    error  = HAL_TIM_PWM_Start(dcMotor->DC_Timer, dcMotor->IN1_Channel);
-    error |= HAL_TIM_PWM_Start(dcMotor->DC_Timer, dcMotor->IN2_Channel);
-    error |= HAL_TIM_GenerateEvent(dcMotor->DC_Timer, TIM_EventSource_Update);       //Sync Counter
-
-    /* Error Handling */
-    if(error != HAL_OK){
-        // HAL_GPIO_WritePin(LD2_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
-        while(1);
-    }
-
-    return DC_MOTOR_OK;
-}
-
-DCMotor_Error Drive_DCMotor(const DCMotor_Instance_t* dcMotor, const uint8_t speed, DCMotor_Direction dir){
-
-    /* Assert Param */
-    if(dcMotor == NULL)
-        return DC_MOTOR_INSTANCE_ERR;
-    else if(dcMotor->config == NULL)
-        return DC_MOTOR_INSTANCE_ERR;
-    else if(speed < dcMotor->config->Min_Speed)
-        return DC_MOTOR_UNDER_RANGE;
-    else if(speed > dcMotor->config->Max_Speed)
-        return DC_MOTOR_ABOVE_RANGE;
-
-    /* Map speed value to counter value */
-    uint16_t mappedValue = map(speed, dcMotor->config->Min_Speed, dcMotor->config->Max_Speed, dcMotor->Min_Cnt, dcMotor->Max_Cnt);
-
-    if(dir == CLOCKWISE){
-        __HAL_TIM_SET_COMPARE(dcMotor->DC_Timer, dcMotor->IN1_Channel, mappedValue);
-        __HAL_TIM_SET_COMPARE(dcMotor->DC_Timer, dcMotor->IN2_Channel, 0);
-    }
-    else if(dir == COUNTER_CLOCKWISE){
-        __HAL_TIM_SET_COMPARE(dcMotor->DC_Timer, dcMotor->IN1_Channel, 0);
-        __HAL_TIM_SET_COMPARE(dcMotor->DC_Timer, dcMotor->IN2_Channel, mappedValue);
-    }
-
-    HAL_TIM_GenerateEvent(dcMotor->DC_Timer, TIM_EventSource_Update);       //Sync Counter
-
-    return DC_MOTOR_OK;
-}
-
-DCMotor_Error Stop_DCMotor(const DCMotor_Instance_t* dcMotor){
-
-    /* Assert Param */
-    if(dcMotor == NULL)
-        return DC_MOTOR_INSTANCE_ERR;
-    else if(dcMotor->config == NULL)
-        return DC_MOTOR_INSTANCE_ERR;
-
-    //Set Both Compare to 0 for 0% power
-    __HAL_TIM_SET_COMPARE(dcMotor->DC_Timer, dcMotor->IN1_Channel, 0);
-    __HAL_TIM_SET_COMPARE(dcMotor->DC_Timer, dcMotor->IN2_Channel, 0);
-
-    return DC_MOTOR_OK;
-}
-
-//DC Motor W Encoder Functions
-DCMotor_Error DCMotor_Encoder_Init(DCMotor_Encoder_Instance_t* encMotor){
-
-    HAL_StatusTypeDef error;
-
-    /* Assert Param */
-    if((encMotor == NULL) || (encMotor->encConfig == NULL) || (encMotor->motorInstance == NULL))
-        return DC_MOTOR_INSTANCE_ERR;
-
-    /* Set Local Scope Variables */
-    currAngle       = encMotor->encConfig->Current_Angle;
-    currEncodeCnt   = encMotor->encConfig->Default_Counter;
-
-    /* Set Encoder Default Counter Value */
-    __HAL_TIM_SET_COUNTER(encMotor->Encoder_Timer, encMotor->encConfig->Default_Counter);
-    error = HAL_TIM_Encoder_Start(encMotor->Encoder_Timer, TIM_CHANNEL_ALL);
-
-    /* Error Handling */
-    if(error != HAL_OK){
-        // HAL_GPIO_WritePin(LD2_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
-        while(1);
-    }
-
-    return DC_MOTOR_OK;
-
-}
-
-DCMotor_Error Drive_DCMotor_Angle(const DCMotor_Encoder_Instance_t* encMotor, int16_t angle){
-
-    DCMotor_Error error;
-    uint32_t desiredCnt;
-    uint32_t angle_to_counter = 0;
-
-    /* Assert Param */
-    if((encMotor == NULL) || (encMotor->encConfig == NULL) || (encMotor->motorInstance == NULL))
-        return DC_MOTOR_OK;
-    else if(angle > encMotor->encConfig->Max_Angle)
-        return DC_MOTOR_ABOVE_RANGE;
-    else if(angle < encMotor->encConfig->Min_Angle)
-        return DC_MOTOR_UNDER_RANGE;
-
-    /* Default Parameter Arguments */
-    if(angle == 0)
-        return DC_MOTOR_OK;
-    else if(angle == 360){
-        desiredCnt = encMotor->encConfig->Default_Counter * 2;
-        error = Drive_DCMotor(encMotor->motorInstance, 40, CLOCKWISE);
-        while(currEncodeCnt <= desiredCnt){
-            currEncodeCnt = __HAL_TIM_GET_COUNTER(encMotor->Encoder_Timer);
-        }
-        error |= Stop_DCMotor(encMotor->motorInstance);
-    }
-    else if(angle == -360){
-        desiredCnt = 0;
-        error = Drive_DCMotor(encMotor->motorInstance, 40, COUNTER_CLOCKWISE);
-        while(currEncodeCnt >= desiredCnt){
-            currEncodeCnt = __HAL_TIM_GET_COUNTER(encMotor->Encoder_Timer);
-        }
-        error |= Stop_DCMotor(encMotor->motorInstance);
-    }
-    else{
-        angle_to_counter = abs(angle) / encMotor->encConfig->Degree_Per_Pulse;
-        if(angle < 0){
-            desiredCnt = currEncodeCnt - angle_to_counter;
-            error = Drive_DCMotor(encMotor->motorInstance, 99, COUNTER_CLOCKWISE);
-            HAL_Delay(1);
-            error = Drive_DCMotor(encMotor->motorInstance, 40, COUNTER_CLOCKWISE);
-            while(currEncodeCnt >= desiredCnt){
-                currEncodeCnt = __HAL_TIM_GET_COUNTER(encMotor->Encoder_Timer);
-            }
-            error |= Stop_DCMotor(encMotor->motorInstance);
-        }
-        else{
-            desiredCnt = currEncodeCnt + angle_to_counter;
-            error = Drive_DCMotor(encMotor->motorInstance, 99, CLOCKWISE);
-            HAL_Delay(1);
-            error = Drive_DCMotor(encMotor->motorInstance, 40, CLOCKWISE);
-            while(currEncodeCnt <= desiredCnt){
-                currEncodeCnt = __HAL_TIM_GET_COUNTER(encMotor->Encoder_Timer);
-            }
-            error |= Stop_DCMotor(encMotor->motorInstance);
-        }
-    }
-
-    /* Update Control Variable */
-    currAngle += angle;
-    currEncodeCnt = __HAL_TIM_GET_COUNTER(encMotor->Encoder_Timer);
-
-    return DC_MOTOR_OK;
-}
+/*
+ *  motor.c
+ *
+ *  V1: Main implementation of DC Motor & Actuator control functions
+ *  V2: Main implementation of Servo Motor control function
+ * 
+ *  Created on: Jan 11, 2023
+ *      Author: Jackie Huynh & Michelle Tran
+ * 
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "dc_motor.h"
+#include "control.h"
+#include "utility.h"
+#include "stm32h5xx_hal.h"
+
+// #define STM32F446
+
+#define DRIVE_DEADBAND              (0.005f)    //Drive magnitude treated as stop
+#define VELOCITY_MIN_COUNTS         (4)         //Counts per sample for a single sample estimate
+#define VELOCITY_WINDOW_MS          (100U)      //No count change for this long reads as standing still
+#define SETTLE_HOLD_MS              (50U)       //Time inside the settle window that ends a move
+
+//IN1 and IN2 together, through the group's burst when there is one
+static DCMotor_Error DCMotor_Write(const DCMotor_Instance_t* dcMotor, uint16_t in1, uint16_t in2){
+
+    PWM_Group_Error error;
+
+    PWM_Group_Begin(dcMotor->Group);
+    error  = PWM_Set_Compare(dcMotor->Group, dcMotor->DC_Timer, dcMotor->IN1_Channel, in1);
+    error |= PWM_Set_Compare(dcMotor->Group, dcMotor->DC_Timer, dcMotor->IN2_Channel, in2);
+    if(dcMotor->Group != NULL)
+        error |= PWM_Group_End(dcMotor->Group);
+
+    return (error == PWM_GROUP_OK) ? DC_MOTOR_OK : DC_MOTOR_INSTANCE_ERR;
+}
+
+//DC Motor Functions
+DCMotor_Error DCMotor_Init(DCMotor_Instance_t* dcMotor){
+
+    HAL_StatusTypeDef error;
+
+    /* Assert Param */
+    if(dcMotor == NULL)
+        return DC_MOTOR_INSTANCE_ERR;
+    else if(dcMotor->config == NULL)
+        return DC_MOTOR_INSTANCE_ERR;
+
+    /* Calculate Min and Max counter value based on user config */
+    dcMotor->Min_Cnt = __HAL_TIM_GET_AUTORELOAD(dcMotor->DC_Timer) * (float)(dcMotor->config->Min_Speed / 100.0);
+    dcMotor->Max_Cnt = __HAL_TIM_GET_AUTORELOAD(dcMotor->DC_Timer) * (float)(dcMotor->config->Max_Speed / 100.0);
+    if(!FixLinearInit(&dcMotor->Speed_Map, dcMotor->config->Min_Speed, dcMotor->config->Max_Speed, dcMotor->Min_Cnt, dcMotor->Max_Cnt) ||
+       !FixLinearInit(&dcMotor->Drive_Map, 0, FIX_Q15_ONE, dcMotor->Min_Cnt, dcMotor->Max_Cnt))
+        return DC_MOTOR_INSTANCE_ERR;
+
+    /* Join the group before the first write */
+    if(dcMotor->Group != NULL){
+        if(PWM_Group_Add_Channel(dcMotor->Group, dcMotor->IN1_Channel) != PWM_GROUP_OK ||
+           PWM_Group_Add_Channel(dcMotor->Group, dcMotor->IN2_Channel) != PWM_GROUP_OK)
+            return DC_MOTOR_INSTANCE_ERR;
+    }
+
+    /* Start PWM Signal */
+    error  = PWM_Start_Channel(dcMotor->DC_Timer, dcMotor->IN1_Channel);
+    error |= PWM_Start_Channel(dcMotor->DC_Timer, dcMotor->IN2_Channel);
+
+    /* Error Handling */
+    if(error != HAL_OK){
+        // HAL_GPIO_WritePin(LD2_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
+        while(1);
+    }
+
+    return DC_MOTOR_OK;
+}
+
+DCMotor_Error Drive_DCMotor(const DCMotor_Instance_t* dcMotor, const uint8_t speed, DCMotor_Direction dir){
+
+    /* Assert Param */
+    if(dcMotor == NULL)
+        return DC_MOTOR_INSTANCE_ERR;
+    else if(dcMotor->config == NULL)
+        return DC_MOTOR_INSTANCE_ERR;
+    else if(speed < dcMotor->config->Min_Speed)
+        return DC_MOTOR_UNDER_RANGE;
+    else if(speed > dcMotor->config->Max_Speed)
+        return DC_MOTOR_ABOVE_RANGE;
+
+    /* Map speed value to counter value */
+    uint16_t mappedValue = FixLinearApply(&dcMotor->Speed_Map, speed);
+
+    /* Taken at the next update without cutting the period short */
+    if(dir == CLOCKWISE)
+        return DCMotor_Write(dcMotor, mappedValue, 0);
+    else if(dir == COUNTER_CLOCKWISE)
+        return DCMotor_Write(dcMotor, 0, mappedValue);
+
+    return DC_MOTOR_OK;
+}
+
+DCMotor_Error Stop_DCMotor(const DCMotor_Instance_t* dcMotor){
+
+    /* Assert Param */
+    if(dcMotor == NULL)
+        return DC_MOTOR_INSTANCE_ERR;
+    else if(dcMotor->config == NULL)
+        return DC_MOTOR_INSTANCE_ERR;
+
+    //Set Both Compare to 0 for 0% power
+    return DCMotor_Write(dcMotor, 0, 0);
+}
+
+//Signed drive for the cascade loop, the magnitude maps onto the configured speed range
+static void DCMotor_Set_Drive(const DCMotor_Instance_t* dcMotor, float drive){
+
+    uint16_t mappedValue;
+
+    if(drive > -DRIVE_DEADBAND && drive < DRIVE_DEADBAND){
+        DCMotor_Write(dcMotor, 0, 0);
+        return;
+    }
+
+    mappedValue = FixLinearApply(&dcMotor->Drive_Map, (int32_t)((drive < 0 ? -drive : drive) * FIX_Q15_ONE));
+
+    if(drive > 0)
+        DCMotor_Write(dcMotor, mappedValue, 0);
+    else
+        DCMotor_Write(dcMotor, 0, mappedValue);
+}
+
+//Counter plus the wraps counted so far. A wrap whose interrupt is still pending, because
+//the caller runs at a higher priority or with interrupts off, is folded in from the flag
+static int64_t DCMotor_Encoder_Read(const DCMotor_Encoder_Instance_t* encMotor){
+
+    TIM_TypeDef* tim = encMotor->Encoder_Timer->Instance;
+    uint32_t period = tim->ARR + 1U;
+    uint32_t primask;
+    uint32_t cnt, cntAfter, sr;
+    int64_t wraps;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    wraps = encMotor->Wraps;
+    cnt = tim->CNT;
+    sr = tim->SR;
+    cntAfter = tim->CNT;
+    __set_PRIMASK(primask);
+
+    /* Flag set, the second read is past the wrap. A low count means it overflowed */
+    if(sr & TIM_SR_UIF){
+        cnt = cntAfter;
+        wraps += (cnt < period / 2U) ? 1 : -1;
+    }
+
+    return wraps * period + cnt;
+}
+
+//Period/frequency hybrid. Fast, the count difference of one sample. Slow, the counts over the
+//samples since the count last moved, and a bound that decays while it stands still.
+static void DCMotor_Encoder_Velocity(DCMotor_Encoder_Instance_t* encMotor, int64_t count){
+
+    DCMotor_Encoder_Config_t* config = encMotor->encConfig;
+    int64_t delta = count - encMotor->Last_Count;
+    int64_t windowDelta;
+    float bound;
+
+    encMotor->Last_Count = count;
+    encMotor->Window_Samples++;
+
+    if(delta >= VELOCITY_MIN_COUNTS || delta <= -VELOCITY_MIN_COUNTS){
+        encMotor->Velocity = (float)delta * config->Loop_Rate;
+        encMotor->Window_Count = count;
+        encMotor->Window_Samples = 0;
+        return;
+    }
+
+    windowDelta = count - encMotor->Window_Count;
+    if(windowDelta != 0){
+        encMotor->Velocity = (float)windowDelta * config->Loop_Rate / encMotor->Window_Samples;
+        encMotor->Window_Count = count;
+        encMotor->Window_Samples = 0;
+        return;
+    }
+
+    if((uint32_t)encMotor->Window_Samples * 1000U >= (uint32_t)VELOCITY_WINDOW_MS * config->Loop_Rate){
+        encMotor->Velocity = 0;
+        encMotor->Window_Samples = 0;
+        return;
+    }
+
+    /* No count yet, the speed is below one count over the window so far */
+    bound = (float)config->Loop_Rate / encMotor->Window_Samples;
+    if(encMotor->Velocity > bound)
+        encMotor->Velocity = bound;
+    else if(encMotor->Velocity < -bound)
+        encMotor->Velocity = -bound;
+}
+
+//Settling time and overshoot of the move in progress
+static void DCMotor_Encoder_Measure(DCMotor_Encoder_Instance_t* encMotor, int64_t count){
+
+    DCMotor_Encoder_Config_t* config = encMotor->encConfig;
+    int64_t excursion = count - encMotor->Target_Count;
+    float error;
+    uint32_t holdSamples = (uint32_t)SETTLE_HOLD_MS * config->Loop_Rate / 1000U;
+
+    if(encMotor->Status != DCMOTOR_MOVING)
+        return;
+
+    encMotor->Move_Samples++;
+
+    /* Past the target in the direction of travel */
+    if(encMotor->Target_Count < encMotor->Move_Start)
+        excursion = -excursion;
+    if(excursion > encMotor->Peak_Excursion)
+        encMotor->Peak_Excursion = excursion;
+
+    error = (float)(count - encMotor->Target_Count) * config->Degree_Per_Pulse;
+    if(error > config->Settle_Window || error < -config->Settle_Window){
+        encMotor->Settle_Samples = 0;
+        return;
+    }
+
+    if(++encMotor->Settle_Samples < holdSamples)
+        return;
+
+    encMotor->Move_Stats.Moves++;
+    encMotor->Move_Stats.Settle_MS = (encMotor->Move_Samples - encMotor->Settle_Samples) * 1000U / config->Loop_Rate;
+    encMotor->Move_Stats.Overshoot = (float)encMotor->Peak_Excursion * config->Degree_Per_Pulse;
+    if(encMotor->Move_Stats.Overshoot > encMotor->Move_Stats.Overshoot_Max)
+        encMotor->Move_Stats.Overshoot_Max = encMotor->Move_Stats.Overshoot;
+    encMotor->Status = DCMOTOR_HOLDING;
+}
+
+//Velocity loop every step, position loop every Position_Divider steps, runs in the scheduler interrupt
+static void DCMotor_Encoder_Loop(void* context){
+
+    DCMotor_Encoder_Instance_t* encMotor = context;
+    DCMotor_Encoder_Config_t* config = encMotor->encConfig;
+    int64_t count = DCMotor_Encoder_Read(encMotor);
+    float drive;
+
+    DCMotor_Encoder_Velocity(encMotor, count);
+
+    if(++encMotor->Position_Phase >= config->Position_Divider){
+        encMotor->Position_Phase = 0;
+        encMotor->Velocity_Setpoint = PidUpdate(&encMotor->Position_Loop,
+                                                (float)(encMotor->Target_Count - config->Default_Counter) * config->Degree_Per_Pulse,
+                                                (float)(count - config->Default_Counter) * config->Degree_Per_Pulse);
+    }
+
+    drive = PidUpdate(&encMotor->Velocity_Loop, encMotor->Velocity_Setpoint, encMotor->Velocity * config->Degree_Per_Pulse);
+    DCMotor_Set_Drive(encMotor->motorInstance, drive);
+
+    DCMotor_Encoder_Measure(encMotor, count);
+}
+
+//DC Motor W Encoder Functions
+DCMotor_Error DCMotor_Encoder_Init(DCMotor_Encoder_Instance_t* encMotor){
+
+    HAL_StatusTypeDef error;
+    DCMotor_Encoder_Config_t* config;
+    sPidConfig pidConfig;
+
+    /* Assert Param */
+    if((encMotor == NULL) || (encMotor->encConfig == NULL) || (encMotor->motorInstance == NULL))
+        return DC_MOTOR_INSTANCE_ERR;
+
+    config = encMotor->encConfig;
+    if((config->Position_PID == NULL) || (config->Velocity_PID == NULL) || (config->Loop_Rate == 0) ||
+       (config->Position_Divider == 0) || (config->Degree_Per_Pulse <= 0))
+        return DC_MOTOR_INSTANCE_ERR;
+
+    /* Cascade, the position loop commands a velocity within Max_Velocity */
+    pidConfig = *config->Position_PID;
+    pidConfig.dt = (float)config->Position_Divider / config->Loop_Rate;
+    pidConfig.outMin = -config->Max_Velocity;
+    pidConfig.outMax = config->Max_Velocity;
+    if(!PidInit(&encMotor->Position_Loop, &pidConfig))
+        return DC_MOTOR_INSTANCE_ERR;
+
+    pidConfig = *config->Velocity_PID;
+    pidConfig.dt = 1.0f / config->Loop_Rate;
+    pidConfig.outMin = -1.0f;
+    pidConfig.outMax = 1.0f;
+    if(!PidInit(&encMotor->Velocity_Loop, &pidConfig))
+        return DC_MOTOR_INSTANCE_ERR;
+
+    /* Set Encoder Default Counter Value, the loop holds it until the first move */
+    encMotor->Wraps = 0;
+    encMotor->Target_Count = config->Default_Counter;
+    encMotor->Last_Count = config->Default_Counter;
+    encMotor->Window_Count = config->Default_Counter;
+    encMotor->Window_Samples = 0;
+    encMotor->Velocity = 0;
+    encMotor->Velocity_Setpoint = 0;
+    encMotor->Position_Phase = 0;
+    encMotor->Move_Stats = (DCMotor_Move_Stats_t){0};
+    encMotor->Status = DCMOTOR_HOLDING;
+
+    encMotor->Loop_ID = ControlRegister("dc_motor", DCMotor_Encoder_Loop, encMotor, config->Loop_Rate, 0);
+    if(encMotor->Loop_ID < 0){
+        encMotor->Status = DCMOTOR_IDLE;
+        return DC_MOTOR_LOOP_ERR;
+    }
+
+    __HAL_TIM_SET_COUNTER(encMotor->Encoder_Timer, config->Default_Counter);
+    __HAL_TIM_CLEAR_FLAG(encMotor->Encoder_Timer, TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE_IT(encMotor->Encoder_Timer, TIM_IT_UPDATE);
+    error = HAL_TIM_Encoder_Start(encMotor->Encoder_Timer, TIM_CHANNEL_ALL);
+
+    /* Error Handling */
+    if(error != HAL_OK){
+        // HAL_GPIO_WritePin(LD2_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
+        while(1);
+    }
+
+    return DC_MOTOR_OK;
+
+}
+
+DCMotor_Error Drive_DCMotor_Angle(DCMotor_Encoder_Instance_t* encMotor, int16_t angle){
+
+    uint32_t primask;
+    int64_t angle_to_counter;
+
+    /* Assert Param */
+    if((encMotor == NULL) || (encMotor->encConfig == NULL) || (encMotor->motorInstance == NULL))
+        return DC_MOTOR_INSTANCE_ERR;
+    else if(encMotor->Status == DCMOTOR_IDLE)
+        return DC_MOTOR_INSTANCE_ERR;
+    else if(angle > encMotor->encConfig->Max_Angle)
+        return DC_MOTOR_ABOVE_RANGE;
+    else if(angle < encMotor->encConfig->Min_Angle)
+        return DC_MOTOR_UNDER_RANGE;
+
+    if(angle == 0)
+        return DC_MOTOR_OK;
+
+    angle_to_counter = (int64_t)(angle / encMotor->encConfig->Degree_Per_Pulse);
+
+    /* The loop interrupt reads the target and the move state together */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    encMotor->Move_Start = DCMotor_Encoder_Read(encMotor);
+    encMotor->Target_Count += angle_to_counter;
+    encMotor->Move_Samples = 0;
+    encMotor->Settle_Samples = 0;
+    encMotor->Peak_Excursion = 0;
+    encMotor->Status = DCMOTOR_MOVING;
+    __set_PRIMASK(primask);
+
+    return DC_MOTOR_OK;
+}
+
+DCMotor_Status DCMotor_Encoder_Get_Status(const DCMotor_Encoder_Instance_t* encMotor){
+    return encMotor->Status;
+}
+
+int64_t DCMotor_Encoder_Get_Count(const DCMotor_Encoder_Instance_t* encMotor){
+    return DCMotor_Encoder_Read(encMotor) - encMotor->encConfig->Default_Counter;
+}
+
+float DCMotor_Encoder_Get_Angle(const DCMotor_Encoder_Instance_t* encMotor){
+    return encMotor->encConfig->Current_Angle + DCMotor_Encoder_Get_Count(encMotor) * encMotor->encConfig->Degree_Per_Pulse;
+}
+
+float DCMotor_Encoder_Get_Velocity(const DCMotor_Encoder_Instance_t* encMotor){
+    return encMotor->Velocity * encMotor->encConfig->Degree_Per_Pulse;
+}
+
+void DCMotor_Encoder_Get_Move_Stats(const DCMotor_Encoder_Instance_t* encMotor, DCMotor_Move_Stats_t* stats){
+
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = encMotor->Move_Stats;
+    __set_PRIMASK(primask);
+}
+
+//Over or underflow of the encoder counter, a low count after the wrap means it counted up
+void DCMotor_Encoder_IRQHandler(DCMotor_Encoder_Instance_t* encMotor){
+
+    TIM_TypeDef* tim = encMotor->Encoder_Timer->Instance;
+
+    if(!(tim->SR & TIM_SR_UIF))
+        return;
+
+    tim->SR = ~TIM_SR_UIF;
+    encMotor->Wraps += (tim->CNT < (tim->ARR + 1U) / 2U) ? 1 : -1;
+}
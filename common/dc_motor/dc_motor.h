@@ -1,71 +1,135 @@
-/*
- *  motor.h
- *
- *  V1: Provide DC Motor & Actuator control functions
- *  V2: Provide Servo Motor control function
- * 
- *  Created on: Jan 11, 2023
- *      Author: Jackie Huynh & Michelle Tran
- * 
- */
-
-#ifndef MOTOR_H_
-#define MOTOR_H
-
-#include <stdint.h>
-#include "stm32h5xx_hal.h"
-
-//DC Motor Error Enum
-typedef enum{
-    DC_MOTOR_OK             = 0x00U,
-	DC_MOTOR_UNDER_RANGE	= 0x01U,
-	DC_MOTOR_ABOVE_RANGE	= 0x02U,
-    DC_MOTOR_INSTANCE_ERR   = 0x03U
-} DCMotor_Error;
-
-//DC Motor Direction Enum
-typedef enum{
-    CLOCKWISE               = 0x00U,
-    COUNTER_CLOCKWISE       = 0x01U
-} DCMotor_Direction;
-
-//DC Motor Struct
-typedef struct{
-	uint8_t Min_Speed;						//Percentage Based
-	uint8_t Max_Speed;						//Percentage Based
-} DCMotor_Config_t;
-
-typedef struct{
-	TIM_HandleTypeDef* 	DC_Timer;
-	uint8_t 			IN1_Channel;
-	uint8_t 			IN2_Channel;
-	uint16_t			Min_Cnt;                      
-	uint16_t			Max_Cnt;   
-	DCMotor_Config_t* 	config;                   
-} DCMotor_Instance_t;
-
-//DC Motor W Encoder Structs
-typedef struct{
-	uint32_t 	Default_Counter;
-	float 		Degree_Per_Pulse;
-	int16_t 	Current_Angle;
-	int16_t 	Min_Angle;
-	int16_t 	Max_Angle;
-} DCMotor_Encoder_Config_t;
-
-typedef struct{
-	TIM_HandleTypeDef*			Encoder_Timer;
-	DCMotor_Encoder_Config_t* 	encConfig;
-	DCMotor_Instance_t* 	  	motorInstance;
-} DCMotor_Encoder_Instance_t;
-
-//DC Motor Functions
-DCMotor_Error DCMotor_Init(DCMotor_Instance_t* dcMotor);
-DCMotor_Error Drive_DCMotor(const DCMotor_Instance_t* dcMotor, const uint8_t speed, DCMotor_Direction dir);
-DCMotor_Error Stop_DCMotor(const DCMotor_Instance_t* dcMotor);
-
-//DC Motor With Encoder Function
-DCMotor_Error DCMotor_Encoder_Init(DCMotor_Encoder_Instance_t* encMotor);
-DCMotor_Error Drive_DCMotor_Angle(const DCMotor_Encoder_Instance_t* encMotor, int16_t angle);
-
+/*
+ *  motor.h
+ *
+ *  V1: Provide DC Motor & Actuator control functions
+ *  V2: Provide Servo Motor control function
+ * 
+ *  Created on: Jan 11, 2023
+ *      Author: Jackie Huynh & Michelle Tran
+ * 
+ */
+
+#ifndef MOTOR_H_
+#define MOTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32h5xx_hal.h"
+#include "pid.h"
+#include "fixmath.h"
+#include "pwm_group.h"
+
+//DC Motor Error Enum
+typedef enum{
+    DC_MOTOR_OK             = 0x00U,
+	DC_MOTOR_UNDER_RANGE	= 0x01U,
+	DC_MOTOR_ABOVE_RANGE	= 0x02U,
+    DC_MOTOR_INSTANCE_ERR   = 0x03U,
+    DC_MOTOR_LOOP_ERR       = 0x04U
+} DCMotor_Error;
+
+//DC Motor Direction Enum
+typedef enum{
+    CLOCKWISE               = 0x00U,
+    COUNTER_CLOCKWISE       = 0x01U
+} DCMotor_Direction;
+
+//DC Motor With Encoder Status Enum
+typedef enum{
+    DCMOTOR_IDLE,                       //Not initialized
+    DCMOTOR_MOVING,                     //Cascade loop driving to the target
+    DCMOTOR_HOLDING                     //Settled, the loop holds the position
+} DCMotor_Status;
+
+//DC Motor Struct
+typedef struct{
+	uint8_t Min_Speed;						//Percentage Based
+	uint8_t Max_Speed;						//Percentage Based
+} DCMotor_Config_t;
+
+typedef struct{
+	TIM_HandleTypeDef* 	DC_Timer;
+	uint8_t 			IN1_Channel;
+	uint8_t 			IN2_Channel;
+	PWM_Group_t*		Group;					//Optional, IN1 and IN2 change in one burst
+	uint16_t			Min_Cnt;                      
+	uint16_t			Max_Cnt;   
+	sFixLinear			Speed_Map;				//Speed percentage to compare count
+	sFixLinear			Drive_Map;				//Drive magnitude in Q15 to compare count
+	DCMotor_Config_t* 	config;                   
+} DCMotor_Instance_t;
+
+//DC Motor W Encoder Structs
+typedef struct{
+	uint32_t 	Default_Counter;
+	float 		Degree_Per_Pulse;
+	int16_t 	Current_Angle;
+	int16_t 	Min_Angle;
+	int16_t 	Max_Angle;
+
+	//Cascade loop, dt and output limits are set on init
+	sPidConfig*	Position_PID;				//Degrees in, deg/s out
+	sPidConfig*	Velocity_PID;				//Deg/s in, drive -1 to 1 out
+	float		Max_Velocity;				//Deg/s, limit of the position loop output
+	uint16_t	Loop_Rate;					//Hz of the velocity loop, must divide the control tick
+	uint8_t		Position_Divider;			//Velocity loop steps per position loop step
+	float		Settle_Window;				//Degrees, a move is settled once it stays inside
+} DCMotor_Encoder_Config_t;
+
+//Settling of the last finished move, measured by the loop
+typedef struct{
+	uint32_t	Moves;						//Moves that settled
+	uint32_t	Settle_MS;					//Move start to the settle window entry it stayed in
+	float		Overshoot;					//Degrees past the target in the direction of travel
+	float		Overshoot_Max;
+} DCMotor_Move_Stats_t;
+
+typedef struct{
+	TIM_HandleTypeDef*			Encoder_Timer;
+	DCMotor_Encoder_Config_t* 	encConfig;
+	DCMotor_Instance_t* 	  	motorInstance;
+
+	/* These will be set in the INIT function and by the control loop */
+	volatile int32_t			Wraps;			//Counter over and underflows, from the update interrupt
+	int64_t						Target_Count;
+	float						Velocity;		//Counts per second
+	float						Velocity_Setpoint;
+	sPid						Position_Loop;
+	sPid						Velocity_Loop;
+	uint8_t						Position_Phase;
+	volatile DCMotor_Status		Status;
+
+	//Velocity estimate, a window spans the samples since the count last moved
+	int64_t						Last_Count;
+	int64_t						Window_Count;
+	uint16_t					Window_Samples;
+
+	//Move measurement
+	int64_t						Move_Start;
+	uint32_t					Move_Samples;
+	uint32_t					Settle_Samples;
+	int64_t						Peak_Excursion;
+	DCMotor_Move_Stats_t		Move_Stats;
+	int8_t						Loop_ID;
+} DCMotor_Encoder_Instance_t;
+
+//DC Motor Functions
+DCMotor_Error DCMotor_Init(DCMotor_Instance_t* dcMotor);
+DCMotor_Error Drive_DCMotor(const DCMotor_Instance_t* dcMotor, const uint8_t speed, DCMotor_Direction dir);
+DCMotor_Error Stop_DCMotor(const DCMotor_Instance_t* dcMotor);
+
+//DC Motor With Encoder Function
+//The encoder timer counts in encoder mode, its update interrupt extends the count past the
+//counter width and the BSP's handler for it calls DCMotor_Encoder_IRQHandler. The position and
+//velocity cascade runs on the control scheduler, call ControlInit before and ControlStart after.
+DCMotor_Error DCMotor_Encoder_Init(DCMotor_Encoder_Instance_t* encMotor);
+//Non-blocking, moves angle degrees from the current target
+DCMotor_Error Drive_DCMotor_Angle(DCMotor_Encoder_Instance_t* encMotor, int16_t angle);
+DCMotor_Status DCMotor_Encoder_Get_Status(const DCMotor_Encoder_Instance_t* encMotor);
+int64_t DCMotor_Encoder_Get_Count(const DCMotor_Encoder_Instance_t* encMotor);
+float DCMotor_Encoder_Get_Angle(const DCMotor_Encoder_Instance_t* encMotor);
+float DCMotor_Encoder_Get_Velocity(const DCMotor_Encoder_Instance_t* encMotor);
+void DCMotor_Encoder_Get_Move_Stats(const DCMotor_Encoder_Instance_t* encMotor, DCMotor_Move_Stats_t* stats);
+void DCMotor_Encoder_IRQHandler(DCMotor_Encoder_Instance_t* encMotor);
+
 #endif
\ No newline at end of file
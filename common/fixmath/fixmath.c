@@ -0,0 +1,166 @@
+#include <string.h>
+
+#include "fixmath.h"
+
+// Static Function Declarations
+static inline uint32_t _fixRead2(const q15_t *p);
+static inline void _fixWrite2(q15_t *p, uint32_t pair);
+
+
+// Static Function Definitions
+// Two lanes in one word, lane 0 low. memcpy compiles to a single unaligned-capable load or store
+static inline uint32_t _fixRead2(const q15_t *p)
+{
+    uint32_t pair;
+
+    memcpy(&pair, p, sizeof(pair));
+    return pair;
+}
+
+static inline void _fixWrite2(q15_t *p, uint32_t pair)
+{
+    memcpy(p, &pair, sizeof(pair));
+}
+
+
+// Public Functions
+bool FixLinearInit(sFixLinear *map, int32_t inMin, int32_t inMax, int32_t outMin, int32_t outMax)
+{
+    int64_t inRange = (int64_t) inMax - inMin;
+    int64_t outRange = (int64_t) outMax - outMin;
+    int64_t mult = 0;
+    uint8_t shift = 0;
+
+    if(inRange < 0 || inRange > INT32_MAX)
+    {
+        return false;
+    }
+
+    // Largest shift that keeps the rounded slope in 32 bits, |outRange| < 2^32 so the scaling fits 64
+    if(inRange > 0)
+    {
+        for(shift = 31; ; shift--)
+        {
+            int64_t scaled = outRange * ((int64_t) 1 << shift);
+
+            mult = (scaled + (scaled >= 0 ? inRange / 2 : -inRange / 2)) / inRange;
+            if(mult >= INT32_MIN && mult <= INT32_MAX)
+            {
+                break;
+            }
+            if(shift == 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    map->inMin = inMin;
+    map->inMax = inMax;
+    map->outMin = outMin;
+    map->outMax = outMax;
+    map->mult = (int32_t) mult;
+    map->shift = shift;
+    map->round = (shift > 0) ? ((int64_t) 1 << (shift - 1)) : 0;
+    return true;
+}
+
+void FixVecAddQ15(const q15_t *a, const q15_t *b, q15_t *dst, uint32_t n)
+{
+    uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    for(; i + 2 <= n; i += 2)
+    {
+        _fixWrite2(&dst[i], __QADD16(_fixRead2(&a[i]), _fixRead2(&b[i])));
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        dst[i] = FixAddQ15(a[i], b[i]);
+    }
+}
+
+void FixVecSubQ15(const q15_t *a, const q15_t *b, q15_t *dst, uint32_t n)
+{
+    uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    for(; i + 2 <= n; i += 2)
+    {
+        _fixWrite2(&dst[i], __QSUB16(_fixRead2(&a[i]), _fixRead2(&b[i])));
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        dst[i] = FixSubQ15(a[i], b[i]);
+    }
+}
+
+void FixVecScaleQ15(const q15_t *src, q15_t scale, int8_t shift, q15_t *dst, uint32_t n)
+{
+    uint8_t right = (uint8_t) (15 - shift);
+    uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    // One load and one store per pair, the lanes are multiplied and saturated on their own
+    for(; i + 2 <= n; i += 2)
+    {
+        uint32_t pair = _fixRead2(&src[i]);
+        int32_t lo = __SSAT(((int32_t) (int16_t) pair * scale) >> right, 16);
+        int32_t hi = __SSAT(((int32_t) (int16_t) (pair >> 16) * scale) >> right, 16);
+
+        _fixWrite2(&dst[i], __PKHBT(lo, hi, 16));
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        dst[i] = FixSatQ15(((int32_t) src[i] * scale) >> right);
+    }
+}
+
+int64_t FixVecDotQ15(const q15_t *a, const q15_t *b, uint32_t n)
+{
+    int64_t sum = 0;
+    uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    // Both lane products accumulate into 64 bits in one SMLALD
+    for(; i + 2 <= n; i += 2)
+    {
+        sum = (int64_t) __SMLALD(_fixRead2(&a[i]), _fixRead2(&b[i]), (uint64_t) sum);
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        sum += (int32_t) a[i] * b[i];
+    }
+
+    return sum;
+}
+
+void FixVecMulShiftQ15(const q15_t *src, const q15_t *mult, const uint8_t *shift, int32_t *dst, uint32_t n)
+{
+    uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    // SMUAD against the multiplier pair with one lane masked off gives one product per lane
+    for(; i + 2 <= n; i += 2)
+    {
+        uint32_t pair = _fixRead2(&src[i]);
+        uint32_t mults = _fixRead2(&mult[i]);
+
+        dst[i]     = (int32_t) __SMUAD(pair, mults & 0x0000FFFFU) >> shift[i];
+        dst[i + 1] = (int32_t) __SMUAD(pair, mults & 0xFFFF0000U) >> shift[i + 1];
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        dst[i] = ((int32_t) src[i] * mult[i]) >> shift[i];
+    }
+}
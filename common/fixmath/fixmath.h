@@ -0,0 +1,137 @@
+#ifndef __FIXMATH_H
+#define __FIXMATH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"
+#endif
+
+/*********************************************************************************
+    Fixed point helpers for drivers and control loops.
+
+    q15_t and q31_t are the CMSIS-DSP fractional formats, 1.15 and 1.31 in
+    [-1, 1). Scalar arithmetic saturates instead of wrapping, on the DSP
+    extension with QADD/SSAT and elsewhere in portable C with the same
+    results.
+
+    sFixLinear replaces map() where it runs per call. FixLinearInit works
+    out the slope once as a 32 bit multiplier and a shift, so applying it is
+    one multiply, an add and a shift with no float or divide. Inputs are
+    clamped to the input range like map(), outputs round to nearest.
+
+    The vector kernels follow CMSIS-DSP naming and take two q15 lanes per
+    32 bit load on the DSP extension. They also build on the host, where
+    tools/fixmath checks them against float and times them.
+***********************************************************************************/
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+#define FIX_Q15_ONE             32768
+#define FIX_Q31_ONE             2147483648.0f
+
+#define FIX_FLOAT_TO_Q15(x)     ((q15_t) ((x) * 32768.0f))
+#define FIX_FLOAT_TO_Q31(x)     ((q31_t) ((x) * FIX_Q31_ONE))
+#define FIX_Q15_TO_FLOAT(x)     ((float) (x) * (1.0f / 32768.0f))
+#define FIX_Q31_TO_FLOAT(x)     ((float) (x) * (1.0f / FIX_Q31_ONE))
+
+typedef struct
+{
+    int32_t inMin;
+    int32_t inMax;
+    int32_t outMin;
+    int32_t outMax;
+    int32_t mult;                   // Slope, scaled by 2^shift
+    int64_t round;                  // Half an output step, scaled by 2^shift
+    uint8_t shift;
+} sFixLinear;
+
+
+// Saturation
+static inline q15_t FixSatQ15(int32_t x)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    return (q15_t) __SSAT(x, 16);
+#else
+    return (x > INT16_MAX) ? INT16_MAX : ((x < INT16_MIN) ? INT16_MIN : (q15_t) x);
+#endif
+}
+
+static inline q31_t FixSatQ31(int64_t x)
+{
+    return (x > INT32_MAX) ? INT32_MAX : ((x < INT32_MIN) ? INT32_MIN : (q31_t) x);
+}
+
+// Saturating arithmetic, products round toward minus infinity like the CMSIS-DSP kernels
+static inline q15_t FixAddQ15(q15_t a, q15_t b)
+{
+    return FixSatQ15((int32_t) a + b);
+}
+
+static inline q15_t FixSubQ15(q15_t a, q15_t b)
+{
+    return FixSatQ15((int32_t) a - b);
+}
+
+static inline q15_t FixMulQ15(q15_t a, q15_t b)
+{
+    return FixSatQ15(((int32_t) a * b) >> 15);
+}
+
+static inline q31_t FixAddQ31(q31_t a, q31_t b)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    return __QADD(a, b);
+#else
+    return FixSatQ31((int64_t) a + b);
+#endif
+}
+
+static inline q31_t FixSubQ31(q31_t a, q31_t b)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    return __QSUB(a, b);
+#else
+    return FixSatQ31((int64_t) a - b);
+#endif
+}
+
+static inline q31_t FixMulQ31(q31_t a, q31_t b)
+{
+    return FixSatQ31(((int64_t) a * b) >> 31);
+}
+
+
+// Linear transforms
+// Maps [inMin, inMax] onto [outMin, outMax], either output order. Returns false if inMin > inMax
+// or the input range is wider than INT32_MAX. A single point input range maps to outMin, as map() does.
+bool FixLinearInit(sFixLinear *map, int32_t inMin, int32_t inMax, int32_t outMin, int32_t outMax);
+
+static inline int32_t FixLinearApply(const sFixLinear *map, int32_t x)
+{
+    if(x <= map->inMin)
+    {
+        return map->outMin;
+    }
+    if(x >= map->inMax)
+    {
+        return map->outMax;
+    }
+
+    return (int32_t) (map->outMin + ((((int64_t) x - map->inMin) * map->mult + map->round) >> map->shift));
+}
+
+
+// Vector kernels, n elements, dst may alias a source
+void FixVecAddQ15(const q15_t *a, const q15_t *b, q15_t *dst, uint32_t n);
+void FixVecSubQ15(const q15_t *a, const q15_t *b, q15_t *dst, uint32_t n);
+// dst = src * scale * 2^shift, saturated
+void FixVecScaleQ15(const q15_t *src, q15_t scale, int8_t shift, q15_t *dst, uint32_t n);
+// Sum of products in 34.30, cannot overflow for any n
+int64_t FixVecDotQ15(const q15_t *a, const q15_t *b, uint32_t n);
+// dst[i] = (src[i] * mult[i]) >> shift[i], per element widening scale for mixed unit records
+void FixVecMulShiftQ15(const q15_t *src, const q15_t *mult, const uint8_t *shift, int32_t *dst, uint32_t n);
+
+#endif /* __FIXMATH_H */
@@ -0,0 +1,227 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "imu.h"
+#include "utility.h"
+
+#define IMU_EXTI_PRIORITY 5
+
+// Static Variables
+static bool _imuCreated = false;
+static volatile bool _imuRunning = false;
+static IRQn_Type _imuIRQ;
+static bool _imuUsesEXTI = false;
+static BNO055_Dev_t *_imuDev;
+static TX_SEMAPHORE _imuTrigger;
+static TX_TIMER _imuTimer;
+static volatile ULONG _imuTriggerTick;
+static volatile sImuStats _imuStats;
+
+// Sample n lives in _imuBuffers[n & 1]. _imuSeq is 2n while sample n is the
+// latest and 2n + 1 while sample n + 1 is being written into the other slot.
+static sImuSample _imuBuffers[2];
+static volatile uint32_t _imuSeq = 0;
+
+// IMU Thread
+#define THREAD_IMU_STACK_SIZE 1024
+static TX_THREAD stThreadImu;
+static uint8_t auThreadImuStack[THREAD_IMU_STACK_SIZE];
+static void thread_imu(ULONG ctx);
+
+// Static Function Declarations
+static void _imuCreate(void);
+static void _imuTimerExpired(ULONG ctx);
+static void _imuPublish(const BNO055_Snapshot_t *data, ULONG timestamp);
+
+
+// Static Function Definitions
+static void _imuCreate(void)
+{
+    if(_imuCreated)
+    {
+        return;
+    }
+
+    tx_semaphore_create(&_imuTrigger, "imu_trigger", 0);
+    tx_timer_create(&_imuTimer, "imu_timer", _imuTimerExpired, 0,
+                    IMU_DEFAULT_PERIOD_MS, IMU_DEFAULT_PERIOD_MS, TX_NO_ACTIVATE);
+
+    tx_thread_create( &stThreadImu,
+        "thread_imu",
+        thread_imu,
+        0,
+        auThreadImuStack,
+        THREAD_IMU_STACK_SIZE,
+        IMU_THREAD_PRIORITY,
+        IMU_THREAD_PRIORITY,
+        0,
+        TX_AUTO_START);
+
+    _imuCreated = true;
+}
+
+static void _imuTimerExpired(ULONG ctx)
+{
+    ImuTriggerFromISR();
+}
+
+static void _imuPublish(const BNO055_Snapshot_t *data, ULONG timestamp)
+{
+    uint32_t seq = _imuSeq;
+    uint32_t sequence = (seq >> 1) + 1;
+    sImuSample *slot = &_imuBuffers[sequence & 1];
+
+    // Odd while writing, readers of the other slot are unaffected
+    _imuSeq = seq + 1;
+    __DMB();
+
+    slot->data = *data;
+    slot->sequence = sequence;
+    slot->timestamp = timestamp;
+
+    __DMB();
+    _imuSeq = seq + 2;
+
+    _imuStats.samples++;
+}
+
+
+// Public Functions
+bool ImuStart(BNO055_Dev_t *dev, uint32_t period_MS)
+{
+    ImuStop();
+    _imuCreate();
+    _imuDev = dev;
+
+    if(period_MS == 0)
+    {
+        period_MS = IMU_DEFAULT_PERIOD_MS;
+    }
+
+    _imuUsesEXTI = false;
+    _imuRunning = true;
+
+    tx_timer_change(&_imuTimer, period_MS, period_MS);
+    return tx_timer_activate(&_imuTimer) == TX_SUCCESS;
+}
+
+bool ImuStartEXTI(BNO055_Dev_t *dev, GPIO_TypeDef *intPort, uint16_t intPin)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    ImuStop();
+    _imuCreate();
+    _imuDev = dev;
+
+    // BNO055 INT is push-pull, active high
+    GPIO_PortClkEnable(intPort);
+    GPIO_InitStruct.Pin = intPin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(intPort, &GPIO_InitStruct);
+
+    _imuIRQ = PinToEXTI(intPin);
+    _imuUsesEXTI = true;
+    _imuRunning = true;
+
+    HAL_NVIC_SetPriority(_imuIRQ, IMU_EXTI_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(_imuIRQ);
+
+    return true;
+}
+
+void ImuStop(void)
+{
+    _imuRunning = false;
+
+    if(!_imuCreated)
+    {
+        return;
+    }
+
+    tx_timer_deactivate(&_imuTimer);
+    if(_imuUsesEXTI)
+    {
+        HAL_NVIC_DisableIRQ(_imuIRQ);
+    }
+}
+
+// ISR or timer context. A trigger that lands while the last one is still pending is counted and dropped.
+void ImuTriggerFromISR(void)
+{
+    ULONG now = tx_time_get();
+
+    if(!_imuRunning)
+    {
+        return;
+    }
+
+    if(tx_semaphore_ceiling_put(&_imuTrigger, 1) == TX_SUCCESS)
+    {
+        _imuTriggerTick = now;
+    }
+    else
+    {
+        _imuStats.triggersDropped++;
+    }
+}
+
+bool ImuGetLatest(sImuSample *sample)
+{
+    uint32_t start, end;
+
+    while(true)
+    {
+        start = _imuSeq & ~1UL;
+        if(start == 0)
+        {
+            return false;
+        }
+
+        __DMB();
+        *sample = _imuBuffers[(start >> 1) & 1];
+        __DMB();
+        end = _imuSeq;
+
+        // The writer only reaches this slot again once the sequence passes start + 2
+        if(end - start <= 2)
+        {
+            break;
+        }
+
+        _imuStats.readerRetries++;
+    }
+
+    sample->age_MS = tx_time_get() - sample->timestamp;
+    return true;
+}
+
+void ImuGetStats(sImuStats *stats)
+{
+    stats->samples         = _imuStats.samples;
+    stats->readErrors      = _imuStats.readErrors;
+    stats->triggersDropped = _imuStats.triggersDropped;
+    stats->readerRetries   = _imuStats.readerRetries;
+}
+
+
+// Threads
+static void thread_imu(ULONG ctx)
+{
+    BNO055_Snapshot_t data;
+    ULONG timestamp;
+
+    while(true)
+    {
+        tx_semaphore_get(&_imuTrigger, TX_WAIT_FOREVER);
+        timestamp = _imuTriggerTick;
+
+        if(BNO055_Get_Snapshot(_imuDev, &data) != BNO055_SUCCESS)
+        {
+            _imuStats.readErrors++;
+            continue;
+        }
+
+        _imuPublish(&data, timestamp);
+    }
+}
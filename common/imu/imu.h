@@ -0,0 +1,57 @@
+#ifndef __IMU_H
+#define __IMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+#include "bno055.h"
+
+/*********************************************************************************
+    Background IMU sampler.
+
+    A service thread owns one BNO055 device and reads one snapshot per
+    trigger. Triggers come from a ThreadX timer (ImuStart) or from the BNO055
+    INT pin through EXTI (ImuStartEXTI). For EXTI, the board's EXTI IRQ handler
+    calls HAL_GPIO_EXTI_IRQHandler(pin) and its HAL_GPIO_EXTI_Rising_Callback
+    calls ImuTriggerFromISR().
+
+    Samples are published into a sequence-counted double buffer. ImuGetLatest
+    is lock-free and may be called from any thread; it never blocks the
+    sampler and only retries if the sampler laps it mid-copy.
+***********************************************************************************/
+
+#define IMU_DEFAULT_PERIOD_MS    10      // BNO055 fusion output rate is 100 Hz
+#ifndef IMU_THREAD_PRIORITY
+#define IMU_THREAD_PRIORITY      8
+#endif
+
+typedef struct
+{
+    BNO055_Snapshot_t data;
+    uint32_t sequence;              // Sample number, 1 for the first sample
+    ULONG timestamp;                // Tick of the trigger that produced the sample
+    uint32_t age_MS;                // Filled by ImuGetLatest, time since timestamp
+} sImuSample;
+
+typedef struct
+{
+    uint32_t samples;               // Samples published
+    uint32_t readErrors;            // Snapshot reads that failed
+    uint32_t triggersDropped;       // Triggers that found one still pending, not yet taken by the sampler
+    uint32_t readerRetries;         // ImuGetLatest copies that were lapped and retried
+} sImuStats;
+
+// Start after BNO055_Mount and BNO055_Init. While running, the sampler is the only user of dev.
+bool ImuStart(BNO055_Dev_t *dev, uint32_t period_MS);
+bool ImuStartEXTI(BNO055_Dev_t *dev, GPIO_TypeDef *intPort, uint16_t intPin);
+void ImuStop(void);
+
+void ImuTriggerFromISR(void);
+
+// Returns false until the first sample is published
+bool ImuGetLatest(sImuSample *sample);
+void ImuGetStats(sImuStats *stats);
+
+#endif /* __IMU_H */
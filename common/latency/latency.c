@@ -0,0 +1,432 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "latency.h"
+#include "memory_layout.h"
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+
+#define LAT_HIST_SUB_BITS   2       // Four buckets per octave
+#define LAT_EVENT_TIMER     0x1
+#define LAT_EVENT_LOAD      0x2
+#define LAT_EVENT_LOAD_DONE 0x4
+
+// Static Data Types
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t hist[LATENCY_HIST_BUCKETS];
+} sLatHist;
+
+typedef struct
+{
+    uint32_t entry;                 // Cycle counter at the last ISR entry
+    uint32_t pendingEntry;          // ISR entry of the first signal since the thread started waiting
+    volatile bool waiting;
+    volatile bool pending;
+} sLatSource;
+
+// Static Variables
+static const char *_sourceNames[LAT_SRC_COUNT] = { "fdcan", "uart", "timer" };
+static const char *_stageNames[LAT_STAGE_COUNT] = { "entry", "wake" };
+static const char *_loadNames[LAT_LOAD_COUNT] = { "idle", "console", "can_flood", "i2c" };
+
+static LatencyLoadFunc _loads[LAT_LOAD_COUNT];
+
+#if defined(MANTICORE_LATENCY)
+static sLatHist _hists[LAT_SRC_COUNT][LAT_STAGE_COUNT];
+static sLatSource _sources[LAT_SRC_COUNT];
+static volatile bool _recording = true;
+static volatile LAT_LOAD _activeLoad = LAT_LOAD_IDLE;
+static bool _latencyReady = false;
+
+static TIM_TypeDef *_timer = NULL;
+static TIM_HandleTypeDef _htim;
+static uint32_t _timerClockHz = 0;
+static TX_EVENT_FLAGS_GROUP _latencyEvent;
+
+// Harness Thread, the timer source's wake target
+#define THREAD_LATENCY_STACK_SIZE 512
+static TX_THREAD stThreadLatency;
+static uint8_t auThreadLatencyStack[THREAD_LATENCY_STACK_SIZE];
+static void thread_latency(ULONG ctx);
+
+// Load Thread, below every other thread
+#define THREAD_LATENCY_LOAD_STACK_SIZE 1024
+#define THREAD_LATENCY_LOAD_PRIORITY 15
+static TX_THREAD stThreadLatencyLoad;
+static uint8_t auThreadLatencyLoadStack[THREAD_LATENCY_LOAD_STACK_SIZE];
+static void thread_latency_load(ULONG ctx);
+#endif
+
+// Static Function Declarations
+#if defined(MANTICORE_LATENCY)
+static void _record(LAT_SRC src, LAT_STAGE stage, uint32_t cycles);
+static uint8_t _bucket(uint32_t cycles);
+static uint32_t _bucketUpper(uint8_t bucket);
+static uint32_t _percentile(const sLatHist *hist, uint32_t permille);
+static uint32_t _cyclesToNs(uint32_t cycles);
+#endif
+
+
+// Static Function Definitions
+#if defined(MANTICORE_LATENCY)
+
+MANTICORE_RAMFUNC static void _record(LAT_SRC src, LAT_STAGE stage, uint32_t cycles)
+{
+    TX_INTERRUPT_SAVE_AREA
+    sLatHist *hist = &_hists[src][stage];
+    uint8_t bucket = _bucket(cycles);
+
+    if(!_recording)
+    {
+        return;
+    }
+
+    TX_DISABLE
+    if(hist->count == 0 || cycles < hist->min)
+    {
+        hist->min = cycles;
+    }
+    if(cycles > hist->max)
+    {
+        hist->max = cycles;
+    }
+    hist->count++;
+    hist->hist[bucket]++;
+    TX_RESTORE
+}
+
+MANTICORE_RAMFUNC static uint8_t _bucket(uint32_t cycles)
+{
+    uint8_t exponent;
+    uint32_t bucket;
+
+    if(cycles < (1U << LAT_HIST_SUB_BITS))
+    {
+        return (uint8_t) cycles;
+    }
+
+    exponent = 31 - __CLZ(cycles);
+    bucket = ((exponent - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS) +
+             ((cycles >> (exponent - LAT_HIST_SUB_BITS)) & ((1U << LAT_HIST_SUB_BITS) - 1));
+
+    return (bucket < LATENCY_HIST_BUCKETS) ? (uint8_t) bucket : LATENCY_HIST_BUCKETS - 1;
+}
+
+static uint32_t _bucketUpper(uint8_t bucket)
+{
+    uint8_t exponent;
+    uint32_t mantissa;
+
+    if(bucket < (1U << LAT_HIST_SUB_BITS))
+    {
+        return bucket;
+    }
+
+    exponent = (bucket >> LAT_HIST_SUB_BITS) + LAT_HIST_SUB_BITS - 1;
+    mantissa = (1U << LAT_HIST_SUB_BITS) + (bucket & ((1U << LAT_HIST_SUB_BITS) - 1));
+
+    return ((mantissa + 1) << (exponent - LAT_HIST_SUB_BITS)) - 1;
+}
+
+static uint32_t _percentile(const sLatHist *hist, uint32_t permille)
+{
+    uint32_t rank = (uint32_t) (((uint64_t) hist->count * permille + 999) / 1000);
+    uint32_t seen = 0;
+
+    for(uint8_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    {
+        seen += hist->hist[i];
+        if(seen >= rank && seen > 0)
+        {
+            // Bounds overshoot by up to a bucket, never past the slowest sample
+            return (i == LATENCY_HIST_BUCKETS - 1 || _bucketUpper(i) > hist->max) ? hist->max : _bucketUpper(i);
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t _cyclesToNs(uint32_t cycles)
+{
+    return (uint32_t) (((uint64_t) cycles * 1000000000ULL) / SystemCoreClock);
+}
+
+#endif
+
+
+// Public Functions
+#if defined(MANTICORE_LATENCY)
+
+MANTICORE_RAMFUNC void LatencyIsrEnter(LAT_SRC src)
+{
+    _sources[src].entry = DWT->CYCCNT;
+}
+
+MANTICORE_RAMFUNC void LatencyEventAge(LAT_SRC src, uint32_t ageCycles)
+{
+    uint32_t sinceEntry = DWT->CYCCNT - _sources[src].entry;
+
+    // An event clock coarser than the ISR can put the event after entry, that is zero latency
+    _record(src, LAT_STAGE_ENTRY, (ageCycles > sinceEntry) ? ageCycles - sinceEntry : 0);
+}
+
+MANTICORE_RAMFUNC void LatencySignal(LAT_SRC src)
+{
+    if(_sources[src].waiting && !_sources[src].pending)
+    {
+        _sources[src].pendingEntry = _sources[src].entry;
+        _sources[src].pending = true;
+    }
+}
+
+void LatencyWait(LAT_SRC src)
+{
+    _sources[src].pending = false;
+    _sources[src].waiting = true;
+}
+
+void LatencyWake(LAT_SRC src)
+{
+    if(_sources[src].pending)
+    {
+        _record(src, LAT_STAGE_WAKE, DWT->CYCCNT - _sources[src].pendingEntry);
+    }
+
+    _sources[src].waiting = false;
+    _sources[src].pending = false;
+}
+
+bool LatencyInit(TIM_TypeDef *timer, UINT priority)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+
+    if(_latencyReady)
+    {
+        return true;
+    }
+    else if(timer == NULL)
+    {
+        return false;
+    }
+
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    LatencyReset();
+
+    // APB1 timers run at twice PCLK1 unless APB1 is undivided, PPRE1 values below 0b100 are
+    _timerClockHz = ((RCC->CFGR2 & RCC_CFGR2_PPRE1_2) == 0) ? pclk : 2U * pclk;
+    _timer = timer;
+
+    tx_event_flags_create(&_latencyEvent, "latency_event");
+
+    tx_thread_create( &stThreadLatency,
+        "thread_latency",
+        thread_latency,
+        0,
+        auThreadLatencyStack,
+        THREAD_LATENCY_STACK_SIZE,
+        priority,
+        priority,
+        0,
+        TX_AUTO_START);
+
+    tx_thread_create( &stThreadLatencyLoad,
+        "thread_latency_load",
+        thread_latency_load,
+        0,
+        auThreadLatencyLoadStack,
+        THREAD_LATENCY_LOAD_STACK_SIZE,
+        THREAD_LATENCY_LOAD_PRIORITY,
+        THREAD_LATENCY_LOAD_PRIORITY,
+        0,
+        TX_AUTO_START);
+
+    // Undivided, so a counter tick is a core cycle when the timer clock matches HCLK
+    _htim.Instance = timer;
+    _htim.Init.Prescaler = 0;
+    _htim.Init.CounterMode = TIM_COUNTERMODE_UP;
+    _htim.Init.Period = (_timerClockHz / LATENCY_TIMER_HZ) - 1;
+    _htim.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    _htim.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+
+    if(HAL_TIM_Base_Init(&_htim) != HAL_OK || HAL_TIM_Base_Start_IT(&_htim) != HAL_OK)
+    {
+        return false;
+    }
+
+    _latencyReady = true;
+    return true;
+}
+
+// The counter restarted at the update event, its value is the time since
+MANTICORE_RAMFUNC void LatencyTimerIRQHandler(void)
+{
+    uint32_t ticks;
+
+    LatencyIsrEnter(LAT_SRC_TIMER);
+    ticks = _timer->CNT;
+
+    if((_timer->SR & TIM_SR_UIF) == 0)
+    {
+        return;
+    }
+
+    _timer->SR = ~((uint32_t) TIM_SR_UIF);
+    LatencyEventAge(LAT_SRC_TIMER, (uint32_t) (((uint64_t) ticks * SystemCoreClock) / _timerClockHz));
+    LatencySignal(LAT_SRC_TIMER);
+    tx_event_flags_set(&_latencyEvent, LAT_EVENT_TIMER, TX_OR);
+}
+
+bool LatencyRun(LAT_LOAD load, uint32_t durationMs)
+{
+    ULONG flags;
+
+    if(!_latencyReady || load >= LAT_LOAD_COUNT || (load != LAT_LOAD_IDLE && _loads[load] == NULL))
+    {
+        return false;
+    }
+
+    LatencyReset();
+    _activeLoad = load;
+    if(load != LAT_LOAD_IDLE)
+    {
+        tx_event_flags_set(&_latencyEvent, LAT_EVENT_LOAD, TX_OR);
+    }
+
+    tx_thread_sleep(durationMs);
+
+    // Freeze the results before the load winds down
+    _recording = false;
+    _activeLoad = LAT_LOAD_IDLE;
+    if(load != LAT_LOAD_IDLE)
+    {
+        tx_event_flags_get(&_latencyEvent, LAT_EVENT_LOAD_DONE, TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
+    }
+
+    return true;
+}
+
+void LatencyReset(void)
+{
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    memset(_hists, 0, sizeof(_hists));
+    _recording = true;
+    TX_RESTORE
+}
+
+bool LatencyGet(LAT_SRC src, LAT_STAGE stage, sLatencyStats *stats)
+{
+    TX_INTERRUPT_SAVE_AREA
+    static sLatHist hist;
+
+    if(src >= LAT_SRC_COUNT || stage >= LAT_STAGE_COUNT || stats == NULL)
+    {
+        return false;
+    }
+
+    TX_DISABLE
+    hist = _hists[src][stage];
+    TX_RESTORE
+
+    stats->count = hist.count;
+    stats->min_NS = _cyclesToNs(hist.min);
+    stats->p50_NS = _cyclesToNs(_percentile(&hist, 500));
+    stats->p90_NS = _cyclesToNs(_percentile(&hist, 900));
+    stats->p99_NS = _cyclesToNs(_percentile(&hist, 990));
+    stats->max_NS = _cyclesToNs(hist.max);
+
+    return true;
+}
+
+#else
+
+bool LatencyRun(LAT_LOAD load, uint32_t durationMs)
+{
+    (void) load;
+    (void) durationMs;
+    return false;
+}
+
+void LatencyReset(void)
+{
+}
+
+bool LatencyGet(LAT_SRC src, LAT_STAGE stage, sLatencyStats *stats)
+{
+    (void) src;
+    (void) stage;
+    (void) stats;
+    return false;
+}
+
+#endif
+
+void LatencySetLoad(LAT_LOAD load, LatencyLoadFunc func)
+{
+    if(load < LAT_LOAD_COUNT && load != LAT_LOAD_IDLE)
+    {
+        _loads[load] = func;
+    }
+}
+
+const char *LatencySourceName(LAT_SRC src)
+{
+    return (src < LAT_SRC_COUNT) ? _sourceNames[src] : "?";
+}
+
+const char *LatencyStageName(LAT_STAGE stage)
+{
+    return (stage < LAT_STAGE_COUNT) ? _stageNames[stage] : "?";
+}
+
+const char *LatencyLoadName(LAT_LOAD load)
+{
+    return (load < LAT_LOAD_COUNT) ? _loadNames[load] : "?";
+}
+
+
+// Threads
+#if defined(MANTICORE_LATENCY)
+
+static void thread_latency(ULONG ctx)
+{
+    ULONG flags;
+
+    (void) ctx;
+
+    while(true)
+    {
+        LatencyWait(LAT_SRC_TIMER);
+        tx_event_flags_get(&_latencyEvent, LAT_EVENT_TIMER, TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
+        LatencyWake(LAT_SRC_TIMER);
+    }
+}
+
+static void thread_latency_load(ULONG ctx)
+{
+    ULONG flags;
+    LAT_LOAD load;
+
+    (void) ctx;
+
+    while(true)
+    {
+        tx_event_flags_get(&_latencyEvent, LAT_EVENT_LOAD, TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
+
+        load = _activeLoad;
+        while(_activeLoad == load && load != LAT_LOAD_IDLE)
+        {
+            _loads[load]();
+        }
+
+        tx_event_flags_set(&_latencyEvent, LAT_EVENT_LOAD_DONE, TX_OR);
+    }
+}
+
+#endif
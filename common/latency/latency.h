@@ -0,0 +1,128 @@
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+
+/*********************************************************************************
+    Interrupt latency and jitter harness.
+
+    Every source is timed in two stages:
+        entry   hardware event to the first instruction of its ISR
+        wake    ISR entry to the thread it signalled running
+
+    Sources and their event clocks:
+        FDCAN   RX timestamp counter, one tick per nominal bit. The counter
+                is captured at the start of frame, so the entry stage includes
+                the frame itself. Its min is the frame time on an idle core, and
+                the spread above the min is the interrupt latency.
+        TIMER   a basic timer's update event. The counter restarts from zero
+                at the update, so its value at ISR entry is the latency in
+                timer ticks. The timer runs at LATENCY_TIMER_HZ.
+        UART    no receive timestamp on the H5, so there is no entry stage.
+                The wake stage is the console's RX ISR to the console thread
+                popping the byte.
+
+    The wake stage is armed by LATENCY_SIGNAL on the path that wakes the
+    thread: the MCAN RPC thread for FDCAN, the harness thread for the timer,
+    the console thread for UART. ISRs that wake nobody leave it alone.
+
+    LatencyRun resets the histograms, runs one load scenario for a fixed time
+    and leaves the results for LatencyGet. "latency run" on the console runs
+    every scenario in order with the same timer rate and durations, and
+    tools/latency/latency_bench.py records that run as a CSV benchmark.
+
+    Only built with -DMANTICORE_LATENCY=ON, the hooks compile to nothing
+    otherwise. Histograms have four buckets per octave of core cycles.
+***********************************************************************************/
+
+#define LATENCY_TIMER_HZ            10000   // Timer source event rate
+#define LATENCY_HIST_BUCKETS        96      // Up to 2^25 cycles, ~134 ms at 250 MHz
+#define LATENCY_RUN_MS_DEFAULT      10000
+
+typedef enum
+{
+    LAT_SRC_FDCAN,
+    LAT_SRC_UART,
+    LAT_SRC_TIMER,
+    LAT_SRC_COUNT,
+} LAT_SRC;
+
+typedef enum
+{
+    LAT_STAGE_ENTRY,
+    LAT_STAGE_WAKE,
+    LAT_STAGE_COUNT,
+} LAT_STAGE;
+
+typedef enum
+{
+    LAT_LOAD_IDLE,
+    LAT_LOAD_CONSOLE,                       // ConsolePrint in a loop, blocking UART TX
+    LAT_LOAD_CAN_FLOOD,                     // Back to back MCAN debug frames to every device
+    LAT_LOAD_I2C,                           // Application supplied
+    LAT_LOAD_COUNT,
+} LAT_LOAD;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min_NS;
+    uint32_t p50_NS;                        // Percentiles are bucket upper bounds, at most 25% high
+    uint32_t p90_NS;
+    uint32_t p99_NS;
+    uint32_t max_NS;
+} sLatencyStats;
+
+// One unit of load, called back to back on the load thread for the whole run
+typedef void (*LatencyLoadFunc)(void);
+
+#if defined(MANTICORE_LATENCY)
+
+void LatencyIsrEnter(LAT_SRC src);
+void LatencyEventAge(LAT_SRC src, uint32_t ageCycles);
+void LatencySignal(LAT_SRC src);
+void LatencyWait(LAT_SRC src);
+void LatencyWake(LAT_SRC src);
+
+// First thing in the ISR
+#define LATENCY_ISR_ENTER(src)              LatencyIsrEnter(src)
+// In the same ISR, the event happened ageCycles core cycles before this call
+#define LATENCY_EVENT_AGE(src, ageCycles)   LatencyEventAge((src), (ageCycles))
+// In the same ISR, right before waking the source's thread
+#define LATENCY_SIGNAL(src)                 LatencySignal(src)
+// In that thread, right before it blocks. Only the first signal after this is timed.
+#define LATENCY_WAIT(src)                   LatencyWait(src)
+// In that thread, once it runs again
+#define LATENCY_WAKE(src)                   LatencyWake(src)
+
+// timer is a basic timer on APB1, clocked and enabled in the NVIC by the BSP. Call after BSP_Init.
+bool LatencyInit(TIM_TypeDef *timer, UINT priority);
+void LatencyTimerIRQHandler(void);
+
+#else
+
+#define LATENCY_ISR_ENTER(src)
+#define LATENCY_EVENT_AGE(src, ageCycles)
+#define LATENCY_SIGNAL(src)
+#define LATENCY_WAIT(src)
+#define LATENCY_WAKE(src)
+
+#endif
+
+// Blocks for durationMs, false when the harness is not built or the scenario has no load function
+bool LatencyRun(LAT_LOAD load, uint32_t durationMs);
+// Clears every histogram and records until the next run ends
+void LatencyReset(void);
+bool LatencyGet(LAT_SRC src, LAT_STAGE stage, sLatencyStats *stats);
+// Registered by whoever owns the peripheral, LAT_LOAD_IDLE takes none
+void LatencySetLoad(LAT_LOAD load, LatencyLoadFunc func);
+
+const char *LatencySourceName(LAT_SRC src);
+const char *LatencyStageName(LAT_STAGE stage);
+const char *LatencyLoadName(LAT_LOAD load);
+
+#endif /* __LATENCY_H */
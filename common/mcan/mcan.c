@@ -12,6 +12,10 @@
 
 #include "tx_api.h"
 #include "mcan.h"
+#include "memory_layout.h"
+#include "boot.h"
+#include "latency.h"
+#include "prof.h"
 
 // Define current device for use in CAN tx
 #if defined(DEMO_NUCLEO_H503)
@@ -35,7 +39,8 @@ static const MCAN_DEV _mcanCurrentDevice = DEV_MTUSC;
 
 #define UINT12_MAX (2 << 11)
 #define MCAN_QUEUE_SIZE 20
-#define MCAN_PRI_COUNT 4
+#define MCAN_TX_FIFO_DEPTH 3     // SRAMCAN_TFQ_NBR, fixed by the H5 message RAM layout
+#define MCAN_FD_MAX_DATA 64
 
 /********** Static Data Structures ********/
 typedef enum {
@@ -75,6 +80,12 @@ static uint8_t* heartbeatDataBuf;
 // Queue Variables
 static MCAN_PriQueue _mcanPriQueue;
 
+// Statistics
+static volatile sMCAN_Stats _mcanStats;
+
+// Category handlers see frames in the RX ISR, ahead of the priority queue
+static MCAN_CatHandler _mcanCatHandlers[MCAN_CAT_COUNT];
+
 // Thread Variables
 #define THREAD_HEARTBEAT_STACK_SIZE 256
 static TX_THREAD stThreadHeartbeat;
@@ -91,12 +102,19 @@ static TX_THREAD stThreadQueueConsumer;
 static uint8_t auThreadQueueConsumerStack[THREAD_QUEUE_CONSUMER_STACK_SIZE];
 static const uint8_t uThreadConsumerDelay = 10;
 
+#if defined(MANTICORE_LATENCY)
+// Core cycles per nominal bit, the unit of the RX timestamp counter
+static uint32_t _mcanCyclesPerBit = 0;
+#endif
+
 
 /********** Static Function Declarations ********/
 static bool _MCAN_ConfigInterface ( FDCAN_GlobalTypeDef* FDCAN_Instance );
 static bool _MCAN_ConfigFilter( MCAN_DEV mcanRxFilter );
 void MCAN_Conv_ID_To_Uint32( sMCAN_ID* mcanID, uint32_t* uIdentifier );
 static uint16_t _MCAN_GetTimestamp( void );
+static uint32_t _MCAN_LengthToDLC( uint8_t length, uint8_t* paddedLength );
+static bool _MCAN_Transmit( sMCAN_ID* mcanID, const uint8_t* mcanData, uint32_t dataLength, uint32_t fdFormat );
 
 // Queue Functions
 void _MCAN_QueueInit( MCAN_Queue *queue);
@@ -159,6 +177,19 @@ static bool _MCAN_ConfigInterface( FDCAN_GlobalTypeDef* FDCAN_Instance )
         return false;
     }
 
+#if defined(MANTICORE_LATENCY)
+    // One tick per nominal bit, RX frames carry the count at their start of frame
+    if (HAL_FDCAN_ConfigTimestampCounter(&_hfdcan, FDCAN_TIMESTAMP_PRESC_1) != HAL_OK ||
+        HAL_FDCAN_EnableTimestampCounter(&_hfdcan, FDCAN_TIMESTAMP_INTERNAL) != HAL_OK)
+    {
+        return false;
+    }
+
+    _mcanCyclesPerBit = (uint32_t) (((uint64_t) SystemCoreClock * _hfdcan.Init.NominalPrescaler *
+                        (1U + _hfdcan.Init.NominalTimeSeg1 + _hfdcan.Init.NominalTimeSeg2)) /
+                        HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN));
+#endif
+
     return true;
 }
 
@@ -234,7 +265,7 @@ static bool _MCAN_ConfigFilter( MCAN_DEV mcanRxFilter )
     Returns:
         None
 ***********************************************************************************/
-void MCAN_Conv_Uint32_To_ID(uint32_t uIdentifier, sMCAN_ID* mcanID )
+MANTICORE_RAMFUNC void MCAN_Conv_Uint32_To_ID(uint32_t uIdentifier, sMCAN_ID* mcanID )
 {
     mcanID->MCAN_PRIORITY  |= (uIdentifier & mMCAN_Priority)  >> kMCAN_SHIFT_Priority;
     mcanID->MCAN_CAT       |= (uIdentifier & mMCAN_Cat)       >> kMCAN_SHIFT_Cat;
@@ -393,13 +424,14 @@ bool _MCAN_QueueEmpty(MCAN_Queue *queue) {
 }
 
 // Check if the queue is full
-bool _MCAN_QueueFull(MCAN_Queue *queue) {
+MANTICORE_RAMFUNC bool _MCAN_QueueFull(MCAN_Queue *queue) {
     return queue->size == MCAN_QUEUE_SIZE;
 }
 
 // Enqueue an element
-void _MCAN_Enqueue(MCAN_Queue *queue, sMCAN_Message message) {
+MANTICORE_RAMFUNC void _MCAN_Enqueue(MCAN_Queue *queue, sMCAN_Message message) {
     if (_MCAN_QueueFull(queue)) {
+        _mcanStats.rxDropped++;
         return;
     }
     
@@ -447,7 +479,7 @@ bool _MCAN_PriQueueEmpty(void) {
 }
 
 // Enqueue an element into the correct queue based on priority
-void _MCAN_PriEnqueue(sMCAN_Message message) {
+MANTICORE_RAMFUNC void _MCAN_PriEnqueue(sMCAN_Message message) {
 
     // Insert message into appropriate queue 
     MCAN_PRI pri = message.mcanID.MCAN_PRIORITY; 
@@ -473,6 +505,90 @@ sMCAN_Message _MCAN_PriDequeue(void) {
 }
 
 
+/************************************************************
+    Name: _MCAN_LengthToDLC
+
+    Description:
+        Rounds a payload length up to the next CAN FD data
+        length code.
+
+    Arguments:
+        length       = payload length in bytes, at most 64
+        paddedLength = set to the byte count the DLC encodes
+
+    Returns:
+        The FDCAN_DLC_BYTES_x code for the padded length
+*************************************************************/
+static uint32_t _MCAN_LengthToDLC( uint8_t length, uint8_t* paddedLength )
+{
+    static const uint8_t fdSizes[] = { 12, 16, 20, 24, 32, 48, 64 };
+
+    if ( length <= 8 )
+    {
+        *paddedLength = length;
+        return (uint32_t) length;   // FDCAN_DLC_BYTES_0 .. FDCAN_DLC_BYTES_8
+    }
+
+    for ( uint8_t i = 0; i < sizeof(fdSizes); i++ )
+    {
+        if ( length <= fdSizes[i] )
+        {
+            *paddedLength = fdSizes[i];
+            return FDCAN_DLC_BYTES_12 + i;
+        }
+    }
+
+    *paddedLength = MCAN_FD_MAX_DATA;
+    return FDCAN_DLC_BYTES_64;
+}
+
+/************************************************************
+    Name: _MCAN_Transmit
+
+    Description:
+        Stamps the ID, builds the TX header and adds the frame
+        to the TX FIFO under the TX mutex.
+
+    Returns:
+        True  = frame added to the TX FIFO
+        False = TX FIFO full or peripheral error
+*************************************************************/
+static bool _MCAN_Transmit( sMCAN_ID* mcanID, const uint8_t* mcanData, uint32_t dataLength, uint32_t fdFormat )
+{
+    HAL_StatusTypeDef status;
+    uint32_t uIdentifier;
+
+    mcanID->MCAN_TimeStamp = _MCAN_GetTimestamp();
+    MCAN_Conv_ID_To_Uint32(mcanID, &uIdentifier);
+
+    FDCAN_TxHeaderTypeDef TxHeader = {
+        .Identifier = uIdentifier,
+        .IdType = FDCAN_EXTENDED_ID,
+        .TxFrameType = FDCAN_DATA_FRAME,
+        .DataLength = dataLength,
+        .ErrorStateIndicator = FDCAN_ESI_ACTIVE,
+        .BitRateSwitch = FDCAN_BRS_OFF,
+        .FDFormat = fdFormat,
+        .TxEventFifoControl = FDCAN_NO_TX_EVENTS,
+        .MessageMarker = 0,
+    };
+
+    // Add frame to TX FIFO -> Transmit
+    tx_mutex_get(&mcanTxMutex, TX_WAIT_FOREVER); // enter critical section, suspend if mutex is locked
+    status = HAL_FDCAN_AddMessageToTxFifoQ(&_hfdcan, &TxHeader, mcanData );
+    tx_mutex_put(&mcanTxMutex);                  // exit critical section
+
+    if (status != HAL_OK)
+    {
+        _mcanStats.txErrors++;
+        return false;
+    }
+
+    _mcanStats.txFrames++;
+    return true;
+}
+
+
 /***************************** Public Function Definitions *****************************/
 
 /*********************************************************************************
@@ -504,6 +620,9 @@ bool MCAN_Init( FDCAN_GlobalTypeDef* FDCAN_Instance, MCAN_DEV mcanRxFilter, MCAN
         return false;
     }
 
+    // Serializes every writer of the TX FIFO
+    tx_mutex_create(&mcanTxMutex, "mcan_tx_mutex", TX_INHERIT);
+
     // Start consumer thread
     tx_thread_create( &stThreadQueueConsumer, 
         "thread_queue_consumer", 
@@ -614,7 +733,6 @@ __weak void MCAN_Rx_Handler(sMCAN_Message rxMessage)
 ***********************************************************************************/
 bool MCAN_TX_Verbose( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanTxDevice, MCAN_DEV mcanRxDevice, uint8_t mcanData[64])
 {
-    int status = 0;
     sMCAN_Message txMessage = {0};
 
     sMCAN_ID mcanID = {
@@ -622,46 +740,124 @@ bool MCAN_TX_Verbose( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanTxDevice
             .MCAN_CAT = mcanType, 
             .MCAN_RX_Device = mcanRxDevice,
             .MCAN_TX_Device = mcanTxDevice,
-            .MCAN_TimeStamp = _MCAN_GetTimestamp(),
     };
 
+    // Classic frame, 8 data bytes
+    if ( !_MCAN_Transmit(&mcanID, mcanData, FDCAN_DLC_BYTES_64, FDCAN_CLASSIC_CAN) )
+    {
+        return false;
+    }
+
     txMessage.mcanID = mcanID;
     memcpy(txMessage.mcanData, mcanData, 8 * sizeof(uint8_t));
+    MCAN_RX_GetLatest(txMessage);
+
+    return true;
+}
+
+bool MCAN_TX( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanRxDevice, uint8_t mcanData[64] )
+{
+    return (bool) MCAN_TX_Verbose(mcanPri, mcanType, _mcanCurrentDevice, mcanRxDevice, mcanData );
+}
+
+/*********************************************************************************
+    Name: MCAN_TX_FD
     
-    // Interpret 32 bit idenfitier from MCAN message struct ID
-    static uint32_t uIdentifier;
-    MCAN_Conv_ID_To_Uint32(&mcanID, &uIdentifier);
+    Description:
+        Transmit a CAN FD frame carrying up to 64 data bytes from the current
+        device. The DLC is rounded up to the next valid FD size and the tail is
+        zero padded. Frames are not echoed to MCAN_RX_GetLatest.
 
-    // Format header: assume 64 byte CANFD with flexible data rate
-    FDCAN_TxHeaderTypeDef TxHeader = {
-        .Identifier = uIdentifier,
-        .IdType = FDCAN_EXTENDED_ID,
-        .TxFrameType = FDCAN_DATA_FRAME,
-        .DataLength = FDCAN_DLC_BYTES_64,
-        .ErrorStateIndicator = FDCAN_ESI_ACTIVE,
-        .BitRateSwitch = FDCAN_BRS_OFF,
-        .FDFormat = FDCAN_CLASSIC_CAN,
-        .TxEventFifoControl = FDCAN_NO_TX_EVENTS,
-        .MessageMarker = 0,
+    Arguments:
+        mcanPri      = message priority
+        mcanType     = message category
+        mcanRxDevice = bitwise OR of the receiving devices
+        mcanData     = payload
+        length       = payload length in bytes, at most 64
+
+    Returns:
+        True  = frame added to the TX FIFO
+        False = invalid length or failed transmission
+***********************************************************************************/
+bool MCAN_TX_FD( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanRxDevice, const uint8_t mcanData[], uint8_t length )
+{
+    uint8_t frameData[MCAN_FD_MAX_DATA] = {0};
+    uint8_t paddedLength;
+    uint32_t dataLength;
+
+    if ( length > MCAN_FD_MAX_DATA )
+    {
+        return false;
+    }
+
+    sMCAN_ID mcanID = {
+            .MCAN_PRIORITY = mcanPri,
+            .MCAN_CAT = mcanType,
+            .MCAN_RX_Device = mcanRxDevice,
+            .MCAN_TX_Device = _mcanCurrentDevice,
     };
 
-    // Add frame to TX FIFO -> Transmit
-    tx_mutex_get(&mcanTxMutex, TX_WAIT_FOREVER); // enter critical section, suspend if mutex is locked
-    status = HAL_FDCAN_AddMessageToTxFifoQ(&_hfdcan, &TxHeader, mcanData );
-    tx_mutex_put(&mcanTxMutex);                  // exit critical section
+    // HAL copies the full DLC size, pad into a local frame
+    dataLength = _MCAN_LengthToDLC(length, &paddedLength);
+    memcpy(frameData, mcanData, length);
+
+    return _MCAN_Transmit(&mcanID, frameData, dataLength, FDCAN_FD_CAN);
+}
+
+/*********************************************************************************
+    Name: MCAN_TxFifoIdle
+    
+    Description:
+        Reports whether every TX FIFO element is free. Low priority bulk senders
+        poll this so they never queue ahead of more urgent frames; the TX FIFO
+        sends in insertion order regardless of identifier.
+
+    Returns:
+        True  = TX FIFO empty
+        False = frames pending
+***********************************************************************************/
+bool MCAN_TxFifoIdle( void )
+{
+    return HAL_FDCAN_GetTxFifoFreeLevel(&_hfdcan) >= MCAN_TX_FIFO_DEPTH;
+}
+
+/*********************************************************************************
+    Name: MCAN_RegisterCatHandler
+    
+    Description:
+        Registers a handler that sees every received frame of a category first.
+        The handler runs in the FDCAN RX ISR and must only copy the frame out.
+        Frames it consumes skip MCAN_RX_GetLatest and the priority queue.
+        Pass NULL to restore normal handling.
 
-    if (status == HAL_OK)
+    Arguments:
+        mcanCat = category to claim
+        handler = ISR context callback, or NULL
+
+    Returns:
+        True  = handler registered
+        False = invalid category
+***********************************************************************************/
+bool MCAN_RegisterCatHandler( MCAN_CAT mcanCat, MCAN_CatHandler handler )
+{
+    if ( (uint32_t) mcanCat >= MCAN_CAT_COUNT )
     {
-        MCAN_RX_GetLatest(txMessage);
-        return true;
+        return false;
     }
 
-    return false;
+    _mcanCatHandlers[mcanCat] = handler;
+    return true;
 }
 
-bool MCAN_TX( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanRxDevice, uint8_t mcanData[64] )
+/*********************************************************************************
+    Name: MCAN_GetDevice
+    
+    Description:
+        Returns the MCAN device this build transmits as.
+***********************************************************************************/
+MCAN_DEV MCAN_GetDevice( void )
 {
-    return (bool) MCAN_TX_Verbose(mcanPri, mcanType, _mcanCurrentDevice, mcanRxDevice, mcanData );
+    return _mcanCurrentDevice;
 }
 
 /********************************************************************************
@@ -718,6 +914,27 @@ FDCAN_HandleTypeDef* MCAN_GetFDCAN_Handle( void )
     return &_hfdcan;
 }
 
+/*********************************************************************************
+    Name: MCAN_GetStats
+    
+    Description:
+        Copies the running MCAN frame counters. Counters are free running and
+        wrap at UINT32_MAX.
+
+    Arguments:
+        stats = pointer to a struct where the counters are stored
+
+    Returns:
+        None
+***********************************************************************************/
+void MCAN_GetStats( sMCAN_Stats* stats )
+{
+    stats->rxFrames  = _mcanStats.rxFrames;
+    stats->rxDropped = _mcanStats.rxDropped;
+    stats->txFrames  = _mcanStats.txFrames;
+    stats->txErrors  = _mcanStats.txErrors;
+}
+
 
 /***************************** External Overrides *****************************/
 
@@ -734,8 +951,9 @@ FDCAN_HandleTypeDef* MCAN_GetFDCAN_Handle( void )
     Returns:
         None
 ***********************************************************************************/
-void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
+MANTICORE_RAMFUNC void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
 {
+    PROF_SCOPE(PROF_MCAN_RX_ISR);
     sMCAN_Message rxMessage = {0};
 
     // Allocate Rx Header to be populated with message data
@@ -751,12 +969,22 @@ void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
         // Insert ID and timestamp into the message
         MCAN_Conv_Uint32_To_ID(rxHeader.Identifier, &rxMessage.mcanID);
         rxMessage.mcanID.MCAN_TimeStamp = _MCAN_GetTimestamp();
+        LATENCY_EVENT_AGE(LAT_SRC_FDCAN, ((uint16_t) (HAL_FDCAN_GetTimestampCounter(hfdcan) - rxHeader.RxTimestamp)) *
+                                         _mcanCyclesPerBit);
+        _mcanStats.rxFrames++;
 
-        // Update latest message
-        MCAN_RX_GetLatest(rxMessage);
+        MCAN_CatHandler handler = ( (uint32_t) rxMessage.mcanID.MCAN_CAT < MCAN_CAT_COUNT ) ? 
+                                  _mcanCatHandlers[rxMessage.mcanID.MCAN_CAT] : NULL;
 
-        // Add message to queue
-        _MCAN_PriEnqueue(rxMessage);
+        // Frames consumed by a category handler skip the queue
+        if ( handler == NULL || !handler(&rxMessage) )
+        {
+            // Update latest message
+            MCAN_RX_GetLatest(rxMessage);
+
+            // Add message to queue
+            _MCAN_PriEnqueue(rxMessage);
+        }
 
         // Enable interrupts to receive new messages
         if (HAL_FDCAN_ActivateNotification(hfdcan, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0) != HAL_OK)
@@ -774,7 +1002,11 @@ void thread_heartbeat(ULONG ctx)
 
     while( true )
     {
-        MCAN_TX( PRI_DEBUG, CAT_HEARTBEAT, rxDevices, heartbeatDataBuf);
+        // Only the first one is stamped, the boot profiler's time to heartbeat
+        if( MCAN_TX( PRI_DEBUG, CAT_HEARTBEAT, rxDevices, heartbeatDataBuf) )
+        {
+            BootMark(BOOT_PHASE_HEARTBEAT);
+        }
         tx_thread_sleep(heartbeatPeriod);
     }
 }
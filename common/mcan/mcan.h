@@ -37,6 +37,10 @@ typedef enum {
 } MCAN_DEV;
 static const MCAN_DEV DEV_ALL = 0x3F;
 
+#define MCAN_PRI_COUNT (PRI_DEBUG + 1)
+#define MCAN_CAT_COUNT (CAT_DEBUG + 1)
+#define MCAN_DEV_COUNT 6
+
 typedef struct{
     MCAN_PRI MCAN_PRIORITY;
     MCAN_CAT MCAN_CAT;
@@ -51,6 +55,18 @@ typedef struct
     uint8_t mcanData[64];
 } sMCAN_Message;
 
+typedef struct
+{
+    uint32_t rxFrames;      // Frames accepted by the RX FIFO0 ISR
+    uint32_t rxDropped;     // Frames lost to a full priority queue
+    uint32_t txFrames;      // Frames added to the TX FIFO
+    uint32_t txErrors;      // Failed TX FIFO insertions
+} sMCAN_Stats;
+
+// Called from the FDCAN RX ISR for frames of a registered category.
+// Return true to consume the frame, false to pass it to the priority queue.
+typedef bool (*MCAN_CatHandler)( const sMCAN_Message* mcanRxMessage );
+
 // User can bitwise OR to configure device filter.
 bool MCAN_Init( FDCAN_GlobalTypeDef* FDCAN_Instance, MCAN_DEV mcanRxFilterm, MCAN_EN mcanEnable);
 
@@ -61,6 +77,11 @@ __weak void MCAN_RX_Handler( sMCAN_Message mcanRxMessage );   // Called by ISR
 
 bool MCAN_TX_Verbose( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanTxDevice, MCAN_DEV mcanRxDevice, uint8_t mcanData[64] );
 bool MCAN_TX( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanRxDevice, uint8_t mcanData[64] );
+bool MCAN_TX_FD( MCAN_PRI mcanPri, MCAN_CAT mcanType, MCAN_DEV mcanRxDevice, const uint8_t mcanData[], uint8_t length );
+bool MCAN_TxFifoIdle( void );
+
+// Route a whole category to an ISR handler instead of the priority queue
+bool MCAN_RegisterCatHandler( MCAN_CAT mcanCat, MCAN_CatHandler handler );
 
 void MCAN_EnableHeartBeats( uint32_t delay, uint8_t* heartbeatData);
 void MCAN_DisableHeartBeats( void );
@@ -74,5 +95,7 @@ const char * MCAN_Cat_String( MCAN_CAT category);
 const char * MCAN_Dev_String( MCAN_DEV device);
 
 FDCAN_HandleTypeDef* MCAN_GetFDCAN_Handle( void );
+MCAN_DEV MCAN_GetDevice( void );
+void MCAN_GetStats( sMCAN_Stats* stats );
 
 #endif /* __MCAN_H */
\ No newline at end of file
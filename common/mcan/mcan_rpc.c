@@ -0,0 +1,749 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "mcan_rpc.h"
+#include "latency.h"
+#include "mcan.h"
+#include "memory_layout.h"
+#include "prof.h"
+#include "tx_api.h"
+
+#define RPC_RX_QUEUE_SIZE   8       // Must be a power of two
+#define RPC_POLL_MS         1       // Deadline and retry resolution while calls are outstanding
+#define RPC_EVENT_RX        0x1
+#define RPC_EVENT_CALL      0x2
+#define RPC_HIST_SUB_BITS   2       // Four buckets per octave
+#define RPC_HASH_SEED       2166136261UL
+#define RPC_HASH_PRIME      16777619UL
+
+// Static Data Types
+typedef enum
+{
+    RPC_SLOT_FREE,
+    RPC_SLOT_RESERVED,              // Being filled by the caller
+    RPC_SLOT_WAITING,               // Request sent, owned by the RPC thread
+    RPC_SLOT_COMPLETING,            // Claimed for completion
+    RPC_SLOT_DONE,                  // Result ready for a blocked caller
+} RPC_SLOT;
+
+typedef struct
+{
+    volatile RPC_SLOT state;
+    MCAN_DEV peer;
+    MCAN_PRI priority;
+    uint8_t method;
+    uint16_t id;
+    uint8_t attempts;
+    uint8_t reqLen;
+    uint8_t req[MCAN_RPC_DATA_MAX];     // Kept for retries
+    ULONG deadline;
+    ULONG nextRetry;
+    uint32_t retryMs;
+    uint32_t startCycles;
+    McanRpcDone done;                   // NULL for a blocked caller
+    void *ctx;
+    sMcanRpcResult result;
+    uint8_t resp[MCAN_RPC_DATA_MAX];
+} sRpcCall;
+
+typedef struct
+{
+    MCAN_DEV peer;
+    uint16_t id;
+    uint32_t hash;                      // Method and request bytes, tells a retry from a reused ID
+    ULONG tick;
+    MCAN_RPC_STATUS status;
+    uint8_t len;
+    uint8_t data[MCAN_RPC_DATA_MAX];
+} sRpcReply;
+
+typedef struct
+{
+    MCAN_DEV peer;
+    MCAN_CAT cat;
+    MCAN_PRI priority;
+    uint32_t cycles;                    // DWT count when the ISR took the frame
+    uint8_t frame[MCAN_RPC_FRAME_MAX];
+} sRpcRxFrame;
+
+typedef struct
+{
+    uint32_t calls;
+    uint32_t replies;
+    uint32_t timeouts;
+    uint32_t retries;
+    uint32_t errors;
+    uint32_t max_US;
+    uint16_t hist[MCAN_RPC_HIST_BUCKETS];
+} sRpcMethodStats;
+
+// Static Variables
+static bool _rpcReady = false;
+static McanRpcMethod _methods[MCAN_RPC_METHOD_MAX];
+static sRpcCall _calls[MCAN_RPC_MAX_PENDING];
+static sRpcReply _replies[MCAN_RPC_REPLY_CACHE];
+static uint8_t _replyNext = 0;
+static uint16_t _nextId = 0;
+static uint32_t _cyclesPerUs = 1;
+static sRpcMethodStats _methodStats[MCAN_RPC_METHOD_MAX];
+static volatile sMcanRpcStats _stats;
+static uint32_t _wakeCount = 0;
+static uint64_t _wakeCycles = 0;
+
+static sRpcRxFrame _rxQueue[RPC_RX_QUEUE_SIZE];
+static volatile uint8_t _rxHead = 0;
+static volatile uint8_t _rxTail = 0;
+static TX_EVENT_FLAGS_GROUP _rpcEvent;
+static TX_EVENT_FLAGS_GROUP _rpcDoneEvent;     // Bit per call slot, wakes blocked callers
+
+// RPC Thread
+#define THREAD_MCAN_RPC_STACK_SIZE 1024
+static TX_THREAD stThreadMcanRpc;
+static uint8_t auThreadMcanRpcStack[THREAD_MCAN_RPC_STACK_SIZE];
+static void thread_mcan_rpc(ULONG ctx);
+
+// Static Function Declarations
+static bool _sendFrame(MCAN_PRI priority, MCAN_CAT cat, MCAN_DEV peer, uint8_t method, uint16_t id,
+                       uint8_t code, const uint8_t data[], uint8_t len);
+static bool _claim(sRpcCall *call, RPC_SLOT from, RPC_SLOT to);
+static uint32_t _hash(uint8_t method, const uint8_t data[], uint8_t len);
+static uint8_t _bucket(uint32_t us);
+static uint32_t _bucketUpper(uint8_t bucket);
+static uint32_t _percentile(const sRpcMethodStats *stats, uint32_t total, uint32_t permille);
+static void _record(const sRpcCall *call);
+static MCAN_RPC_STATUS _startCall(MCAN_DEV peer, uint8_t method, const uint8_t req[], uint8_t reqLen,
+                                  const sMcanRpcOptions *options, McanRpcDone done, void *ctx, sRpcCall **slot);
+static void _complete(sRpcCall *call, MCAN_RPC_STATUS status, uint32_t cycles, const uint8_t data[], uint8_t len);
+static void _serve(const sRpcRxFrame *rx, ULONG now);
+static void _reply(const sRpcRxFrame *rx);
+static void _service(ULONG now);
+static bool _queueFrame(const sMCAN_Message *mcanRxMessage);
+static bool _commandHandler(const sMCAN_Message *mcanRxMessage);
+static bool _responseHandler(const sMCAN_Message *mcanRxMessage);
+static MCAN_RPC_STATUS _profMethod(MCAN_DEV caller, const uint8_t req[], uint8_t reqLen,
+                                   uint8_t resp[], uint8_t *respLen);
+
+
+// Static Function Definitions
+static bool _sendFrame(MCAN_PRI priority, MCAN_CAT cat, MCAN_DEV peer, uint8_t method, uint16_t id,
+                       uint8_t code, const uint8_t data[], uint8_t len)
+{
+    uint8_t frame[MCAN_RPC_FRAME_MAX];
+
+    frame[0] = method;
+    frame[1] = (uint8_t) id;
+    frame[2] = (uint8_t) (id >> 8);
+    frame[3] = code;
+    frame[4] = len;
+    if(len > 0)
+    {
+        memcpy(&frame[MCAN_RPC_HEADER_SIZE], data, len);
+    }
+
+    return MCAN_TX_FD(priority, cat, peer, frame, MCAN_RPC_HEADER_SIZE + len);
+}
+
+// Slot ownership moves between callers and the RPC thread through these transitions only
+static bool _claim(sRpcCall *call, RPC_SLOT from, RPC_SLOT to)
+{
+    TX_INTERRUPT_SAVE_AREA
+    bool claimed = false;
+
+    TX_DISABLE
+    if(call->state == from)
+    {
+        call->state = to;
+        claimed = true;
+    }
+    TX_RESTORE
+
+    return claimed;
+}
+
+// FNV-1a
+static uint32_t _hash(uint8_t method, const uint8_t data[], uint8_t len)
+{
+    uint32_t hash = (RPC_HASH_SEED ^ method) * RPC_HASH_PRIME;
+
+    for(uint8_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ data[i]) * RPC_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+// Exact below 4 us, then four linear buckets per octave
+static uint8_t _bucket(uint32_t us)
+{
+    uint8_t exponent;
+    uint32_t bucket;
+
+    if(us < (1U << RPC_HIST_SUB_BITS))
+    {
+        return (uint8_t) us;
+    }
+
+    exponent = 31 - __CLZ(us);
+    bucket = ((exponent - RPC_HIST_SUB_BITS + 1) << RPC_HIST_SUB_BITS) +
+             ((us >> (exponent - RPC_HIST_SUB_BITS)) & ((1U << RPC_HIST_SUB_BITS) - 1));
+
+    return (bucket < MCAN_RPC_HIST_BUCKETS) ? (uint8_t) bucket : MCAN_RPC_HIST_BUCKETS - 1;
+}
+
+static uint32_t _bucketUpper(uint8_t bucket)
+{
+    uint8_t exponent;
+    uint32_t mantissa;
+
+    if(bucket < (1U << RPC_HIST_SUB_BITS))
+    {
+        return bucket;
+    }
+
+    exponent = (bucket >> RPC_HIST_SUB_BITS) + RPC_HIST_SUB_BITS - 1;
+    mantissa = (1U << RPC_HIST_SUB_BITS) + (bucket & ((1U << RPC_HIST_SUB_BITS) - 1));
+
+    return ((mantissa + 1) << (exponent - RPC_HIST_SUB_BITS)) - 1;
+}
+
+static uint32_t _percentile(const sRpcMethodStats *stats, uint32_t total, uint32_t permille)
+{
+    uint32_t rank = (total * permille + 999) / 1000;
+    uint32_t seen = 0;
+
+    for(uint8_t i = 0; i < MCAN_RPC_HIST_BUCKETS; i++)
+    {
+        seen += stats->hist[i];
+        if(seen >= rank && seen > 0)
+        {
+            // The last bucket is open ended, its bound would understate the slowest calls
+            return (i == MCAN_RPC_HIST_BUCKETS - 1) ? stats->max_US : _bucketUpper(i);
+        }
+    }
+
+    return 0;
+}
+
+static void _record(const sRpcCall *call)
+{
+    sRpcMethodStats *stats = &_methodStats[call->method];
+    uint8_t bucket;
+
+    stats->calls++;
+
+    if(call->result.status == MCAN_RPC_TIMEOUT)
+    {
+        stats->timeouts++;
+        return;
+    }
+
+    stats->replies++;
+    if(call->result.status != MCAN_RPC_OK)
+    {
+        stats->errors++;
+    }
+
+    if(call->result.latency_US > stats->max_US)
+    {
+        stats->max_US = call->result.latency_US;
+    }
+
+    // Halve every bucket before one saturates, the percentiles keep their shape
+    bucket = _bucket(call->result.latency_US);
+    if(stats->hist[bucket] == UINT16_MAX)
+    {
+        for(uint8_t i = 0; i < MCAN_RPC_HIST_BUCKETS; i++)
+        {
+            stats->hist[i] >>= 1;
+        }
+    }
+    stats->hist[bucket]++;
+}
+
+// Fills a free slot and sends the first request, the slot is WAITING on success
+static MCAN_RPC_STATUS _startCall(MCAN_DEV peer, uint8_t method, const uint8_t req[], uint8_t reqLen,
+                                  const sMcanRpcOptions *options, McanRpcDone done, void *ctx, sRpcCall **slot)
+{
+    static const sMcanRpcOptions defaults = { PRI_WARNING, MCAN_RPC_TIMEOUT_MS, 0 };
+    TX_INTERRUPT_SAVE_AREA
+    sRpcCall *call = NULL;
+    ULONG now;
+    uint8_t index;
+
+    if(options == NULL)
+    {
+        options = &defaults;
+    }
+
+    // Exactly one device, other than this one
+    if(!_rpcReady || method >= MCAN_RPC_METHOD_MAX || reqLen > MCAN_RPC_DATA_MAX || (reqLen > 0 && req == NULL) ||
+       peer == 0 || (peer & (peer - 1)) != 0 || peer == MCAN_GetDevice() || options->timeoutMs == 0)
+    {
+        return MCAN_RPC_INVALID;
+    }
+
+    TX_DISABLE
+    for(index = 0; index < MCAN_RPC_MAX_PENDING; index++)
+    {
+        if(_calls[index].state == RPC_SLOT_FREE)
+        {
+            call = &_calls[index];
+            call->state = RPC_SLOT_RESERVED;
+            break;
+        }
+    }
+
+    // Zero is never used, a zeroed frame is not a reply
+    if(++_nextId == 0)
+    {
+        _nextId = 1;
+    }
+    if(call != NULL)
+    {
+        call->id = _nextId;
+    }
+    TX_RESTORE
+
+    if(call == NULL)
+    {
+        return MCAN_RPC_TABLE_FULL;
+    }
+
+    tx_event_flags_set(&_rpcDoneEvent, ~(1UL << index), TX_AND);
+
+    now = tx_time_get();
+    call->peer = peer;
+    call->priority = options->priority;
+    call->method = method;
+    call->attempts = 1;
+    call->reqLen = reqLen;
+    if(reqLen > 0)
+    {
+        memcpy(call->req, req, reqLen);
+    }
+    call->deadline = now + options->timeoutMs;
+    call->retryMs = options->retryMs;
+    call->nextRetry = now + options->retryMs;
+    call->done = done;
+    call->ctx = ctx;
+    call->startCycles = DWT->CYCCNT;
+    call->state = RPC_SLOT_WAITING;
+
+    if(!_sendFrame(call->priority, CAT_COMMAND, peer, method, call->id, 0, call->req, reqLen) && call->retryMs == 0)
+    {
+        // Nothing can answer, give the slot back unless the deadline already took it
+        if(_claim(call, RPC_SLOT_WAITING, RPC_SLOT_FREE))
+        {
+            return MCAN_RPC_TX_ERROR;
+        }
+    }
+
+    tx_event_flags_set(&_rpcEvent, RPC_EVENT_CALL, TX_OR);
+    *slot = call;
+    return MCAN_RPC_OK;
+}
+
+// Only for a slot claimed into COMPLETING
+static void _complete(sRpcCall *call, MCAN_RPC_STATUS status, uint32_t cycles, const uint8_t data[], uint8_t len)
+{
+    call->result.status = status;
+    call->result.peer = call->peer;
+    call->result.method = call->method;
+    call->result.attempts = call->attempts;
+    call->result.latency_US = (status == MCAN_RPC_TIMEOUT) ? 0 : (cycles - call->startCycles) / _cyclesPerUs;
+    call->result.len = len;
+    call->result.data = call->resp;
+    if(len > 0)
+    {
+        memcpy(call->resp, data, len);
+    }
+
+    _record(call);
+
+    if(call->done != NULL)
+    {
+        call->done(&call->result, call->ctx);
+        call->state = RPC_SLOT_FREE;
+    }
+    else
+    {
+        call->state = RPC_SLOT_DONE;
+        tx_event_flags_set(&_rpcDoneEvent, 1UL << (call - _calls), TX_OR);
+    }
+}
+
+// Runs the method once per request, retries of an answered request get the cached reply
+static void _serve(const sRpcRxFrame *rx, ULONG now)
+{
+    uint8_t method = rx->frame[0];
+    uint16_t id = rx->frame[1] | ((uint16_t) rx->frame[2] << 8);
+    uint8_t len = rx->frame[4];
+    const uint8_t *data = &rx->frame[MCAN_RPC_HEADER_SIZE];
+    uint32_t hash = _hash(method, data, len);
+    sRpcReply *reply;
+
+    for(uint8_t i = 0; i < MCAN_RPC_REPLY_CACHE; i++)
+    {
+        reply = &_replies[i];
+        if(reply->peer == rx->peer && reply->id == id && reply->hash == hash &&
+           (now - reply->tick) < MCAN_RPC_REPLAY_MS)
+        {
+            _stats.replayed++;
+            _sendFrame(rx->priority, CAT_RESPONSE, rx->peer, method, id, reply->status, reply->data, reply->len);
+            return;
+        }
+    }
+
+    if(_methods[method] == NULL)
+    {
+        return;
+    }
+
+    reply = &_replies[_replyNext];
+    _replyNext = (_replyNext + 1) % MCAN_RPC_REPLY_CACHE;
+
+    reply->len = 0;
+    reply->status = _methods[method](rx->peer, data, len, reply->data, &reply->len);
+    if(reply->len > MCAN_RPC_DATA_MAX)
+    {
+        reply->len = 0;
+        reply->status = MCAN_RPC_ERROR;
+    }
+    reply->peer = rx->peer;
+    reply->id = id;
+    reply->hash = hash;
+    reply->tick = now;
+    _stats.served++;
+
+    _sendFrame(rx->priority, CAT_RESPONSE, rx->peer, method, id, reply->status, reply->data, reply->len);
+}
+
+static void _reply(const sRpcRxFrame *rx)
+{
+    uint8_t method = rx->frame[0];
+    uint16_t id = rx->frame[1] | ((uint16_t) rx->frame[2] << 8);
+
+    for(uint8_t i = 0; i < MCAN_RPC_MAX_PENDING; i++)
+    {
+        sRpcCall *call = &_calls[i];
+
+        if(call->state == RPC_SLOT_WAITING && call->id == id && call->peer == rx->peer && call->method == method &&
+           _claim(call, RPC_SLOT_WAITING, RPC_SLOT_COMPLETING))
+        {
+            _complete(call, (MCAN_RPC_STATUS) rx->frame[3], rx->cycles, &rx->frame[MCAN_RPC_HEADER_SIZE], rx->frame[4]);
+            return;
+        }
+    }
+
+    // Answer to a retry of a completed call, or to a call that timed out
+    _stats.lateReplies++;
+}
+
+// Expire calls past their deadline and resend unanswered ones
+static void _service(ULONG now)
+{
+    for(uint8_t i = 0; i < MCAN_RPC_MAX_PENDING; i++)
+    {
+        sRpcCall *call = &_calls[i];
+
+        if(call->state != RPC_SLOT_WAITING)
+        {
+            continue;
+        }
+
+        if((LONG) (now - call->deadline) >= 0)
+        {
+            if(_claim(call, RPC_SLOT_WAITING, RPC_SLOT_COMPLETING))
+            {
+                _complete(call, MCAN_RPC_TIMEOUT, 0, NULL, 0);
+            }
+        }
+        else if(call->retryMs > 0 && (LONG) (now - call->nextRetry) >= 0)
+        {
+            call->nextRetry = now + call->retryMs;
+            _methodStats[call->method].retries++;
+            if(_sendFrame(call->priority, CAT_COMMAND, call->peer, call->method, call->id, call->attempts,
+                          call->req, call->reqLen))
+            {
+                call->attempts++;
+            }
+        }
+    }
+}
+
+// FDCAN RX ISR, stamps the frame for the round trip time
+MANTICORE_RAMFUNC static bool _queueFrame(const sMCAN_Message *mcanRxMessage)
+{
+    uint8_t next = (_rxHead + 1) & (RPC_RX_QUEUE_SIZE - 1);
+
+    if(next == _rxTail)
+    {
+        _stats.framesLost++;
+        return true;
+    }
+
+    _rxQueue[_rxHead].peer = mcanRxMessage->mcanID.MCAN_TX_Device;
+    _rxQueue[_rxHead].cat = mcanRxMessage->mcanID.MCAN_CAT;
+    _rxQueue[_rxHead].priority = mcanRxMessage->mcanID.MCAN_PRIORITY;
+    _rxQueue[_rxHead].cycles = DWT->CYCCNT;
+    memcpy(_rxQueue[_rxHead].frame, mcanRxMessage->mcanData, MCAN_RPC_FRAME_MAX);
+    _rxHead = next;
+
+    LATENCY_SIGNAL(LAT_SRC_FDCAN);
+    tx_event_flags_set(&_rpcEvent, RPC_EVENT_RX, TX_OR);
+    return true;
+}
+
+// Requests for registered methods addressed to this device only
+MANTICORE_RAMFUNC static bool _commandHandler(const sMCAN_Message *mcanRxMessage)
+{
+    const uint8_t *frame = mcanRxMessage->mcanData;
+
+    if(mcanRxMessage->mcanID.MCAN_RX_Device != MCAN_GetDevice() ||
+       frame[0] >= MCAN_RPC_METHOD_MAX || _methods[frame[0]] == NULL || frame[4] > MCAN_RPC_DATA_MAX)
+    {
+        return false;
+    }
+
+    return _queueFrame(mcanRxMessage);
+}
+
+MANTICORE_RAMFUNC static bool _responseHandler(const sMCAN_Message *mcanRxMessage)
+{
+    const uint8_t *frame = mcanRxMessage->mcanData;
+
+    if(mcanRxMessage->mcanID.MCAN_RX_Device != MCAN_GetDevice() ||
+       frame[0] >= MCAN_RPC_METHOD_MAX || frame[4] > MCAN_RPC_DATA_MAX)
+    {
+        return false;
+    }
+
+    return _queueFrame(mcanRxMessage);
+}
+
+// Built in method, the ProfPack summary of the probe in req[0]
+static MCAN_RPC_STATUS _profMethod(MCAN_DEV caller, const uint8_t req[], uint8_t reqLen,
+                                   uint8_t resp[], uint8_t *respLen)
+{
+    (void) caller;
+
+    if(reqLen != 1 || !ProfPack((PROF_ID) req[0], resp, MCAN_RPC_DATA_MAX))
+    {
+        return MCAN_RPC_BAD_REQUEST;
+    }
+
+    *respLen = PROF_PACKED_SIZE;
+    return MCAN_RPC_OK;
+}
+
+
+// Public Functions
+bool McanRpcInit(void)
+{
+    if(_rpcReady)
+    {
+        return true;
+    }
+
+    memset(_calls, 0, sizeof(_calls));
+    memset(_replies, 0, sizeof(_replies));
+    memset(_methodStats, 0, sizeof(_methodStats));
+
+    // Round trips are timed on the DWT cycle counter
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    _cyclesPerUs = (SystemCoreClock >= 1000000UL) ? SystemCoreClock / 1000000UL : 1;
+
+    // Start IDs somewhere other than zero so a caller restarted by a reset is unlikely to repeat its last IDs
+    _nextId = (uint16_t) DWT->CYCCNT;
+
+    tx_event_flags_create(&_rpcEvent, "mcan_rpc_event");
+    tx_event_flags_create(&_rpcDoneEvent, "mcan_rpc_done");
+
+    tx_thread_create( &stThreadMcanRpc,
+        "thread_mcan_rpc",
+        thread_mcan_rpc,
+        0,
+        auThreadMcanRpcStack,
+        THREAD_MCAN_RPC_STACK_SIZE,
+        5,
+        5,
+        0,
+        TX_AUTO_START);
+
+    if(!MCAN_RegisterCatHandler(CAT_COMMAND, _commandHandler) ||
+       !MCAN_RegisterCatHandler(CAT_RESPONSE, _responseHandler))
+    {
+        return false;
+    }
+
+    _methods[MCAN_RPC_METHOD_PROF] = _profMethod;
+    _rpcReady = true;
+    return true;
+}
+
+bool McanRpcRegister(uint8_t method, McanRpcMethod handler)
+{
+    if(method >= MCAN_RPC_METHOD_MAX)
+    {
+        return false;
+    }
+
+    _methods[method] = handler;
+    return true;
+}
+
+MCAN_RPC_STATUS McanRpcCall(MCAN_DEV peer, uint8_t method, const uint8_t req[], uint8_t reqLen,
+                            uint8_t resp[], uint8_t *respLen, const sMcanRpcOptions *options)
+{
+    MCAN_RPC_STATUS status;
+    sRpcCall *call;
+    ULONG flags;
+
+    // The RPC thread completes calls, it cannot wait for one
+    if(tx_thread_identify() == &stThreadMcanRpc)
+    {
+        return MCAN_RPC_INVALID;
+    }
+
+    status = _startCall(peer, method, req, reqLen, options, NULL, NULL, &call);
+    if(status != MCAN_RPC_OK)
+    {
+        return status;
+    }
+
+    // The RPC thread always completes the call by its deadline
+    tx_event_flags_get(&_rpcDoneEvent, 1UL << (call - _calls), TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
+
+    status = call->result.status;
+    if(resp != NULL)
+    {
+        memcpy(resp, call->resp, call->result.len);
+    }
+    if(respLen != NULL)
+    {
+        *respLen = call->result.len;
+    }
+    call->state = RPC_SLOT_FREE;
+
+    return status;
+}
+
+MCAN_RPC_STATUS McanRpcCallAsync(MCAN_DEV peer, uint8_t method, const uint8_t req[], uint8_t reqLen,
+                                 const sMcanRpcOptions *options, McanRpcDone done, void *ctx)
+{
+    sRpcCall *call;
+
+    if(done == NULL)
+    {
+        return MCAN_RPC_INVALID;
+    }
+
+    return _startCall(peer, method, req, reqLen, options, done, ctx, &call);
+}
+
+bool McanRpcGetMethodStats(uint8_t method, sMcanRpcMethodStats *stats)
+{
+    const sRpcMethodStats *methodStats;
+    uint32_t total = 0;
+
+    if(method >= MCAN_RPC_METHOD_MAX)
+    {
+        return false;
+    }
+
+    methodStats = &_methodStats[method];
+    for(uint8_t i = 0; i < MCAN_RPC_HIST_BUCKETS; i++)
+    {
+        total += methodStats->hist[i];
+    }
+
+    stats->calls    = methodStats->calls;
+    stats->replies  = methodStats->replies;
+    stats->timeouts = methodStats->timeouts;
+    stats->retries  = methodStats->retries;
+    stats->errors   = methodStats->errors;
+    stats->max_US   = methodStats->max_US;
+    stats->p50_US   = _percentile(methodStats, total, 500);
+    stats->p90_US   = _percentile(methodStats, total, 900);
+    stats->p99_US   = _percentile(methodStats, total, 990);
+
+    return true;
+}
+
+void McanRpcGetStats(sMcanRpcStats *stats)
+{
+    stats->served      = _stats.served;
+    stats->replayed    = _stats.replayed;
+    stats->lateReplies = _stats.lateReplies;
+    stats->framesLost  = _stats.framesLost;
+    stats->wakeCyclesMin  = _stats.wakeCyclesMin;
+    stats->wakeCyclesMax  = _stats.wakeCyclesMax;
+    stats->wakeCyclesMean = (_wakeCount > 0) ? (uint32_t) (_wakeCycles / _wakeCount) : 0;
+}
+
+
+// Threads
+static void thread_mcan_rpc(ULONG ctx)
+{
+    sRpcRxFrame rx;
+    ULONG flags;
+    ULONG wait;
+    ULONG now;
+    uint32_t waitStart;
+    uint32_t wakeCycles;
+
+    while(true)
+    {
+        // Sleep until a frame or a new call arrives, poll deadlines while calls are outstanding
+        wait = TX_WAIT_FOREVER;
+        for(uint8_t i = 0; i < MCAN_RPC_MAX_PENDING; i++)
+        {
+            if(_calls[i].state == RPC_SLOT_WAITING)
+            {
+                wait = RPC_POLL_MS;
+                break;
+            }
+        }
+
+        waitStart = DWT->CYCCNT;
+        LATENCY_WAIT(LAT_SRC_FDCAN);
+        tx_event_flags_get(&_rpcEvent, RPC_EVENT_RX | RPC_EVENT_CALL, TX_OR_CLEAR, &flags, wait);
+        LATENCY_WAKE(LAT_SRC_FDCAN);
+        now = tx_time_get();
+
+        // Wake latency, only for a frame that arrived while this thread was waiting
+        if(_rxTail != _rxHead && (int32_t) (_rxQueue[_rxTail].cycles - waitStart) > 0)
+        {
+            wakeCycles = DWT->CYCCNT - _rxQueue[_rxTail].cycles;
+            if(_wakeCount == 0 || wakeCycles < _stats.wakeCyclesMin)
+            {
+                _stats.wakeCyclesMin = wakeCycles;
+            }
+            if(wakeCycles > _stats.wakeCyclesMax)
+            {
+                _stats.wakeCyclesMax = wakeCycles;
+            }
+            _wakeCycles += wakeCycles;
+            _wakeCount++;
+        }
+
+        while(_rxTail != _rxHead)
+        {
+            rx = _rxQueue[_rxTail];
+            _rxTail = (_rxTail + 1) & (RPC_RX_QUEUE_SIZE - 1);
+
+            if(rx.cat == CAT_COMMAND)
+            {
+                _serve(&rx, now);
+            }
+            else
+            {
+                _reply(&rx);
+            }
+        }
+
+        _service(now);
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef __MCAN_RPC_H
+#define __MCAN_RPC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mcan.h"
+
+/*********************************************************************************
+    Request/response calls between modules over MCAN.
+
+    A request is a CAT_COMMAND frame to one device, the reply is a CAT_RESPONSE
+    frame carrying the same method and request ID. Each call has a deadline and
+    waits in a table of MCAN_RPC_MAX_PENDING outstanding calls. It completes
+    exactly once, with the reply or with MCAN_RPC_TIMEOUT: either through a
+    callback on the RPC thread or by waking the thread blocked in McanRpcCall.
+
+    With retryMs set, an unanswered request is sent again under the same ID
+    until the deadline. Servers keep their last MCAN_RPC_REPLY_CACHE replies for
+    MCAN_RPC_REPLAY_MS and answer a repeated request from the cache, so a
+    retried method runs at most once. Deadlines must be shorter than that.
+
+    Round trips are timed from the first request leaving the caller to the reply
+    reaching the FDCAN ISR, on the DWT cycle counter. Each method keeps a
+    histogram with four buckets per octave of microseconds, at most 25% wide, which
+    McanRpcGetMethodStats reduces to p50, p90 and p99.
+
+    Only requests for a registered method are claimed from CAT_COMMAND, other
+    command frames still go through the MCAN priority queue. McanRpcInit
+    registers MCAN_RPC_METHOD_PROF, which serves this device's PROF_SCOPE probes.
+
+    Frame payload:
+        [method u8][id u16 LE][attempt or status u8][len u8][data len bytes]
+***********************************************************************************/
+
+#define MCAN_RPC_FRAME_MAX          64
+#define MCAN_RPC_HEADER_SIZE        5
+#define MCAN_RPC_DATA_MAX           (MCAN_RPC_FRAME_MAX - MCAN_RPC_HEADER_SIZE)
+
+#define MCAN_RPC_METHOD_MAX         16      // Method IDs 0 to MCAN_RPC_METHOD_MAX - 1
+#define MCAN_RPC_MAX_PENDING        8       // Outstanding calls from this device
+#define MCAN_RPC_REPLY_CACHE        8       // Replies a server remembers for retries
+#define MCAN_RPC_TIMEOUT_MS         50      // Deadline when no options are given
+#define MCAN_RPC_REPLAY_MS          1000    // Longest a server answers retries from its cache
+#define MCAN_RPC_HIST_BUCKETS       64      // Up to ~131 ms, slower round trips land in the last bucket
+
+#define MCAN_RPC_METHOD_PROF        (MCAN_RPC_METHOD_MAX - 1)   // Built in, profiling probe summaries, see prof.h
+
+typedef enum
+{
+    // Sent by the server
+    MCAN_RPC_OK            = 0x00,
+    MCAN_RPC_ERROR         = 0x01,          // Method ran and failed
+    MCAN_RPC_BAD_REQUEST   = 0x02,          // Method rejected the arguments
+
+    // Raised by the caller
+    MCAN_RPC_TIMEOUT       = 0x80,
+    MCAN_RPC_TABLE_FULL    = 0x81,
+    MCAN_RPC_TX_ERROR      = 0x82,
+    MCAN_RPC_INVALID       = 0x83,
+} MCAN_RPC_STATUS;
+
+typedef struct
+{
+    MCAN_PRI priority;
+    uint32_t timeoutMs;                     // Deadline from the call
+    uint32_t retryMs;                       // Resend period while unanswered, 0 sends once
+} sMcanRpcOptions;
+
+typedef struct
+{
+    MCAN_RPC_STATUS status;
+    MCAN_DEV peer;
+    uint8_t method;
+    uint8_t attempts;                       // Requests sent, including retries
+    uint32_t latency_US;                    // Round trip, 0 on timeout
+    const uint8_t *data;                    // Reply payload, valid during the callback only
+    uint8_t len;
+} sMcanRpcResult;
+
+typedef struct
+{
+    uint32_t calls;
+    uint32_t replies;
+    uint32_t timeouts;
+    uint32_t retries;
+    uint32_t errors;                        // Replies other than MCAN_RPC_OK
+    uint32_t p50_US;                        // Percentiles are bucket upper bounds
+    uint32_t p90_US;
+    uint32_t p99_US;
+    uint32_t max_US;
+} sMcanRpcMethodStats;
+
+typedef struct
+{
+    uint32_t served;                        // Requests run by a method
+    uint32_t replayed;                      // Retries answered from the reply cache
+    uint32_t lateReplies;                   // Replies with no outstanding call
+    uint32_t framesLost;                    // RX queue full
+    uint32_t wakeCyclesMin;                 // RX ISR to the idle RPC thread running
+    uint32_t wakeCyclesMean;
+    uint32_t wakeCyclesMax;
+} sMcanRpcStats;
+
+// Runs on the RPC thread. Fill at most MCAN_RPC_DATA_MAX reply bytes and set respLen.
+typedef MCAN_RPC_STATUS (*McanRpcMethod)(MCAN_DEV caller, const uint8_t req[], uint8_t reqLen,
+                                         uint8_t resp[], uint8_t *respLen);
+
+// Runs on the RPC thread, must not block on another call
+typedef void (*McanRpcDone)(const sMcanRpcResult *result, void *ctx);
+
+// Claims RPC frames from MCAN and starts the RPC thread. Call after MCAN_Init.
+bool McanRpcInit(void);
+
+// Server side
+bool McanRpcRegister(uint8_t method, McanRpcMethod handler);
+
+// Client side, options may be NULL for PRI_WARNING, MCAN_RPC_TIMEOUT_MS and no retries.
+// Blocks until the reply or the deadline. resp takes MCAN_RPC_DATA_MAX bytes and may be NULL.
+MCAN_RPC_STATUS McanRpcCall(MCAN_DEV peer, uint8_t method, const uint8_t req[], uint8_t reqLen,
+                            uint8_t resp[], uint8_t *respLen, const sMcanRpcOptions *options);
+
+// Returns MCAN_RPC_OK once the call is outstanding, done is then called exactly once
+MCAN_RPC_STATUS McanRpcCallAsync(MCAN_DEV peer, uint8_t method, const uint8_t req[], uint8_t reqLen,
+                                 const sMcanRpcOptions *options, McanRpcDone done, void *ctx);
+
+bool McanRpcGetMethodStats(uint8_t method, sMcanRpcMethodStats *stats);
+void McanRpcGetStats(sMcanRpcStats *stats);
+
+#endif /* __MCAN_RPC_H */
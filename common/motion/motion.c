@@ -0,0 +1,179 @@
+#include "motion.h"
+#include <stddef.h>
+
+//Local Scope Function
+//TIM_CHANNEL_1 to 4 are 0x0, 0x4, 0x8 and 0xC
+static uint8_t Motion_Channel_Index(uint32_t channel){
+    return (uint8_t)(channel >> 2);
+}
+
+//Update period of the group's timer in seconds
+static float Motion_Period(const PWM_Group_t* group){
+    return (float)(group->htim->Init.Prescaler + 1U) * (float)(__HAL_TIM_GET_AUTORELOAD(group->htim) + 1U)
+           / (float)HAL_RCC_GetSysClockFreq();
+}
+
+//Position the channel's staged compare value stands for
+static void Motion_Axis_Sync(Motion_Axis_t* axis){
+    axis->position = (axis->group->staged[Motion_Channel_Index(axis->channel)] - axis->countsOffset) / axis->countsPerUnit;
+
+    if(axis->position < axis->minPosition)
+        axis->position = axis->minPosition;
+    else if(axis->position > axis->maxPosition)
+        axis->position = axis->maxPosition;
+}
+
+//Motion Functions
+Motion_Error Motion_Axis_From_Servo(Motion_Axis_t* axis, const Servo_Instance_t* servo, const sMotionLimits* limits){
+
+    /* Asserting Params */
+    if(axis == NULL || servo == NULL || limits == NULL)
+        return MOTION_INSTANCE_ERROR;
+    else if(!servo->ready || servo->group == NULL || servo->config->maxAngle <= servo->config->minAngle)
+        return MOTION_INSTANCE_ERROR;
+
+    /* Same line as the angle map in Drive_Servo */
+    axis->group = servo->group;
+    axis->channel = servo->channel;
+    axis->countsPerUnit = ((float)servo->maxCnt - servo->minCnt) / (servo->config->maxAngle - servo->config->minAngle);
+    axis->countsOffset = servo->minCnt - servo->config->minAngle * axis->countsPerUnit;
+    axis->minPosition = servo->config->minAngle;
+    axis->maxPosition = servo->config->maxAngle;
+    axis->limits = *limits;
+    Motion_Axis_Sync(axis);
+
+    return MOTION_OK;
+}
+
+Motion_Error Motion_Axis_From_Actuator(Motion_Axis_t* axis, const Actuator_Instance_t* act, const sMotionLimits* limits){
+
+    /* Asserting Params */
+    if(axis == NULL || act == NULL || limits == NULL)
+        return MOTION_INSTANCE_ERROR;
+    else if(!act->Ready || act->Group == NULL || act->config->Desired_Max_Length <= act->config->Desired_Min_Length)
+        return MOTION_INSTANCE_ERROR;
+
+    /* Same line as the length map in Drive_Actuator */
+    axis->group = act->Group;
+    axis->channel = act->Channel;
+    axis->countsPerUnit = ((float)act->Max_Cnt - act->Min_Cnt) / (act->config->Desired_Max_Length - act->config->Desired_Min_Length);
+    axis->countsOffset = act->Min_Cnt - act->config->Desired_Min_Length * axis->countsPerUnit;
+    axis->minPosition = act->config->Desired_Min_Length;
+    axis->maxPosition = act->config->Desired_Max_Length;
+    axis->limits = *limits;
+    Motion_Axis_Sync(axis);
+
+    return MOTION_OK;
+}
+
+Motion_Error Motion_Move(Motion_Axis_t* const axes[], const float targets[], uint8_t count, eMotionShape shape,
+                         uint32_t* buffer, uint32_t bufferWords){
+
+    PWM_Group_t* groups[MOTION_AXES_MAX];
+    sMotionProfile* profiles[MOTION_AXES_MAX];
+    uint32_t* frames[MOTION_AXES_MAX];
+    uint32_t frameCount[MOTION_AXES_MAX];
+    uint8_t masks[MOTION_AXES_MAX];
+    uint8_t groupCount = 0;
+    uint8_t started = 0;
+    uint32_t used = 0;
+    uint32_t primask;
+    Motion_Error error = MOTION_OK;
+
+    /* Asserting Params */
+    if(axes == NULL || targets == NULL || buffer == NULL || count == 0 || count > MOTION_AXES_MAX)
+        return MOTION_INSTANCE_ERROR;
+
+    for(uint8_t i = 0; i < count; i++){
+        uint8_t g;
+
+        if(axes[i] == NULL || axes[i]->group == NULL || axes[i]->group->htim == NULL)
+            return MOTION_INSTANCE_ERROR;
+        else if(Motion_Channel_Index(axes[i]->channel) >= axes[i]->group->channelCount)
+            return MOTION_INSTANCE_ERROR;
+        else if(targets[i] < axes[i]->minPosition || targets[i] > axes[i]->maxPosition)
+            return MOTION_RANGE_ERROR;
+
+        /* One stream per timer */
+        for(g = 0; g < groupCount && groups[g] != axes[i]->group; g++);
+        if(g == groupCount){
+            if(axes[i]->group->armed)
+                return MOTION_BUSY;
+            groups[groupCount] = axes[i]->group;
+            masks[groupCount++] = 0;
+        }
+        masks[g] |= 1U << Motion_Channel_Index(axes[i]->channel);
+    }
+
+    /* Plan from where each axis was last sent and finish together */
+    for(uint8_t i = 0; i < count; i++){
+        if(!MotionPlan(&axes[i]->profile, shape, axes[i]->position, targets[i], &axes[i]->limits))
+            return MOTION_LIMIT_ERROR;
+        profiles[i] = &axes[i]->profile;
+    }
+    MotionSynchronize(profiles, count);
+
+    /* Frames of each group, channels outside the move repeat their staged value */
+    for(uint8_t g = 0; g < groupCount; g++){
+        float period = Motion_Period(groups[g]);
+        uint8_t stride = groups[g]->channelCount;
+
+        frameCount[g] = MotionFramesMax(profiles, count, period);
+        if(frameCount[g] > (bufferWords - used) / stride ||
+           frameCount[g] > PWM_GROUP_STREAM_MAX_BYTES / (stride * sizeof(uint32_t)))
+            return MOTION_BUFFER_ERROR;
+        frames[g] = &buffer[used];
+        used += frameCount[g] * stride;
+
+        for(uint32_t f = 0; f < frameCount[g]; f++){
+            for(uint8_t c = 0; c < stride; c++)
+                frames[g][f * stride + c] = groups[g]->staged[c];
+        }
+
+        for(uint8_t i = 0; i < count; i++){
+            if(axes[i]->group != groups[g])
+                continue;
+            if(!MotionFill(&axes[i]->profile, period, axes[i]->countsPerUnit, axes[i]->countsOffset,
+                           &frames[g][Motion_Channel_Index(axes[i]->channel)], stride, frameCount[g]))
+                return MOTION_RANGE_ERROR;
+        }
+    }
+
+    /* Start every stream before the next update of any of the timers, all of them or none */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    for(uint8_t g = 0; g < groupCount; g++){
+        if(groups[g]->armed)
+            error = MOTION_BUSY;
+    }
+    while(error == MOTION_OK && started < groupCount){
+        if(PWM_Group_Stream(groups[started], frames[started], frameCount[started], masks[started]) != PWM_GROUP_OK)
+            error = MOTION_BUFFER_ERROR;
+        else
+            started++;
+    }
+    /* A DMA that refused to start, stop the others before they get past their first frame */
+    if(error != MOTION_OK){
+        for(uint8_t g = 0; g < started; g++)
+            PWM_Group_Stream_Cancel(groups[g]);
+    }
+    __set_PRIMASK(primask);
+
+    if(error != MOTION_OK)
+        return error;
+
+    for(uint8_t i = 0; i < count; i++)
+        axes[i]->position = targets[i];
+
+    return MOTION_OK;
+}
+
+bool Motion_Busy(Motion_Axis_t* const axes[], uint8_t count){
+
+    for(uint8_t i = 0; i < count; i++){
+        if(axes[i] != NULL && PWM_Group_Streaming(axes[i]->group))
+            return true;
+    }
+
+    return false;
+}
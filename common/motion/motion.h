@@ -0,0 +1,63 @@
+#ifndef __MOTION_H
+#define __MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32h5xx_hal.h"
+#include "motion_profile.h"
+#include "pwm_group.h"
+#include "servo.h"
+
+/*
+ *  Motion
+ *
+ *  Profiled moves for servos and actuators. An axis is one channel of a PWM group with a
+ *  linear map from position (degrees, mm) to compare counts. Motion_Move plans a profile per
+ *  axis, stretches them to finish together, samples them once per PWM period into the
+ *  caller's buffer and streams the frames into the CCRs by DMA. The move then runs without
+ *  the CPU, at 50 Hz and four channels a two second move takes 400 words of buffer.
+ *
+ *  Axes on different timers stream from their own part of the buffer. The streams start in
+ *  one interrupt-free section and the moves end within a PWM period of each other.
+ */
+
+/* List of Macros */
+#define MOTION_AXES_MAX     (8U)            //Axes in one move
+
+//Motion Error Enum
+typedef enum{
+    MOTION_OK               = 0x00U,
+    MOTION_INSTANCE_ERROR   = 0x01U,
+    MOTION_RANGE_ERROR      = 0x02U,
+    MOTION_LIMIT_ERROR      = 0x03U,
+    MOTION_BUFFER_ERROR     = 0x04U,
+    MOTION_BUSY             = 0x05U
+} Motion_Error;
+
+//Motion Axis Struct
+typedef struct{
+	PWM_Group_t*		group;				//The axis channel must be in the group
+	uint32_t			channel;
+	float				countsPerUnit;
+	float				countsOffset;		//Counts at position 0
+	float				minPosition;
+	float				maxPosition;
+	sMotionLimits		limits;
+
+	/* These will be set by the bind functions and by Motion_Move */
+	float				position;			//Target of the last move
+	sMotionProfile		profile;
+} Motion_Axis_t;
+
+//Motion Functions
+//Axis for an initialized servo or actuator with a group, starting from its current compare value
+Motion_Error Motion_Axis_From_Servo(Motion_Axis_t* axis, const Servo_Instance_t* servo, const sMotionLimits* limits);
+Motion_Error Motion_Axis_From_Actuator(Motion_Axis_t* axis, const Actuator_Instance_t* act, const sMotionLimits* limits);
+
+//Moves every axis to its target together. buffer stays in use until Motion_Busy is false.
+//BUSY while a burst or stream of any of the groups is armed. Starts the streams of all groups or of none
+Motion_Error Motion_Move(Motion_Axis_t* const axes[], const float targets[], uint8_t count, eMotionShape shape,
+                         uint32_t* buffer, uint32_t bufferWords);
+bool Motion_Busy(Motion_Axis_t* const axes[], uint8_t count);
+
+#endif
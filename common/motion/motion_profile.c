@@ -0,0 +1,257 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "motion_profile.h"
+
+// Static Function Declarations
+static void _motionBuild(sMotionProfile *profile, uint8_t segments, const float durations[], const float accels[], const float jerks[]);
+static void _motionPlanTrapezoid(float distance, const sMotionLimits *limits, float durations[], float accels[]);
+static void _motionPlanSCurve(float distance, const sMotionLimits *limits, float durations[]);
+
+
+// Static Function Definitions
+// Segment start states from the durations. accels sets each segment's acceleration, jerk profiles
+// pass NULL and carry the acceleration over from the previous segment.
+static void _motionBuild(sMotionProfile *profile, uint8_t segments, const float durations[], const float accels[], const float jerks[])
+{
+    float t = 0.0f, p = 0.0f, v = 0.0f, a = 0.0f;
+
+    profile->segments = segments;
+    profile->vPeak = 0.0f;
+    profile->aPeak = 0.0f;
+
+    for(uint8_t i = 0; i < segments; i++)
+    {
+        float d = durations[i];
+        float j = (jerks != NULL) ? jerks[i] : 0.0f;
+
+        if(accels != NULL)
+        {
+            a = accels[i];
+        }
+
+        profile->segTime[i] = t;
+        profile->segPos[i] = p;
+        profile->segVel[i] = v;
+        profile->segAcc[i] = a;
+        profile->segJerk[i] = j;
+
+        p += d * (v + d * (a / 2.0f + d * j / 6.0f));
+        v += d * (a + d * j / 2.0f);
+        a += d * j;
+        t += d;
+
+        profile->vPeak = (v > profile->vPeak) ? v : profile->vPeak;
+        profile->aPeak = (fabsf(a) > profile->aPeak) ? fabsf(a) : profile->aPeak;
+        if(accels != NULL)
+        {
+            profile->aPeak = (fabsf(accels[i]) > profile->aPeak) ? fabsf(accels[i]) : profile->aPeak;
+        }
+    }
+
+    profile->duration = t;
+    profile->stretch = 1.0f;
+}
+
+// Accelerate, cruise, decelerate. A triangle when vMax is out of reach.
+static void _motionPlanTrapezoid(float distance, const sMotionLimits *limits, float durations[], float accels[])
+{
+    float v = limits->vMax;
+    float tAcc = v / limits->aMax;
+    float tCruise = 0.0f;
+
+    if(distance >= v * tAcc)
+    {
+        tCruise = (distance - v * tAcc) / v;
+    }
+    else
+    {
+        v = sqrtf(distance * limits->aMax);
+        tAcc = v / limits->aMax;
+    }
+
+    durations[0] = tAcc;
+    durations[1] = tCruise;
+    durations[2] = tAcc;
+    accels[0] = limits->aMax;
+    accels[1] = 0.0f;
+    accels[2] = -limits->aMax;
+}
+
+// Jerk segments of tJerk, constant acceleration of tConst and a cruise of tCruise
+static void _motionPlanSCurve(float distance, const sMotionLimits *limits, float durations[])
+{
+    float v = limits->vMax, a = limits->aMax, j = limits->jMax;
+    float tJerk, tConst, tCruise = 0.0f;
+    float vJerk = a * a / j;        // Lowest speed that reaches aMax
+
+    if(v >= vJerk)
+    {
+        tJerk = a / j;
+        tConst = v / a - tJerk;
+    }
+    else
+    {
+        tJerk = sqrtf(v / j);
+        tConst = 0.0f;
+    }
+
+    // Speeding up and slowing down take v * (2 tJerk + tConst) between them
+    if(distance >= v * (2.0f * tJerk + tConst))
+    {
+        tCruise = distance / v - (2.0f * tJerk + tConst);
+    }
+    else
+    {
+        // Peak speed with aMax reached solves v^2 + v vJerk - distance aMax = 0
+        v = (-vJerk + sqrtf(vJerk * vJerk + 4.0f * distance * a)) / 2.0f;
+        if(v >= vJerk && limits->vMax >= vJerk)
+        {
+            tJerk = a / j;
+            tConst = v / a - tJerk;
+        }
+        else
+        {
+            tJerk = cbrtf(distance / (2.0f * j));
+            tConst = 0.0f;
+        }
+    }
+
+    durations[0] = tJerk;
+    durations[1] = tConst;
+    durations[2] = tJerk;
+    durations[3] = tCruise;
+    durations[4] = tJerk;
+    durations[5] = tConst;
+    durations[6] = tJerk;
+}
+
+
+// Public Functions
+bool MotionPlan(sMotionProfile *profile, eMotionShape shape, float start, float target, const sMotionLimits *limits)
+{
+    static const float jerkSigns[MOTION_SEGMENTS] = { 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 1.0f };
+    float durations[MOTION_SEGMENTS];
+    float values[MOTION_SEGMENTS];
+    float distance = fabsf(target - start);
+
+    if(limits == NULL || !(limits->vMax > 0.0f) || !(limits->aMax > 0.0f) ||
+       (shape == MOTION_SCURVE && !(limits->jMax > 0.0f)))
+    {
+        return false;
+    }
+
+    profile->start = start;
+    profile->target = target;
+
+    if(distance == 0.0f)
+    {
+        durations[0] = 0.0f;
+        values[0] = 0.0f;
+        _motionBuild(profile, 1, durations, values, NULL);
+        return true;
+    }
+
+    if(shape == MOTION_TRAPEZOID)
+    {
+        _motionPlanTrapezoid(distance, limits, durations, values);
+        _motionBuild(profile, 3, durations, values, NULL);
+    }
+    else
+    {
+        _motionPlanSCurve(distance, limits, durations);
+        for(uint8_t i = 0; i < MOTION_SEGMENTS; i++)
+        {
+            values[i] = jerkSigns[i] * limits->jMax;
+        }
+        _motionBuild(profile, MOTION_SEGMENTS, durations, NULL, values);
+    }
+
+    return true;
+}
+
+float MotionSynchronize(sMotionProfile *profiles[], uint8_t count)
+{
+    float longest = 0.0f;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        longest = (profiles[i]->duration > longest) ? profiles[i]->duration : longest;
+    }
+
+    // Slowing a profile down by k divides its speed by k, its acceleration by k^2 and its jerk by k^3
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(profiles[i]->duration > 0.0f)
+        {
+            profiles[i]->stretch *= longest / profiles[i]->duration;
+            profiles[i]->duration = longest;
+        }
+    }
+
+    return longest;
+}
+
+float MotionPosition(const sMotionProfile *profile, float t)
+{
+    float planned, d, s;
+    uint8_t i;
+
+    if(t <= 0.0f)
+    {
+        return profile->start;
+    }
+    if(t >= profile->duration)
+    {
+        return profile->target;
+    }
+
+    planned = t / profile->stretch;
+    for(i = profile->segments - 1; i > 0 && planned < profile->segTime[i]; i--)
+    {
+    }
+
+    d = planned - profile->segTime[i];
+    s = profile->segPos[i] + d * (profile->segVel[i] + d * (profile->segAcc[i] / 2.0f + d * profile->segJerk[i] / 6.0f));
+
+    return (profile->target >= profile->start) ? profile->start + s : profile->start - s;
+}
+
+uint32_t MotionFrames(const sMotionProfile *profile, float period_S)
+{
+    uint32_t frames = (uint32_t) ceilf(profile->duration / period_S);
+
+    return (frames == 0) ? 1 : frames;
+}
+
+uint32_t MotionFramesMax(sMotionProfile *const profiles[], uint8_t count, float period_S)
+{
+    uint32_t longest = 1;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        uint32_t frames = MotionFrames(profiles[i], period_S);
+
+        longest = (frames > longest) ? frames : longest;
+    }
+
+    return longest;
+}
+
+bool MotionFill(const sMotionProfile *profile, float period_S, float countsPerUnit, float countsOffset,
+                uint32_t *out, uint32_t stride, uint32_t frames)
+{
+    for(uint32_t i = 0; i < frames; i++)
+    {
+        // Frame i is loaded on the update that ends period i
+        float counts = countsOffset + MotionPosition(profile, (float) (i + 1) * period_S) * countsPerUnit;
+
+        if(counts < 0.0f)
+        {
+            return false;
+        }
+        out[i * stride] = (uint32_t) (counts + 0.5f);
+    }
+
+    return true;
+}
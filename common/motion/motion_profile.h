@@ -0,0 +1,78 @@
+#ifndef __MOTION_PROFILE_H
+#define __MOTION_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+    Point to point motion profiles.
+
+    Trapezoidal profiles limit velocity and acceleration. S-curve profiles also
+    limit jerk, with seven segments of +J, 0, -J, cruise, -J, 0, +J. Both start
+    and end at rest. When the distance is too short to reach a limit, the
+    profile reduces to a triangle, or to an S-curve without its constant
+    acceleration or cruise segments.
+
+    A plan stores each segment's start state, so evaluation is one cubic.
+    MotionSynchronize stretches every profile in time to the longest one. The
+    axes then arrive together, and a stretched profile stays inside its limits.
+    MotionFill samples a profile once per PWM period into compare values for
+    DMA, so a move costs the CPU nothing while it runs.
+
+    Pure C with no HAL or RTOS dependency, the host check in tools/motion
+    builds the same file.
+***********************************************************************************/
+
+#define MOTION_SEGMENTS     7
+
+typedef enum
+{
+    MOTION_TRAPEZOID,
+    MOTION_SCURVE
+} eMotionShape;
+
+typedef struct
+{
+    float vMax;                     // Units/s
+    float aMax;                     // Units/s^2
+    float jMax;                     // Units/s^3, S-curve only
+} sMotionLimits;
+
+typedef struct
+{
+    float start;
+    float target;
+    float duration;                 // Seconds, stretched
+    float stretch;                  // Planned time per real time, 1 unless synchronised
+    float vPeak;                    // Reached before stretching, may be below vMax
+    float aPeak;
+    uint8_t segments;
+    float segTime[MOTION_SEGMENTS]; // Planned start time of each segment
+    float segPos[MOTION_SEGMENTS];  // Distance covered at the segment start
+    float segVel[MOTION_SEGMENTS];
+    float segAcc[MOTION_SEGMENTS];
+    float segJerk[MOTION_SEGMENTS];
+} sMotionProfile;
+
+// Returns false on non-positive limits. A zero length move plans with zero duration.
+bool MotionPlan(sMotionProfile *profile, eMotionShape shape, float start, float target, const sMotionLimits *limits);
+
+// Stretches every profile to the longest duration, returns that duration
+float MotionSynchronize(sMotionProfile *profiles[], uint8_t count);
+
+// Position at t seconds from the start, clamped to start and target outside the move
+float MotionPosition(const sMotionProfile *profile, float t);
+
+// Number of samples at period_S that cover the move, the last one lands on the target
+uint32_t MotionFrames(const sMotionProfile *profile, float period_S);
+
+// Frames of the longest of several profiles. A zero length move is never stretched, so
+// the first profile alone may be a single frame.
+uint32_t MotionFramesMax(sMotionProfile *const profiles[], uint8_t count, float period_S);
+
+// Writes countsOffset + position * countsPerUnit for each period to out[i * stride],
+// frames samples, holding the target after the move. Returns false if a value is negative.
+bool MotionFill(const sMotionProfile *profile, float period_S, float countsPerUnit, float countsOffset,
+                uint32_t *out, uint32_t stride, uint32_t frames);
+
+#endif /* __MOTION_PROFILE_H */
@@ -0,0 +1,236 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "prof.h"
+#include "memory_layout.h"
+#include "tx_api.h"
+
+#if !defined(__linux__)
+#include "stm32h5xx.h"
+#endif
+
+// Static Data Types
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_HIST_BUCKETS];
+} sProfProbe;
+
+// Static Variables
+static const char *_probeNames[PROF_ID_COUNT] =
+{
+    "mcan_rx_isr",
+    "console_print",
+    "bno055_read",
+    "bno055_burst",
+};
+
+#if defined(MANTICORE_PROFILING)
+static sProfProbe _probes[PROF_ID_COUNT];
+#endif
+
+// Static Function Declarations
+#if defined(MANTICORE_PROFILING)
+static uint32_t _percentile(const sProfProbe *probe, uint32_t permille);
+#endif
+static void _put32(uint8_t buff[], uint32_t value);
+static uint32_t _get32(const uint8_t buff[]);
+
+
+// Static Function Definitions
+#if defined(MANTICORE_PROFILING)
+
+// Upper bound of the bucket holding the sample, the real max when that is lower
+static uint32_t _percentile(const sProfProbe *probe, uint32_t permille)
+{
+    uint64_t target = ((uint64_t) probe->count * permille + 999U) / 1000U;
+    uint64_t seen = 0;
+
+    for(uint8_t bucket = 0; bucket < PROF_HIST_BUCKETS; bucket++)
+    {
+        seen += probe->hist[bucket];
+        if(seen >= target && seen > 0)
+        {
+            uint32_t upper = (bucket == 0) ? 0 : (uint32_t) ((1ULL << bucket) - 1U);
+
+            return (upper < probe->max) ? upper : probe->max;
+        }
+    }
+
+    return probe->max;
+}
+
+#endif
+
+static void _put32(uint8_t buff[], uint32_t value)
+{
+    buff[0] = (uint8_t) value;
+    buff[1] = (uint8_t) (value >> 8);
+    buff[2] = (uint8_t) (value >> 16);
+    buff[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t _get32(const uint8_t buff[])
+{
+    return (uint32_t) buff[0] | ((uint32_t) buff[1] << 8) | ((uint32_t) buff[2] << 16) | ((uint32_t) buff[3] << 24);
+}
+
+
+// Public Functions
+#if defined(MANTICORE_PROFILING)
+
+// Probes sit in the FDCAN ISR, keep the record path out of flash with it
+MANTICORE_RAMFUNC void ProfRecord(PROF_ID id, uint32_t start)
+{
+    TX_INTERRUPT_SAVE_AREA
+    uint32_t ticks = ProfNow() - start;
+    uint8_t bucket = (ticks == 0) ? 0 : (uint8_t) (32U - (uint32_t) __builtin_clz(ticks));
+    sProfProbe *probe;
+
+    if((uint32_t) id >= PROF_ID_COUNT)
+    {
+        return;
+    }
+
+    if(bucket >= PROF_HIST_BUCKETS)
+    {
+        bucket = PROF_HIST_BUCKETS - 1;
+    }
+
+    probe = &_probes[id];
+
+    TX_DISABLE
+    if(probe->count == 0 || ticks < probe->min)
+    {
+        probe->min = ticks;
+    }
+    if(ticks > probe->max)
+    {
+        probe->max = ticks;
+    }
+    probe->count++;
+    probe->total += ticks;
+    probe->hist[bucket]++;
+    TX_RESTORE
+}
+
+MANTICORE_RAMFUNC void ProfScopeEnd(const sProfScope *scope)
+{
+    ProfRecord(scope->id, scope->start);
+}
+
+#endif
+
+void ProfInit(void)
+{
+#if defined(MANTICORE_PROFILING) && !defined(__linux__)
+    // Already running from the startup code unless a debugger reset the DWT
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    ProfReset();
+}
+
+void ProfReset(void)
+{
+#if defined(MANTICORE_PROFILING)
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    memset(_probes, 0, sizeof(_probes));
+    TX_RESTORE
+#endif
+}
+
+bool ProfGet(PROF_ID id, sProfStats *stats)
+{
+#if defined(MANTICORE_PROFILING)
+    TX_INTERRUPT_SAVE_AREA
+    sProfProbe probe;
+
+    if((uint32_t) id >= PROF_ID_COUNT || stats == NULL)
+    {
+        return false;
+    }
+
+    TX_DISABLE
+    probe = _probes[id];
+    TX_RESTORE
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = probe.count;
+    stats->min = probe.min;
+    stats->max = probe.max;
+    stats->mean = (probe.count > 0) ? (uint32_t) (probe.total / probe.count) : 0;
+    stats->p50 = _percentile(&probe, 500);
+    stats->p90 = _percentile(&probe, 900);
+    stats->p99 = _percentile(&probe, 990);
+    stats->ticksPerUs = ProfTicksPerUs();
+    memcpy(stats->hist, probe.hist, sizeof(stats->hist));
+
+    return true;
+#else
+    (void) id;
+    (void) stats;
+    return false;
+#endif
+}
+
+uint32_t ProfTicksPerUs(void)
+{
+#if defined(__linux__)
+    return 1000UL;
+#else
+    return (SystemCoreClock >= 1000000UL) ? SystemCoreClock / 1000000UL : 1;
+#endif
+}
+
+const char *ProfName(PROF_ID id)
+{
+    return ((uint32_t) id < PROF_ID_COUNT) ? _probeNames[id] : "?";
+}
+
+bool ProfPack(PROF_ID id, uint8_t buff[], uint8_t size)
+{
+    sProfStats stats;
+
+    if(buff == NULL || size < PROF_PACKED_SIZE || !ProfGet(id, &stats))
+    {
+        return false;
+    }
+
+    _put32(&buff[0], stats.count);
+    _put32(&buff[4], stats.min);
+    _put32(&buff[8], stats.max);
+    _put32(&buff[12], stats.mean);
+    _put32(&buff[16], stats.p50);
+    _put32(&buff[20], stats.p90);
+    _put32(&buff[24], stats.p99);
+    _put32(&buff[28], stats.ticksPerUs);
+
+    return true;
+}
+
+bool ProfUnpack(const uint8_t buff[], uint8_t len, sProfStats *stats)
+{
+    if(buff == NULL || stats == NULL || len < PROF_PACKED_SIZE)
+    {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = _get32(&buff[0]);
+    stats->min = _get32(&buff[4]);
+    stats->max = _get32(&buff[8]);
+    stats->mean = _get32(&buff[12]);
+    stats->p50 = _get32(&buff[16]);
+    stats->p90 = _get32(&buff[20]);
+    stats->p99 = _get32(&buff[24]);
+    stats->ticksPerUs = _get32(&buff[28]);
+
+    return true;
+}
@@ -0,0 +1,112 @@
+#ifndef __PROF_H
+#define __PROF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+    Scoped code profiling on the DWT cycle counter.
+
+    PROF_SCOPE(id) times from its own line to the end of the enclosing block,
+    every return included. PROF_BEGIN(id) and PROF_END(id) time a region
+    inside one block. Each probe keeps count, min, max, total and a histogram
+    with one bucket per power of two ticks in a static table, updated with
+    interrupts disabled, so a probe may be hit from threads and ISRs alike.
+
+    Probes only exist with -DMANTICORE_PROFILING=ON. Otherwise the macros
+    compile to nothing and every probe reads as never hit.
+
+    A tick is a core clock cycle on target. The ThreadX Linux port uses
+    nanoseconds from clock_gettime, so both wrap after 2^32 ticks. ProfTicksPerUs
+    converts either.
+
+    Results are read with the "prof" console command, from another module
+    with "prof dev" through the MCAN_RPC_METHOD_PROF method, or with ProfGet.
+***********************************************************************************/
+
+#define PROF_HIST_BUCKETS       32      // Bucket b holds [2^(b-1), 2^b) ticks, the last one everything above
+#define PROF_PACKED_SIZE        32      // ProfPack output, fits one MCAN RPC reply
+
+// One entry per probe site, add new probes here and to the names in prof.c
+typedef enum
+{
+    PROF_MCAN_RX_ISR,                   // FDCAN RX FIFO0 callback
+    PROF_CONSOLE_PRINT,                 // ConsolePrint, mutex wait and UART included
+    PROF_BNO055_READ,                   // Blocking BNO055 register read
+    PROF_BNO055_BURST,                  // Wait for a queued BNO055 burst read
+    PROF_ID_COUNT,
+} PROF_ID;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;                       // Ticks
+    uint32_t max;
+    uint32_t mean;
+    uint32_t p50;                       // Percentiles are bucket upper bounds
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t ticksPerUs;                // Of the device that took the samples
+    uint32_t hist[PROF_HIST_BUCKETS];   // Local probes only, ProfUnpack leaves it zeroed
+} sProfStats;
+
+#if defined(MANTICORE_PROFILING)
+
+#if defined(__linux__)
+#include <time.h>
+
+static inline uint32_t ProfNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) (((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec);
+}
+#else
+#include "stm32h5xx.h"
+
+// Started at reset by the startup code
+static inline uint32_t ProfNow(void)
+{
+    return DWT->CYCCNT;
+}
+#endif
+
+typedef struct
+{
+    PROF_ID id;
+    uint32_t start;
+} sProfScope;
+
+void ProfRecord(PROF_ID id, uint32_t start);
+void ProfScopeEnd(const sProfScope *scope);
+
+#define PROF_CONCAT_(a, b)      a##b
+#define PROF_CONCAT(a, b)       PROF_CONCAT_(a, b)
+
+#define PROF_SCOPE(id) \
+    sProfScope PROF_CONCAT(_profScope, __LINE__) __attribute__((cleanup(ProfScopeEnd))) = { (id), ProfNow() }
+#define PROF_BEGIN(id)          const uint32_t PROF_CONCAT(_profStart, id) = ProfNow()
+#define PROF_END(id)            ProfRecord((id), PROF_CONCAT(_profStart, id))
+
+#else
+
+#define PROF_SCOPE(id)
+#define PROF_BEGIN(id)
+#define PROF_END(id)
+
+#endif
+
+// Resets every probe, safe to call at any time
+void ProfInit(void);
+void ProfReset(void);
+
+bool ProfGet(PROF_ID id, sProfStats *stats);
+uint32_t ProfTicksPerUs(void);
+const char *ProfName(PROF_ID id);
+
+// Summary without the histogram, little endian, for MCAN. Both return false on a bad id or size.
+bool ProfPack(PROF_ID id, uint8_t buff[], uint8_t size);
+bool ProfUnpack(const uint8_t buff[], uint8_t len, sProfStats *stats);
+
+#endif /* __PROF_H */
@@ -0,0 +1,325 @@
+#include "pwm_group.h"
+#include <stddef.h>
+#include <string.h>
+
+//Local Scope Variables
+static PWM_Group_t* pwmGroups[PWM_GROUP_MAX];
+static uint8_t pwmGroupCount = 0;
+
+//Local Scope Function
+static int8_t PWM_Group_Channel_Index(uint32_t channel){
+    switch(channel){
+        case TIM_CHANNEL_1: return 0;
+        case TIM_CHANNEL_2: return 1;
+        case TIM_CHANNEL_3: return 2;
+        case TIM_CHANNEL_4: return 3;
+        default:            return -1;
+    }
+}
+
+static PWM_Group_t* PWM_Group_Find(const DMA_HandleTypeDef* hdma){
+
+    for(uint8_t i = 0; i < pwmGroupCount; i++){
+        if(pwmGroups[i]->htim->hdma[TIM_DMA_ID_UPDATE] == hdma)
+            return pwmGroups[i];
+    }
+
+    return NULL;
+}
+
+static void PWM_Group_DMA_Cplt(DMA_HandleTypeDef* hdma);
+static void PWM_Group_DMA_Error(DMA_HandleTypeDef* hdma);
+
+//Copy the last frame of the stream into staged and next for the channels it drove
+static void PWM_Group_Stream_Finish(PWM_Group_t* group){
+
+    const uint32_t* last = &group->stream[(group->streamFrames - 1U) * group->channelCount];
+
+    for(uint8_t i = 0; i < group->channelCount; i++){
+        if(group->streamMask & (1U << i)){
+            group->staged[i] = last[i];
+            group->next[i] = last[i];
+        }
+    }
+}
+
+//Arm words from source as bursts from the next update on, the DMA is idle
+static HAL_StatusTypeDef PWM_Group_Arm(PWM_Group_t* group, const uint32_t* source, uint32_t words){
+
+    TIM_TypeDef* tim = group->htim->Instance;
+    DMA_HandleTypeDef* hdma = group->htim->hdma[TIM_DMA_ID_UPDATE];
+
+    hdma->XferCpltCallback = PWM_Group_DMA_Cplt;
+    hdma->XferHalfCpltCallback = NULL;
+    hdma->XferErrorCallback = PWM_Group_DMA_Error;
+
+    /* Burst from CCR1 on the update request, GPDMA counts bytes */
+    tim->DCR = TIM_DMABASE_CCR1 | ((uint32_t)(group->channelCount - 1U) << TIM_DCR_DBL_Pos) | TIM_DCR_DBSS_0;
+    if(HAL_DMA_Start_IT(hdma, (uint32_t)source, (uint32_t)&tim->DMAR, words * sizeof(uint32_t)) != HAL_OK)
+        return HAL_ERROR;
+
+    group->armed = true;
+    tim->DIER |= TIM_DIER_UDE;
+    return HAL_OK;
+}
+
+//Burst written, send the commit that queued up behind it
+static void PWM_Group_DMA_Cplt(DMA_HandleTypeDef* hdma){
+
+    PWM_Group_t* group = PWM_Group_Find(hdma);
+
+    if(group == NULL)
+        return;
+
+    group->htim->Instance->DIER &= ~TIM_DIER_UDE;
+    group->armed = false;
+    group->commits++;
+
+    /* The streamed channels hold their last frame, also in a commit queued during the stream */
+    if(group->streaming){
+        group->streaming = false;
+        PWM_Group_Stream_Finish(group);
+    }
+
+    if(group->queued){
+        group->queued = false;
+        memcpy(group->burst, group->next, sizeof(group->burst));
+        if(PWM_Group_Arm(group, group->burst, group->channelCount) != HAL_OK)
+            group->dmaErrors++;
+    }
+}
+
+static void PWM_Group_DMA_Error(DMA_HandleTypeDef* hdma){
+
+    PWM_Group_t* group = PWM_Group_Find(hdma);
+
+    if(group == NULL)
+        return;
+
+    group->htim->Instance->DIER &= ~TIM_DIER_UDE;
+    group->armed = false;
+    group->queued = false;
+    group->streaming = false;
+    group->dmaErrors++;
+}
+
+//PWM Group Functions
+PWM_Group_Error PWM_Group_Init(PWM_Group_t* group, TIM_HandleTypeDef* htim){
+
+    uint8_t slot;
+
+    /* Assert Params */
+    if(group == NULL || htim == NULL)
+        return PWM_GROUP_INSTANCE_ERROR;
+    else if(htim->hdma[TIM_DMA_ID_UPDATE] == NULL)
+        return PWM_GROUP_DMA_ERROR;
+
+    /* Register with the DMA callbacks, once per group */
+    for(slot = 0; slot < pwmGroupCount; slot++){
+        if(pwmGroups[slot] == group)
+            break;
+    }
+    if(slot == pwmGroupCount){
+        if(pwmGroupCount >= PWM_GROUP_MAX)
+            return PWM_GROUP_INSTANCE_ERROR;
+        pwmGroups[pwmGroupCount++] = group;
+    }
+
+    /* Start from the compare values the timer has now */
+    group->htim = htim;
+    group->staged[0] = htim->Instance->CCR1;
+    group->staged[1] = htim->Instance->CCR2;
+    group->staged[2] = htim->Instance->CCR3;
+    group->staged[3] = htim->Instance->CCR4;
+    group->channelCount = 0;
+    group->holdDepth = 0;
+    group->held = false;
+    group->armed = false;
+    group->queued = false;
+    group->streaming = false;
+    group->stream = NULL;
+    group->streamFrames = 0;
+    group->streamMask = 0;
+    group->commits = 0;
+    group->merged = 0;
+    group->dmaErrors = 0;
+
+    return PWM_GROUP_OK;
+}
+
+PWM_Group_Error PWM_Group_Add_Channel(PWM_Group_t* group, uint32_t channel){
+
+    int8_t index = PWM_Group_Channel_Index(channel);
+
+    if(group == NULL || group->htim == NULL)
+        return PWM_GROUP_INSTANCE_ERROR;
+    else if(index < 0)
+        return PWM_GROUP_CHANNEL_ERROR;
+
+    if(index + 1 > group->channelCount)
+        group->channelCount = index + 1;
+
+    /* The driver may have set the compare directly before it joined */
+    group->staged[index] = __HAL_TIM_GET_COMPARE(group->htim, channel);
+
+    return PWM_GROUP_OK;
+}
+
+PWM_Group_Error PWM_Group_Stage(PWM_Group_t* group, uint32_t channel, uint32_t compare){
+
+    int8_t index = PWM_Group_Channel_Index(channel);
+
+    if(group == NULL || group->htim == NULL)
+        return PWM_GROUP_INSTANCE_ERROR;
+    else if(index < 0 || index >= group->channelCount)
+        return PWM_GROUP_CHANNEL_ERROR;
+
+    group->staged[index] = compare;
+
+    return PWM_GROUP_OK;
+}
+
+PWM_Group_Error PWM_Group_Commit(PWM_Group_t* group){
+
+    uint32_t primask;
+    PWM_Group_Error error = PWM_GROUP_OK;
+
+    if(group == NULL || group->htim == NULL)
+        return PWM_GROUP_INSTANCE_ERROR;
+    else if(group->channelCount == 0)
+        return PWM_GROUP_CHANNEL_ERROR;
+
+    if(group->holdDepth != 0){
+        group->held = true;
+        return PWM_GROUP_OK;
+    }
+
+    /* The DMA never reads a buffer that is being written. An armed burst keeps its values
+       and this commit waits in next for the burst after it */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if(group->armed){
+        if(group->queued)
+            group->merged++;
+        memcpy(group->next, group->staged, sizeof(group->next));
+        group->queued = true;
+    }
+    else{
+        memcpy(group->burst, group->staged, sizeof(group->burst));
+        if(PWM_Group_Arm(group, group->burst, group->channelCount) != HAL_OK){
+            group->dmaErrors++;
+            error = PWM_GROUP_DMA_ERROR;
+        }
+    }
+    __set_PRIMASK(primask);
+
+    return error;
+}
+
+void PWM_Group_Begin(PWM_Group_t* group){
+    if(group != NULL)
+        group->holdDepth++;
+}
+
+PWM_Group_Error PWM_Group_End(PWM_Group_t* group){
+
+    if(group == NULL || group->holdDepth == 0)
+        return PWM_GROUP_INSTANCE_ERROR;
+
+    if(--group->holdDepth != 0 || !group->held)
+        return PWM_GROUP_OK;
+
+    group->held = false;
+    return PWM_Group_Commit(group);
+}
+
+PWM_Group_Error PWM_Group_Stream(PWM_Group_t* group, const uint32_t* frames, uint32_t frameCount, uint8_t channelMask){
+
+    uint32_t primask;
+    PWM_Group_Error error = PWM_GROUP_OK;
+
+    if(group == NULL || group->htim == NULL || frames == NULL)
+        return PWM_GROUP_INSTANCE_ERROR;
+    else if(group->channelCount == 0 || (channelMask >> group->channelCount) != 0)
+        return PWM_GROUP_CHANNEL_ERROR;
+    else if(frameCount == 0 || frameCount > PWM_GROUP_STREAM_MAX_BYTES / (group->channelCount * sizeof(uint32_t)))
+        return PWM_GROUP_LENGTH_ERROR;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if(group->armed){
+        error = PWM_GROUP_BUSY;
+    }
+    else{
+        group->stream = frames;
+        group->streamFrames = frameCount;
+        group->streamMask = channelMask;
+        group->streaming = true;
+        if(PWM_Group_Arm(group, frames, frameCount * group->channelCount) != HAL_OK){
+            group->streaming = false;
+            group->dmaErrors++;
+            error = PWM_GROUP_DMA_ERROR;
+        }
+    }
+    __set_PRIMASK(primask);
+
+    return error;
+}
+
+bool PWM_Group_Streaming(const PWM_Group_t* group){
+    return group != NULL && group->streaming;
+}
+
+void PWM_Group_Stream_Cancel(PWM_Group_t* group){
+
+    uint32_t primask;
+
+    if(group == NULL || group->htim == NULL)
+        return;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if(group->streaming){
+        group->htim->Instance->DIER &= ~TIM_DIER_UDE;
+        HAL_DMA_Abort(group->htim->hdma[TIM_DMA_ID_UPDATE]);
+        group->armed = false;
+        group->streaming = false;
+
+        if(group->queued){
+            group->queued = false;
+            memcpy(group->burst, group->next, sizeof(group->burst));
+            if(PWM_Group_Arm(group, group->burst, group->channelCount) != HAL_OK)
+                group->dmaErrors++;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+PWM_Group_Error PWM_Set_Compare(PWM_Group_t* group, TIM_HandleTypeDef* htim, uint32_t channel, uint32_t compare){
+
+    PWM_Group_Error error;
+
+    /* No group, the preload register takes it at the next update */
+    if(group == NULL){
+        __HAL_TIM_SET_COMPARE(htim, channel, compare);
+        return PWM_GROUP_OK;
+    }
+
+    error = PWM_Group_Stage(group, channel, compare);
+    if(error != PWM_GROUP_OK)
+        return error;
+
+    return PWM_Group_Commit(group);
+}
+
+HAL_StatusTypeDef PWM_Start_Channel(TIM_HandleTypeDef* htim, uint32_t channel){
+
+    bool running = (htim->Instance->CR1 & TIM_CR1_CEN) != 0U;
+    HAL_StatusTypeDef error = HAL_TIM_PWM_Start(htim, channel);
+
+    /* Sync the counter and load the compare values of a timer that was not counting yet */
+    if(error == HAL_OK && !running)
+        error = HAL_TIM_GenerateEvent(htim, TIM_EventSource_Update);
+
+    return error;
+}
@@ -0,0 +1,87 @@
+#ifndef __PWM_GROUP_H
+#define __PWM_GROUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32h5xx_hal.h"
+
+/*
+ *  PWM Group
+ *
+ *  Stages the compare values of every channel of one timer and commits them in a single
+ *  DMA burst to TIMx_DMAR on the next update event. The burst writes the CCR preload
+ *  registers right after that update, so all channels switch together on the update after
+ *  it and never mid period. No update event is forced, the PWM period is never cut short.
+ *
+ *  The BSP links a GPDMA channel to hdma[TIM_DMA_ID_UPDATE] of the timer: update request,
+ *  memory to peripheral, word transfers, source increment, normal mode. The group owns
+ *  CCR1 up to its highest channel, do not write those CCRs directly while it is in use.
+ *
+ *  A stream is the same burst over many frames, one frame of channelCount words per update,
+ *  so a precomputed trajectory plays out at the PWM rate with no CPU work. One GPDMA block
+ *  carries at most PWM_GROUP_STREAM_MAX_BYTES. Commits during a stream queue behind it, and
+ *  the channels in the stream mask finish on the last frame's values.
+ */
+
+/* List of Macros */
+#define PWM_GROUP_CHANNELS  (4U)            //CCR1 to CCR4
+#define PWM_GROUP_MAX       (4U)            //Groups sharing the DMA callbacks
+#define PWM_GROUP_STREAM_MAX_BYTES  (0xFFFFU)   //GPDMA block size field
+
+//PWM Group Error Enum
+typedef enum{
+    PWM_GROUP_OK            = 0x00U,
+    PWM_GROUP_INSTANCE_ERROR = 0x01U,
+    PWM_GROUP_CHANNEL_ERROR = 0x02U,
+    PWM_GROUP_DMA_ERROR     = 0x03U,
+    PWM_GROUP_BUSY          = 0x04U,
+    PWM_GROUP_LENGTH_ERROR  = 0x05U
+} PWM_Group_Error;
+
+//PWM Group Struct
+typedef struct{
+	TIM_HandleTypeDef*	htim;
+
+	/* These will be set in the INIT function and by the group functions */
+	uint32_t			staged[PWM_GROUP_CHANNELS];		//Written by the drivers
+	uint32_t			next[PWM_GROUP_CHANNELS];		//Committed while a burst was armed
+	uint32_t			burst[PWM_GROUP_CHANNELS];		//DMA source, only written while the DMA is idle
+	uint8_t				channelCount;		//Burst length, CCR1 up to the highest channel added
+	uint8_t				holdDepth;			//Begin/End nesting, commits wait for the outermost End
+	bool				held;				//A commit arrived while held
+	volatile bool		armed;				//Burst waits for the update event
+	volatile bool		queued;				//next holds a commit for the burst after the armed one
+	volatile bool		streaming;			//The armed transfer is a stream
+	const uint32_t*		stream;				//Frames of the running stream
+	uint32_t			streamFrames;
+	uint8_t				streamMask;			//Channels the stream drives, bit 0 is channel 1
+	uint32_t			commits;			//Bursts completed
+	uint32_t			merged;				//Commits that replaced a queued one before it went out
+	uint32_t			dmaErrors;
+} PWM_Group_t;
+
+//PWM Group Functions
+//Captures the current compare values, the timer runs with auto-reload and compare preload
+PWM_Group_Error PWM_Group_Init(PWM_Group_t* group, TIM_HandleTypeDef* htim);
+PWM_Group_Error PWM_Group_Add_Channel(PWM_Group_t* group, uint32_t channel);
+PWM_Group_Error PWM_Group_Stage(PWM_Group_t* group, uint32_t channel, uint32_t compare);
+//Publishes every staged value at the next update, or the one after if a burst is still armed
+PWM_Group_Error PWM_Group_Commit(PWM_Group_t* group);
+//Commits between Begin and End become one burst at End, for updates across several drivers
+void PWM_Group_Begin(PWM_Group_t* group);
+PWM_Group_Error PWM_Group_End(PWM_Group_t* group);
+
+//Plays frameCount frames of channelCount compare values, one per update. frames must stay
+//valid until the stream ends. BUSY while a burst or stream is armed
+PWM_Group_Error PWM_Group_Stream(PWM_Group_t* group, const uint32_t* frames, uint32_t frameCount, uint8_t channelMask);
+bool PWM_Group_Streaming(const PWM_Group_t* group);
+//Stops a running stream. Staged values stay as they were before it, a queued commit goes out next
+void PWM_Group_Stream_Cancel(PWM_Group_t* group);
+
+//Compare write for drivers, staged and committed through the group if there is one
+PWM_Group_Error PWM_Set_Compare(PWM_Group_t* group, TIM_HandleTypeDef* htim, uint32_t channel, uint32_t compare);
+//Starts a channel. Only a stopped timer gets an update event to load its preloads, a timer already
+//running other channels keeps its period and an armed burst waits for its natural update
+HAL_StatusTypeDef PWM_Start_Channel(TIM_HandleTypeDef* htim, uint32_t channel);
+
+#endif
@@ -6,60 +6,75 @@
 #define MAX_CLOCKWISE_SPEED_PERCENTAGE  (0.064f)
 #define ONE_POINT_FIVE_MS_PERCENTAGE    (0.075f)
 #define MAX_COUNTER_SPEED_PERCENTAGE    (0.086f)
-#define SAMPLE_CNT                      (15U)
+#define SAMPLES_PER_STEP                (CONT_SERVO_RING_LEN / 2U)
 #define PID_Kp                          (0.025f)      
-#define PID_Ki                          (0.00025f)
-#define INTEGRAL_CAP                    (200.0)
+#define PID_Ki                          (0.00025f)    //Per feedback period
+#define INTEGRAL_CAP                    (200.0f)
 #define SERVO_SPEED_OFFSET              (30.0)
 #define ANGLE_THRESHOLD                 (2)
 #define SPEED_OFFSET                    (30.0)
 #define SERVO_MIN_TIM_US                (0)
 #define SERVO_MAX_TIM_US                (20000)
+#define PULSE_FRAC_BITS                 (4)           //Sub microsecond bits of the drive pulse
 #define ERROR_THRESHOLD                 (1.2)
 #define STEADY_STATE_CNT_THRES          (1000)
 #define INITIAL_ANGLE_OFFSET            (8)
-#define INTEGRAL_RESET_THRESHOLD        (1000)
-
-//Local Scope Typedef
-typedef enum{
-    CAPTURE_FREQUENCY,
-    CAPTURE_DUTY
-} FEEDBACK_CAPTURE;
-
-typedef enum{
-    CAPTURE_INITIAL_RISING,
-    CAPTURE_FALLING,
-    CAPTURE_NEXT_RISING,
-    CALCULATE
-} CAPTURE_STATE;
 
 //Local Scope Variables
-static char servoFreqError      = 0;
-static char actFreqError        = 0;
-static uint16_t freqCnt = 0;
-static float currAngle = 0;
-static float currDuty = 0;
-static volatile FEEDBACK_CAPTURE feedbackCap = CAPTURE_FREQUENCY;
-static volatile CAPTURE_STATE captureState   = CAPTURE_INITIAL_RISING;
-static volatile uint16_t initialRiseCnt = 0;
-static volatile uint16_t fallingCnt     = 0;
-static volatile uint16_t nextRiseCnt    = 0;
-static volatile bool captureComplete = false; 
-static uint16_t stopCnt = 0;
-static uint16_t clockwiseSpeedCnt = 0;
-static uint16_t counterClockwiseSpeedCnt = 0;
+static CONT_Servo_Instance_t* contServos[CONT_SERVO_MAX];
+static uint8_t contServoCount = 0;
 
 //Local Scope Function
-static void Change_IC_IT_Edge(TIM_HandleTypeDef* tim, const uint8_t channel, uint32_t polarity){
+//Channel paired with the period channel, captures the falling edge of the same input
+static uint32_t CONT_Servo_Duty_Channel(const CONT_Servo_Instance_t* contServo){
+    return (contServo->ICTimerChannel == TIM_CHANNEL_1) ? TIM_CHANNEL_2 : TIM_CHANNEL_1;
+}
+
+//PWM-input mode, every rising edge latches the period and resets the counter, the falling edge latches the high time
+static HAL_StatusTypeDef CONT_Servo_Config_PWM_Input(CONT_Servo_Instance_t* contServo){
     TIM_IC_InitTypeDef sConfigIC = {0};
+    TIM_SlaveConfigTypeDef sSlaveConfig = {0};
 
-    sConfigIC.ICPolarity = polarity;
+    sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_RISING;
     sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
     sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
     sConfigIC.ICFilter = 0;
-    if (HAL_TIM_IC_ConfigChannel(tim, &sConfigIC, channel) != HAL_OK)
-    {
-        while(1);
+    if(HAL_TIM_IC_ConfigChannel(contServo->ICTimer, &sConfigIC, contServo->ICTimerChannel) != HAL_OK)
+        return HAL_ERROR;
+
+    sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_FALLING;
+    sConfigIC.ICSelection = TIM_ICSELECTION_INDIRECTTI;
+    if(HAL_TIM_IC_ConfigChannel(contServo->ICTimer, &sConfigIC, CONT_Servo_Duty_Channel(contServo)) != HAL_OK)
+        return HAL_ERROR;
+
+    sSlaveConfig.SlaveMode = TIM_SLAVEMODE_RESET;
+    sSlaveConfig.InputTrigger = (contServo->ICTimerChannel == TIM_CHANNEL_1) ? TIM_TS_TI1FP1 : TIM_TS_TI2FP2;
+    sSlaveConfig.TriggerPolarity = TIM_TRIGGERPOLARITY_RISING;
+    sSlaveConfig.TriggerPrescaler = TIM_TRIGGERPRESCALER_DIV1;
+    sSlaveConfig.TriggerFilter = 0;
+    return HAL_TIM_SlaveConfigSynchro(contServo->ICTimer, &sSlaveConfig);
+}
+
+static void CONT_Servo_Capture_Stop(CONT_Servo_Instance_t* contServo){
+    HAL_TIM_DMABurst_ReadStop(contServo->ICTimer, (contServo->ICTimerChannel == TIM_CHANNEL_1) ? TIM_DMA_CC1 : TIM_DMA_CC2);
+    HAL_TIM_IC_Stop(contServo->ICTimer, CONT_Servo_Duty_Channel(contServo));
+    HAL_TIM_IC_Stop(contServo->ICTimer, contServo->ICTimerChannel);
+}
+
+static void CONT_Servo_Set_Status(CONT_Servo_Instance_t* contServo, CSERVO_STATUS status){
+    contServo->status = status;
+    if(contServo->statusCallback != NULL)
+        contServo->statusCallback(contServo, status);
+}
+
+//HAL reports the channel that fired as a HAL_TIM_ACTIVE_CHANNEL_x bit
+static HAL_TIM_ActiveChannel CONT_Servo_Active_Channel(uint8_t channel){
+    switch(channel){
+        case TIM_CHANNEL_1: return HAL_TIM_ACTIVE_CHANNEL_1;
+        case TIM_CHANNEL_2: return HAL_TIM_ACTIVE_CHANNEL_2;
+        case TIM_CHANNEL_3: return HAL_TIM_ACTIVE_CHANNEL_3;
+        case TIM_CHANNEL_4: return HAL_TIM_ACTIVE_CHANNEL_4;
+        default:            return HAL_TIM_ACTIVE_CHANNEL_CLEARED;
     }
 }
 
@@ -81,18 +96,21 @@ Servo_Error Servo_Init(Servo_Instance_t* servo){
         timFreq = Get_Freq(HAL_RCC_GetSysClockFreq(), servo->htim->Init.Prescaler, __HAL_TIM_GET_AUTORELOAD(servo->htim));
     #endif
 
-	if(timFreq != DESIRED_SERVO_FREQ){
-		servoFreqError = 1;
+	servo->ready = false;
+	if(timFreq != DESIRED_SERVO_FREQ)
 		return SERVO_FREQ_ERROR;
-	}
 
 	/* Configure Min and Max count based on duty cycle given */
 	servo->minCnt = servo->config->minDuty * __HAL_TIM_GET_AUTORELOAD(servo->htim);
 	servo->maxCnt = servo->config->maxDuty * __HAL_TIM_GET_AUTORELOAD(servo->htim);
+	if(!FixLinearInit(&servo->angleMap, servo->config->minAngle, servo->config->maxAngle, servo->minCnt, servo->maxCnt))
+		return SERVO_INSTANCE_ERROR;
 
     /* Start PWM Signal */
-    HAL_TIM_PWM_Start(servo->htim, servo->channel);
-    HAL_TIM_GenerateEvent(servo->htim, TIM_EventSource_Update);     //Sync Counter
+    if(servo->group != NULL && PWM_Group_Add_Channel(servo->group, servo->channel) != PWM_GROUP_OK)
+        return SERVO_INSTANCE_ERROR;
+    PWM_Start_Channel(servo->htim, servo->channel);
+    servo->ready = true;
 
 	/* Zero Out SERVO */
 	Drive_Servo(servo, 0);
@@ -102,21 +120,21 @@ Servo_Error Servo_Init(Servo_Instance_t* servo){
 
 Servo_Error Drive_Servo(const Servo_Instance_t* servo, const int8_t angle){
 
-    /* Servo Protection */
-	if(servoFreqError)
-		return SERVO_FREQ_ERROR;
-
 	/* Asserting Params */
 	if(servo == NULL)
 		return SERVO_INSTANCE_ERROR;
+
+    /* Servo Protection */
+	if(!servo->ready)
+		return SERVO_FREQ_ERROR;
 	else if(angle < servo->config->minAngle)
 		return SERVO_RANGE_ERROR_MIN;
 	else if(angle > servo->config->maxAngle)
 		return SERVO_RANGE_ERROR_MAX;
 
-	/* Set New Compare Value */
-	__HAL_TIM_SET_COMPARE(servo->htim, servo->channel, map(angle, servo->config->minAngle, servo->config->maxAngle, servo->minCnt, servo->maxCnt));
-    HAL_TIM_GenerateEvent(servo->htim, TIM_EventSource_Update);
+	/* Set New Compare Value, taken at the next update without cutting the period short */
+	if(PWM_Set_Compare(servo->group, servo->htim, servo->channel, FixLinearApply(&servo->angleMap, angle)) != PWM_GROUP_OK)
+		return SERVO_INSTANCE_ERROR;
 
     return SERVO_OK;
 }
@@ -142,10 +160,9 @@ Actuator_Error Actuator_Init(Actuator_Instance_t* act){
     #endif
 
     /* Check if timer gives desired frequency */
-    if(timFreq != DESIRED_ACT_FREQ){
-        actFreqError = 1;
+    act->Ready = false;
+    if(timFreq != DESIRED_ACT_FREQ)
         return ACTUATOR_FREQ_ERROR;
-    }
 
     /* Configure Min and Max counter based on user config */
 
@@ -156,11 +173,15 @@ Actuator_Error Actuator_Init(Actuator_Instance_t* act){
     //Save Min and Max Counter for Desired Min and Max Length
     act->Min_Cnt = map(act->config->Desired_Min_Length, act->config->Min_Length, act->config->Max_Length, min_cnt, max_cnt);
     act->Max_Cnt = map(act->config->Desired_Max_Length, act->config->Min_Length, act->config->Max_Length, min_cnt, max_cnt);
+    if(!FixLinearInit(&act->Length_Map, act->config->Desired_Min_Length, act->config->Desired_Max_Length, act->Min_Cnt, act->Max_Cnt))
+        return ACTUATOR_INSTANCE_ERROR;
 
     /* Start Actuator PWM Signal */
     __HAL_TIM_SET_COMPARE(act->Act_Timer, act->Channel, act->Min_Cnt);
-    HAL_TIM_PWM_Start(act->Act_Timer, act->Channel);
-    HAL_TIM_GenerateEvent(act->Act_Timer, TIM_EventSource_Update);      //Sync Coutner
+    if(act->Group != NULL && PWM_Group_Add_Channel(act->Group, act->Channel) != PWM_GROUP_OK)
+        return ACTUATOR_INSTANCE_ERROR;
+    PWM_Start_Channel(act->Act_Timer, act->Channel);
+    act->Ready = true;
 
     return ACTUATOR_OK;
 }
@@ -172,290 +193,329 @@ Actuator_Error Drive_Actuator(const Actuator_Instance_t* act, const uint8_t leng
         return ACTUATOR_INSTANCE_ERROR;
     else if(act->config == NULL)
         return ACTUATOR_INSTANCE_ERROR;
+    else if(!act->Ready)
+        return ACTUATOR_FREQ_ERROR;
     else if(length < act->config->Desired_Min_Length)
         return ACTUATOR_UNDER_RANGE;
     else if(length > act->config->Desired_Max_Length)
         return ACTUATOR_ABOVE_RANGE;
 
     /* Map length to counter value range */
-    uint16_t mappedLength = map(length, act->config->Desired_Min_Length, act->config->Desired_Max_Length, act->Min_Cnt, act->Max_Cnt);
+    uint16_t mappedLength = FixLinearApply(&act->Length_Map, length);
     
-    /* Set New PWM Compare Value */
-    __HAL_TIM_SET_COMPARE(act->Act_Timer, act->Channel, mappedLength);
-
-    HAL_TIM_GenerateEvent(act->Act_Timer, TIM_EventSource_Update);      //Sync Counter
+    /* Set New PWM Compare Value, taken at the next update without cutting the period short */
+    if(PWM_Set_Compare(act->Group, act->Act_Timer, act->Channel, mappedLength) != PWM_GROUP_OK)
+        return ACTUATOR_INSTANCE_ERROR;
 
     return ACTUATOR_OK;
 }
 
-Servo_Error CONT_Servo_Init(CONT_Servo_Instance_t* contServo){
+//Feedback angle from the captures of one half ring, averaged over the half
+static bool CONT_Servo_Feedback_Angle(CONT_Servo_Instance_t* contServo, const CONT_Servo_Capture_t* captures, float* angle){
 
-    /* Temp Variables */
-    static uint32_t contTimerFreq = 0;
-    static uint32_t counterTimerFreq = 0;
-    uint32_t differenceSum = 0;
+    uint32_t periodSum = 0;
+    uint32_t highSum = 0;
+    bool periodOnCh1 = (contServo->ICTimerChannel == TIM_CHANNEL_1);
 
-    /* Assert Parameters */
-    if(contServo == NULL)
-        return SERVO_INSTANCE_ERROR;
-    else if(contServo->contServoConfig == NULL)
-        return SERVO_INSTANCE_ERROR;
+    for(uint8_t i = 0; i < SAMPLES_PER_STEP; i++){
+        periodSum += periodOnCh1 ? captures[i].ccr1 : captures[i].ccr2;
+        highSum += periodOnCh1 ? captures[i].ccr2 : captures[i].ccr1;
+    }
 
-    /* Check if Continuous Servo Timer is setup to be 50Hz PWM */
-    contTimerFreq = Get_Freq(HAL_RCC_GetSysClockFreq(), contServo->contServoTimer->Init.Prescaler, __HAL_TIM_GET_AUTORELOAD(contServo->contServoTimer));
-    if(contTimerFreq != DESIRED_SERVO_FREQ)
-        return SERVO_FREQ_ERROR;
+    // No edges yet, the ring still holds the cleared captures
+    if(periodSum == 0)
+        return false;
 
-    /* Set Servo Motor speed to Stop mode */
+    contServo->periodCnt = periodSum / SAMPLES_PER_STEP;
+    *angle = map(highSum / (float)periodSum, contServo->contServoConfig->feedbackMinDuty, contServo->contServoConfig->feedbackMaxDuty, 0, 360);
+    return true;
+}
 
-    //Find Counter value for 1.5ms
-    stopCnt = __HAL_TIM_GET_AUTORELOAD(contServo->contServoTimer) * ONE_POINT_FIVE_MS_PERCENTAGE;
-    clockwiseSpeedCnt = __HAL_TIM_GET_AUTORELOAD(contServo->contServoTimer) * MAX_CLOCKWISE_SPEED_PERCENTAGE;
-    counterClockwiseSpeedCnt = __HAL_TIM_GET_AUTORELOAD(contServo->contServoTimer) * MAX_COUNTER_SPEED_PERCENTAGE;
+//Start a move to an absolute target, the loop state starts over
+static void CONT_Servo_Start_Move(CONT_Servo_Instance_t* contServo, float targetAngle){
 
-    //Set Continuous Servo Motor Timer compare counter to 1.5ms
-    __HAL_TIM_SET_COMPARE(contServo->contServoTimer, contServo->contServoChannel, stopCnt);
+    contServo->targetAngle = targetAngle;
+    PidReset(&contServo->pid);
+    contServo->steadyStateCnt = 0;
+    CONT_Servo_Set_Status(contServo, CSERVO_MOVING);
+}
+
+//Relative request to an absolute target, wrapped to 0 - 360
+static float CONT_Servo_Relative_Target(float currAngle, int16_t angle, CSERVO_DIR dir){
 
-    //Start Continuous Servo Motor PWM Timer
-    HAL_TIM_PWM_Start(contServo->contServoTimer, contServo->contServoChannel);
+    float targetAngle = currAngle;
+
+    if(dir == SERVO_CLOCKWISE){
+        targetAngle = currAngle - angle;
+        if(targetAngle < 0){
+            targetAngle = 360 + targetAngle;
+        }
+    }
+    else if(dir == SERVO_COUNTERCLOCKWISE){
+        targetAngle = currAngle + angle;
+        if(targetAngle > 360){
+            targetAngle = targetAngle - 360;
+        }
+    }
 
-    //Generate Update event to sync timer
-    HAL_TIM_GenerateEvent(contServo->contServoTimer, TIM_EventSource_Update);
+    return targetAngle;
+}
 
-    /* Counter Timer Init and Calibration */
+//One PID step per half ring, runs in the DMA transfer interrupt. The settle count is
+//scaled by SAMPLES_PER_STEP so the loop keeps its per-period time constants
+static void CONT_Servo_Control_Step(CONT_Servo_Instance_t* contServo, float detectedAngle){
 
-    //Check if Counter Timer does not count slower than feedback signal 
-    counterTimerFreq = HAL_RCC_GetSysClockFreq() / (contServo->ICTimer->Init.Prescaler + 1);
-    if(counterTimerFreq < contServo->contServoConfig->feedbackFreq)
-        return SERVO_FREQ_ERROR;
+    float error = 0.0;
+    float output = 0.0;
+    float offset = 0.0;
 
-    //Start Counter TimerstopCounter
-    feedbackCap = CAPTURE_FREQUENCY;
-    Change_IC_IT_Edge(contServo->ICTimer, contServo->ICTimerChannel, TIM_INPUTCHANNELPOLARITY_RISING);
-    HAL_TIM_IC_Start_IT(contServo->ICTimer, contServo->ICTimerChannel);
-    HAL_TIM_GenerateEvent(contServo->ICTimer, TIM_EventSource_Update);
+    contServo->currAngle = detectedAngle;
 
-    //Validate and Calibrate Actual Real-Time Feedback Signal
-    
-    //Grab Feedback Frequency
-    for(uint8_t i = 0; i < SAMPLE_CNT; i++){
-        //Poll until capture is complete
-        while(!captureComplete);
-        captureComplete = false; 
-
-        if(nextRiseCnt < initialRiseCnt)
-            differenceSum += (0xFFFF - initialRiseCnt) + nextRiseCnt;  //Account for Overflow
-        else
-            differenceSum += (nextRiseCnt - initialRiseCnt);
+    // Pick up a target set from thread context
+    if(contServo->targetPending){
+        contServo->targetPending = false;
+        CONT_Servo_Start_Move(contServo, CONT_Servo_Relative_Target(detectedAngle, contServo->requestAngle, contServo->requestDir));
     }
 
-    // Calculate Frequency
-    freqCnt = differenceSum / SAMPLE_CNT;
+    if(contServo->status != CSERVO_MOVING)
+        return;
 
-    // Capture Initial Angle
-    HAL_TIM_IC_Stop(contServo->ICTimer, contServo->ICTimerChannel);
-    Change_IC_IT_Edge(contServo->ICTimer, contServo->ICTimerChannel, TIM_INPUTCHANNELPOLARITY_BOTHEDGE);
-    __HAL_TIM_SET_COUNTER(contServo->ICTimer, 0);
-    feedbackCap = CAPTURE_DUTY;
-    captureState = CAPTURE_NEXT_RISING;
-    HAL_TIM_IC_Start_IT(contServo->ICTimer, contServo->ICTimerChannel);
-
-    while(captureState != CALCULATE);
-    captureComplete = false;
-
-    // Calculate Initial Angle
-    if(nextRiseCnt > fallingCnt)
-        currDuty = ((0xFFFF - nextRiseCnt) + fallingCnt) / (float)freqCnt;
-    else
-        currDuty = (fallingCnt - nextRiseCnt) / (float)freqCnt;
+    // Positive error drives toward higher pulse widths
+    error = -(contServo->targetAngle - detectedAngle);
 
-    // Calculate Detected Angle
-    currAngle = map(currDuty, contServo->contServoConfig->feedbackMinDuty, contServo->contServoConfig->feedbackMaxDuty, 0, 360);
+    //Check if we are within threshold
+    if((error < ERROR_THRESHOLD) && (error > -ERROR_THRESHOLD)){
+        if(contServo->steadyStateCnt > STEADY_STATE_CNT_THRES / SAMPLES_PER_STEP){
+            PWM_Set_Compare(contServo->contServoGroup, contServo->contServoTimer, contServo->contServoChannel, contServo->stopCnt);
+            CONT_Servo_Set_Status(contServo, CSERVO_HOLDING);
+            if(contServo->completeCallback != NULL)
+                contServo->completeCallback(contServo, detectedAngle);
+            return;
+        }
+        contServo->steadyStateCnt++;
+    }
+    else{
+        contServo->steadyStateCnt = 0;
+    }
 
-    HAL_TIM_IC_Stop(contServo->ICTimer, contServo->ICTimerChannel);
-    captureState = CAPTURE_NEXT_RISING;
+    // PI with the output capped to the PWM limit, the block stops integrating while capped
+    output = -PidUpdate(&contServo->pid, contServo->targetAngle, detectedAngle);
 
-    // Zero out Servo
-    if((180 - currAngle) > 0)
-        Drive_CONT_Servo_Angle(contServo, 180 - currAngle, SERVO_COUNTERCLOCKWISE);
+    // Counter Speed Offset
+    if(error > ERROR_THRESHOLD)
+        offset = SPEED_OFFSET;
+    else if(error < -ERROR_THRESHOLD)
+        offset = -SPEED_OFFSET;
     else
-        Drive_CONT_Servo_Angle(contServo, currAngle - 180, SERVO_CLOCKWISE);
+        offset = 0;
 
-    return SERVO_OK;
+    // Drive Servo Motor
+    PWM_Set_Compare(contServo->contServoGroup, contServo->contServoTimer, contServo->contServoChannel,
+                    FixLinearApply(&contServo->pulseMap, (int32_t)((1500 + output + offset) * (1 << PULSE_FRAC_BITS))));
 }
 
-Servo_Error Drive_CONT_Servo_Angle(CONT_Servo_Instance_t* contServo, int16_t angle, CSERVO_DIR dir){
+//Half of the ring was written, no CPU work happened per edge
+static void CONT_Servo_Capture(CONT_Servo_Instance_t* contServo, const CONT_Servo_Capture_t* captures){
 
-    static float targetAngle = 0.0;
-    static float detectedAngle = 0.0;
-    float detectedDuty = 0.0;
-    float output = 0.0;
-    static float error = 0.0;
-    float pError = 0.0;
-    float iError = 0.0;
-    float prevError = 0.0;
-    float offset = 0.0;
-    uint16_t steadyStateCnt = 0;
-    uint16_t integralResetCnt = 0;
+    float detectedAngle;
 
-    /* Assert Parameter */
+    if(!CONT_Servo_Feedback_Angle(contServo, captures, &detectedAngle))
+        return;
+
+    // First samples after init, zero out the servo
+    if(contServo->status == CSERVO_CALIBRATING){
+        contServo->currAngle = detectedAngle;
+        CONT_Servo_Start_Move(contServo, 180);
+    }
+
+    CONT_Servo_Control_Step(contServo, detectedAngle);
+}
+
+//Instance whose period channel DMA request fired
+static CONT_Servo_Instance_t* CONT_Servo_Find(const TIM_HandleTypeDef* htim){
+
+    for(uint8_t i = 0; i < contServoCount; i++){
+        if(contServos[i]->ICTimer == htim && CONT_Servo_Active_Channel(contServos[i]->ICTimerChannel) == htim->Channel)
+            return contServos[i];
+    }
+
+    return NULL;
+}
+
+Servo_Error CONT_Servo_Init(CONT_Servo_Instance_t* contServo){
+
+    /* Temp Variables */
+    uint32_t contTimerFreq = 0;
+    uint32_t counterTimerFreq = 0;
+    uint8_t slot;
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    /* Assert Parameters */
     if(contServo == NULL)
         return SERVO_INSTANCE_ERROR;
     else if(contServo->contServoConfig == NULL)
         return SERVO_INSTANCE_ERROR;
-    
-    /* Calculate Current Angle */
-    if(dir == SERVO_CLOCKWISE){
-        targetAngle = currAngle - angle;
-        if(targetAngle < 0){
-            targetAngle = 360 + targetAngle;
-        }
+    else if(contServo->ICTimerChannel != TIM_CHANNEL_1 && contServo->ICTimerChannel != TIM_CHANNEL_2)
+        return SERVO_INSTANCE_ERROR;
+
+    /* Register with the capture callback, once per instance */
+    for(slot = 0; slot < contServoCount; slot++){
+        if(contServos[slot] == contServo)
+            break;
     }
-    else if(dir == SERVO_COUNTERCLOCKWISE){
-        targetAngle = currAngle + angle;
-        if(targetAngle > 360){
-            targetAngle = targetAngle - 360;
-        }
+    if(slot == contServoCount){
+        if(contServoCount >= CONT_SERVO_MAX)
+            return SERVO_INSTANCE_ERROR;
+        contServos[contServoCount] = contServo;
     }
 
-    /* Change IC Timer to Capture Duty */
-    HAL_TIM_IC_Stop(contServo->ICTimer, contServo->ICTimerChannel);
-    Change_IC_IT_Edge(contServo->ICTimer, contServo->ICTimerChannel, TIM_INPUTCHANNELPOLARITY_BOTHEDGE);
-    __HAL_TIM_SET_COUNTER(contServo->ICTimer, 0);
-    feedbackCap = CAPTURE_DUTY;
-    captureState = CAPTURE_NEXT_RISING;
-    HAL_TIM_IC_Start_IT(contServo->ICTimer, contServo->ICTimerChannel);
-
-    /* PID Control Loop */
-    while(1){
-        
-        // Wait until feedback is detected
-        while(captureState != CALCULATE);
-        captureComplete = false;
-
-        // Calculate Detected Duty
-        if(nextRiseCnt > fallingCnt)
-            detectedDuty = ((0xFFFF - nextRiseCnt) + fallingCnt) / (float)freqCnt;
-        else
-            detectedDuty = (fallingCnt - nextRiseCnt) / (float)freqCnt;
-
-        // Calculate Detected Angle
-        detectedAngle = map(detectedDuty, contServo->contServoConfig->feedbackMinDuty, contServo->contServoConfig->feedbackMaxDuty, 0, 360);
-
-        // P and I error calculation
-        error = -(targetAngle - detectedAngle);
-
-        //Check if we are within threshold
-        if((error < ERROR_THRESHOLD) && (error > -ERROR_THRESHOLD)){
-            if(steadyStateCnt > STEADY_STATE_CNT_THRES){
-                __HAL_TIM_SET_COMPARE(contServo->contServoTimer, contServo->contServoChannel, stopCnt);
-                currAngle = detectedAngle;
-                break;
-            }
-            steadyStateCnt++;
-        }
-        else{
-            steadyStateCnt = 0;
-        }
+    /* Check if Continuous Servo Timer is setup to be 50Hz PWM */
+    contTimerFreq = Get_Freq(HAL_RCC_GetSysClockFreq(), contServo->contServoTimer->Init.Prescaler, __HAL_TIM_GET_AUTORELOAD(contServo->contServoTimer));
+    if(contTimerFreq != DESIRED_SERVO_FREQ)
+        return SERVO_FREQ_ERROR;
 
-        pError = PID_Kp * error;
+    /* Check if Counter Timer does not count slower than feedback signal */
+    counterTimerFreq = HAL_RCC_GetSysClockFreq() / (contServo->ICTimer->Init.Prescaler + 1);
+    if(contServo->contServoConfig->feedbackFreq == 0 || counterTimerFreq < contServo->contServoConfig->feedbackFreq)
+        return SERVO_FREQ_ERROR;
 
-        iError = PID_Ki * (prevError + error);
+    /* Check if a feedback period fits in the 16 bit capture */
+    if(counterTimerFreq / contServo->contServoConfig->feedbackFreq >= 0xFFFF)
+        return SERVO_FREQ_ERROR;
 
-        prevError += error;
+    /* PI on the angle error, one step per half ring */
+    sPidConfig pidConfig = {
+        .kp     = PID_Kp,
+        .ki     = PID_Ki * contServo->contServoConfig->feedbackFreq,
+        .kd     = 0,
+        .dt     = SAMPLES_PER_STEP / (float)contServo->contServoConfig->feedbackFreq,
+        .tauD   = 0,
+        .outMin = -INTEGRAL_CAP,
+        .outMax = INTEGRAL_CAP
+    };
+    if(!PidInit(&contServo->pid, &pidConfig))
+        return SERVO_INSTANCE_ERROR;
 
-        output = pError + iError;
+    /* Drive pulse to compare count, the step only multiplies and shifts */
+    if(!FixLinearInit(&contServo->pulseMap, SERVO_MIN_TIM_US << PULSE_FRAC_BITS, SERVO_MAX_TIM_US << PULSE_FRAC_BITS,
+                      0, contServo->contServoTimer->Init.Period))
+        return SERVO_INSTANCE_ERROR;
 
-        // Cap Output to make sure we don't exceed PWM Limit
-        if(output > INTEGRAL_CAP)
-            output = 200.0;
-        else if(output < -INTEGRAL_CAP)
-            output = -200.0;
+    /* Set Servo Motor speed to Stop mode */
 
-        // Counter Speed Offset
-        if(error > ERROR_THRESHOLD)
-            offset = SPEED_OFFSET;
-        else if(error < -ERROR_THRESHOLD)
-            offset = -SPEED_OFFSET;
-        else
-            offset = 0;
+    //Find Counter value for 1.5ms
+    contServo->stopCnt = __HAL_TIM_GET_AUTORELOAD(contServo->contServoTimer) * ONE_POINT_FIVE_MS_PERCENTAGE;
 
-        // Drive Servo Motor
-        __HAL_TIM_SET_COMPARE(contServo->contServoTimer, contServo->contServoChannel,
-                              map(1500 + output + offset, SERVO_MIN_TIM_US, SERVO_MAX_TIM_US, 0, contServo->contServoTimer->Init.Period));
+    //Set Continuous Servo Motor Timer compare counter to 1.5ms
+    __HAL_TIM_SET_COMPARE(contServo->contServoTimer, contServo->contServoChannel, contServo->stopCnt);
+    if(contServo->contServoGroup != NULL && PWM_Group_Add_Channel(contServo->contServoGroup, contServo->contServoChannel) != PWM_GROUP_OK)
+        return SERVO_INSTANCE_ERROR;
 
-        // Prevent Integral explosion
-        integralResetCnt++;
-        if(integralResetCnt > INTEGRAL_RESET_THRESHOLD){
-            integralResetCnt = 0;
-            prevError = 0;
-        }
+    //Start Continuous Servo Motor PWM Timer, synced only if this channel starts it
+    PWM_Start_Channel(contServo->contServoTimer, contServo->contServoChannel);
+
+    /* Feedback pin as timer input */
+    if(contServo->feedbackPort != NULL){
+        GPIO_InitStruct.Pin = contServo->feedbackPin;
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+        GPIO_InitStruct.Pull = GPIO_NOPULL;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+        GPIO_InitStruct.Alternate = contServo->feedbackAF;
+        HAL_GPIO_Init(contServo->feedbackPort, &GPIO_InitStruct);
+    }
 
-        captureState = CAPTURE_NEXT_RISING;   
+    /* Captures stream into the ring, the control loop starts with the first half */
+    if(slot != contServoCount)
+        CONT_Servo_Capture_Stop(contServo);
+    for(uint8_t i = 0; i < CONT_SERVO_RING_LEN; i++){
+        contServo->ring[i].ccr1 = 0;
+        contServo->ring[i].ccr2 = 0;
+    }
+    contServo->targetPending = false;
+    contServo->periodCnt = 0;
+    CONT_Servo_Set_Status(contServo, CSERVO_CALIBRATING);
 
+    if(CONT_Servo_Config_PWM_Input(contServo) != HAL_OK){
+        CONT_Servo_Set_Status(contServo, CSERVO_ERROR);
+        return SERVO_INSTANCE_ERROR;
+    }
+
+    if(slot == contServoCount)
+        contServoCount++;
+
+    //Burst reads CCR1 and CCR2 on every period capture, the length is in bytes for GPDMA
+    if(HAL_TIM_IC_Start(contServo->ICTimer, CONT_Servo_Duty_Channel(contServo)) != HAL_OK ||
+       HAL_TIM_IC_Start(contServo->ICTimer, contServo->ICTimerChannel) != HAL_OK ||
+       HAL_TIM_DMABurst_MultiReadStart(contServo->ICTimer, TIM_DMABASE_CCR1,
+                                       (contServo->ICTimerChannel == TIM_CHANNEL_1) ? TIM_DMA_CC1 : TIM_DMA_CC2,
+                                       (uint32_t*)contServo->ring, TIM_DMABURSTLENGTH_2TRANSFERS, sizeof(contServo->ring)) != HAL_OK){
+        CONT_Servo_Set_Status(contServo, CSERVO_ERROR);
+        return SERVO_INSTANCE_ERROR;
     }
 
     return SERVO_OK;
 }
 
-void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim){
-    
-    switch(feedbackCap){
+Servo_Error CONT_Servo_Set_Target(CONT_Servo_Instance_t* contServo, int16_t angle, CSERVO_DIR dir){
 
-        case CAPTURE_FREQUENCY:
-            
-            switch(captureState){
+    uint32_t primask;
 
-                case CAPTURE_INITIAL_RISING:
-                    if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_7) == GPIO_PIN_SET){
-                        initialRiseCnt = HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_1);
-                        captureState = CAPTURE_NEXT_RISING;
-                    }
-                    break;
+    /* Assert Parameter */
+    if(contServo == NULL)
+        return SERVO_INSTANCE_ERROR;
+    else if(contServo->contServoConfig == NULL)
+        return SERVO_INSTANCE_ERROR;
+
+    switch(contServo->status){
+        case CSERVO_IDLE:
+        case CSERVO_ERROR:
+            return SERVO_INSTANCE_ERROR;
+        case CSERVO_CALIBRATING:
+            return SERVO_BUSY;
+        default:
+            break;
+    }
+
+    /* The transfer interrupt applies the request on the next control step */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    contServo->requestAngle = angle;
+    contServo->requestDir = dir;
+    contServo->targetPending = true;
+    __set_PRIMASK(primask);
 
-                case CAPTURE_NEXT_RISING:
-                    if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_7) == GPIO_PIN_SET){
-                        nextRiseCnt = HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_1);
-                        captureState = CAPTURE_INITIAL_RISING;
-                        captureComplete = true;
-                        __HAL_TIM_SET_COUNTER(htim, 0);
-                    }
-                    break;
+    return SERVO_OK;
+}
 
-                default:
-                    break;
+CSERVO_STATUS CONT_Servo_Get_Status(const CONT_Servo_Instance_t* contServo){
 
-            }
+    /* A target that is not picked up yet already counts as a move */
+    if(contServo->targetPending)
+        return CSERVO_MOVING;
 
-            break;
+    return contServo->status;
+}
 
-        case CAPTURE_DUTY:
+float CONT_Servo_Get_Angle(const CONT_Servo_Instance_t* contServo){
+    return contServo->currAngle;
+}
 
-            switch(captureState){
+//DMA filled the first half of the ring
+void HAL_TIM_IC_CaptureHalfCpltCallback(TIM_HandleTypeDef *htim){
 
-                case CAPTURE_NEXT_RISING:
-                    if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_7) == GPIO_PIN_SET){
-                        nextRiseCnt = HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_1);
-                        captureState = CAPTURE_FALLING;
-                    }
-                    break;
+    CONT_Servo_Instance_t* contServo = CONT_Servo_Find(htim);
 
-                case CAPTURE_FALLING:
-                    if(HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_7) == GPIO_PIN_RESET){
-                        fallingCnt = HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_1);
-                        captureState = CALCULATE;
-                        captureComplete = true;
-                        __HAL_TIM_SET_COUNTER(htim, 0);
-                    }
-                    break;
+    if(contServo != NULL)
+        CONT_Servo_Capture(contServo, &contServo->ring[0]);
 
-                default:
-                    break;
+}
 
-            }
+//DMA filled the second half of the ring and wraps
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim){
 
-            break; 
+    CONT_Servo_Instance_t* contServo = CONT_Servo_Find(htim);
 
-    }
+    if(contServo != NULL)
+        CONT_Servo_Capture(contServo, &contServo->ring[SAMPLES_PER_STEP]);
 
-}
\ No newline at end of file
+}
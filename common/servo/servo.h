@@ -2,11 +2,17 @@
 #define __SERVO_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "stm32h5xx_hal.h"  
+#include "pid.h"
+#include "fixmath.h"
+#include "pwm_group.h"
 
 /* List of Macros */
 #define DESIRED_SERVO_FREQ  (50U)           //In Hz
 #define DESIRED_ACT_FREQ    (50U)           //In Hz
+#define CONT_SERVO_MAX      (4U)            //Continuous servos sharing the capture callback
+#define CONT_SERVO_RING_LEN (8U)            //Feedback captures per DMA ring, one control step per half
 
 //Servo Motor Error Enum
 typedef enum{
@@ -14,7 +20,8 @@ typedef enum{
 	SERVO_FREQ_ERROR 		= 0x01U,
 	SERVO_RANGE_ERROR_MIN	= 0x02U,
 	SERVO_RANGE_ERROR_MAX	= 0x03U,
-	SERVO_INSTANCE_ERROR	= 0x04U
+	SERVO_INSTANCE_ERROR	= 0x04U,
+	SERVO_BUSY				= 0x05U
 } Servo_Error;
 
 //Actuator Enum
@@ -32,6 +39,15 @@ typedef enum{
 	SERVO_COUNTERCLOCKWISE
 } CSERVO_DIR;
 
+//Continuous Servo Status Enum
+typedef enum{
+	CSERVO_IDLE,				//Not initialized
+	CSERVO_CALIBRATING,			//Waiting for the first feedback captures
+	CSERVO_MOVING,				//Control loop driving to the target
+	CSERVO_HOLDING,				//Settled on the target, motor stopped
+	CSERVO_ERROR				//Feedback capture could not be configured
+} CSERVO_STATUS;
+
 //Servo Motor Configuration Struct
 typedef struct{
 	float minDuty;
@@ -45,10 +61,13 @@ typedef struct{
 	TIM_HandleTypeDef*	htim;
 	uint8_t				channel;
 	Servo_Config_t*		config;
+	PWM_Group_t*		group;				//Optional, compare updates go out in the group's burst
 
 	/* These will be set in the INIT function */
 	uint32_t 			minCnt;
 	uint32_t 			maxCnt;
+	sFixLinear			angleMap;			//Angle to compare count
+	bool				ready;
 } Servo_Instance_t;
 
 //Actuator Configuration Struct
@@ -67,10 +86,13 @@ typedef struct
 	TIM_HandleTypeDef* Act_Timer;
 	uint8_t Channel;
     Actuator_Config_t* config;
+	PWM_Group_t* Group;					  //Optional, compare updates go out in the group's burst
 
     /* Will be Initialized by function */
 	uint16_t Min_Cnt;                     
 	uint16_t Max_Cnt;                     
+	sFixLinear Length_Map;                //Length to compare count
+	bool Ready;
 } Actuator_Instance_t;
 
 //Continuous Servo Motor Configuration Struct
@@ -82,18 +104,61 @@ typedef struct{
 	uint32_t feedbackFreq;		//Feedback Signal Frequency (in Hz)
 } CONT_Servo_Config_t;
 
-//Continuous Servo Motor Instance Struct
+//One PWM-input capture, written by the DMA burst in CCR1, CCR2 order
 typedef struct{
+	uint32_t ccr1;
+	uint32_t ccr2;
+} CONT_Servo_Capture_t;
+
+//Continuous Servo Motor Instance Struct
+typedef struct CONT_Servo_Instance CONT_Servo_Instance_t;
+
+//Called from the feedback capture interrupt
+typedef void (*CONT_Servo_Status_Callback_t)(CONT_Servo_Instance_t* contServo, CSERVO_STATUS status);
+typedef void (*CONT_Servo_Complete_Callback_t)(CONT_Servo_Instance_t* contServo, float angle);
+
+struct CONT_Servo_Instance{
 	//PWM Timer Handle
 	TIM_HandleTypeDef* 	contServoTimer;
 	uint8_t				contServoChannel;
+	PWM_Group_t*		contServoGroup;		//Optional, compare updates go out in the group's burst
 
-	//Timer Input Capture Handle
+	//Timer Input Capture Handle, the BSP links a circular GPDMA channel to the
+	//DMA request of ICTimerChannel and leaves the auto-reload at 0xFFFF
 	TIM_HandleTypeDef* 	ICTimer;
-	uint8_t				ICTimerChannel;
+	uint8_t				ICTimerChannel;		//TIM_CHANNEL_1 or 2, latches the period, the other one the duty
+
+	//Feedback pin, set up as the timer input on init. NULL port if the BSP did it
+	GPIO_TypeDef*		feedbackPort;
+	uint16_t			feedbackPin;
+	uint8_t				feedbackAF;
 
 	CONT_Servo_Config_t* contServoConfig;
-} CONT_Servo_Instance_t;
+
+	//Optional, set before init
+	CONT_Servo_Status_Callback_t	statusCallback;		//Every status change
+	CONT_Servo_Complete_Callback_t	completeCallback;	//A move settled on its target
+
+	/* These will be set in the INIT function and by the control loop */
+	volatile CSERVO_STATUS	status;
+	uint16_t			stopCnt;
+	sFixLinear			pulseMap;			//Pulse width in 1/16 us to compare count
+	uint16_t			periodCnt;			//Feedback period of the last step in counts
+	float				currAngle;
+	float				targetAngle;
+
+	//Target request from SetTarget, applied on the next feedback sample
+	volatile bool		targetPending;
+	int16_t				requestAngle;
+	CSERVO_DIR			requestDir;
+
+	//Control loop state
+	sPid				pid;
+	uint16_t			steadyStateCnt;
+
+	//Feedback captures, filled by DMA
+	CONT_Servo_Capture_t	ring[CONT_SERVO_RING_LEN];
+};
 
 //Servo Functions
 Servo_Error Servo_Init(Servo_Instance_t* servo);
@@ -104,7 +169,13 @@ Actuator_Error Actuator_Init(Actuator_Instance_t* act);
 Actuator_Error Drive_Actuator(const Actuator_Instance_t* act, const uint8_t length);
 
 //Continuous Servo Functions
+//The feedback timer captures in PWM-input mode and DMA fills the ring, the control loop runs
+//in the half and full transfer interrupts, one step per CONT_SERVO_RING_LEN / 2 feedback
+//periods. Init returns right away, the servo drives to 180 degrees before it reports HOLDING
 Servo_Error CONT_Servo_Init(CONT_Servo_Instance_t* contServo);
-Servo_Error Drive_CONT_Servo_Angle(CONT_Servo_Instance_t* contServo, int16_t angle, CSERVO_DIR dir);
+//Non-blocking, moves angle degrees from the current position in the given direction
+Servo_Error CONT_Servo_Set_Target(CONT_Servo_Instance_t* contServo, int16_t angle, CSERVO_DIR dir);
+CSERVO_STATUS CONT_Servo_Get_Status(const CONT_Servo_Instance_t* contServo);
+float CONT_Servo_Get_Angle(const CONT_Servo_Instance_t* contServo);
 
 #endif
\ No newline at end of file
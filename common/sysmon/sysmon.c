@@ -0,0 +1,346 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "sysmon.h"
+#include "tx_api.h"
+#include "tx_thread.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <time.h>
+#else
+#include "stm32h5xx.h"
+#endif
+
+#define STACK_FILL_BYTE ((UCHAR) 0xEF)
+
+typedef struct
+{
+    TX_THREAD *thread;
+    uint64_t time;
+    ULONG runCount;
+    ULONG preemptions;
+    ULONG interruptPreemptions;
+} sSysmonHistory;
+
+// Static Variables
+static bool _sysmonReady = false;
+static sSysmonHistory _history[SYSMON_MAX_THREADS];
+static uint64_t _lastSampleTime = 0;
+static uint64_t _lastIsrTime = 0;
+static uint64_t _lastIdleTime = 0;
+
+// Static Function Declarations
+static uint64_t _timeNow(void);
+static uint32_t _timeToUS(uint64_t time);
+static bool _threadTime(TX_THREAD *thread, uint64_t *time);
+static uint64_t _isrTime(void);
+static bool _idleTime(uint64_t *time);
+static uint32_t _stackHighWater(TX_THREAD *thread);
+static sSysmonHistory *_historyFind(TX_THREAD *thread);
+static uint16_t _permille(uint64_t part, uint64_t whole);
+
+
+// Time sources
+#if defined(__linux__)
+
+// Linux port: nanoseconds from the monotonic clock and each thread's pthread CPU clock
+static uint64_t _timeNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec;
+}
+
+static uint32_t _timeToUS(uint64_t time)
+{
+    return (uint32_t) (time / 1000ULL);
+}
+
+static bool _threadTime(TX_THREAD *thread, uint64_t *time)
+{
+    clockid_t clock;
+    struct timespec cpu;
+
+    if(thread->tx_thread_linux_thread_id == 0 ||
+       pthread_getcpuclockid(thread->tx_thread_linux_thread_id, &clock) != 0 ||
+       clock_gettime(clock, &cpu) != 0)
+    {
+        return false;
+    }
+
+    *time = ((uint64_t) cpu.tv_sec * 1000000000ULL) + (uint64_t) cpu.tv_nsec;
+    return true;
+}
+
+static uint64_t _isrTime(void)
+{
+    return 0;
+}
+
+static bool _idleTime(uint64_t *time)
+{
+    return false;
+}
+
+#else
+
+// MCU: DWT cycle counter, extended to 64 bits across calls. Must be sampled
+// more often than the counter wraps (~17 s at 250 MHz).
+static uint64_t _timeNow(void)
+{
+    static uint64_t extended = 0;
+    static uint32_t last = 0;
+    uint32_t now = DWT->CYCCNT;
+
+    extended += (uint32_t) (now - last);
+    last = now;
+
+    return extended;
+}
+
+static uint32_t _timeToUS(uint64_t time)
+{
+    return (uint32_t) (time / (SystemCoreClock / 1000000UL));
+}
+
+static bool _threadTime(TX_THREAD *thread, uint64_t *time)
+{
+#if defined(TX_EXECUTION_PROFILE_ENABLE)
+    EXECUTION_TIME total;
+
+    if(_tx_execution_thread_time_get(thread, &total) != TX_SUCCESS)
+    {
+        return false;
+    }
+
+    // The running thread is only credited when it is switched out, add its current slice
+    if(thread == tx_thread_identify())
+    {
+        total += (uint32_t) (DWT->CYCCNT - (uint32_t) thread->tx_thread_execution_time_last_start);
+    }
+
+    *time = total;
+    return true;
+#else
+    return false;
+#endif
+}
+
+static uint64_t _isrTime(void)
+{
+#if defined(TX_EXECUTION_PROFILE_ENABLE)
+    EXECUTION_TIME total = 0;
+
+    _tx_execution_isr_time_get(&total);
+    return total;
+#else
+    return 0;
+#endif
+}
+
+static bool _idleTime(uint64_t *time)
+{
+#if defined(TX_EXECUTION_PROFILE_ENABLE)
+    EXECUTION_TIME total = 0;
+
+    _tx_execution_idle_time_get(&total);
+    *time = total;
+    return true;
+#else
+    return false;
+#endif
+}
+
+#endif /* __linux__ */
+
+
+// Static Function Definitions
+
+// Stacks are filled with 0xEF on creation, the deepest overwritten byte is the high-water mark
+static uint32_t _stackHighWater(TX_THREAD *thread)
+{
+    const UCHAR *start = (const UCHAR *) thread->tx_thread_stack_start;
+    const UCHAR *end = (const UCHAR *) thread->tx_thread_stack_end;
+    const UCHAR *p = start;
+
+    while(p <= end && *p == STACK_FILL_BYTE)
+    {
+        p++;
+    }
+
+    return (uint32_t) (end - p + 1);
+}
+
+static sSysmonHistory *_historyFind(TX_THREAD *thread)
+{
+    sSysmonHistory *freeSlot = NULL;
+
+    for(uint8_t i = 0; i < SYSMON_MAX_THREADS; i++)
+    {
+        if(_history[i].thread == thread)
+        {
+            return &_history[i];
+        }
+
+        if(freeSlot == NULL && _history[i].thread == NULL)
+        {
+            freeSlot = &_history[i];
+        }
+    }
+
+    if(freeSlot != NULL)
+    {
+        memset(freeSlot, 0, sizeof(*freeSlot));
+        freeSlot->thread = thread;
+    }
+
+    return freeSlot;
+}
+
+static uint16_t _permille(uint64_t part, uint64_t whole)
+{
+    if(whole == 0)
+    {
+        return 0;
+    }
+
+    if(part >= whole)
+    {
+        return SYSMON_PERMILLE;
+    }
+
+    return (uint16_t) ((part * SYSMON_PERMILLE) / whole);
+}
+
+
+// Public Functions
+bool SysmonInit(void)
+{
+    uint64_t idle = 0;
+
+#if !defined(__linux__)
+    // Start the DWT cycle counter, the execution profile kit's time source
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    memset(_history, 0, sizeof(_history));
+    _lastSampleTime = _timeNow();
+    _lastIsrTime = _isrTime();
+    _lastIdleTime = _idleTime(&idle) ? idle : 0;
+    _sysmonReady = true;
+
+    return true;
+}
+
+uint8_t SysmonSample(sSysmonThread threads[], uint8_t maxThreads, sSysmonSummary *summary)
+{
+    TX_INTERRUPT_SAVE_AREA
+    TX_THREAD *list[SYSMON_MAX_THREADS];
+    uint64_t now, interval, isr, idle, threadSum = 0;
+    uint8_t count = 0;
+    bool timeValid = true;
+
+    if(!_sysmonReady)
+    {
+        SysmonInit();
+    }
+
+    if(maxThreads > SYSMON_MAX_THREADS)
+    {
+        maxThreads = SYSMON_MAX_THREADS;
+    }
+
+    // Snapshot the created list, threads are never deleted at runtime
+    TX_DISABLE
+    TX_THREAD *thread = _tx_thread_created_ptr;
+    ULONG created = _tx_thread_created_count;
+    for(ULONG i = 0; i < created && count < maxThreads; i++)
+    {
+        list[count++] = thread;
+        thread = thread->tx_thread_created_next;
+    }
+    TX_RESTORE
+
+    now = _timeNow();
+    interval = now - _lastSampleTime;
+    _lastSampleTime = now;
+
+    memset(summary, 0, sizeof(*summary));
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        sSysmonThread *out = &threads[i];
+        sSysmonHistory *history = _historyFind(list[i]);
+        CHAR *name;
+        UINT state, priority, preemptThreshold;
+        ULONG runCount, timeSlice;
+        ULONG preemptions = 0, interruptPreemptions = 0;
+        uint64_t time = 0;
+
+        memset(out, 0, sizeof(*out));
+        out->thread = list[i];
+
+        tx_thread_info_get(list[i], &name, &state, &runCount, &priority, &preemptThreshold,
+                           &timeSlice, TX_NULL, TX_NULL);
+
+#if defined(TX_THREAD_ENABLE_PERFORMANCE_INFO)
+        ULONG solicited;
+        tx_thread_performance_info_get(list[i], TX_NULL, TX_NULL, &solicited, &interruptPreemptions,
+                                       TX_NULL, TX_NULL, TX_NULL, TX_NULL, TX_NULL, TX_NULL);
+        preemptions = solicited + interruptPreemptions;
+#endif
+
+        out->name = name;
+        out->state = state;
+        out->priority = priority;
+        out->stackSize = (uint32_t) list[i]->tx_thread_stack_size;
+        out->stackHighWater = _stackHighWater(list[i]);
+
+        if(!_threadTime(list[i], &time))
+        {
+            timeValid = false;
+        }
+
+        if(history != NULL)
+        {
+            out->cpuPermille = _permille(time - history->time, interval);
+            out->resumptions = runCount - history->runCount;
+            out->preemptions = preemptions - history->preemptions;
+            threadSum += time - history->time;
+
+            summary->interruptPreemptions += interruptPreemptions - history->interruptPreemptions;
+
+            history->time = time;
+            history->runCount = runCount;
+            history->preemptions = preemptions;
+            history->interruptPreemptions = interruptPreemptions;
+        }
+
+        summary->contextSwitches += out->resumptions;
+        summary->preemptions += out->preemptions;
+    }
+
+    isr = _isrTime();
+    summary->isrPermille = _permille(isr - _lastIsrTime, interval);
+    _lastIsrTime = isr;
+
+    if(_idleTime(&idle))
+    {
+        summary->idlePermille = _permille(idle - _lastIdleTime, interval);
+        _lastIdleTime = idle;
+    }
+    else if(timeValid)
+    {
+        // No idle accounting (Linux port), idle is whatever the threads did not use
+        summary->idlePermille = _permille(interval - ((threadSum < interval) ? threadSum : interval), interval);
+    }
+
+    summary->threadCount = count;
+    summary->interval_US = _timeToUS(interval);
+    summary->timeValid = timeValid;
+
+    return count;
+}
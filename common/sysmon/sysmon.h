@@ -0,0 +1,62 @@
+#ifndef __SYSMON_H
+#define __SYSMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tx_api.h"
+
+/*********************************************************************************
+    System monitor: per-thread CPU load, ISR time, idle time, stack high-water
+    marks and scheduler counters, sampled as deltas between SysmonSample calls.
+
+    On the MCU, thread and ISR time come from the ThreadX execution profile kit
+    clocked by the DWT cycle counter (TX_EXECUTION_PROFILE_ENABLE in tx_user.h).
+    ISRs are only accounted when wrapped in SYSMON_ISR_ENTER / SYSMON_ISR_EXIT.
+
+    On the ThreadX Linux port, thread time comes from each thread's pthread CPU
+    clock and ISR time is reported as zero.
+***********************************************************************************/
+
+#define SYSMON_MAX_THREADS   16
+#define SYSMON_PERMILLE      1000
+
+#if defined(TX_EXECUTION_PROFILE_ENABLE)
+#define SYSMON_ISR_ENTER()   _tx_execution_isr_enter()
+#define SYSMON_ISR_EXIT()    _tx_execution_isr_exit()
+#else
+#define SYSMON_ISR_ENTER()
+#define SYSMON_ISR_EXIT()
+#endif
+
+typedef struct
+{
+    TX_THREAD *thread;
+    const char *name;
+    UINT state;
+    UINT priority;
+    uint16_t cpuPermille;           // Share of the sample interval spent in this thread
+    uint32_t stackSize;
+    uint32_t stackHighWater;        // Deepest stack use seen, in bytes
+    uint32_t resumptions;           // Since the previous sample
+    uint32_t preemptions;           // Solicited and interrupt preemptions since the previous sample
+} sSysmonThread;
+
+typedef struct
+{
+    uint8_t threadCount;
+    uint16_t isrPermille;
+    uint16_t idlePermille;
+    uint32_t interval_US;
+    uint32_t contextSwitches;       // Thread resumptions since the previous sample
+    uint32_t preemptions;           // Solicited and interrupt preemptions since the previous sample
+    uint32_t interruptPreemptions;
+    bool timeValid;                 // False when no time source is available in this build
+} sSysmonSummary;
+
+bool SysmonInit(void);
+
+// Fills up to maxThreads entries and returns the number of entries written
+uint8_t SysmonSample(sSysmonThread threads[], uint8_t maxThreads, sSysmonSummary *summary);
+
+#endif /* __SYSMON_H */
@@ -0,0 +1,552 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetry.h"
+#include "console.h"
+#include "mcan.h"
+#include "imu.h"
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+#include "tx_thread.h"
+
+#define TELEM_DELIMITER        0x00
+#define TELEM_FRAME_MAX        (TELEM_HEADER_SIZE + TELEM_MAX_PAYLOAD + TELEM_CRC_SIZE)
+#define TELEM_ENCODED_MAX      (TELEM_FRAME_MAX + (TELEM_FRAME_MAX / 254) + 1)
+#define TELEM_WIRE_MAX         (TELEM_ENCODED_MAX + 2)
+#define TELEM_MAX_COMMANDS     16
+#define TELEM_RX_FLAG          0x1
+#define CRC32_FINAL_XOR        0xFFFFFFFFUL
+
+typedef struct
+{
+    uint8_t id;
+    TelemCommandHandler handler;
+} sTelemCommand;
+
+// Static Variables
+static bool _telemetryReady = false;
+static CRC_HandleTypeDef _hcrc;
+static TX_MUTEX _telemTxMutex;
+static TX_EVENT_FLAGS_GROUP _telemRxEvent;
+
+static uint8_t _txRaw[TELEM_FRAME_MAX];
+static uint8_t _txWire[TELEM_WIRE_MAX];
+static uint16_t _streamSeq[TELEM_STREAM_COUNT];
+
+// RX framing, filled byte by byte from the console UART ISR
+static uint8_t _rxEncoded[TELEM_ENCODED_MAX];
+static volatile uint16_t _rxLen = 0;
+static volatile bool _rxInFrame = false;
+static volatile bool _rxDiscard = false;
+static uint8_t _rxPendingEncoded[TELEM_ENCODED_MAX];
+static volatile uint16_t _rxPendingLen = 0;
+static volatile bool _rxPending = false;
+static uint8_t _rxRaw[TELEM_FRAME_MAX];
+static uint8_t _rxResponse[TELEM_MAX_PAYLOAD];
+
+static sTelemCommand _commands[TELEM_MAX_COMMANDS];
+static uint8_t _registeredCommands = 0;
+
+static uint16_t _streamPeriod[TELEM_STREAM_COUNT] = {0};
+static ULONG _streamLast[TELEM_STREAM_COUNT] = {0};
+static uint32_t _imuLastSequence = 0;
+
+// Telemetry Thread
+#define THREAD_TELEMETRY_STACK_SIZE 2048
+static TX_THREAD stThreadTelemetry;
+static uint8_t auThreadTelemetryStack[THREAD_TELEMETRY_STACK_SIZE];
+static const uint8_t THREAD_TELEMETRY_DELAY_MS = 5;
+static void thread_telemetry(ULONG ctx);
+
+// Static Function Declarations
+static uint16_t _cobsEncode(const uint8_t *in, uint16_t len, uint8_t *out);
+static uint16_t _cobsDecode(const uint8_t *in, uint16_t len, uint8_t *out);
+static uint32_t _crc32(const uint8_t *buff, uint16_t len);
+static bool _sendFrame(TELEM_FRAME_TYPE type, uint8_t id, uint16_t seq, const void *payload, uint16_t payloadLen);
+static void _processRxFrame(void);
+static void _sendIMU(void);
+static void _sendMCANStats(void);
+static void _sendThreadStats(void);
+static TELEM_STATUS _cmdPing(const uint8_t *request, uint16_t requestLen, uint8_t *response, uint16_t *responseLen);
+static TELEM_STATUS _cmdStreamRate(const uint8_t *request, uint16_t requestLen, uint8_t *response, uint16_t *responseLen);
+
+static inline void _putU16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline void _putU32(uint8_t *out, uint32_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static inline uint16_t _getU16(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+static inline uint32_t _getU32(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+/*********************************************************************************
+    Name: _cobsEncode
+
+    Description:
+        Consistent Overhead Byte Stuffing. Removes every 0x00 from the frame so
+        0x00 can be used as an unambiguous delimiter. Output is at most
+        len + len / 254 + 1 bytes.
+
+    Returns:
+        Encoded length
+***********************************************************************************/
+static uint16_t _cobsEncode(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t writeIndex = 1;
+    uint16_t codeIndex = 0;
+    uint8_t code = 1;
+
+    for(uint16_t readIndex = 0; readIndex < len; readIndex++)
+    {
+        if(in[readIndex] == 0)
+        {
+            out[codeIndex] = code;
+            codeIndex = writeIndex++;
+            code = 1;
+        }
+        else
+        {
+            out[writeIndex++] = in[readIndex];
+            code++;
+
+            if(code == 0xFF)
+            {
+                out[codeIndex] = code;
+                codeIndex = writeIndex++;
+                code = 1;
+            }
+        }
+    }
+
+    out[codeIndex] = code;
+    return writeIndex;
+}
+
+/*********************************************************************************
+    Name: _cobsDecode
+
+    Returns:
+        Decoded length, 0 if the input is malformed
+***********************************************************************************/
+static uint16_t _cobsDecode(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t readIndex = 0;
+    uint16_t writeIndex = 0;
+
+    while(readIndex < len)
+    {
+        uint8_t code = in[readIndex++];
+
+        if(code == 0 || readIndex + code - 1 > len || writeIndex + code > TELEM_FRAME_MAX)
+        {
+            return 0;
+        }
+
+        for(uint8_t i = 1; i < code; i++)
+        {
+            out[writeIndex++] = in[readIndex++];
+        }
+
+        if(code != 0xFF && readIndex < len)
+        {
+            out[writeIndex++] = 0;
+        }
+    }
+
+    return writeIndex;
+}
+
+// Standard CRC-32 from the hardware CRC unit, caller must hold _telemTxMutex
+static uint32_t _crc32(const uint8_t *buff, uint16_t len)
+{
+    return HAL_CRC_Calculate(&_hcrc, (uint32_t *) buff, len) ^ CRC32_FINAL_XOR;
+}
+
+static bool _sendFrame(TELEM_FRAME_TYPE type, uint8_t id, uint16_t seq, const void *payload, uint16_t payloadLen)
+{
+    uint16_t rawLen = TELEM_HEADER_SIZE + payloadLen;
+    uint16_t wireLen;
+
+    if(!_telemetryReady || payloadLen > TELEM_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    tx_mutex_get(&_telemTxMutex, TX_WAIT_FOREVER);
+
+    // Header
+    _txRaw[0] = type;
+    _txRaw[1] = id;
+    _putU16(&_txRaw[2], seq);
+    _putU32(&_txRaw[4], tx_time_get());
+
+    // Payload and CRC
+    memcpy(&_txRaw[TELEM_HEADER_SIZE], payload, payloadLen);
+    _putU32(&_txRaw[rawLen], _crc32(_txRaw, rawLen));
+    rawLen += TELEM_CRC_SIZE;
+
+    // Delimit both ends so a host resynchronizes after any text or line noise
+    _txWire[0] = TELEM_DELIMITER;
+    wireLen = 1 + _cobsEncode(_txRaw, rawLen, &_txWire[1]);
+    _txWire[wireLen++] = TELEM_DELIMITER;
+
+    ConsoleWriteRaw((const char *) _txWire, wireLen);
+
+    tx_mutex_put(&_telemTxMutex);
+
+    return true;
+}
+
+static void _processRxFrame(void)
+{
+    uint16_t rawLen;
+    uint16_t responseLen = 0;
+    TELEM_STATUS status = TELEM_STATUS_UNKNOWN_CMD;
+
+    tx_mutex_get(&_telemTxMutex, TX_WAIT_FOREVER);
+    rawLen = _cobsDecode(_rxPendingEncoded, _rxPendingLen, _rxRaw);
+    _rxPending = false;
+
+    // Drop malformed frames silently, the host retries on timeout
+    if(rawLen < TELEM_HEADER_SIZE + TELEM_CRC_SIZE ||
+       _crc32(_rxRaw, rawLen - TELEM_CRC_SIZE) != _getU32(&_rxRaw[rawLen - TELEM_CRC_SIZE]) ||
+       _rxRaw[0] != TELEM_FRAME_COMMAND)
+    {
+        tx_mutex_put(&_telemTxMutex);
+        return;
+    }
+    tx_mutex_put(&_telemTxMutex);
+
+    for(uint8_t i = 0; i < _registeredCommands; i++)
+    {
+        if(_commands[i].id == _rxRaw[1])
+        {
+            status = _commands[i].handler(&_rxRaw[TELEM_HEADER_SIZE], rawLen - TELEM_HEADER_SIZE - TELEM_CRC_SIZE,
+                                          &_rxResponse[1], &responseLen);
+            break;
+        }
+    }
+
+    if(responseLen > TELEM_MAX_PAYLOAD - 1)
+    {
+        responseLen = 0;
+        status = TELEM_STATUS_FAILED;
+    }
+
+    _rxResponse[0] = status;
+    _sendFrame(TELEM_FRAME_RESPONSE, _rxRaw[1], _getU16(&_rxRaw[2]), _rxResponse, responseLen + 1);
+}
+
+// Latest sample from the IMU sampler, skipped if nothing new was published since the last frame
+static void _sendIMU(void)
+{
+    sImuSample latest;
+    sTelemIMU sample;
+
+    if(!ImuGetLatest(&latest) || latest.sequence == _imuLastSequence)
+    {
+        return;
+    }
+    _imuLastSequence = latest.sequence;
+
+    sample.accel[0] = latest.data.accel.x;
+    sample.accel[1] = latest.data.accel.y;
+    sample.accel[2] = latest.data.accel.z;
+    sample.gyro[0]  = latest.data.gyro.x;
+    sample.gyro[1]  = latest.data.gyro.y;
+    sample.gyro[2]  = latest.data.gyro.z;
+    sample.mag[0]   = latest.data.mag.x;
+    sample.mag[1]   = latest.data.mag.y;
+    sample.mag[2]   = latest.data.mag.z;
+    sample.quat[0]  = latest.data.quaternion.w;
+    sample.quat[1]  = latest.data.quaternion.x;
+    sample.quat[2]  = latest.data.quaternion.y;
+    sample.quat[3]  = latest.data.quaternion.z;
+
+    TelemetrySendIMU(&sample);
+}
+
+static void _sendMCANStats(void)
+{
+    sMCAN_Stats mcanStats;
+    sTelemMCANStats sample;
+
+    MCAN_GetStats(&mcanStats);
+    sample.rxFrames  = mcanStats.rxFrames;
+    sample.rxDropped = mcanStats.rxDropped;
+    sample.txFrames  = mcanStats.txFrames;
+    sample.txErrors  = mcanStats.txErrors;
+
+    TelemetrySend(TELEM_STREAM_MCAN_STATS, &sample, sizeof(sample));
+}
+
+// One frame per created thread
+static void _sendThreadStats(void)
+{
+    TX_THREAD *thread = _tx_thread_created_ptr;
+    ULONG threadCount = _tx_thread_created_count;
+    sTelemThreadStats sample;
+    CHAR *name;
+    UINT state;
+    UINT priority;
+    UINT preemptThreshold;
+    ULONG runCount;
+    ULONG timeSlice;
+    TX_THREAD *nextThread;
+    TX_THREAD *nextSuspended;
+
+    for(ULONG i = 0; i < threadCount && thread != NULL; i++)
+    {
+        if(tx_thread_info_get(thread, &name, &state, &runCount, &priority, &preemptThreshold,
+                              &timeSlice, &nextThread, &nextSuspended) != TX_SUCCESS)
+        {
+            break;
+        }
+
+        memset(&sample, 0, sizeof(sample));
+        strncpy(sample.name, name, TELEM_THREAD_NAME_MAX - 1);
+        sample.state     = state;
+        sample.priority  = priority;
+        sample.runCount  = runCount;
+        sample.stackSize = thread->tx_thread_stack_size;
+
+        TelemetrySend(TELEM_STREAM_THREAD_STATS, &sample, sizeof(sample));
+        thread = nextThread;
+    }
+}
+
+static TELEM_STATUS _cmdPing(const uint8_t *request, uint16_t requestLen, uint8_t *response, uint16_t *responseLen)
+{
+    memcpy(response, request, requestLen);
+    *responseLen = requestLen;
+    return TELEM_STATUS_OK;
+}
+
+static TELEM_STATUS _cmdStreamRate(const uint8_t *request, uint16_t requestLen, uint8_t *response, uint16_t *responseLen)
+{
+    if(requestLen != 3)
+    {
+        return TELEM_STATUS_BAD_ARGS;
+    }
+
+    return TelemetrySetStreamPeriod((TELEM_STREAM) request[0], _getU16(&request[1])) ? TELEM_STATUS_OK : TELEM_STATUS_BAD_ARGS;
+}
+
+/***************************** Public Function Definitions *****************************/
+
+/*********************************************************************************
+    Name: TelemetryInit
+
+    Description:
+        Configures the hardware CRC unit for standard CRC-32 and starts the
+        telemetry thread. ConsoleInit must be called first, telemetry frames
+        share the console UART.
+
+    Returns:
+        True  = telemetry channel ready
+        False = CRC unit configuration failure
+***********************************************************************************/
+bool TelemetryInit(void)
+{
+    // CRC-32 (zlib): default polynomial and init value, reflected in and out
+    __HAL_RCC_CRC_CLK_ENABLE();
+    _hcrc.Instance                     = CRC;
+    _hcrc.Init.DefaultPolynomialUse    = DEFAULT_POLYNOMIAL_ENABLE;
+    _hcrc.Init.DefaultInitValueUse     = DEFAULT_INIT_VALUE_ENABLE;
+    _hcrc.Init.InputDataInversionMode  = CRC_INPUTDATA_INVERSION_BYTE;
+    _hcrc.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_ENABLE;
+    _hcrc.InputDataFormat              = CRC_INPUTDATA_FORMAT_BYTES;
+
+    if (HAL_CRC_Init(&_hcrc) != HAL_OK)
+    {
+        return false;
+    }
+
+    tx_mutex_create(&_telemTxMutex, "telemetry_tx_mutex", TX_INHERIT);
+    tx_event_flags_create(&_telemRxEvent, "telemetry_rx_event");
+
+    TelemetryRegisterCommand(TELEM_CMD_PING, _cmdPing);
+    TelemetryRegisterCommand(TELEM_CMD_STREAM_RATE, _cmdStreamRate);
+
+    tx_thread_create( &stThreadTelemetry,
+        "thread_telemetry",
+        thread_telemetry,
+        0,
+        auThreadTelemetryStack,
+        THREAD_TELEMETRY_STACK_SIZE,
+        4,
+        4,
+        0,
+        TX_AUTO_START);
+
+    _telemetryReady = true;
+    return true;
+}
+
+bool TelemetrySend(TELEM_STREAM stream, const void *payload, uint16_t payloadLen)
+{
+    if(stream >= TELEM_STREAM_COUNT)
+    {
+        return false;
+    }
+
+    return _sendFrame(TELEM_FRAME_STREAM, stream, _streamSeq[stream]++, payload, payloadLen);
+}
+
+bool TelemetrySendIMU(const sTelemIMU *sample)
+{
+    return TelemetrySend(TELEM_STREAM_IMU, sample, sizeof(sTelemIMU));
+}
+
+/*********************************************************************************
+    Name: TelemetrySetStreamPeriod
+
+    Description:
+        Sets the period of a stream generated by the telemetry thread itself.
+        The IMU stream sends the latest sample from the IMU sampler (ImuStart),
+        at most one frame per published sample.
+
+    Arguments:
+        stream    = periodic stream
+        period_MS = period in ms, 0 disables the stream
+
+    Returns:
+        True  = period updated
+        False = unknown stream
+***********************************************************************************/
+bool TelemetrySetStreamPeriod(TELEM_STREAM stream, uint16_t period_MS)
+{
+    if(stream < TELEM_STREAM_IMU || stream >= TELEM_STREAM_COUNT)
+    {
+        return false;
+    }
+
+    _streamPeriod[stream] = period_MS;
+    return true;
+}
+
+bool TelemetryRegisterCommand(uint8_t commandID, TelemCommandHandler handler)
+{
+    if(_registeredCommands == TELEM_MAX_COMMANDS || handler == NULL)
+    {
+        return false;
+    }
+
+    _commands[_registeredCommands].id = commandID;
+    _commands[_registeredCommands].handler = handler;
+    _registeredCommands++;
+
+    return true;
+}
+
+/***************************** External Overrides *****************************/
+
+/*********************************************************************************
+    Name: ConsoleBinaryRxByte
+
+    Description:
+        Claims console UART bytes between 0x00 delimiters. A complete frame is
+        handed to the telemetry thread; a frame arriving while the previous one
+        is still pending is dropped.
+***********************************************************************************/
+bool ConsoleBinaryRxByte(uint8_t rxByte)
+{
+    if(!_telemetryReady)
+    {
+        return false;
+    }
+
+    if(rxByte == TELEM_DELIMITER)
+    {
+        // Closing delimiter of a non-empty frame, otherwise an opening one
+        if(_rxInFrame && _rxLen > 0)
+        {
+            if(!_rxPending && !_rxDiscard)
+            {
+                memcpy(_rxPendingEncoded, _rxEncoded, _rxLen);
+                _rxPendingLen = _rxLen;
+                _rxPending = true;
+                tx_event_flags_set(&_telemRxEvent, TELEM_RX_FLAG, TX_OR);
+            }
+            _rxInFrame = false;
+        }
+        else
+        {
+            _rxInFrame = true;
+        }
+
+        _rxLen = 0;
+        _rxDiscard = false;
+        return true;
+    }
+
+    if(!_rxInFrame)
+    {
+        return false;
+    }
+
+    // Oversized frames are swallowed up to their closing delimiter
+    if(_rxLen < TELEM_ENCODED_MAX)
+    {
+        _rxEncoded[_rxLen++] = rxByte;
+    }
+    else
+    {
+        _rxDiscard = true;
+    }
+
+    return true;
+}
+
+/***************************** Threads *****************************/
+static void thread_telemetry(ULONG ctx)
+{
+    ULONG flags;
+    ULONG now;
+
+    while(true)
+    {
+        if(tx_event_flags_get(&_telemRxEvent, TELEM_RX_FLAG, TX_OR_CLEAR, &flags, THREAD_TELEMETRY_DELAY_MS) == TX_SUCCESS)
+        {
+            _processRxFrame();
+        }
+
+        now = tx_time_get();
+
+        if(_streamPeriod[TELEM_STREAM_IMU] != 0 &&
+           now - _streamLast[TELEM_STREAM_IMU] >= _streamPeriod[TELEM_STREAM_IMU])
+        {
+            _streamLast[TELEM_STREAM_IMU] = now;
+            _sendIMU();
+        }
+
+        if(_streamPeriod[TELEM_STREAM_MCAN_STATS] != 0 &&
+           now - _streamLast[TELEM_STREAM_MCAN_STATS] >= _streamPeriod[TELEM_STREAM_MCAN_STATS])
+        {
+            _streamLast[TELEM_STREAM_MCAN_STATS] = now;
+            _sendMCANStats();
+        }
+
+        if(_streamPeriod[TELEM_STREAM_THREAD_STATS] != 0 &&
+           now - _streamLast[TELEM_STREAM_THREAD_STATS] >= _streamPeriod[TELEM_STREAM_THREAD_STATS])
+        {
+            _streamLast[TELEM_STREAM_THREAD_STATS] = now;
+            _sendThreadStats();
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h5xx_hal.h"
+
+/*********************************************************************************
+    Binary telemetry channel multiplexed with the text console UART.
+
+    Every frame is COBS encoded and wrapped in 0x00 delimiters, a byte the text
+    console never emits, so a host can split the stream into text and frames.
+
+    Decoded frame layout (little endian):
+        [type u8][id u8][seq u16][timestamp u32][payload 0..TELEM_MAX_PAYLOAD][crc32 u32]
+
+    The CRC is the standard CRC-32 (zlib) over everything before it, computed
+    by the hardware CRC unit.
+***********************************************************************************/
+
+#define TELEM_MAX_PAYLOAD     200
+#define TELEM_HEADER_SIZE     8
+#define TELEM_CRC_SIZE        4
+#define TELEM_THREAD_NAME_MAX 16
+
+typedef enum
+{
+    TELEM_FRAME_STREAM   = 0x01,
+    TELEM_FRAME_COMMAND  = 0x02,
+    TELEM_FRAME_RESPONSE = 0x03,
+} TELEM_FRAME_TYPE;
+
+typedef enum
+{
+    TELEM_STREAM_IMU          = 0x01,
+    TELEM_STREAM_MCAN_STATS   = 0x02,
+    TELEM_STREAM_THREAD_STATS = 0x03,
+    TELEM_STREAM_COUNT,
+} TELEM_STREAM;
+
+typedef enum
+{
+    TELEM_CMD_PING        = 0x01,     // Echo the payload
+    TELEM_CMD_STREAM_RATE = 0x02,     // [stream u8][period_ms u16], 0 disables the stream
+    TELEM_CMD_USER        = 0x40,     // First id available to TelemetryRegisterCommand
+} TELEM_CMD;
+
+typedef enum
+{
+    TELEM_STATUS_OK          = 0x00,
+    TELEM_STATUS_UNKNOWN_CMD = 0x01,
+    TELEM_STATUS_BAD_ARGS    = 0x02,
+    TELEM_STATUS_FAILED      = 0x03,
+} TELEM_STATUS;
+
+// Stream payloads
+typedef struct __attribute__((packed))
+{
+    float accel[3];
+    float gyro[3];
+    float mag[3];
+    float quat[4];      // w, x, y, z
+} sTelemIMU;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t rxFrames;
+    uint32_t rxDropped;
+    uint32_t txFrames;
+    uint32_t txErrors;
+} sTelemMCANStats;
+
+typedef struct __attribute__((packed))
+{
+    char     name[TELEM_THREAD_NAME_MAX];
+    uint8_t  state;
+    uint8_t  priority;
+    uint32_t runCount;
+    uint32_t stackSize;
+} sTelemThreadStats;
+
+// Command handler. Fills response and responseLen (at most TELEM_MAX_PAYLOAD - 1 bytes).
+typedef TELEM_STATUS (*TelemCommandHandler)(const uint8_t *request, uint16_t requestLen, uint8_t *response, uint16_t *responseLen);
+
+bool TelemetryInit(void);
+
+bool TelemetrySend(TELEM_STREAM stream, const void *payload, uint16_t payloadLen);
+bool TelemetrySendIMU(const sTelemIMU *sample);
+
+bool TelemetrySetStreamPeriod(TELEM_STREAM stream, uint16_t period_MS);
+bool TelemetryRegisterCommand(uint8_t commandID, TelemCommandHandler handler);
+
+#endif /* __TELEMETRY_H */
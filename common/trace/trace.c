@@ -0,0 +1,416 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "trace.h"
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+
+#if defined(TX_ENABLE_EVENT_TRACE)
+#include "tx_trace.h"
+
+#define TRACE_MAGIC_0            'T'
+#define TRACE_MAGIC_1            'X'
+#define TRACE_PKT_OVERHEAD       8           // magic, type, seq, len, checksum
+#define TRACE_PKT_ENTRIES        16          // Entries per events packet
+#define TRACE_HEADER_PAYLOAD     (sizeof(uint32_t) + sizeof(TX_TRACE_HEADER) + (TRACE_REGISTRY_ENTRIES * sizeof(TX_TRACE_OBJECT_ENTRY)))
+#define TRACE_EVENTS_PAYLOAD     (TRACE_PKT_ENTRIES * sizeof(TX_TRACE_BUFFER_ENTRY))
+#define TRACE_PKT_MAX            (TRACE_PKT_OVERHEAD + ((TRACE_HEADER_PAYLOAD > TRACE_EVENTS_PAYLOAD) ? TRACE_HEADER_PAYLOAD : TRACE_EVENTS_PAYLOAD))
+#define TRACE_RAM_SIZE           (sizeof(TX_TRACE_HEADER) + (TRACE_REGISTRY_ENTRIES * sizeof(TX_TRACE_OBJECT_ENTRY)) + (TRACE_BUFFER_ENTRIES * sizeof(TX_TRACE_BUFFER_ENTRY)))
+#define TRACE_ALL_CLASSES        (TX_TRACE_ALL_EVENTS | TX_TRACE_USER_EVENTS)
+
+#define TRACE_START_FLAG         0x1
+#define TRACE_TX_DONE_FLAG       0x2
+#define TRACE_STOPPED_FLAG       0x4
+#define TRACE_DRAIN_MS           5
+#define TRACE_TX_TIMEOUT_MS      50
+#define TRACE_STOP_TIMEOUT_MS    500
+
+// Drain Thread
+#define THREAD_TRACE_STACK_SIZE 1024
+static TX_THREAD stThreadTrace;
+static uint8_t auThreadTraceStack[THREAD_TRACE_STACK_SIZE];
+static void thread_trace(ULONG ctx);
+
+// Static Variables
+static UART_HandleTypeDef *_traceUart = NULL;
+static TX_EVENT_FLAGS_GROUP _traceEvent;
+static volatile bool _traceRunning = false;
+static volatile bool _traceStopRequest = false;
+static volatile bool _txBusy = false;
+static volatile uint32_t _traceWraps = 0;
+
+// ThreadX writes events here, ULONG for alignment
+static ULONG _traceRam[(TRACE_RAM_SIZE + sizeof(ULONG) - 1) / sizeof(ULONG)];
+
+// Read position in the ring and wrap count at the last drain
+static uint32_t _readIndex = 0;
+static uint32_t _readWraps = 0;
+
+// Double buffered packets, one filling while the other is on the wire
+static uint8_t _txBuff[2][TRACE_PKT_MAX];
+static uint8_t _txIndex = 0;
+static uint8_t _txSeq = 0;
+
+static sTraceStats _stats;
+
+// Static Function Declarations
+static void _traceBufferFull(VOID *buffer);
+static uint8_t *_packetBegin(void);
+static bool _packetWait(void);
+static bool _packetSend(TRACE_PKT type, uint16_t payloadLen);
+static void _sendHeader(void);
+static void _sendLost(uint32_t lost);
+static void _drain(bool final);
+
+
+// Static Function Definitions
+
+// Called by ThreadX from the tracing context each time the ring wraps
+static void _traceBufferFull(VOID *buffer)
+{
+    _traceWraps++;
+}
+
+static uint8_t *_packetBegin(void)
+{
+    return &_txBuff[_txIndex][TRACE_PKT_OVERHEAD - sizeof(uint16_t)];
+}
+
+// Waits for the transfer on the wire, aborting it if the UART stalled
+static bool _packetWait(void)
+{
+    ULONG flags;
+
+    if(_txBusy && tx_event_flags_get(&_traceEvent, TRACE_TX_DONE_FLAG, TX_OR_CLEAR, &flags, TRACE_TX_TIMEOUT_MS) != TX_SUCCESS)
+    {
+        HAL_UART_AbortTransmit(_traceUart);
+        _txBusy = false;
+        return false;
+    }
+
+    return true;
+}
+
+/*********************************************************************************
+    Name: _packetSend
+
+    Description:
+        Completes the header and Fletcher-16 checksum of the packet built in the
+        free buffer, waits for the previous transfer and starts this one. The
+        other buffer is then free to be filled while this one is on the wire.
+
+    Returns:
+        False if the previous transfer did not complete or the UART refused
+***********************************************************************************/
+static bool _packetSend(TRACE_PKT type, uint16_t payloadLen)
+{
+    uint8_t *pkt = _txBuff[_txIndex];
+    uint16_t len = TRACE_PKT_OVERHEAD + payloadLen;
+    uint16_t sum1 = 0, sum2 = 0;
+    HAL_StatusTypeDef status;
+
+    pkt[0] = TRACE_MAGIC_0;
+    pkt[1] = TRACE_MAGIC_1;
+    pkt[2] = type;
+    pkt[3] = _txSeq;
+    pkt[4] = payloadLen & 0xFF;
+    pkt[5] = payloadLen >> 8;
+
+    for(uint16_t i = 2; i < len - sizeof(uint16_t); i++)
+    {
+        sum1 = (sum1 + pkt[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+
+    pkt[len - 2] = sum1;
+    pkt[len - 1] = sum2;
+
+    if(!_packetWait())
+    {
+        return false;
+    }
+
+    tx_event_flags_set(&_traceEvent, ~TRACE_TX_DONE_FLAG, TX_AND);
+    _txBusy = true;
+
+    if(_traceUart->hdmatx != NULL)
+    {
+        status = HAL_UART_Transmit_DMA(_traceUart, pkt, len);
+    }
+    else
+    {
+        status = HAL_UART_Transmit_IT(_traceUart, pkt, len);
+    }
+
+    if(status != HAL_OK)
+    {
+        _txBusy = false;
+        return false;
+    }
+
+    _txIndex ^= 1;
+    _txSeq++;
+    _stats.packetsSent++;
+    return true;
+}
+
+// Core clock, trace control header and object registry so the host can name objects and scale time
+static void _sendHeader(void)
+{
+    uint8_t *payload = _packetBegin();
+    uint32_t coreClock = SystemCoreClock;
+    uint16_t registrySize = (uint16_t) ((uint8_t *) _tx_trace_registry_end_ptr - (uint8_t *) _tx_trace_registry_start_ptr);
+
+    memcpy(payload, &coreClock, sizeof(coreClock));
+    memcpy(payload + sizeof(coreClock), _tx_trace_header_ptr, sizeof(TX_TRACE_HEADER));
+    memcpy(payload + sizeof(coreClock) + sizeof(TX_TRACE_HEADER), _tx_trace_registry_start_ptr, registrySize);
+
+    _packetSend(TRACE_PKT_HEADER, sizeof(coreClock) + sizeof(TX_TRACE_HEADER) + registrySize);
+}
+
+static void _sendLost(uint32_t lost)
+{
+    memcpy(_packetBegin(), &lost, sizeof(lost));
+    _packetSend(TRACE_PKT_LOST, sizeof(lost));
+}
+
+/*********************************************************************************
+    Name: _drain
+
+    Description:
+        Streams every entry ThreadX wrote since the previous drain. The number
+        written is the distance between the read index and the current write
+        pointer plus a full ring per wrap. More than a ring means the oldest
+        entries were overwritten; they are reported in a lost packet and the
+        drain restarts from the oldest entry still in the ring.
+
+        Entries only count as sent once their packet is on the wire. A packet
+        the UART refused ends the drain, the next one retries from there.
+
+    Arguments:
+        final = disable tracing at the snapshot, so nothing is left behind it
+***********************************************************************************/
+static void _drain(bool final)
+{
+    TX_INTERRUPT_SAVE_AREA
+    TX_TRACE_BUFFER_ENTRY *current;
+    uint32_t wraps;
+    uint32_t ringSize = _tx_trace_buffer_end_ptr - _tx_trace_buffer_start_ptr;
+    uint32_t currentIndex, pending;
+    int64_t written;
+
+    TX_DISABLE
+    current = _tx_trace_buffer_current_ptr;
+    wraps = _traceWraps;
+    if(final)
+    {
+        tx_trace_disable();
+    }
+    TX_RESTORE
+
+    if(current == TX_NULL)
+    {
+        return;
+    }
+
+    currentIndex = current - _tx_trace_buffer_start_ptr;
+    written = ((int64_t) (wraps - _readWraps) * ringSize) + currentIndex - _readIndex;
+    pending = (uint32_t) written;
+
+    if(written > ringSize)
+    {
+        _stats.entriesLost += (uint32_t) (written - ringSize);
+        _sendLost((uint32_t) (written - ringSize));
+        _readIndex = currentIndex;
+        pending = ringSize;
+    }
+
+    while(pending > 0)
+    {
+        uint32_t count = ringSize - _readIndex;
+
+        count = (count < pending) ? count : pending;
+        count = (count < TRACE_PKT_ENTRIES) ? count : TRACE_PKT_ENTRIES;
+
+        memcpy(_packetBegin(), &_tx_trace_buffer_start_ptr[_readIndex], count * sizeof(TX_TRACE_BUFFER_ENTRY));
+        if(!_packetSend(TRACE_PKT_EVENTS, count * sizeof(TX_TRACE_BUFFER_ENTRY)))
+        {
+            break;
+        }
+
+        _stats.entriesSent += count;
+        _readIndex = (_readIndex + count) % ringSize;
+        pending -= count;
+    }
+
+    // Entries still pending are behind the write pointer, possibly in the previous wrap
+    _readWraps = (pending > currentIndex) ? wraps - 1 : wraps;
+}
+
+static void thread_trace(ULONG ctx)
+{
+    uint32_t lastHeader = 0;
+    ULONG flags;
+
+    while(true)
+    {
+        if(!_traceRunning)
+        {
+            tx_event_flags_get(&_traceEvent, TRACE_START_FLAG, TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
+            lastHeader = tx_time_get() - TRACE_HEADER_PERIOD_MS;
+            continue;
+        }
+
+        // Flush what was recorded up to the stop and let the last packet leave the UART
+        if(_traceStopRequest)
+        {
+            _drain(true);
+            _packetWait();
+
+            _traceStopRequest = false;
+            _traceRunning = false;
+            tx_event_flags_set(&_traceEvent, TRACE_STOPPED_FLAG, TX_OR);
+            continue;
+        }
+
+        if((tx_time_get() - lastHeader) >= TRACE_HEADER_PERIOD_MS)
+        {
+            _sendHeader();
+            lastHeader = tx_time_get();
+        }
+
+        _drain(false);
+        tx_thread_sleep(TRACE_DRAIN_MS);
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart == _traceUart)
+    {
+        _txBusy = false;
+        tx_event_flags_set(&_traceEvent, TRACE_TX_DONE_FLAG, TX_OR);
+    }
+}
+
+#endif /* TX_ENABLE_EVENT_TRACE */
+
+
+// Public Functions
+
+/*********************************************************************************
+    Name: TraceInit
+
+    Description:
+        Creates the drain thread for streaming over uart. The BSP must have
+        initialised the UART, and linked a GPDMA channel to hdmatx for DMA.
+
+    Returns:
+        False if ThreadX was built without TX_ENABLE_EVENT_TRACE
+***********************************************************************************/
+bool TraceInit(UART_HandleTypeDef *uart)
+{
+#if defined(TX_ENABLE_EVENT_TRACE)
+    if(uart == NULL)
+    {
+        return false;
+    }
+
+    _traceUart = uart;
+    tx_event_flags_create(&_traceEvent, "trace_event");
+
+    // Lowest priority above heartbeat and blink, trace draining must not perturb the threads it observes
+    tx_thread_create( &stThreadTrace,
+        "thread_trace",
+        thread_trace,
+        0,
+        auThreadTraceStack,
+        THREAD_TRACE_STACK_SIZE,
+        5,
+        5,
+        0,
+        TX_AUTO_START);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TraceStart(ULONG eventMask)
+{
+#if defined(TX_ENABLE_EVENT_TRACE)
+    if(_traceUart == NULL || _traceRunning)
+    {
+        return false;
+    }
+
+    // DWT cycle counter is the trace time stamp source
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    if(tx_trace_enable(_traceRam, sizeof(_traceRam), TRACE_REGISTRY_ENTRIES) != TX_SUCCESS)
+    {
+        return false;
+    }
+
+    tx_trace_buffer_full_notify(_traceBufferFull);
+    TraceSetFilter(eventMask);
+
+    _traceWraps = 0;
+    _readWraps = 0;
+    _readIndex = 0;
+    memset(&_stats, 0, sizeof(_stats));
+
+    _traceRunning = true;
+    tx_event_flags_set(&_traceEvent, TRACE_START_FLAG, TX_OR);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*********************************************************************************
+    Name: TraceStop
+
+    Description:
+        Stops recording and waits for the drain thread to stream the entries
+        recorded up to the stop. Returns after TRACE_STOP_TIMEOUT_MS at most,
+        the drain thread then finishes the flush on its own.
+***********************************************************************************/
+void TraceStop(void)
+{
+#if defined(TX_ENABLE_EVENT_TRACE)
+    ULONG flags;
+
+    if(!_traceRunning || _traceStopRequest)
+    {
+        return;
+    }
+
+    tx_event_flags_set(&_traceEvent, ~TRACE_STOPPED_FLAG, TX_AND);
+    _traceStopRequest = true;
+    tx_event_flags_get(&_traceEvent, TRACE_STOPPED_FLAG, TX_OR_CLEAR, &flags, TRACE_STOP_TIMEOUT_MS);
+#endif
+}
+
+bool TraceSetFilter(ULONG eventMask)
+{
+#if defined(TX_ENABLE_EVENT_TRACE)
+    tx_trace_event_unfilter(TRACE_ALL_CLASSES);
+    return tx_trace_event_filter(TRACE_ALL_CLASSES & ~eventMask) == TX_SUCCESS;
+#else
+    return false;
+#endif
+}
+
+void TraceGetStats(sTraceStats *stats)
+{
+#if defined(TX_ENABLE_EVENT_TRACE)
+    *stats = _stats;
+    stats->running = _traceRunning;
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+
+/*********************************************************************************
+    Streaming ThreadX event trace.
+
+    ThreadX records events into a small circular RAM buffer; a drain thread
+    copies new entries out and streams them over a UART (DMA when the handle
+    has hdmatx linked, interrupt driven otherwise). Time stamps are the DWT
+    cycle counter. Requires a build with -DMANTICORE_TRACE=ON, which enables
+    TX_ENABLE_EVENT_TRACE in external/tx_user.h.
+
+    Packet layout (little endian), resynchronised on the magic by the host:
+        ['T']['X'][type u8][seq u8][len u16][payload len bytes][fletcher16 u16]
+
+    TRACE_PKT_HEADER payload is [core clock u32][TX_TRACE_HEADER][object registry],
+    re-sent every TRACE_HEADER_PERIOD_MS so a host may attach at any time.
+    TRACE_PKT_EVENTS payload is a run of TX_TRACE_BUFFER_ENTRY records.
+    TRACE_PKT_LOST payload is [entries lost u32] when the ring overran.
+
+    tools/trace/trace_capture.py reassembles the stream into a TraceX file.
+***********************************************************************************/
+
+#ifndef TRACE_BUFFER_ENTRIES
+#define TRACE_BUFFER_ENTRIES     64      // 32 bytes each
+#endif
+#ifndef TRACE_REGISTRY_ENTRIES
+#define TRACE_REGISTRY_ENTRIES   16      // 48 bytes each, one per named ThreadX object
+#endif
+#define TRACE_HEADER_PERIOD_MS   1000
+
+#define TRACE_EVENTS_DEFAULT     (TX_TRACE_INTERNAL_EVENTS | TX_TRACE_THREAD_EVENTS | TX_TRACE_USER_EVENTS)
+
+typedef enum
+{
+    TRACE_PKT_HEADER = 0x01,
+    TRACE_PKT_EVENTS = 0x02,
+    TRACE_PKT_LOST   = 0x03,
+} TRACE_PKT;
+
+typedef struct
+{
+    uint32_t entriesSent;
+    uint32_t entriesLost;
+    uint32_t packetsSent;
+    bool running;
+} sTraceStats;
+
+// Wrap IRQ handlers to record ISR enter/exit, the ISR id is the exception number
+#if defined(TX_ENABLE_EVENT_TRACE)
+#define TRACE_ISR_ENTER()                   tx_trace_isr_enter_insert((ULONG) __get_IPSR())
+#define TRACE_ISR_EXIT()                    tx_trace_isr_exit_insert((ULONG) __get_IPSR())
+#define TRACE_USER_EVENT(id, a, b, c, d)    tx_trace_user_event_insert(TX_TRACE_USER_EVENT_START + (id), (a), (b), (c), (d))
+#else
+#define TRACE_ISR_ENTER()
+#define TRACE_ISR_EXIT()
+#define TRACE_USER_EVENT(id, a, b, c, d)
+#endif
+
+bool TraceInit(UART_HandleTypeDef *uart);
+
+// eventMask is a combination of the TX_TRACE_*_EVENTS classes to record, others are filtered on target
+bool TraceStart(ULONG eventMask);
+void TraceStop(void);
+bool TraceSetFilter(ULONG eventMask);
+
+void TraceGetStats(sTraceStats *stats);
+
+#endif /* __TRACE_H */
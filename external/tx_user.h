@@ -0,0 +1,34 @@
+#ifndef TX_USER_H
+#define TX_USER_H
+
+/*********************************************************************************
+    MantiCore ThreadX configuration, copied into the ThreadX build as tx_user.h.
+    Everything here applies to the kernel, the port assembly and every module
+    that includes tx_api.h. See common/inc/tx_user_sample.h for all options.
+***********************************************************************************/
+
+/* Thread execution profiling for the console `top` command. The profile kit is
+   clocked by the DWT cycle counter (its default TX_EXECUTION_TIME_SOURCE) and
+   the Cortex-M port does not run ISRs through context save/restore, so ISRs
+   call _tx_execution_isr_enter/exit through SYSMON_ISR_ENTER/EXIT instead.
+   The Linux port has no profiling hooks, sysmon uses pthread CPU clocks there.
+   Define MANTICORE_DISABLE_PROFILING to build without the scheduler hooks.  */
+
+#if !defined(MANTICORE_DISABLE_PROFILING) && !defined(__linux__)
+#define TX_EXECUTION_PROFILE_ENABLE
+#define TX_CORTEX_M_EPK
+#endif
+
+#if !defined(MANTICORE_DISABLE_PROFILING)
+#define TX_THREAD_ENABLE_PERFORMANCE_INFO
+#endif
+
+/* Event trace for TraceX, streamed by common/trace. Opt in with -DMANTICORE_TRACE=ON,
+   every kernel service pays a check even while tracing is stopped. The time stamp
+   is the port default TX_TRACE_TIME_SOURCE, the DWT cycle counter.  */
+
+#if defined(MANTICORE_TRACE)
+#define TX_ENABLE_EVENT_TRACE
+#endif
+
+#endif /* TX_USER_H */
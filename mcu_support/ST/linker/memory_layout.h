@@ -0,0 +1,36 @@
+#ifndef __MEMORY_LAYOUT_H
+#define __MEMORY_LAYOUT_H
+
+/*********************************************************************************
+    Placement of latency critical code and tables.
+
+    Flash runs with FLASH_LATENCY_5 at 250 MHz. ICACHE hides the wait states
+    for cached lines, but the first run of an ISR after other code evicted it
+    stalls on line fills. MANTICORE_RAMFUNC functions are copied to SRAM by the
+    startup code and always run without wait states. MANTICORE_FASTDATA does
+    the same for const tables read in those paths; writable data is already in
+    SRAM. Mixing const and writable objects in one section fails to compile.
+
+    The .ramfunc and .fastdata sections are defined in the STM32H5xx_FLASH.ld
+    scripts. ThreadX and HAL code that cannot carry the attributes is placed by
+    the ramfunc_objects.ld fragment they include.
+
+    Configure with -DMANTICORE_RAM_PLACEMENT=OFF to leave everything in flash
+    and compare latencies against the default build.
+
+    MANTICORE_NOINIT objects go to .noinit, which the startup code neither
+    copies nor zeroes. They keep their contents across a reset and hold
+    garbage after power on, so they must carry their own validity check.
+***********************************************************************************/
+
+#if defined(MANTICORE_RAM_PLACEMENT)
+#define MANTICORE_RAMFUNC       __attribute__((section(".ramfunc")))
+#define MANTICORE_FASTDATA      __attribute__((section(".fastdata")))
+#else
+#define MANTICORE_RAMFUNC
+#define MANTICORE_FASTDATA
+#endif
+
+#define MANTICORE_NOINIT        __attribute__((section(".noinit")))
+
+#endif /* __MEMORY_LAYOUT_H */
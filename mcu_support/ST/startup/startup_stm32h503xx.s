@@ -44,6 +44,13 @@ defined in linker script */
 .word	_sbss
 /* end address for the .bss section. defined in linker script */
 .word	_ebss
+/* load, start and end addresses of the .ramfunc and .fastdata sections. defined in linker script */
+.word	_siramfunc
+.word	_sramfunc
+.word	_eramfunc
+.word	_sifastdata
+.word	_sfastdata
+.word	_efastdata
 
 .equ  BootRAM,        0xF1E0F85F
 /**
@@ -61,6 +68,45 @@ defined in linker script */
 Reset_Handler:
   ldr   sp, =_estack    /* set stack pointer */
 
+/* Start the DWT cycle counter for the boot profiler, see boot.h */
+	ldr	r0, =0xE000EDFC
+	ldr	r1, [r0]
+	orr	r1, r1, #0x01000000
+	str	r1, [r0]          /* DCB->DEMCR |= TRCENA */
+	ldr	r0, =0xE0001000
+	movs	r1, #0
+	str	r1, [r0, #4]      /* DWT->CYCCNT = 0 */
+	ldr	r1, [r0]
+	orr	r1, r1, #1
+	str	r1, [r0]          /* DWT->CTRL |= CYCCNTENA */
+
+/* Copy the ramfunc code and fastdata tables from flash to SRAM */
+	ldr	r0, =_sramfunc
+	ldr	r1, =_eramfunc
+	ldr	r2, =_siramfunc
+	b	LoopCopyRamFunc
+
+CopyRamFunc:
+	ldr	r3, [r2], #4
+	str	r3, [r0], #4
+
+LoopCopyRamFunc:
+	cmp	r0, r1
+	bcc	CopyRamFunc
+
+	ldr	r0, =_sfastdata
+	ldr	r1, =_efastdata
+	ldr	r2, =_sifastdata
+	b	LoopCopyFastData
+
+CopyFastData:
+	ldr	r3, [r2], #4
+	str	r3, [r0], #4
+
+LoopCopyFastData:
+	cmp	r0, r1
+	bcc	CopyFastData
+
 /* Copy the data segment initializers from flash to SRAM */
   movs	r1, #0
   b	LoopCopyDataInit
@@ -77,6 +123,11 @@ LoopCopyDataInit:
 	adds	r2, r0, r1
 	cmp	r2, r3
 	bcc	CopyDataInit
+/* Boot profiler: RAM sections copied */
+	ldr	r0, =0xE0001004
+	ldr	r1, [r0]
+	ldr	r0, =BootResetCycles
+	str	r1, [r0, #0]
 	ldr	r2, =_sbss
 	b	LoopFillZerobss
 /* Zero fill the bss segment. */
@@ -88,6 +139,11 @@ LoopFillZerobss:
 	ldr	r3, = _ebss
 	cmp	r2, r3
 	bcc	FillZerobss
+/* Boot profiler: .bss zeroed */
+	ldr	r0, =0xE0001004
+	ldr	r1, [r0]
+	ldr	r0, =BootResetCycles
+	str	r1, [r0, #4]
 
 /* Call the clock system initialization function.*/
     bl  SystemInit
@@ -101,6 +157,13 @@ LoopForever:
 
 .size	Reset_Handler, .-Reset_Handler
 
+/* Cycle counter at the COPY and ZERO boot phases, read by BootMark(BOOT_PHASE_MAIN) */
+	.section	.noinit.BootResetCycles,"aw",%nobits
+	.align	2
+.global BootResetCycles
+BootResetCycles:
+	.space	8
+
 /**
  * @brief  This is the code that gets called when the processor receives an
  *         unexpected interrupt.  This simply enters an infinite loop, preserving
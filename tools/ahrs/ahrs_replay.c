@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "ahrs_filter.h"
+
+/*********************************************************************************
+    Replay of recorded raw AMG samples through the common/ahrs Madgwick filter.
+
+    Every line of the log is one raw BNO055 sample in register LSBs, accel xyz,
+    mag xyz, gyro xyz, scaled the way thread_ahrs scales them. Columns after
+    the ninth are ignored, so tools/bno055_emu streams replay too. The
+    quaternion after every step is compared with the reference bit for bit,
+    any difference fails. The benchmark then replays the whole log again and
+    times AhrsFilterUpdate per step, in ns and, on x86, in TSC cycles.
+
+    Build from the repository root, with the same flags as the AHRS library:
+        gcc -std=gnu11 -O2 -Wall -ffp-contract=off -fno-math-errno -Icommon/ahrs \
+            common/ahrs/ahrs_filter.c tools/ahrs/ahrs_replay.c -lm -o ahrs_replay
+
+    Usage:
+        ahrs_replay tools/ahrs/amg_log.txt tools/ahrs/amg_reference.txt
+        ahrs_replay log.txt reference.txt --write     rewrite the reference after an intended change
+
+    Host timings only rank changes to the update, the target cost is in
+    AhrsGetStats.
+***********************************************************************************/
+
+#define REPLAY_SAMPLE_S     0.002f      // AHRS_DEFAULT_SAMPLE_MS
+#define REPLAY_MAX_STEPS    4096
+#define BENCH_ROUNDS        2000
+
+typedef struct
+{
+    float gyro[3];
+    float accel[3];
+    float mag[3];
+} sReplayStep;
+
+// Static Variables
+static sReplayStep _steps[REPLAY_MAX_STEPS];
+static uint32_t _quat[REPLAY_MAX_STEPS][4];
+static volatile float _sink;
+
+// Static Function Declarations
+static uint32_t _loadLog(const char *path);
+static uint32_t _bits(float value);
+static double _seconds(void);
+static void _bench(uint32_t count);
+
+
+// Static Function Definitions
+// Raw LSBs as thread_ahrs feeds them, accel and mag unscaled
+static uint32_t _loadLog(const char *path)
+{
+    FILE *log = fopen(path, "r");
+    char line[256];
+    int raw[9];
+    uint32_t count = 0;
+
+    if(log == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+
+    while(fgets(line, sizeof(line), log) != NULL && count < REPLAY_MAX_STEPS)
+    {
+        if(line[0] == '#' || sscanf(line, "%d %d %d %d %d %d %d %d %d", &raw[0], &raw[1], &raw[2],
+                                    &raw[3], &raw[4], &raw[5], &raw[6], &raw[7], &raw[8]) != 9)
+        {
+            continue;
+        }
+
+        for(int i = 0; i < 3; i++)
+        {
+            _steps[count].accel[i] = raw[i];
+            _steps[count].mag[i] = raw[3 + i];
+            _steps[count].gyro[i] = raw[6 + i] * AHRS_GYRO_RAD_PER_LSB;
+        }
+        count++;
+    }
+
+    fclose(log);
+    return count;
+}
+
+static uint32_t _bits(float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double _seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void _bench(uint32_t count)
+{
+    sAhrsFilter filter;
+    double start, ns;
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks;
+#endif
+
+    AhrsFilterInit(&filter, AHRS_DEFAULT_BETA, REPLAY_SAMPLE_S);
+    start = _seconds();
+#if defined(__x86_64__) || defined(__i386__)
+    ticks = __rdtsc();
+#endif
+    for(uint32_t r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            AhrsFilterUpdate(&filter, _steps[i].gyro, _steps[i].accel, _steps[i].mag);
+        }
+        _sink = filter.q.w;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    ticks = __rdtsc() - ticks;
+#endif
+    ns = (_seconds() - start) * 1e9 / ((double) BENCH_ROUNDS * count);
+
+#if defined(__x86_64__) || defined(__i386__)
+    printf("AhrsFilterUpdate %.1f ns, %.0f TSC cycles per step\n", ns, (double) ticks / ((double) BENCH_ROUNDS * count));
+#else
+    printf("AhrsFilterUpdate %.1f ns per step\n", ns);
+#endif
+}
+
+
+int main(int argc, char *argv[])
+{
+    sAhrsFilter filter;
+    sAhrsEuler euler;
+    FILE *reference;
+    char line[128];
+    uint32_t count, checked = 0, mismatched = 0;
+    bool write = (argc > 3 && strcmp(argv[3], "--write") == 0);
+
+    if(argc < 3)
+    {
+        printf("usage: %s log.txt reference.txt [--write]\n", argv[0]);
+        return 1;
+    }
+
+    count = _loadLog(argv[1]);
+    if(count == 0)
+    {
+        printf("no samples in %s\n", argv[1]);
+        return 1;
+    }
+
+    AhrsFilterInit(&filter, AHRS_DEFAULT_BETA, REPLAY_SAMPLE_S);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        AhrsFilterUpdate(&filter, _steps[i].gyro, _steps[i].accel, _steps[i].mag);
+        _quat[i][0] = _bits(filter.q.w);
+        _quat[i][1] = _bits(filter.q.x);
+        _quat[i][2] = _bits(filter.q.y);
+        _quat[i][3] = _bits(filter.q.z);
+    }
+
+    AhrsQuatToEuler(&filter.q, &euler);
+    printf("%u steps, final q %.6f %.6f %.6f %.6f, roll %.2f pitch %.2f yaw %.2f deg\n", count,
+           filter.q.w, filter.q.x, filter.q.y, filter.q.z,
+           euler.roll * 57.2957795f, euler.pitch * 57.2957795f, euler.yaw * 57.2957795f);
+
+    if(write)
+    {
+        reference = fopen(argv[2], "w");
+        if(reference == NULL)
+        {
+            perror(argv[2]);
+            return 1;
+        }
+
+        fprintf(reference, "# Quaternion w x y z after every step of the log, IEEE single bits\n");
+        for(uint32_t i = 0; i < count; i++)
+        {
+            fprintf(reference, "%08x %08x %08x %08x\n", _quat[i][0], _quat[i][1], _quat[i][2], _quat[i][3]);
+        }
+        fclose(reference);
+        printf("wrote %u steps to %s\n", count, argv[2]);
+        return 0;
+    }
+
+    reference = fopen(argv[2], "r");
+    if(reference == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), reference) != NULL)
+    {
+        uint32_t expected[4];
+
+        if(line[0] == '#' || sscanf(line, "%x %x %x %x", &expected[0], &expected[1], &expected[2], &expected[3]) != 4)
+        {
+            continue;
+        }
+
+        if(checked < count && memcmp(expected, _quat[checked], sizeof(expected)) != 0)
+        {
+            if(mismatched == 0)
+            {
+                printf("  ! step %u: %08x %08x %08x %08x, reference %08x %08x %08x %08x\n", checked,
+                       _quat[checked][0], _quat[checked][1], _quat[checked][2], _quat[checked][3],
+                       expected[0], expected[1], expected[2], expected[3]);
+            }
+            mismatched++;
+        }
+        checked++;
+    }
+    fclose(reference);
+
+    printf("%u steps checked, %u differ\n", checked, mismatched);
+    _bench(count);
+
+    if(checked != count || mismatched != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
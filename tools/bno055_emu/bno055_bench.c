@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bno055.h"
+#include "bno055_regs.h"
+#include "bno055_flash.h"
+#include "bno055_emu.h"
+#include "tx_api.h"
+
+/*********************************************************************************
+    Runs the BNO055 driver against the register map emulator and reports the
+    bus and blocking cost of each API call.
+
+    Build from the repository root:
+        gcc -std=gnu11 -O2 -no-pie -Wall -Itools/bno055_emu/include -Itools/bno055_emu \
+            -Icommon/bno055 -Icommon/fixmath -Icommon/prof common/bno055/bno055.c common/bno055/bno055_flash.c \
+            common/fixmath/fixmath.c tools/bno055_emu/bno055_emu.c tools/bno055_emu/bno055_bench.c \
+            -Wl,--defsym=_envdata=_snvdata+0x2000 -o bno055_bench
+
+    Usage:
+        bno055_bench [stream.txt] [snapshot reads]
+***********************************************************************************/
+
+#define BENCH_DEFAULT_READS     1000
+#define BENCH_FLASH_WRAP_SAVES  300         // Enough to fill the sector and force an erase
+#define BENCH_INIT_BUDGET_MS    800         // Power on to calibrated CONFIG mode, boot time included
+
+typedef struct
+{
+    sBno055EmuStats stats;
+    uint64_t time_US;
+} sBenchMark;
+
+// Static Variables
+static I2C_HandleTypeDef _hi2c;
+static uint8_t _dmaChannel;
+static BNO055_Bus_t _bus;
+static BNO055_Dev_t _imu;
+static BNO055_Dev_t _imu2;
+static uint32_t _failures;
+
+// Static Function Declarations
+static void _benchStart(sBenchMark *mark);
+static void _benchReport(const char *name, int status, const sBenchMark *mark);
+static void _benchExpect(const char *what, int ok);
+static const char *_benchStatus(int status);
+static bool _benchMatchesStream(const BNO055_Raw_Snapshot_t *raw, uint64_t time_US);
+
+
+// Static Function Definitions
+static void _benchStart(sBenchMark *mark)
+{
+    Bno055EmuGetStats(&mark->stats);
+    mark->time_US = Bno055EmuTime_US();
+}
+
+static void _benchReport(const char *name, int status, const sBenchMark *mark)
+{
+    sBno055EmuStats now;
+
+    Bno055EmuGetStats(&now);
+    printf("%-28s %-10s %6u %7u %9.2f %9.2f %9.2f %9.2f %5u %5u\n",
+           name, _benchStatus(status),
+           now.transactions - mark->stats.transactions,
+           now.bytes - mark->stats.bytes,
+           (now.busTime_US - mark->stats.busTime_US) / 1000.0,
+           (now.sleepTime_US - mark->stats.sleepTime_US) / 1000.0,
+           (now.flashTime_US - mark->stats.flashTime_US) / 1000.0,
+           (Bno055EmuTime_US() - mark->time_US) / 1000.0,
+           now.modeViolations - mark->stats.modeViolations,
+           now.ignoredWrites - mark->stats.ignoredWrites);
+}
+
+static void _benchExpect(const char *what, int ok)
+{
+    if(!ok)
+    {
+        printf("  ! %s\n", what);
+        _failures++;
+    }
+}
+
+static const char *_benchStatus(int status)
+{
+    switch(status)
+    {
+        case BNO055_SUCCESS:      return "ok";
+        case BNO055_NOT_DETECTED: return "not_found";
+        case BNO055_I2C_ERROR:    return "i2c_error";
+        case BNO055_TIMEOUT:      return "timeout";
+        case BNO055_BUSY:         return "busy";
+        case BNO055_FLASH_ERROR:  return "flash";
+        case BNO055_INVALID_ARG:  return "invalid";
+        default:                  return "-";
+    }
+}
+
+static bool _benchMatchesStream(const BNO055_Raw_Snapshot_t *raw, uint64_t time_US)
+{
+    const sBno055EmuSample *sample = Bno055EmuStreamAt(time_US);
+
+    return memcmp(raw->words, sample->words, sizeof(raw->words)) == 0 && raw->temp == sample->temp;
+}
+
+
+int main(int argc, char *argv[])
+{
+    BNO055_Axis_Vec_t vec;
+    BNO055_Quad_Vec_t quat;
+    BNO055_Snapshot_t snapshot;
+    BNO055_Raw_Snapshot_t raw;
+    BNO055_Raw_AMG_t amg;
+    BNO055_Raw_Snapshot_t raw2;
+    sBenchMark mark;
+    uint32_t reads = BENCH_DEFAULT_READS;
+    uint32_t mismatches = 0;
+    uint8_t profile[BNO055_CALIB_LEN];
+    uint8_t stored[BNO055_CALIB_LEN];
+    int status;
+
+    Bno055EmuInit();
+
+    if(argc > 1 && !Bno055EmuLoadStream(argv[1]))
+    {
+        fprintf(stderr, "cannot read stream %s\n", argv[1]);
+        return 2;
+    }
+    if(argc > 2)
+    {
+        reads = (uint32_t) strtoul(argv[2], NULL, 0);
+    }
+
+    _hi2c.hdmarx = &_dmaChannel;
+    BNO055_Bus_Mount(&_bus, &_hi2c);
+    BNO055_Mount(&_imu, &_bus, BNO055_I2C_ADDR_LO);
+
+    printf("%-28s %-10s %6s %7s %9s %9s %9s %9s %5s %5s\n",
+           "call", "status", "xfers", "bytes", "bus_ms", "sleep_ms", "flash_ms", "block_ms", "early", "ignor");
+
+    // Bring-up and mode switches
+    _benchStart(&mark);
+    status = BNO055_Init(&_imu);
+    _benchReport("Init (power on)", status, &mark);
+    _benchExpect("init should succeed", status == BNO055_SUCCESS);
+    _benchExpect("init should fit its time budget", Bno055EmuTime_US() - mark.time_US < BENCH_INIT_BUDGET_MS * 1000ULL);
+    _benchExpect("nothing to restore on a blank sector", !BNO055_Calib_Restored(&_imu));
+
+    _benchStart(&mark);
+    status = BNO055_Get_Accel(&_imu, &vec);
+    _benchReport("Get_Accel (enter NDOF)", status, &mark);
+
+    _benchStart(&mark);
+    status = BNO055_Get_Accel(&_imu, &vec);
+    _benchReport("Get_Accel", status, &mark);
+
+    _benchStart(&mark);
+    status = BNO055_Get_Quaternion(&_imu, &quat);
+    _benchReport("Get_Quaternion", status, &mark);
+
+    _benchStart(&mark);
+    status = BNO055_Get_Snapshot(&_imu, &snapshot);
+    _benchReport("Get_Snapshot", status, &mark);
+
+    _benchStart(&mark);
+    status = BNO055_Get_Raw_Snapshot(&_imu, &raw);
+    _benchReport("Get_Raw_Snapshot", status, &mark);
+    _benchExpect("raw snapshot should match the stream", _benchMatchesStream(&raw, Bno055EmuTime_US()));
+
+    // Calibration capture and restore
+    _benchStart(&mark);
+    status = BNO055_Calibrate(&_imu);
+    _benchReport("Calibrate (uncalibrated)", status, &mark);
+    _benchExpect("calibrate should wait for full status", status == BNO055_BUSY);
+
+    Bno055EmuSetCalibStat(BNO055_I2C_ADDR_LO, 0xFF);
+    _benchStart(&mark);
+    status = BNO055_Calibrate(&_imu);
+    _benchReport("Calibrate (store)", status, &mark);
+    _benchExpect("calibrate should store", status == BNO055_SUCCESS);
+
+    _benchStart(&mark);
+    status = BNO055_Calibrate(&_imu);
+    _benchReport("Calibrate (unchanged)", status, &mark);
+
+    for(uint8_t i = 0; i < BNO055_CALIB_LEN; i++)
+    {
+        profile[i] = Bno055EmuReadRegister(BNO055_I2C_ADDR_LO, 0, BNO055_CALIB_START + i);
+    }
+
+    Bno055EmuPowerCycle();
+    _benchStart(&mark);
+    status = BNO055_Init(&_imu);
+    _benchReport("Init (restore profile)", status, &mark);
+    _benchExpect("init should restore the stored profile", BNO055_Calib_Restored(&_imu));
+    _benchExpect("restore should fit the init time budget", Bno055EmuTime_US() - mark.time_US < BENCH_INIT_BUDGET_MS * 1000ULL);
+    for(uint8_t i = 0; i < BNO055_CALIB_LEN; i++)
+    {
+        _benchExpect("restored register differs", Bno055EmuReadRegister(BNO055_I2C_ADDR_LO, 0, BNO055_CALIB_START + i) == profile[i]);
+    }
+
+    // Chip already up, as after an MCU-only reset, so init has to reset it
+    _benchStart(&mark);
+    status = BNO055_Init(&_imu);
+    _benchReport("Init (chip already up)", status, &mark);
+    _benchExpect("warm init should succeed", status == BNO055_SUCCESS && BNO055_Calib_Restored(&_imu));
+    _benchExpect("warm init should reset the chip", Bno055EmuTime_US() - mark.time_US >= BNO055_RESET_MIN_MS * 1000ULL);
+
+    // Software fusion path
+    _benchStart(&mark);
+    status = BNO055_Set_Sensor_Config(&_imu, BNO055_ACC_RANGE_4G | BNO055_ACC_BW_250HZ,
+                                      BNO055_GYRO_RANGE_2000DPS | BNO055_GYRO_BW_523HZ);
+    _benchReport("Set_Sensor_Config", status, &mark);
+
+    // Same mode change AhrsStart makes, the chip has to follow it
+    _benchStart(&mark);
+    status = BNO055_Set_OP_Mode(&_imu, AMG);
+    _benchReport("Set_OP_Mode (AMG)", status, &mark);
+    _benchExpect("chip should be in AMG mode",
+                 (Bno055EmuReadRegister(BNO055_I2C_ADDR_LO, 0, BNO055_OPR_MODE) & 0x0F) == OPR_MODE_AMG);
+
+    _benchStart(&mark);
+    status = BNO055_Get_Raw_AMG(&_imu, &amg);
+    _benchReport("Get_Raw_AMG (in AMG)", status, &mark);
+
+    status = BNO055_Set_OP_Mode(&_imu, (BNO055_OPERATION_MODE) (NDOF + 1));
+    _benchExpect("unknown mode should be refused", status == BNO055_INVALID_ARG);
+    _benchExpect("unknown mode should leave the chip in AMG",
+                 (Bno055EmuReadRegister(BNO055_I2C_ADDR_LO, 0, BNO055_OPR_MODE) & 0x0F) == OPR_MODE_AMG &&
+                 _imu.currentMode == AMG);
+
+    _benchStart(&mark);
+    status = BNO055_Get_Raw_AMG(&_imu, &amg);
+    _benchReport("Get_Raw_AMG", status, &mark);
+
+    // Streamed snapshots at the fusion rate
+    _benchStart(&mark);
+    for(uint32_t i = 0; i < reads; i++)
+    {
+        tx_thread_sleep(BNO055_EMU_SAMPLE_US / 1000);
+        if(BNO055_Get_Raw_Snapshot(&_imu, &raw) != BNO055_SUCCESS || !_benchMatchesStream(&raw, Bno055EmuTime_US()))
+        {
+            mismatches++;
+        }
+    }
+    _benchReport("Get_Raw_Snapshot stream", mismatches == 0 ? BNO055_SUCCESS : BNO055_I2C_ERROR, &mark);
+    printf("  %u reads over %u stream samples, %u mismatched\n", reads, Bno055EmuStreamLength(), mismatches);
+    _failures += mismatches != 0;
+
+    // Redundant pair on one bus, reads queued together go out back-to-back
+    Bno055EmuAttach(BNO055_I2C_ADDR_HI);
+    BNO055_Mount(&_imu2, &_bus, BNO055_I2C_ADDR_HI);
+
+    _benchStart(&mark);
+    status = BNO055_Init(&_imu2);
+    _benchReport("Init (second device)", status, &mark);
+    _benchExpect("second device has no profile of its own", !BNO055_Calib_Restored(&_imu2));
+
+    Bno055EmuSetCalibStat(BNO055_I2C_ADDR_HI, 0xFF);
+    BNO055_Get_Raw_Snapshot(&_imu2, &raw2);
+    _benchStart(&mark);
+    status = BNO055_Calibrate(&_imu2);
+    _benchReport("Calibrate (second device)", status, &mark);
+    _benchExpect("second device should store", status == BNO055_SUCCESS);
+    _benchExpect("first profile survives the second save",
+                 BNO055_Flash_Load(0, stored) && memcmp(stored, profile, sizeof(profile)) == 0);
+
+    mismatches = 0;
+    BNO055_Get_Raw_Snapshot(&_imu, &raw);
+    _benchStart(&mark);
+    for(uint32_t i = 0; i < reads; i++)
+    {
+        uint64_t first_US, second_US;
+
+        tx_thread_sleep(BNO055_EMU_SAMPLE_US / 1000);
+        status = BNO055_Snapshot_Start(&_imu);
+        first_US = Bno055EmuTime_US();
+        status |= BNO055_Snapshot_Start(&_imu2);
+        second_US = Bno055EmuTime_US();
+        status |= BNO055_Raw_Snapshot_Wait(&_imu, &raw);
+        status |= BNO055_Raw_Snapshot_Wait(&_imu2, &raw2);
+        if(status != BNO055_SUCCESS || !_benchMatchesStream(&raw, first_US) || !_benchMatchesStream(&raw2, second_US))
+        {
+            mismatches++;
+        }
+    }
+    _benchReport("Snapshot pair stream", mismatches == 0 ? BNO055_SUCCESS : BNO055_I2C_ERROR, &mark);
+    {
+        sBno055EmuStats now;
+        Bno055EmuGetStats(&now);
+        printf("  %u pairs, %u burst reads, %u mismatched\n", reads, now.burstReads - mark.stats.burstReads, mismatches);
+        _benchExpect("one burst read per device per pair", now.burstReads - mark.stats.burstReads == 2 * reads);
+    }
+    _failures += mismatches != 0;
+
+    // A stuck read of the first device is aborted, the queued read of the second starts from the abort callback
+    Bno055EmuStallReads(BNO055_I2C_ADDR_LO, 1);
+    _benchStart(&mark);
+    tx_thread_sleep(BNO055_EMU_SAMPLE_US / 1000);
+    status = BNO055_Snapshot_Start(&_imu);
+    status |= BNO055_Snapshot_Start(&_imu2);
+    _benchExpect("stuck read should still queue", status == BNO055_SUCCESS);
+    _benchExpect("stuck read should time out", BNO055_Raw_Snapshot_Wait(&_imu, &raw) != BNO055_SUCCESS);
+    status = BNO055_Raw_Snapshot_Wait(&_imu2, &raw2);
+    _benchReport("Snapshot after abort", status, &mark);
+    {
+        sBno055EmuStats now;
+        Bno055EmuGetStats(&now);
+        printf("  %u aborted, %u refused while busy\n", now.aborts - mark.stats.aborts, now.busyReads - mark.stats.busyReads);
+        _benchExpect("the stuck read should be aborted once", now.aborts - mark.stats.aborts == 1);
+        _benchExpect("no read should start before the abort completes", now.busyReads == mark.stats.busyReads);
+    }
+    _benchExpect("queued read should complete after the abort", status == BNO055_SUCCESS);
+    _benchExpect("first device reads again after the abort",
+                 BNO055_Get_Raw_Snapshot(&_imu, &raw) == BNO055_SUCCESS && _benchMatchesStream(&raw, Bno055EmuTime_US()));
+
+    // Fill the sector with saves of the second device, the erase has to keep the first profile
+    _benchStart(&mark);
+    for(uint32_t i = 0; i < BENCH_FLASH_WRAP_SAVES; i++)
+    {
+        uint8_t churn[BNO055_CALIB_LEN] = { (uint8_t) i, (uint8_t) (i >> 8) };
+        if(BNO055_Flash_Save(1, churn) != HAL_OK)
+        {
+            _failures++;
+            break;
+        }
+    }
+    _benchReport("Flash_Save wrap", BNO055_SUCCESS, &mark);
+    {
+        sBno055EmuStats now;
+        Bno055EmuGetStats(&now);
+        _benchExpect("the sector should have been erased", now.flashErases > mark.stats.flashErases);
+    }
+    _benchExpect("first profile survives the erase",
+                 BNO055_Flash_Load(0, stored) && memcmp(stored, profile, sizeof(profile)) == 0);
+    _benchExpect("second device reads its newest save",
+                 BNO055_Flash_Load(1, stored) && stored[0] == (uint8_t) (BENCH_FLASH_WRAP_SAVES - 1));
+
+    printf("%s\n", _failures == 0 ? "PASS" : "FAIL");
+    return _failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,644 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bno055_emu.h"
+#include "bno055_regs.h"
+#include "stm32h5xx_hal.h"
+#include "tx_api.h"
+
+#define EMU_PAGES               2
+#define EMU_PAGE_SIZE           0x80
+#define EMU_NVDATA_SIZE         0x2000U
+#define EMU_NVDATA_OFFSET       0x1E000U    // Last sector of bank 2 on a 128K part
+#define EMU_FLASH_PROGRAM_US    60ULL       // Per quad-word
+#define EMU_FLASH_ERASE_US      2000ULL     // Per sector
+#define EMU_FUSION_FIRST        OPR_MODE_IMU
+#define EMU_SYS_STATUS_IDLE     0x00U
+#define EMU_SYS_STATUS_FUSION   0x05U
+
+// Emulated NVDATA sector, linked with --defsym=_envdata=_snvdata+0x2000
+uint32_t _snvdata[EMU_NVDATA_SIZE / sizeof(uint32_t)] __attribute__((aligned(16)));
+uint32_t Bno055EmuFlashBase;
+ICACHE_TypeDef Bno055EmuIcache;
+
+typedef struct
+{
+    bool attached;
+    uint8_t regs[EMU_PAGES][EMU_PAGE_SIZE];
+    uint8_t page;
+    uint8_t regPtr;
+    uint8_t calibStat;
+    uint64_t bootReady_US;
+    uint64_t modeReady_US;
+} sEmuChip;
+
+// Static Variables
+static sEmuChip _chips[BNO055_EMU_CHIPS];   // By address bit 0
+static sEmuChip *_chip = &_chips[0];        // Addressed by the current transfer
+static uint64_t _now_US;
+static bool _flashLocked = true;
+static sBno055EmuStats _stats;
+
+// Stalled burst reads and the abort of one, the abort callback is the next interrupt
+static uint8_t _stallAddr;
+static uint32_t _stallCount;
+static bool _readStalled;
+static I2C_HandleTypeDef *_abortPending;
+
+static sBno055EmuSample _stream[BNO055_EMU_MAX_SAMPLES];
+static uint32_t _streamLength;
+
+// Level and still, gravity on z, 16 LSB per uT field pointing north and down
+static const sBno055EmuSample _stillSample =
+{
+    .words = { 0, 0, 981,   320, 0, -640,   0, 0, 0,   0, 0, 0,   16384, 0, 0, 0,   0, 0, 0,   0, 0, 981 },
+    .temp = 25,
+};
+
+// Static Function Declarations
+static sEmuChip *_emuChip(uint16_t addr);
+static void _emuResetRegisters(void);
+static void _emuAdvance(uint64_t us, uint64_t *account);
+static bool _emuBusTransfer(uint16_t devAddress, uint16_t bytes);
+static void _emuCheckModeTime(void);
+static bool _emuConfigRegister(uint8_t page, uint8_t reg);
+static void _emuWrite(uint8_t reg, uint8_t value);
+static void _emuRefreshData(void);
+static uint8_t _emuRead(uint8_t reg);
+static void _emuInterrupts(void);
+
+
+// Static Function Definitions
+static sEmuChip *_emuChip(uint16_t addr)
+{
+    if((addr & ~1U) != BNO055_I2C_ADDR_LO)
+    {
+        return NULL;
+    }
+
+    return &_chips[addr & 1U];
+}
+
+static void _emuResetRegisters(void)
+{
+    uint8_t (*regs)[EMU_PAGE_SIZE] = _chip->regs;
+
+    memset(_chip->regs, 0, sizeof(_chip->regs));
+
+    regs[0][BNO055_CHIP_ID]         = BNO055_EXPECTED_ID;
+    regs[0][BNO055_ACC_ID]          = 0xFB;
+    regs[0][BNO055_MAG_ID]          = 0x32;
+    regs[0][BNO055_GYRO_ID]         = 0x0F;
+    regs[0][BNO055_SW_REV_ID_LSB]   = 0x11;
+    regs[0][BNO055_SW_REV_ID_MSB]   = 0x03;
+    regs[0][BNO055_BL_REV_ID]       = 0x15;
+    regs[0][BNO055_ST_RESULT]       = 0x0F;
+    regs[0][BNO055_UNIT_SEL]        = 0x80;
+    regs[0][BNO055_OPR_MODE]        = OPR_MODE_CONFIG;
+    regs[0][BNO055_AXIS_MAP_CONFIG] = 0x24;
+    regs[0][BNO055_ACC_RADIUS_LSB]  = 0xE8;    // 1000
+    regs[0][BNO055_ACC_RADIUS_MSB]  = 0x03;
+    regs[0][BNO055_MAG_RADIUS_LSB]  = 0xE0;    // 480
+    regs[0][BNO055_MAG_RADIUS_MSB]  = 0x01;
+
+    regs[1][BNO055_PAGE_ID]         = BNO055_PAGE_1;
+    regs[1][BNO055_ACC_CONFIG]      = 0x0D;
+    regs[1][BNO055_MAG_CONFIG]      = 0x6D;
+    regs[1][BNO055_GYRO_CONFIG_0]   = 0x38;
+
+    _chip->page = BNO055_PAGE_0;
+    _chip->regPtr = 0;
+    _chip->modeReady_US = 0;
+}
+
+static void _emuAdvance(uint64_t us, uint64_t *account)
+{
+    _now_US += us;
+    *account += us;
+}
+
+// Start, address byte and payload at 9 bits a byte, then stop. False if no chip ACKs the address.
+static bool _emuBusTransfer(uint16_t devAddress, uint16_t bytes)
+{
+    sEmuChip *chip = _emuChip(devAddress >> 1);
+    bool acked = chip != NULL && chip->attached && _now_US >= chip->bootReady_US;
+
+    if(acked)
+    {
+        _chip = chip;
+    }
+
+    if(!acked)
+    {
+        bytes = 0;
+        _stats.nacks++;
+    }
+
+    _stats.transactions++;
+    _stats.bytes += bytes + 1;
+    _emuAdvance(((bytes + 1) * 9ULL + 2) * 1000000ULL / BNO055_EMU_I2C_HZ, &_stats.busTime_US);
+
+    return acked;
+}
+
+static void _emuCheckModeTime(void)
+{
+    if(_now_US < _chip->modeReady_US)
+    {
+        _stats.modeViolations++;
+    }
+}
+
+// Registers the part only accepts in CONFIG mode
+static bool _emuConfigRegister(uint8_t page, uint8_t reg)
+{
+    if(page == BNO055_PAGE_1)
+    {
+        return reg != BNO055_PAGE_ID;
+    }
+
+    return reg == BNO055_UNIT_SEL || reg == BNO055_TEMP_SOURCE || reg == BNO055_AXIS_MAP_CONFIG ||
+           reg == BNO055_AXIS_MAP_SIGN || (reg >= BNO055_CALIB_START && reg < BNO055_CALIB_START + BNO055_CALIB_LEN);
+}
+
+static void _emuWrite(uint8_t reg, uint8_t value)
+{
+    uint8_t (*regs)[EMU_PAGE_SIZE] = _chip->regs;
+    uint8_t mode = regs[0][BNO055_OPR_MODE] & 0x0F;
+
+    if(reg >= EMU_PAGE_SIZE)
+    {
+        return;
+    }
+
+    if(reg == BNO055_PAGE_ID)
+    {
+        _chip->page = value & 0x01;
+        return;
+    }
+
+    if(_emuConfigRegister(_chip->page, reg) && mode != OPR_MODE_CONFIG)
+    {
+        _stats.ignoredWrites++;
+        return;
+    }
+
+    if(_chip->page == BNO055_PAGE_0 && reg == BNO055_OPR_MODE)
+    {
+        value &= 0x0F;
+        regs[0][reg] = value;
+        _chip->modeReady_US = _now_US + ((value == OPR_MODE_CONFIG) ? BNO055_ANY_TO_CONFIG_MS : BNO055_CONFIG_TO_ANY_MS) * 1000ULL;
+        regs[0][BNO055_SYS_STATUS] = (value >= EMU_FUSION_FIRST) ? EMU_SYS_STATUS_FUSION : EMU_SYS_STATUS_IDLE;
+        return;
+    }
+
+    if(_chip->page == BNO055_PAGE_0 && reg == BNO055_SYS_TRIGGER)
+    {
+        if(value & BNO055_SYS_RESET)
+        {
+            _emuResetRegisters();
+            _chip->bootReady_US = _now_US + BNO055_EMU_BOOT_US;
+        }
+        return;
+    }
+
+    // Data and status registers are read only
+    if(_chip->page == BNO055_PAGE_0 && reg < BNO055_UNIT_SEL)
+    {
+        return;
+    }
+
+    regs[_chip->page][reg] = value;
+}
+
+static void _emuRefreshData(void)
+{
+    const sBno055EmuSample *sample = Bno055EmuStreamAt(_now_US);
+    uint8_t (*regs)[EMU_PAGE_SIZE] = _chip->regs;
+    uint8_t mode = regs[0][BNO055_OPR_MODE] & 0x0F;
+    uint8_t words;
+
+    // CONFIG freezes the outputs, non-fusion modes only update the sensor words
+    if(mode == OPR_MODE_CONFIG)
+    {
+        return;
+    }
+
+    words = (mode >= EMU_FUSION_FIRST) ? BNO055_EMU_WORDS : 9;
+    for(uint8_t i = 0; i < words; i++)
+    {
+        regs[0][BNO055_ACC_DATA_X_LSB + 2 * i]     = (uint8_t) sample->words[i];
+        regs[0][BNO055_ACC_DATA_X_LSB + 2 * i + 1] = (uint8_t) ((uint16_t) sample->words[i] >> 8);
+    }
+    regs[0][BNO055_TEMP] = (uint8_t) sample->temp;
+    regs[0][BNO055_CALIB_STAT] = (mode >= EMU_FUSION_FIRST) ? _chip->calibStat : 0;
+}
+
+static uint8_t _emuRead(uint8_t reg)
+{
+    return (reg < EMU_PAGE_SIZE) ? _chip->regs[_chip->page][reg] : 0;
+}
+
+
+// Public Functions
+// Nothing runs concurrently, pending completions are taken when the driver waits
+static void _emuInterrupts(void)
+{
+    I2C_HandleTypeDef *hi2c = _abortPending;
+
+    if(hi2c != NULL)
+    {
+        _abortPending = NULL;
+        HAL_I2C_AbortCpltCallback(hi2c);
+    }
+}
+
+void Bno055EmuInit(void)
+{
+    memset(_snvdata, 0xFF, sizeof(_snvdata));
+    Bno055EmuFlashBase = (uint32_t) (uintptr_t) _snvdata - EMU_NVDATA_OFFSET;
+
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_chips, 0, sizeof(_chips));
+    _now_US = 0;
+    _streamLength = 0;
+    _stallCount = 0;
+    _readStalled = false;
+    _abortPending = NULL;
+
+    Bno055EmuAttach(BNO055_I2C_ADDR_LO);
+}
+
+bool Bno055EmuAttach(uint8_t addr)
+{
+    sEmuChip *chip = _emuChip(addr);
+
+    if(chip == NULL)
+    {
+        return false;
+    }
+
+    chip->attached = true;
+    chip->calibStat = 0;
+    _chip = chip;
+    _emuResetRegisters();
+    chip->bootReady_US = _now_US + BNO055_EMU_BOOT_US;
+    return true;
+}
+
+void Bno055EmuPowerCycle(void)
+{
+    for(uint8_t i = 0; i < BNO055_EMU_CHIPS; i++)
+    {
+        if(_chips[i].attached)
+        {
+            _chip = &_chips[i];
+            _emuResetRegisters();
+            _chip->bootReady_US = _now_US + BNO055_EMU_BOOT_US;
+        }
+    }
+}
+
+bool Bno055EmuLoadStream(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[512];
+
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    _streamLength = 0;
+    while(_streamLength < BNO055_EMU_MAX_SAMPLES && fgets(line, sizeof(line), file) != NULL)
+    {
+        sBno055EmuSample *sample = &_stream[_streamLength];
+        char *cursor = line;
+        char *end;
+        int fields = 0;
+
+        while(fields <= BNO055_EMU_WORDS)
+        {
+            long value = strtol(cursor, &end, 0);
+            if(end == cursor)
+            {
+                break;
+            }
+
+            if(fields < BNO055_EMU_WORDS)
+            {
+                sample->words[fields] = (int16_t) value;
+            }
+            else
+            {
+                sample->temp = (int8_t) value;
+            }
+            fields++;
+
+            cursor = end;
+            while(*cursor == ',' || *cursor == ' ' || *cursor == '\t')
+            {
+                cursor++;
+            }
+        }
+
+        // Comments, blank and short lines are skipped
+        if(fields == BNO055_EMU_WORDS)
+        {
+            sample->temp = _stillSample.temp;
+        }
+        if(fields >= BNO055_EMU_WORDS)
+        {
+            _streamLength++;
+        }
+    }
+
+    fclose(file);
+    return _streamLength > 0;
+}
+
+uint32_t Bno055EmuStreamLength(void)
+{
+    return _streamLength;
+}
+
+const sBno055EmuSample *Bno055EmuStreamAt(uint64_t time_US)
+{
+    if(_streamLength == 0)
+    {
+        return &_stillSample;
+    }
+
+    return &_stream[(time_US / BNO055_EMU_SAMPLE_US) % _streamLength];
+}
+
+void Bno055EmuSetCalibStat(uint8_t addr, uint8_t calibStat)
+{
+    sEmuChip *chip = _emuChip(addr);
+
+    if(chip != NULL)
+    {
+        chip->calibStat = calibStat;
+    }
+}
+
+void Bno055EmuStallReads(uint8_t addr, uint32_t count)
+{
+    _stallAddr = addr;
+    _stallCount = count;
+}
+
+uint8_t Bno055EmuReadRegister(uint8_t addr, uint8_t page, uint8_t reg)
+{
+    sEmuChip *chip = _emuChip(addr);
+
+    return (chip != NULL) ? chip->regs[page & 0x01][reg & 0x7F] : 0;
+}
+
+uint64_t Bno055EmuTime_US(void)
+{
+    return _now_US;
+}
+
+void Bno055EmuGetStats(sBno055EmuStats *stats)
+{
+    *stats = _stats;
+}
+
+
+// HAL I2C
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    if(!_emuBusTransfer(DevAddress, Size))
+    {
+        return HAL_ERROR;
+    }
+
+    _emuCheckModeTime();
+    _chip->regPtr = pData[0];
+    for(uint16_t i = 1; i < Size; i++)
+    {
+        _emuWrite(_chip->regPtr++, pData[i]);
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    if(!_emuBusTransfer(DevAddress, Size))
+    {
+        return HAL_ERROR;
+    }
+
+    _emuCheckModeTime();
+    _emuRefreshData();
+    for(uint16_t i = 0; i < Size; i++)
+    {
+        pData[i] = _emuRead(_chip->regPtr++);
+    }
+
+    return HAL_OK;
+}
+
+// Register address write, repeated start, then the read, as one transfer. The completion
+// callback runs before the call returns, so reads queued by it follow back-to-back.
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    if(_readStalled || _abortPending != NULL)
+    {
+        _stats.busyReads++;
+        return HAL_BUSY;
+    }
+
+    if(_stallCount > 0 && (DevAddress >> 1) == _stallAddr)
+    {
+        _stallCount--;
+        _readStalled = true;
+        return HAL_OK;
+    }
+
+    if(!_emuBusTransfer(DevAddress, Size + 2))
+    {
+        HAL_I2C_ErrorCallback(hi2c);
+        return HAL_OK;
+    }
+
+    _stats.burstReads++;
+    _emuCheckModeTime();
+    _emuRefreshData();
+    _chip->regPtr = (uint8_t) MemAddress;
+    for(uint16_t i = 0; i < Size; i++)
+    {
+        pData[i] = _emuRead(_chip->regPtr++);
+    }
+
+    HAL_I2C_MemRxCpltCallback(hi2c);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return HAL_I2C_Mem_Read_DMA(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+// Refused when no transfer is running, like the HAL outside master mode
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress)
+{
+    if(!_readStalled)
+    {
+        return HAL_ERROR;
+    }
+
+    _readStalled = false;
+    _abortPending = hi2c;
+    _stats.aborts++;
+    return HAL_OK;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    // nRESET low holds the part in reset, it boots again on release
+    if(PinState == GPIO_PIN_RESET)
+    {
+        _emuResetRegisters();
+        _chip->bootReady_US = UINT64_MAX;
+    }
+    else if(_chip->bootReady_US == UINT64_MAX)
+    {
+        _chip->bootReady_US = _now_US + BNO055_EMU_BOOT_US;
+    }
+}
+
+
+// HAL Flash
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    _flashLocked = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    _flashLocked = true;
+    return HAL_OK;
+}
+
+// Quad-words can only be programmed once per erase, as on the part
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t FlashAddress, uint32_t DataAddress)
+{
+    uint8_t *target = (uint8_t *) (uintptr_t) FlashAddress;
+    uint8_t *nvdata = (uint8_t *) _snvdata;
+
+    if(_flashLocked || TypeProgram != FLASH_TYPEPROGRAM_QUADWORD || (FlashAddress & 0x0F) != 0 ||
+       target < nvdata || target + 16 > nvdata + EMU_NVDATA_SIZE)
+    {
+        return HAL_ERROR;
+    }
+
+    for(uint8_t i = 0; i < 16; i++)
+    {
+        if(target[i] != 0xFF)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    memcpy(target, (const void *) (uintptr_t) DataAddress, 16);
+    _stats.flashPrograms++;
+    _emuAdvance(EMU_FLASH_PROGRAM_US, &_stats.flashTime_US);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+    uint32_t offset = (uint32_t) (uintptr_t) _snvdata - FLASH_BASE;
+
+    *SectorError = 0xFFFFFFFFU;
+    if(_flashLocked || pEraseInit->TypeErase != FLASH_TYPEERASE_SECTORS || pEraseInit->NbSectors != 1 ||
+       pEraseInit->Banks != FLASH_BANK_2 || pEraseInit->Sector != (offset % FLASH_BANK_SIZE) / FLASH_SECTOR_SIZE)
+    {
+        *SectorError = pEraseInit->Sector;
+        return HAL_ERROR;
+    }
+
+    memset(_snvdata, 0xFF, sizeof(_snvdata));
+    _stats.flashErases++;
+    _emuAdvance(EMU_FLASH_ERASE_US, &_stats.flashTime_US);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ICACHE_Invalidate(void)
+{
+    return HAL_OK;
+}
+
+
+// ThreadX
+UINT tx_semaphore_create(TX_SEMAPHORE *semaphore, CHAR *name, ULONG initial_count)
+{
+    semaphore->count = initial_count;
+    return TX_SUCCESS;
+}
+
+// Nothing else runs, so an empty semaphore can only time out
+UINT tx_semaphore_get(TX_SEMAPHORE *semaphore, ULONG wait_option)
+{
+    _emuInterrupts();
+
+    if(semaphore->count > 0)
+    {
+        semaphore->count--;
+        return TX_SUCCESS;
+    }
+
+    if(wait_option != TX_NO_WAIT && wait_option != TX_WAIT_FOREVER)
+    {
+        _emuAdvance(wait_option * 1000ULL, &_stats.sleepTime_US);
+    }
+
+    return TX_NO_INSTANCE;
+}
+
+UINT tx_semaphore_put(TX_SEMAPHORE *semaphore)
+{
+    semaphore->count++;
+    return TX_SUCCESS;
+}
+
+// Nothing else runs, a free mutex is all there is
+UINT tx_mutex_create(TX_MUTEX *mutex_ptr, CHAR *name_ptr, UINT inherit)
+{
+    mutex_ptr->count = 0;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_get(TX_MUTEX *mutex_ptr, ULONG wait_option)
+{
+    mutex_ptr->count++;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_put(TX_MUTEX *mutex_ptr)
+{
+    if(mutex_ptr->count == 0)
+    {
+        return TX_NOT_OWNED;
+    }
+
+    mutex_ptr->count--;
+    return TX_SUCCESS;
+}
+
+UINT tx_thread_sleep(ULONG timer_ticks)
+{
+    _emuInterrupts();
+    _emuAdvance(timer_ticks * 1000ULL, &_stats.sleepTime_US);
+    return TX_SUCCESS;
+}
+
+ULONG tx_time_get(void)
+{
+    return (ULONG) (_now_US / 1000ULL);
+}
@@ -0,0 +1,79 @@
+#ifndef __BNO055_EMU_H
+#define __BNO055_EMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+    BNO055 register map emulator for host builds of common/bno055.
+
+    Serves the HAL I2C calls of the driver from emulated register maps, one
+    per attached chip at BNO055_I2C_ADDR_LO and _HI on a single bus, with
+    both pages, the operating modes and their switch times, the boot and reset
+    time, CONFIG-only registers and the calibration status. Sensor registers
+    are refreshed from a replayed stream at BNO055_EMU_SAMPLE_US, fusion
+    registers only in fusion modes like the real part.
+
+    Time is virtual and advances by I2C bus time, flash time and the driver's
+    sleeps, so the counters describe what a call costs on the target bus.
+
+    Stream file: one sample per line, '#' starts a comment. 22 integers in
+    register order (accel xyz, mag xyz, gyro xyz, euler hrp, quaternion wxyz,
+    linear accel xyz, gravity xyz) and an optional temperature.
+***********************************************************************************/
+
+#define BNO055_EMU_I2C_HZ       400000UL
+#define BNO055_EMU_BOOT_US      650000ULL    // Power on and reset to first ACK
+#define BNO055_EMU_SAMPLE_US    10000ULL     // Fusion output rate
+#define BNO055_EMU_WORDS        22
+#define BNO055_EMU_MAX_SAMPLES  4096
+#define BNO055_EMU_CHIPS        2
+
+typedef struct
+{
+    uint32_t transactions;          // I2C transfers started, a memory read counts once
+    uint32_t bytes;                 // Bytes on the bus including address bytes
+    uint32_t burstReads;            // Completed DMA/IT memory reads
+    uint32_t nacks;                 // Transfers refused while booting
+    uint32_t busyReads;             // Burst reads refused while one was stalled or being aborted
+    uint32_t aborts;                // Stalled reads aborted by the driver
+    uint32_t modeViolations;        // Accesses before a mode switch time elapsed
+    uint32_t ignoredWrites;         // Config register writes outside CONFIG mode
+    uint32_t flashErases;
+    uint32_t flashPrograms;         // Quad-words
+    uint64_t busTime_US;
+    uint64_t sleepTime_US;          // tx_thread_sleep and semaphore timeouts
+    uint64_t flashTime_US;
+} sBno055EmuStats;
+
+typedef struct
+{
+    int16_t words[BNO055_EMU_WORDS];
+    int8_t temp;
+} sBno055EmuSample;
+
+// Power on with an erased NVDATA sector, the built-in level, still sample and one chip at BNO055_I2C_ADDR_LO
+void Bno055EmuInit(void);
+
+// Power on a chip at the other address, both see the same stream
+bool Bno055EmuAttach(uint8_t addr);
+
+// Power cycle the attached chips, flash and the clock are kept
+void Bno055EmuPowerCycle(void);
+
+bool Bno055EmuLoadStream(const char *path);
+uint32_t Bno055EmuStreamLength(void);
+// Sample the registers hold at time_US
+const sBno055EmuSample *Bno055EmuStreamAt(uint64_t time_US);
+
+void Bno055EmuSetCalibStat(uint8_t addr, uint8_t calibStat);
+
+// The next count burst reads from addr never complete. Like the HAL, a read started while one is
+// stalled or being aborted returns HAL_BUSY, and an abort completes on the driver's next wait.
+void Bno055EmuStallReads(uint8_t addr, uint32_t count);
+uint8_t Bno055EmuReadRegister(uint8_t addr, uint8_t page, uint8_t reg);
+
+uint64_t Bno055EmuTime_US(void);
+void Bno055EmuGetStats(sBno055EmuStats *stats);
+
+#endif /* __BNO055_EMU_H */
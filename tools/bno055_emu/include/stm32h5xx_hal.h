@@ -0,0 +1,94 @@
+#ifndef __STM32H5XX_HAL_H
+#define __STM32H5XX_HAL_H
+
+/*********************************************************************************
+    Host stand-in for the subset of the STM32H5 HAL used by common/bno055.
+
+    I2C calls are served by the BNO055 register map emulator, flash calls by an
+    emulated NVDATA sector. Builds must link with -no-pie so static data has
+    32-bit addresses, as the flash HAL passes addresses as uint32_t.
+***********************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum
+{
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+// I2C
+typedef struct
+{
+    void *hdmarx;                   // Non-NULL selects the DMA read path in the driver
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT    0x00000001U
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress);
+
+// Defined by the driver, called by the emulator when a non-blocking read ends
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c);
+
+// GPIO, only for BNO055_HARDWARE_RESET builds
+typedef struct
+{
+    uint32_t unused;
+} GPIO_TypeDef;
+
+typedef enum
+{
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+// Flash, the emulated NVDATA sector is the last sector of bank 2 on a 128K part
+extern uint32_t Bno055EmuFlashBase;
+
+#define FLASH_BASE                   Bno055EmuFlashBase
+#define FLASH_BANK_SIZE              0x10000U
+#define FLASH_SECTOR_SIZE            0x2000U
+#define FLASH_BANK_1                 0x00000001U
+#define FLASH_BANK_2                 0x00000002U
+#define FLASH_TYPEERASE_SECTORS      0x00000004U
+#define FLASH_TYPEPROGRAM_QUADWORD   0x00000002U
+
+typedef struct
+{
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Sector;
+    uint32_t NbSectors;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t FlashAddress, uint32_t DataAddress);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+
+// ICACHE, never enabled on the host
+typedef struct
+{
+    volatile uint32_t CR;
+} ICACHE_TypeDef;
+
+extern ICACHE_TypeDef Bno055EmuIcache;
+
+#define ICACHE                  (&Bno055EmuIcache)
+#define ICACHE_CR_EN            0x00000001U
+#define READ_BIT(REG, BIT)      ((REG) & (BIT))
+
+HAL_StatusTypeDef HAL_ICACHE_Invalidate(void);
+
+#endif /* __STM32H5XX_HAL_H */
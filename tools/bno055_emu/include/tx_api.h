@@ -0,0 +1,51 @@
+#ifndef __TX_API_H
+#define __TX_API_H
+
+/*********************************************************************************
+    Host stand-in for the ThreadX services used by common/bno055.
+
+    There is one thread of control. Time is virtual: sleeps and semaphore
+    timeouts advance the emulator clock instead of blocking, so a run measures
+    what the driver would block for on the target. One tick is one ms.
+***********************************************************************************/
+
+#include <stdint.h>
+
+typedef unsigned long ULONG;
+typedef unsigned int UINT;
+typedef char CHAR;
+
+#define TX_SUCCESS          0x00U
+#define TX_NO_INSTANCE      0x0DU
+#define TX_NOT_OWNED        0x1EU
+#define TX_INHERIT          1U
+#define TX_NO_WAIT          0UL
+#define TX_WAIT_FOREVER     0xFFFFFFFFUL
+
+typedef struct
+{
+    ULONG count;
+} TX_SEMAPHORE;
+
+UINT tx_semaphore_create(TX_SEMAPHORE *semaphore, CHAR *name, ULONG initial_count);
+UINT tx_semaphore_get(TX_SEMAPHORE *semaphore, ULONG wait_option);
+UINT tx_semaphore_put(TX_SEMAPHORE *semaphore);
+
+typedef struct
+{
+    ULONG count;
+} TX_MUTEX;
+
+UINT tx_mutex_create(TX_MUTEX *mutex_ptr, CHAR *name_ptr, UINT inherit);
+UINT tx_mutex_get(TX_MUTEX *mutex_ptr, ULONG wait_option);
+UINT tx_mutex_put(TX_MUTEX *mutex_ptr);
+
+// Interrupts are the emulator's synchronous callbacks, there is nothing to mask
+#define TX_INTERRUPT_SAVE_AREA
+#define TX_DISABLE
+#define TX_RESTORE
+
+UINT tx_thread_sleep(ULONG timer_ticks);
+ULONG tx_time_get(void);
+
+#endif /* __TX_API_H */
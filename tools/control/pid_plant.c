@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "pid.h"
+
+/*********************************************************************************
+    Step responses of the common/control PID block on host plant models.
+
+    Each case closes the loop around a simulated plant, integrated at ten
+    substeps per controller period, and checks rise time, overshoot, settling
+    time and steady-state error against limits. The Q31 block runs the same
+    position case and has to track the float trajectory.
+
+    Plants, normalised so full scale is 1:
+        speed      first order, tau 50 ms, full drive gives full speed
+        position   integrator behind the speed plant, full speed is 2 /s
+
+    Build from the repository root:
+        gcc -std=gnu11 -O2 -Wall -ffp-contract=off -Icommon/control -Icommon/fixmath \
+            common/control/pid.c tools/control/pid_plant.c -lm -o pid_plant
+
+    Usage:
+        pid_plant [trace.csv]       optional per step trace of every case
+***********************************************************************************/
+
+#define PLANT_DT            0.001f      // Controller period
+#define PLANT_SUBSTEPS      10
+#define PLANT_TAU           0.05f
+#define PLANT_MAX_SPEED     2.0f
+#define PLANT_MAX_STEPS     4000
+
+typedef enum
+{
+    PLANT_SPEED,
+    PLANT_POSITION
+} ePlant;
+
+typedef enum
+{
+    BLOCK_FLOAT,
+    BLOCK_Q31
+} eBlock;
+
+typedef struct
+{
+    const char *name;
+    ePlant plant;
+    eBlock block;
+    sPidConfig config;
+    float setpoint;
+    float disturbance;              // Drive lost to load from disturbanceAt on, fraction of full scale
+    float disturbanceAt;            // Seconds
+    float duration;                 // Seconds
+    float riseMax;                  // Seconds, 10 to 90 percent
+    float overshootMax;             // Percent of the step
+    float settleMax;                // Seconds into a 2 percent band
+    float errorMax;                 // Final error, percent of the step
+} sPlantCase;
+
+typedef struct
+{
+    float rise;
+    float overshoot;
+    float settle;
+    float finalError;
+    float recover;                  // Seconds back into the band after the disturbance, 0 if none
+    bool saturated;                 // Output hit a limit at some point
+} sPlantResult;
+
+typedef struct
+{
+    float speed;
+    float position;
+} sPlantState;
+
+// Static Variables
+static float _trajectory[2][PLANT_MAX_STEPS];
+static FILE *_trace;
+static uint32_t _failures;
+
+// Static Function Declarations
+static float _plantStep(sPlantState *state, ePlant plant, float drive);
+static bool _plantRun(const sPlantCase *test, sPlantResult *result, float trajectory[]);
+static void _plantExpect(const char *what, bool ok);
+
+
+// Static Function Definitions
+// One controller period of the plant, drive in [-1, 1]
+static float _plantStep(sPlantState *state, ePlant plant, float drive)
+{
+    const float h = PLANT_DT / PLANT_SUBSTEPS;
+
+    for(int i = 0; i < PLANT_SUBSTEPS; i++)
+    {
+        state->speed += h * (drive - state->speed) / PLANT_TAU;
+        state->position += h * PLANT_MAX_SPEED * state->speed;
+    }
+
+    return plant == PLANT_SPEED ? state->speed : state->position;
+}
+
+static bool _plantRun(const sPlantCase *test, sPlantResult *result, float trajectory[])
+{
+    sPid pid;
+    sPidQ31 pidQ31;
+    sPlantState state = { 0.0f, 0.0f };
+    float measurement = 0.0f;
+    float output;
+    float peak = 0.0f;
+    float lastOutside = 0.0f;
+    float disturbedOutside = 0.0f;
+    float t10 = -1.0f, t90 = -1.0f;
+    uint32_t steps = (uint32_t) (test->duration / PLANT_DT + 0.5f);
+
+    if(steps > PLANT_MAX_STEPS)
+    {
+        return false;
+    }
+    if(test->block == BLOCK_FLOAT ? !PidInit(&pid, &test->config) : !PidQ31Init(&pidQ31, &test->config))
+    {
+        return false;
+    }
+
+    result->saturated = false;
+    for(uint32_t i = 0; i < steps; i++)
+    {
+        float t = i * PLANT_DT;
+        bool disturbed = test->disturbance != 0.0f && t >= test->disturbanceAt;
+
+        if(test->block == BLOCK_FLOAT)
+        {
+            output = PidUpdate(&pid, test->setpoint, measurement);
+            result->saturated |= pid.saturated;
+        }
+        else
+        {
+            output = PID_Q31_TO_FLOAT(PidQ31Update(&pidQ31, PID_FLOAT_TO_Q31(test->setpoint), PID_FLOAT_TO_Q31(measurement)));
+            result->saturated |= pidQ31.saturated;
+        }
+
+        measurement = _plantStep(&state, test->plant, output - (disturbed ? test->disturbance : 0.0f));
+        if(trajectory != NULL)
+        {
+            trajectory[i] = measurement;
+        }
+        if(_trace != NULL)
+        {
+            fprintf(_trace, "%s,%.4f,%.6f,%.6f,%.6f\n", test->name, t + PLANT_DT, test->setpoint, output, measurement);
+        }
+
+        // Step metrics, the disturbance window is tracked on its own
+        if(t10 < 0.0f && measurement >= 0.1f * test->setpoint)
+        {
+            t10 = t;
+        }
+        if(t90 < 0.0f && measurement >= 0.9f * test->setpoint)
+        {
+            t90 = t;
+        }
+        if(fabsf(measurement - test->setpoint) > 0.02f * test->setpoint)
+        {
+            if(disturbed)
+            {
+                disturbedOutside = t + PLANT_DT - test->disturbanceAt;
+            }
+            else
+            {
+                lastOutside = t + PLANT_DT;
+            }
+        }
+        if(!disturbed && measurement > peak)
+        {
+            peak = measurement;
+        }
+    }
+
+    result->rise = (t10 >= 0.0f && t90 >= 0.0f) ? t90 - t10 : INFINITY;
+    result->overshoot = peak > test->setpoint ? 100.0f * (peak - test->setpoint) / test->setpoint : 0.0f;
+    result->settle = lastOutside;
+    result->finalError = 100.0f * fabsf(measurement - test->setpoint) / test->setpoint;
+    result->recover = disturbedOutside;
+    return true;
+}
+
+static void _plantExpect(const char *what, bool ok)
+{
+    if(!ok)
+    {
+        printf("  ! %s\n", what);
+        _failures++;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    // Speed PI cancels the plant pole. Position is already type 1, PD alone tracks a step and the
+    // integral only earns its place against a load. The large steps sit at the limit for a third
+    // of a second, without anti-windup the integral would take the position far past the target.
+    static const sPlantCase cases[] =
+    {
+        { "speed PI",             PLANT_SPEED,    BLOCK_FLOAT, { 2.0f, 40.0f, 0.0f,  PLANT_DT, 0.0f,   -1.0f, 1.0f }, 0.5f, 0.0f, 0.0f, 1.0f, 0.10f, 2.0f, 0.20f, 0.1f },
+        { "speed PI load step",   PLANT_SPEED,    BLOCK_FLOAT, { 2.0f, 40.0f, 0.0f,  PLANT_DT, 0.0f,   -1.0f, 1.0f }, 0.5f, 0.2f, 1.0f, 2.0f, 0.10f, 2.0f, 0.20f, 0.1f },
+        { "position PD",          PLANT_POSITION, BLOCK_FLOAT, { 6.0f, 0.0f,  0.15f, PLANT_DT, 0.005f, -1.0f, 1.0f }, 0.2f, 0.0f, 0.0f, 1.0f, 0.25f, 2.0f, 0.40f, 0.1f },
+        { "position PID sat",     PLANT_POSITION, BLOCK_FLOAT, { 8.0f, 20.0f, 0.2f,  PLANT_DT, 0.005f, -1.0f, 1.0f }, 0.8f, 0.1f, 1.5f, 3.0f, 0.60f, 5.0f, 1.00f, 0.2f },
+        { "position PID sat Q31", PLANT_POSITION, BLOCK_Q31,   { 8.0f, 20.0f, 0.2f,  PLANT_DT, 0.005f, -1.0f, 1.0f }, 0.8f, 0.1f, 1.5f, 3.0f, 0.60f, 5.0f, 1.00f, 0.2f },
+    };
+    sPlantResult result;
+    float maxDelta = 0.0f;
+
+    if(argc > 1)
+    {
+        _trace = fopen(argv[1], "w");
+        if(_trace == NULL)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+        fprintf(_trace, "case,time,setpoint,output,measurement\n");
+    }
+
+    printf("%-22s %8s %10s %9s %9s %9s %4s\n", "case", "rise ms", "overshoot", "settle ms", "error %", "load ms", "sat");
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const sPlantCase *test = &cases[i];
+        float *trajectory = (i == 3) ? _trajectory[0] : ((i == 4) ? _trajectory[1] : NULL);
+
+        if(!_plantRun(test, &result, trajectory))
+        {
+            printf("%-22s invalid configuration\n", test->name);
+            _failures++;
+            continue;
+        }
+
+        printf("%-22s %8.1f %9.2f%% %9.1f %9.3f %9.1f %4s\n", test->name, result.rise * 1000.0f, result.overshoot,
+               result.settle * 1000.0f, result.finalError, result.recover * 1000.0f, result.saturated ? "yes" : "no");
+        _plantExpect("rise time", result.rise <= test->riseMax);
+        _plantExpect("overshoot", result.overshoot <= test->overshootMax);
+        _plantExpect("settling time", result.settle <= test->settleMax);
+        _plantExpect("steady-state error", result.finalError <= test->errorMax);
+        if(test->disturbance != 0.0f)
+        {
+            _plantExpect("load step recovery", result.recover <= test->settleMax);
+        }
+    }
+
+    // The saturated cases spend their first part at the limit, anti-windup keeps the overshoot down
+    for(uint32_t i = 0; i < (uint32_t) (cases[3].duration / PLANT_DT + 0.5f); i++)
+    {
+        float delta = fabsf(_trajectory[0][i] - _trajectory[1][i]);
+        maxDelta = delta > maxDelta ? delta : maxDelta;
+    }
+    printf("Q31 tracks float within %.6f of full scale\n", maxDelta);
+    _plantExpect("Q31 trajectory", maxDelta < 0.001f);
+
+    // Invalid configurations are refused
+    {
+        sPid pid;
+        sPidQ31 pidQ31;
+        sPidConfig config = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f };
+
+        _plantExpect("zero dt refused", !PidInit(&pid, &config));
+        config.dt = PLANT_DT;
+        config.outMax = 2.0f;
+        _plantExpect("Q31 range above full scale refused", !PidQ31Init(&pidQ31, &config));
+        config.outMax = 1.0f;
+        config.kp = 4e9f;
+        _plantExpect("Q31 gain beyond 2^30 refused", !PidQ31Init(&pidQ31, &config));
+    }
+
+    if(_trace != NULL)
+    {
+        fclose(_trace);
+    }
+
+    printf("%s\n", _failures == 0 ? "PASS" : "FAIL");
+    return _failures == 0 ? 0 : 1;
+}
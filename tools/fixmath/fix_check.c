@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "fixmath.h"
+
+/*********************************************************************************
+    Checks and benchmarks of common/fixmath.
+
+    The linear transforms are swept over the driver ranges and compared
+    with the exact rational result and with the float map() they replace.
+    Saturating arithmetic is compared with a 64 bit reference on edge and
+    random operands, and every vector kernel with its scalar definition on
+    odd lengths, so the packed loop and the tail both run. The benchmark
+    times map() against FixLinearApply and each kernel per element.
+
+    Build from the repository root, portable path:
+        gcc -std=gnu11 -O2 -Wall -Icommon/fixmath \
+            common/fixmath/fixmath.c tools/fixmath/fix_check.c -lm -o fix_check
+
+    Packed lane path on the host, against the intrinsic models in include/:
+        gcc -std=gnu11 -O2 -Wall -D__ARM_FEATURE_DSP=1 -Itools/fixmath/include -Icommon/fixmath \
+            common/fixmath/fixmath.c tools/fixmath/fix_check.c -lm -o fix_check_dsp
+
+    Host timings only rank the two approaches, on the target map() is a
+    float divide and FixLinearApply an SMLAL and a shift.
+***********************************************************************************/
+
+#define CHECK_RANDOM        1000000
+#define CHECK_VEC_LEN       1023        // Odd, leaves a tail element
+#define BENCH_CALLS         20000000
+#define BENCH_VEC_ROUNDS    20000
+
+typedef struct
+{
+    const char *name;
+    int32_t inMin;
+    int32_t inMax;
+    int32_t outMin;
+    int32_t outMax;
+    int32_t step;                   // Input sweep step
+    double errorMax;                // Counts from the exact result
+} sLinearCase;
+
+// Static Variables
+static uint32_t _failures;
+static uint32_t _seed = 12345;
+static volatile int32_t _sink;
+static q15_t _a[CHECK_VEC_LEN], _b[CHECK_VEC_LEN], _out[CHECK_VEC_LEN], _ref[CHECK_VEC_LEN];
+static int32_t _wide[CHECK_VEC_LEN], _wideRef[CHECK_VEC_LEN];
+static uint8_t _shift[CHECK_VEC_LEN];
+
+// Static Function Declarations
+static void _checkExpect(const char *what, bool ok);
+static uint32_t _random(void);
+static float _mapFloat(float x, float x_min, float x_max, float out_min, float out_max);
+static double _seconds(void);
+static void _checkLinear(void);
+static void _checkScalar(void);
+static void _checkVectors(void);
+static void _bench(void);
+
+
+// Static Function Definitions
+static void _checkExpect(const char *what, bool ok)
+{
+    if(!ok)
+    {
+        printf("  ! %s\n", what);
+        _failures++;
+    }
+}
+
+static uint32_t _random(void)
+{
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    return _seed;
+}
+
+// Copy of map() in common/utility/utility.h, which needs the device headers
+static float _mapFloat(float x, float x_min, float x_max, float out_min, float out_max)
+{
+    if(x <= x_min)
+    {
+        return out_min;
+    }
+    if(x >= x_max)
+    {
+        return out_max;
+    }
+
+    return (x - x_min) * (out_max - out_min) / (x_max - x_min) + out_min;
+}
+
+static double _seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void _checkLinear(void)
+{
+    // The ranges the drivers set up, then the extremes of the 32 bit domain
+    static const sLinearCase cases[] =
+    {
+        { "servo angle",          -90,        90,         500,        2500,       1,      0.5 },
+        { "actuator length",       10,        90,        1100,        1900,       1,      0.5 },
+        { "dc motor speed",         0,       100,           0,        1999,       1,      0.5 },
+        { "dc motor drive q15",     0,     32768,         100,         999,       1,      0.5 },
+        { "servo pulse 1/16 us",    0,    320000,           0,       19999,       1,      0.5 },
+        { "falling output",         0,       100,        4000,        1000,       1,      0.5 },
+        { "steep",                  0,         3,           0,  2000000000,       1,      0.5 },
+        { "full range",   -1073741824, 1073741823, INT32_MIN,   INT32_MAX,   65521,      1.0 },
+    };
+    sFixLinear map;
+
+    printf("%-22s %8s %10s %11s %10s\n", "transform", "shift", "max error", "map() diff", "inputs");
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const sLinearCase *test = &cases[i];
+        double worst = 0.0;
+        uint32_t mapDiff = 0, inputs = 0;
+        bool floatComparable = fabs((double) test->outMax - test->outMin) < (1 << 23);
+
+        if(!FixLinearInit(&map, test->inMin, test->inMax, test->outMin, test->outMax))
+        {
+            printf("%-22s refused\n", test->name);
+            _failures++;
+            continue;
+        }
+
+        for(int64_t x = (int64_t) test->inMin - 2; x <= (int64_t) test->inMax + 2; x += test->step)
+        {
+            int32_t fix = FixLinearApply(&map, (int32_t) x);
+            double exact;
+
+            if(x <= test->inMin)
+            {
+                exact = test->outMin;
+            }
+            else if(x >= test->inMax)
+            {
+                exact = test->outMax;
+            }
+            else
+            {
+                exact = test->outMin + (double) (x - test->inMin) * ((double) test->outMax - test->outMin) / ((double) test->inMax - test->inMin);
+            }
+
+            worst = fmax(worst, fabs(fix - exact));
+            // map() truncates where it is assigned to a compare register, rounding moves some values by one
+            if(floatComparable && fix != (int32_t) _mapFloat((float) x, test->inMin, test->inMax, test->outMin, test->outMax))
+            {
+                mapDiff++;
+            }
+            inputs++;
+        }
+
+        printf("%-22s %8u %10.6f %11u %10u\n", test->name, map.shift, worst, mapDiff, inputs);
+        // Half a count of rounding plus the slope's own rounding, a few millionths of a count here
+        _checkExpect("within the rounding error of the exact line", worst <= test->errorMax + 1e-4);
+    }
+
+    _checkExpect("inverted input range refused", !FixLinearInit(&map, 10, 0, 0, 100));
+    _checkExpect("input range above INT32_MAX refused", !FixLinearInit(&map, INT32_MIN, INT32_MAX, 0, 100));
+    _checkExpect("single point range accepted", FixLinearInit(&map, 5, 5, 10, 20));
+    _checkExpect("single point clamps like map()", FixLinearApply(&map, 5) == 10 && FixLinearApply(&map, 6) == 20 && FixLinearApply(&map, 4) == 10);
+}
+
+static void _checkScalar(void)
+{
+    static const int32_t edges16[] = { INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX - 1, INT16_MAX };
+    static const int32_t edges32[] = { INT32_MIN, INT32_MIN + 1, -1, 0, 1, INT32_MAX - 1, INT32_MAX };
+    uint32_t errors = 0;
+
+    for(uint32_t i = 0; i < CHECK_RANDOM + 49; i++)
+    {
+        q15_t a15 = (i < 49) ? edges16[i / 7] : (q15_t) _random();
+        q15_t b15 = (i < 49) ? edges16[i % 7] : (q15_t) _random();
+        q31_t a31 = (i < 49) ? edges32[i / 7] : (q31_t) _random();
+        q31_t b31 = (i < 49) ? edges32[i % 7] : (q31_t) _random();
+        int64_t sum15 = (int64_t) a15 + b15, diff15 = (int64_t) a15 - b15, prod15 = ((int64_t) a15 * b15) >> 15;
+        int64_t sum31 = (int64_t) a31 + b31, diff31 = (int64_t) a31 - b31, prod31 = ((int64_t) a31 * b31) >> 31;
+
+        errors += FixAddQ15(a15, b15) != fmin(fmax(sum15, INT16_MIN), INT16_MAX);
+        errors += FixSubQ15(a15, b15) != fmin(fmax(diff15, INT16_MIN), INT16_MAX);
+        errors += FixMulQ15(a15, b15) != fmin(fmax(prod15, INT16_MIN), INT16_MAX);
+        errors += FixAddQ31(a31, b31) != (sum31 > INT32_MAX ? INT32_MAX : (sum31 < INT32_MIN ? INT32_MIN : sum31));
+        errors += FixSubQ31(a31, b31) != (diff31 > INT32_MAX ? INT32_MAX : (diff31 < INT32_MIN ? INT32_MIN : diff31));
+        errors += FixMulQ31(a31, b31) != (prod31 > INT32_MAX ? INT32_MAX : prod31);
+    }
+
+    printf("saturating scalar ops, %u mismatches\n", errors);
+    _checkExpect("saturating scalar ops", errors == 0);
+    _checkExpect("-1 * -1 saturates", FixMulQ15(INT16_MIN, INT16_MIN) == INT16_MAX && FixMulQ31(INT32_MIN, INT32_MIN) == INT32_MAX);
+    _checkExpect("float conversions", FIX_FLOAT_TO_Q15(0.5f) == 16384 && FIX_Q31_TO_FLOAT(FIX_FLOAT_TO_Q31(-0.25f)) == -0.25f);
+}
+
+static void _checkVectors(void)
+{
+    int64_t dot = 0;
+    bool ok;
+
+    for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+    {
+        // Operands near the rails so saturation happens in both lanes
+        _a[i] = (i % 5 == 0) ? INT16_MAX - (q15_t) (i & 7) : (q15_t) _random();
+        _b[i] = (i % 7 == 0) ? INT16_MIN + (q15_t) (i & 7) : (q15_t) _random();
+        _shift[i] = (uint8_t) (_random() % 16);
+    }
+
+    FixVecAddQ15(_a, _b, _out, CHECK_VEC_LEN);
+    for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+    {
+        _ref[i] = FixAddQ15(_a[i], _b[i]);
+    }
+    _checkExpect("FixVecAddQ15", memcmp(_out, _ref, sizeof(_ref)) == 0);
+
+    FixVecSubQ15(_a, _b, _out, CHECK_VEC_LEN);
+    for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+    {
+        _ref[i] = FixSubQ15(_a[i], _b[i]);
+    }
+    _checkExpect("FixVecSubQ15", memcmp(_out, _ref, sizeof(_ref)) == 0);
+
+    ok = true;
+    for(int8_t shift = -4; shift <= 4; shift++)
+    {
+        FixVecScaleQ15(_a, -23170, shift, _out, CHECK_VEC_LEN);
+        for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+        {
+            float exact = FIX_Q15_TO_FLOAT(_a[i]) * FIX_Q15_TO_FLOAT(-23170) * ldexpf(1.0f, shift);
+
+            exact = fminf(fmaxf(exact, -1.0f), FIX_Q15_TO_FLOAT(INT16_MAX));
+            ok &= fabsf(FIX_Q15_TO_FLOAT(_out[i]) - exact) <= 1.0f / 32768.0f;
+        }
+    }
+    _checkExpect("FixVecScaleQ15 within one LSB of float", ok);
+
+    for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+    {
+        dot += (int32_t) _a[i] * _b[i];
+    }
+    _checkExpect("FixVecDotQ15", FixVecDotQ15(_a, _b, CHECK_VEC_LEN) == dot);
+
+    // Aliased output, as the drivers use it in place
+    memcpy(_out, _a, sizeof(_out));
+    FixVecAddQ15(_out, _b, _out, CHECK_VEC_LEN);
+    for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+    {
+        _ref[i] = FixAddQ15(_a[i], _b[i]);
+    }
+    _checkExpect("FixVecAddQ15 in place", memcmp(_out, _ref, sizeof(_ref)) == 0);
+
+    FixVecMulShiftQ15(_a, _b, _shift, _wide, CHECK_VEC_LEN);
+    for(uint32_t i = 0; i < CHECK_VEC_LEN; i++)
+    {
+        _wideRef[i] = (int32_t) floor((double) _a[i] * _b[i] / (double) (1 << _shift[i]));
+    }
+    _checkExpect("FixVecMulShiftQ15", memcmp(_wide, _wideRef, sizeof(_wideRef)) == 0);
+
+    printf("vector kernels checked on %u elements\n", CHECK_VEC_LEN);
+}
+
+static void _bench(void)
+{
+    sFixLinear map;
+    double start, mapNs, fixNs;
+    int32_t acc = 0;
+
+    FixLinearInit(&map, -90, 90, 500, 2500);
+
+    start = _seconds();
+    for(uint32_t i = 0; i < BENCH_CALLS; i++)
+    {
+        acc += (int32_t) _mapFloat((float) (int32_t) ((i & 255) - 128), -90, 90, 500, 2500);
+        _sink = acc;
+    }
+    mapNs = (_seconds() - start) * 1e9 / BENCH_CALLS;
+
+    start = _seconds();
+    for(uint32_t i = 0; i < BENCH_CALLS; i++)
+    {
+        acc += FixLinearApply(&map, (int32_t) ((i & 255) - 128));
+        _sink = acc;
+    }
+    fixNs = (_seconds() - start) * 1e9 / BENCH_CALLS;
+
+    printf("map() %.2f ns, FixLinearApply %.2f ns per call\n", mapNs, fixNs);
+
+    start = _seconds();
+    for(uint32_t r = 0; r < BENCH_VEC_ROUNDS; r++)
+    {
+        FixVecAddQ15(_a, _b, _out, CHECK_VEC_LEN);
+        _sink = _out[r % CHECK_VEC_LEN];
+    }
+    printf("FixVecAddQ15 %.3f ns per element\n", (_seconds() - start) * 1e9 / BENCH_VEC_ROUNDS / CHECK_VEC_LEN);
+
+    start = _seconds();
+    for(uint32_t r = 0; r < BENCH_VEC_ROUNDS; r++)
+    {
+        _sink = (int32_t) FixVecDotQ15(_a, _b, CHECK_VEC_LEN);
+    }
+    printf("FixVecDotQ15 %.3f ns per element\n", (_seconds() - start) * 1e9 / BENCH_VEC_ROUNDS / CHECK_VEC_LEN);
+
+    start = _seconds();
+    for(uint32_t r = 0; r < BENCH_VEC_ROUNDS; r++)
+    {
+        FixVecMulShiftQ15(_a, _b, _shift, _wide, CHECK_VEC_LEN);
+        _sink = _wide[r % CHECK_VEC_LEN];
+    }
+    printf("FixVecMulShiftQ15 %.3f ns per element\n", (_seconds() - start) * 1e9 / BENCH_VEC_ROUNDS / CHECK_VEC_LEN);
+}
+
+
+int main(int argc, char *argv[])
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    printf("packed lane path\n");
+#else
+    printf("portable path\n");
+#endif
+
+    _checkLinear();
+    _checkScalar();
+    _checkVectors();
+    _bench();
+
+    printf("%s\n", _failures == 0 ? "PASS" : "FAIL");
+    return _failures == 0 ? 0 : 1;
+}
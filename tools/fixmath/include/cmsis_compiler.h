@@ -0,0 +1,61 @@
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+/*********************************************************************************
+    Host models of the Cortex-M33 DSP intrinsics used by common/fixmath.
+
+    Building with -D__ARM_FEATURE_DSP=1 and this directory on the include path
+    runs the packed lane code of the kernels on the host, so fix_check can
+    compare it against the portable path.
+***********************************************************************************/
+
+#include <stdint.h>
+
+static inline int32_t _emuSat(int64_t x, int bits)
+{
+    int64_t max = ((int64_t) 1 << (bits - 1)) - 1;
+
+    return (int32_t) ((x > max) ? max : ((x < -max - 1) ? -max - 1 : x));
+}
+
+static inline int16_t _emuLane(uint32_t x, int lane)
+{
+    return (int16_t) (x >> (16 * lane));
+}
+
+#define __SSAT(x, bits)         _emuSat((int64_t) (x), (bits))
+#define __PKHBT(a, b, s)        ((((uint32_t) (a)) & 0x0000FFFFU) | ((((uint32_t) (b)) << (s)) & 0xFFFF0000U))
+
+static inline int32_t __QADD(int32_t a, int32_t b)
+{
+    return _emuSat((int64_t) a + b, 32);
+}
+
+static inline int32_t __QSUB(int32_t a, int32_t b)
+{
+    return _emuSat((int64_t) a - b, 32);
+}
+
+static inline uint32_t __QADD16(uint32_t a, uint32_t b)
+{
+    return (uint16_t) _emuSat(_emuLane(a, 0) + _emuLane(b, 0), 16) |
+           ((uint32_t) (uint16_t) _emuSat(_emuLane(a, 1) + _emuLane(b, 1), 16) << 16);
+}
+
+static inline uint32_t __QSUB16(uint32_t a, uint32_t b)
+{
+    return (uint16_t) _emuSat(_emuLane(a, 0) - _emuLane(b, 0), 16) |
+           ((uint32_t) (uint16_t) _emuSat(_emuLane(a, 1) - _emuLane(b, 1), 16) << 16);
+}
+
+static inline uint32_t __SMUAD(uint32_t a, uint32_t b)
+{
+    return (uint32_t) ((int32_t) _emuLane(a, 0) * _emuLane(b, 0) + (int32_t) _emuLane(a, 1) * _emuLane(b, 1));
+}
+
+static inline uint64_t __SMLALD(uint32_t a, uint32_t b, uint64_t acc)
+{
+    return acc + (uint64_t) ((int64_t) _emuLane(a, 0) * _emuLane(b, 0) + (int64_t) _emuLane(a, 1) * _emuLane(b, 1));
+}
+
+#endif /* __CMSIS_COMPILER_H */
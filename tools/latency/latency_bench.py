@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Run the MantiCore interrupt latency benchmark over the console and keep it as a CSV.
+
+The target must be built with -DMANTICORE_LATENCY=ON (see common/latency/latency.h).
+This tool unlocks the console, sends "latency run N" and collects the rows the
+target prints after each load scenario:
+    lat,load,source,stage,count,min_ns,p50_ns,p90_ns,p99_ns,max_ns
+
+Scenarios without a load function print "lat,<load>,skipped" and are left out.
+With --baseline, every row also present in the baseline is compared on p99 and
+max, and the exit status is 1 when any of them grew by more than --tolerance.
+
+Examples:
+    latency_bench.py /dev/ttyUSB1 -o latency.csv
+    latency_bench.py /dev/ttyUSB1 --seconds 30 -o latency.csv --baseline main.csv --tolerance 0.2
+"""
+
+import argparse
+import csv
+import sys
+import time
+
+import serial
+
+UNLOCK = b"console\r"
+ROW_PREFIX = "lat,"
+DONE = "latency done"
+FIELDS = ["load", "source", "stage", "count", "min_ns", "p50_ns", "p90_ns", "p99_ns", "max_ns"]
+COMPARED = ["p99_ns", "max_ns"]
+LOAD_COUNT = 4
+
+
+def run(port, seconds, timeout):
+    rows = []
+    skipped = []
+    line = b""
+
+    port.write(UNLOCK)
+    time.sleep(0.5)
+    port.reset_input_buffer()
+    port.write(f"latency run {seconds}\r".encode())
+
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        line += port.read(256)
+        while b"\n" in line:
+            text, line = line.split(b"\n", 1)
+            text = text.decode(errors="replace").strip()
+
+            if text == DONE:
+                return rows, skipped
+            if not text.startswith(ROW_PREFIX) or text.startswith(ROW_PREFIX + "load,"):
+                continue
+
+            values = text[len(ROW_PREFIX):].split(",")
+            if len(values) == 2 and values[1] == "skipped":
+                skipped.append(values[0])
+            elif len(values) == len(FIELDS):
+                rows.append(dict(zip(FIELDS, values)))
+
+    raise TimeoutError(f"no '{DONE}' within {timeout:.0f} s, is the target built with MANTICORE_LATENCY?")
+
+
+def compare(rows, baseline_path, tolerance):
+    with open(baseline_path, newline="") as baseline_file:
+        baseline = {(row["load"], row["source"], row["stage"]): row for row in csv.DictReader(baseline_file)}
+
+    regressions = 0
+    for row in rows:
+        base = baseline.get((row["load"], row["source"], row["stage"]))
+        if base is None:
+            continue
+        for field in COMPARED:
+            limit = int(base[field]) * (1.0 + tolerance)
+            if int(row[field]) > limit:
+                regressions += 1
+                print(f"REGRESSION {row['load']} {row['source']} {row['stage']} {field}: "
+                      f"{base[field]} -> {row[field]} ns")
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=921600)
+    parser.add_argument("-o", "--output", default="latency.csv")
+    parser.add_argument("--seconds", type=int, default=10, help="per load scenario, same as on the target")
+    parser.add_argument("--baseline", help="earlier CSV from this tool to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.25, help="allowed p99 and max growth, 0.25 = 25%%")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    rows, skipped = run(port, args.seconds, timeout=args.seconds * LOAD_COUNT + 30)
+
+    with open(args.output, "w", newline="") as out:
+        writer = csv.DictWriter(out, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    print(f"wrote {len(rows)} rows to {args.output}")
+    if skipped:
+        print(f"skipped loads without a load function: {', '.join(skipped)}")
+
+    if args.baseline and compare(rows, args.baseline, args.tolerance) > 0:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
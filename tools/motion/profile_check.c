@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "motion_profile.h"
+
+/*********************************************************************************
+    Checks of the common/motion profile planner.
+
+    Every case samples the profile finely and checks that it starts and ends
+    on its endpoints, never moves backwards and keeps velocity and
+    acceleration inside the limits. S-curves must not step their
+    acceleration by more than the jerk limit allows between samples, which a
+    trapezoid does at every corner. Short moves exercise the triangle and the
+    reduced S-curves, synchronised moves have to finish together and stay
+    inside their limits, and MotionFill has to produce the compare values a
+    servo would see at 50 Hz. A group whose first axis does not move still
+    needs the frames of its longest axis.
+
+    Build from the repository root:
+        gcc -std=gnu11 -O2 -Wall -ffp-contract=off -Icommon/motion \
+            common/motion/motion_profile.c tools/motion/profile_check.c -lm -o profile_check
+
+    Usage:
+        profile_check [trace.csv]   optional position, velocity, acceleration trace of every case
+***********************************************************************************/
+
+#define CHECK_DT            0.005f      // Finite difference step
+#define CHECK_TOL           0.01f       // Relative slack on the limits
+#define SERVO_PERIOD        0.02f       // 50 Hz
+#define SERVO_MIN_CNT       500.0f      // Counts at -90 degrees
+#define SERVO_MAX_CNT       2500.0f     // Counts at 90 degrees
+
+typedef struct
+{
+    const char *name;
+    eMotionShape shape;
+    float start;
+    float target;
+    sMotionLimits limits;
+    float duration;                 // Expected, 0 to skip
+} sCheckCase;
+
+typedef struct
+{
+    float vMax;
+    float aMax;
+    float aStep;                    // Largest acceleration change between samples
+} sCheckResult;
+
+// Static Variables
+static FILE *_trace;
+static uint32_t _failures;
+
+// Static Function Declarations
+static void _checkExpect(const char *what, bool ok);
+static void _checkProfile(const char *name, const sMotionProfile *profile, const sMotionLimits *limits, eMotionShape shape, sCheckResult *result);
+
+
+// Static Function Definitions
+static void _checkExpect(const char *what, bool ok)
+{
+    if(!ok)
+    {
+        printf("  ! %s\n", what);
+        _failures++;
+    }
+}
+
+// Samples a planned, possibly stretched, profile and checks it against the limits
+static void _checkProfile(const char *name, const sMotionProfile *profile, const sMotionLimits *limits, eMotionShape shape, sCheckResult *result)
+{
+    float direction = (profile->target >= profile->start) ? 1.0f : -1.0f;
+    float prevAcc = 0.0f;
+    bool monotonic = true;
+    uint32_t steps = (uint32_t) ceilf(profile->duration / CHECK_DT) + 2;
+
+    result->vMax = 0.0f;
+    result->aMax = 0.0f;
+    result->aStep = 0.0f;
+
+    for(uint32_t i = 0; i <= steps; i++)
+    {
+        float t = i * CHECK_DT;
+        float p0 = MotionPosition(profile, t - CHECK_DT);
+        float p1 = MotionPosition(profile, t);
+        float p2 = MotionPosition(profile, t + CHECK_DT);
+        float v = (p2 - p0) / (2.0f * CHECK_DT);
+        float a = (p2 - 2.0f * p1 + p0) / (CHECK_DT * CHECK_DT);
+
+        monotonic &= direction * (p2 - p1) >= -1e-4f;
+        result->vMax = fabsf(v) > result->vMax ? fabsf(v) : result->vMax;
+        result->aMax = fabsf(a) > result->aMax ? fabsf(a) : result->aMax;
+        result->aStep = fabsf(a - prevAcc) > result->aStep ? fabsf(a - prevAcc) : result->aStep;
+        prevAcc = a;
+
+        if(_trace != NULL)
+        {
+            fprintf(_trace, "%s,%.4f,%.5f,%.4f,%.3f\n", name, t, p1, v, a);
+        }
+    }
+
+    _checkExpect("starts on start", MotionPosition(profile, 0.0f) == profile->start);
+    _checkExpect("ends on target", MotionPosition(profile, profile->duration) == profile->target);
+    _checkExpect("plan reaches target", fabsf(MotionPosition(profile, profile->duration * 0.99999f) - profile->target) <= 1e-3f * (1.0f + fabsf(profile->target)));
+    _checkExpect("monotonic", monotonic);
+    _checkExpect("velocity limit", result->vMax <= limits->vMax * (1.0f + CHECK_TOL));
+    // Float rounding of the positions adds about 1 /s^2 of noise to the second difference
+    _checkExpect("acceleration limit", result->aMax <= limits->aMax * (1.0f + CHECK_TOL) + 2.0f);
+    if(shape == MOTION_SCURVE)
+    {
+        _checkExpect("jerk limit", result->aStep <= limits->jMax * CHECK_DT * (1.0f + CHECK_TOL) + 2.0f);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    // Degrees, degrees/s, /s^2, /s^3. Long moves reach every limit, short ones lose the cruise,
+    // then the constant acceleration, then both
+    static const sCheckCase cases[] =
+    {
+        { "trapezoid",               MOTION_TRAPEZOID,   0.0f,  90.0f, { 60.0f, 240.0f,    0.0f }, 1.75f },
+        { "trapezoid triangle",      MOTION_TRAPEZOID,   0.0f,   5.0f, { 60.0f, 240.0f,    0.0f }, 0.288675f },
+        { "trapezoid reverse",       MOTION_TRAPEZOID,  45.0f, -80.0f, { 60.0f, 240.0f,    0.0f }, 0.0f },
+        { "s-curve",                 MOTION_SCURVE,      0.0f,  90.0f, { 60.0f, 240.0f, 2400.0f }, 1.85f },
+        { "s-curve no const accel",  MOTION_SCURVE,      0.0f,  90.0f, { 20.0f, 240.0f, 2400.0f }, 0.0f },
+        { "s-curve no cruise",       MOTION_SCURVE,      0.0f,  10.0f, { 60.0f, 240.0f, 2400.0f }, 0.0f },
+        { "s-curve jerk only",       MOTION_SCURVE,      0.0f,   0.5f, { 60.0f, 240.0f, 2400.0f }, 0.0f },
+        { "s-curve reverse",         MOTION_SCURVE,     90.0f, -30.0f, { 60.0f, 240.0f, 2400.0f }, 0.0f },
+        { "zero length",             MOTION_SCURVE,     12.0f,  12.0f, { 60.0f, 240.0f, 2400.0f }, 0.0f },
+    };
+    sMotionProfile profile;
+    sCheckResult result;
+
+    if(argc > 1)
+    {
+        _trace = fopen(argv[1], "w");
+        if(_trace == NULL)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+        fprintf(_trace, "case,time,position,velocity,acceleration\n");
+    }
+
+    printf("%-24s %9s %9s %9s %9s %10s\n", "case", "time s", "v peak", "v max", "a max", "a step");
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const sCheckCase *test = &cases[i];
+
+        if(!MotionPlan(&profile, test->shape, test->start, test->target, &test->limits))
+        {
+            printf("%-24s invalid limits\n", test->name);
+            _failures++;
+            continue;
+        }
+
+        _checkProfile(test->name, &profile, &test->limits, test->shape, &result);
+        printf("%-24s %9.4f %9.3f %9.3f %9.2f %10.3f\n", test->name, profile.duration, profile.vPeak, result.vMax, result.aMax, result.aStep);
+        if(test->duration != 0.0f)
+        {
+            _checkExpect("duration", fabsf(profile.duration - test->duration) <= 1e-4f * test->duration);
+        }
+    }
+
+    // The trapezoid steps its acceleration, the check above would catch an S-curve doing so
+    MotionPlan(&profile, MOTION_TRAPEZOID, 0.0f, 90.0f, &cases[0].limits);
+    _checkProfile("trapezoid step", &profile, &cases[3].limits, MOTION_TRAPEZOID, &result);
+    _checkExpect("trapezoid steps its acceleration", result.aStep > cases[3].limits.jMax * CHECK_DT * 2.0f);
+
+    // Three axes of different lengths and limits arrive together and stay inside their limits
+    {
+        static const sMotionLimits limits[3] =
+        {
+            { 60.0f, 240.0f, 2400.0f },
+            { 30.0f, 100.0f, 1000.0f },
+            { 90.0f, 400.0f, 4000.0f },
+        };
+        static const float targets[3][2] = { { 0.0f, 90.0f }, { 10.0f, 20.0f }, { -45.0f, 60.0f } };
+        sMotionProfile axes[3];
+        sMotionProfile *profiles[3] = { &axes[0], &axes[1], &axes[2] };
+        float longest = 0.0f, synced;
+
+        for(int i = 0; i < 3; i++)
+        {
+            MotionPlan(&axes[i], MOTION_SCURVE, targets[i][0], targets[i][1], &limits[i]);
+            longest = axes[i].duration > longest ? axes[i].duration : longest;
+        }
+        synced = MotionSynchronize(profiles, 3);
+
+        printf("synchronised %.4f s\n", synced);
+        _checkExpect("synchronised to the longest", synced == longest);
+        for(int i = 0; i < 3; i++)
+        {
+            char name[24];
+
+            snprintf(name, sizeof(name), "synchronised %d", i);
+            _checkExpect("same finish", axes[i].duration == synced);
+            _checkProfile(name, &axes[i], &limits[i], MOTION_SCURVE, &result);
+        }
+    }
+
+    // Compare values for a servo from -90 to 90 degrees at 50 Hz, two axes in a four channel frame
+    {
+        static const sMotionLimits limits = { 60.0f, 240.0f, 2400.0f };
+        const float countsPerUnit = (SERVO_MAX_CNT - SERVO_MIN_CNT) / 180.0f;
+        const float countsOffset = SERVO_MIN_CNT + 90.0f * countsPerUnit;
+        static uint32_t frames[4 * 256];
+        sMotionProfile a, b;
+        sMotionProfile *profiles[2] = { &a, &b };
+        uint32_t count;
+        bool steady = true;
+
+        MotionPlan(&a, MOTION_SCURVE, -30.0f, 60.0f, &limits);
+        MotionPlan(&b, MOTION_SCURVE, 20.0f, 0.0f, &limits);
+        MotionSynchronize(profiles, 2);
+        count = MotionFrames(&a, SERVO_PERIOD);
+        memset(frames, 0xA5, sizeof(frames));
+
+        _checkExpect("frames fit", count <= 256 && count == MotionFrames(&b, SERVO_PERIOD));
+        _checkExpect("fill a", MotionFill(&a, SERVO_PERIOD, countsPerUnit, countsOffset, &frames[0], 4, count));
+        _checkExpect("fill b", MotionFill(&b, SERVO_PERIOD, countsPerUnit, countsOffset, &frames[2], 4, count));
+        for(uint32_t i = 1; i < count; i++)
+        {
+            // 60 degrees/s is 13.3 counts per period
+            steady &= abs((int32_t) frames[4 * i] - (int32_t) frames[4 * (i - 1)]) <= 14;
+        }
+
+        printf("fill %u frames, last %u %u\n", count, frames[4 * (count - 1)], frames[4 * (count - 1) + 2]);
+        _checkExpect("frames cover the move", count * SERVO_PERIOD >= a.duration && (count - 1) * SERVO_PERIOD < a.duration);
+        _checkExpect("last frame on target", frames[4 * (count - 1)] == 2167 && frames[4 * (count - 1) + 2] == 1500);
+        _checkExpect("first frame moved off start", frames[0] >= 1167 && frames[0] < 1170);
+        _checkExpect("no step above the speed limit", steady);
+        _checkExpect("other channels untouched", frames[1] == 0xA5A5A5A5 && frames[4 * count - 1] == 0xA5A5A5A5);
+        _checkExpect("negative counts refused", !MotionFill(&a, SERVO_PERIOD, countsPerUnit, -2000.0f, &frames[0], 4, count));
+    }
+
+    // An axis already on its target keeps zero duration, the group still needs the frames of the longest axis
+    {
+        static const sMotionLimits limits = { 60.0f, 240.0f, 2400.0f };
+        const float countsPerUnit = (SERVO_MAX_CNT - SERVO_MIN_CNT) / 180.0f;
+        const float countsOffset = SERVO_MIN_CNT + 90.0f * countsPerUnit;
+        static uint32_t frames[2 * 256];
+        sMotionProfile hold, move;
+        sMotionProfile *profiles[2] = { &hold, &move };
+        uint32_t count;
+
+        MotionPlan(&hold, MOTION_SCURVE, 10.0f, 10.0f, &limits);
+        MotionPlan(&move, MOTION_SCURVE, 0.0f, 90.0f, &limits);
+        MotionSynchronize(profiles, 2);
+        count = MotionFramesMax(profiles, 2, SERVO_PERIOD);
+
+        printf("held first axis %u frames\n", count);
+        _checkExpect("held axis stays zero length", hold.duration == 0.0f && MotionFrames(&hold, SERVO_PERIOD) == 1);
+        _checkExpect("frames of the longest axis", count == MotionFrames(&move, SERVO_PERIOD) && count <= 256);
+        _checkExpect("fill held", MotionFill(&hold, SERVO_PERIOD, countsPerUnit, countsOffset, &frames[0], 2, count));
+        _checkExpect("fill moving", MotionFill(&move, SERVO_PERIOD, countsPerUnit, countsOffset, &frames[1], 2, count));
+        _checkExpect("held axis on target", frames[0] == 1611 && frames[2 * (count - 1)] == 1611);
+        _checkExpect("moving axis reaches target", frames[2 * (count - 1) + 1] == 2500);
+    }
+
+    // Invalid limits are refused
+    {
+        sMotionLimits limits = { 60.0f, 0.0f, 2400.0f };
+
+        _checkExpect("zero acceleration refused", !MotionPlan(&profile, MOTION_TRAPEZOID, 0.0f, 1.0f, &limits));
+        limits.aMax = 240.0f;
+        limits.jMax = 0.0f;
+        _checkExpect("zero jerk refused for an s-curve", !MotionPlan(&profile, MOTION_SCURVE, 0.0f, 1.0f, &limits));
+        _checkExpect("jerk unused by a trapezoid", MotionPlan(&profile, MOTION_TRAPEZOID, 0.0f, 1.0f, &limits));
+    }
+
+    if(_trace != NULL)
+    {
+        fclose(_trace);
+    }
+
+    printf("%s\n", _failures == 0 ? "PASS" : "FAIL");
+    return _failures == 0 ? 0 : 1;
+}
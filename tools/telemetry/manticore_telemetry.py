@@ -0,0 +1,186 @@
+"""Host-side decoder for the MantiCore binary telemetry channel.
+
+The firmware multiplexes COBS-framed binary telemetry with the text console on
+one UART. Frames are wrapped in 0x00 delimiters, which the text console never
+emits. See common/telemetry/telemetry.h for the frame layout.
+"""
+
+import struct
+import zlib
+from dataclasses import dataclass
+
+DELIMITER = 0x00
+HEADER = struct.Struct("<BBHI")
+CRC = struct.Struct("<I")
+
+FRAME_STREAM = 0x01
+FRAME_COMMAND = 0x02
+FRAME_RESPONSE = 0x03
+
+STREAM_IMU = 0x01
+STREAM_MCAN_STATS = 0x02
+STREAM_THREAD_STATS = 0x03
+
+CMD_PING = 0x01
+CMD_STREAM_RATE = 0x02
+
+STATUS_NAMES = {0: "OK", 1: "UNKNOWN_CMD", 2: "BAD_ARGS", 3: "FAILED"}
+
+THREAD_STATES = {
+    0: "READY", 1: "COMPLETED", 2: "TERMINATED", 3: "SUSPENDED", 4: "SLEEP",
+    5: "QUEUE_SUSP", 6: "SEMAPHORE_SUSP", 7: "EVENT_FLAG", 8: "BLOCK_MEMORY",
+    9: "BYTE_MEMORY", 13: "MUTEX_SUSP",
+}
+
+_IMU = struct.Struct("<13f")
+_MCAN_STATS = struct.Struct("<4I")
+_THREAD_STATS = struct.Struct("<16sBBII")
+
+
+class FrameError(Exception):
+    pass
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_index] = code
+                code_index = len(out)
+                out.append(0)
+                code = 1
+    out[code_index] = code
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> bytes:
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        index += 1
+        if code == 0 or index + code - 1 > len(data):
+            raise FrameError("malformed COBS block")
+        out += data[index:index + code - 1]
+        index += code - 1
+        if code != 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+@dataclass
+class Frame:
+    type: int
+    id: int
+    seq: int
+    timestamp: int
+    payload: bytes
+
+    def decode(self):
+        """Returns the typed payload of a stream frame, or the raw bytes."""
+        if self.type == FRAME_STREAM:
+            if self.id == STREAM_IMU:
+                v = _IMU.unpack(self.payload)
+                return {"accel": v[0:3], "gyro": v[3:6], "mag": v[6:9], "quat": v[9:13]}
+            if self.id == STREAM_MCAN_STATS:
+                keys = ("rx_frames", "rx_dropped", "tx_frames", "tx_errors")
+                return dict(zip(keys, _MCAN_STATS.unpack(self.payload)))
+            if self.id == STREAM_THREAD_STATS:
+                name, state, priority, run_count, stack_size = _THREAD_STATS.unpack(self.payload)
+                return {
+                    "name": name.split(b"\0", 1)[0].decode(errors="replace"),
+                    "state": THREAD_STATES.get(state, str(state)),
+                    "priority": priority,
+                    "run_count": run_count,
+                    "stack_size": stack_size,
+                }
+        if self.type == FRAME_RESPONSE:
+            return {"status": STATUS_NAMES.get(self.payload[0], str(self.payload[0])),
+                    "data": self.payload[1:]}
+        return self.payload
+
+
+def decode_frame(encoded: bytes) -> Frame:
+    raw = cobs_decode(encoded)
+    if len(raw) < HEADER.size + CRC.size:
+        raise FrameError("short frame")
+    body, (crc,) = raw[:-CRC.size], CRC.unpack(raw[-CRC.size:])
+    if zlib.crc32(body) != crc:
+        raise FrameError("CRC mismatch")
+    frame_type, frame_id, seq, timestamp = HEADER.unpack(body[:HEADER.size])
+    return Frame(frame_type, frame_id, seq, timestamp, body[HEADER.size:])
+
+
+def encode_frame(frame_type: int, frame_id: int, seq: int, payload: bytes = b"", timestamp: int = 0) -> bytes:
+    body = HEADER.pack(frame_type, frame_id, seq & 0xFFFF, timestamp) + payload
+    return bytes([DELIMITER]) + cobs_encode(body + CRC.pack(zlib.crc32(body))) + bytes([DELIMITER])
+
+
+def encode_command(command_id: int, seq: int, payload: bytes = b"") -> bytes:
+    return encode_frame(FRAME_COMMAND, command_id, seq, payload)
+
+
+def encode_stream_rate(stream: int, period_ms: int, seq: int) -> bytes:
+    return encode_command(CMD_STREAM_RATE, seq, struct.pack("<BH", stream, period_ms))
+
+
+class StreamSplitter:
+    """Splits the raw UART byte stream into console text and telemetry frames.
+
+    feed() yields ("text", bytes), ("frame", Frame) and ("error", str) events.
+    The splitter mirrors the firmware receiver: a 0x00 opens a frame unless a
+    non-empty frame is open, in which case it closes it.
+    """
+
+    def __init__(self):
+        self._in_frame = False
+        self._buffer = bytearray()
+        self.frames = 0
+        self.errors = 0
+        self._last_seq = {}
+        self.gaps = 0
+
+    def feed(self, data: bytes):
+        text = bytearray()
+        for byte in data:
+            if byte == DELIMITER:
+                if self._in_frame and self._buffer:
+                    if text:
+                        yield ("text", bytes(text))
+                        text.clear()
+                    yield self._finish()
+                    self._in_frame = False
+                else:
+                    self._in_frame = True
+                self._buffer.clear()
+            elif self._in_frame:
+                self._buffer.append(byte)
+            else:
+                text.append(byte)
+        if text:
+            yield ("text", bytes(text))
+
+    def _finish(self):
+        try:
+            frame = decode_frame(bytes(self._buffer))
+        except FrameError as error:
+            self.errors += 1
+            return ("error", str(error))
+
+        self.frames += 1
+        if frame.type == FRAME_STREAM:
+            last = self._last_seq.get(frame.id)
+            if last is not None and frame.seq != (last + 1) & 0xFFFF:
+                self.gaps += (frame.seq - last - 1) & 0xFFFF
+            self._last_seq[frame.id] = frame.seq
+        return ("frame", frame)
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Stream and decode MantiCore telemetry from a module's console UART.
+
+Examples:
+    telemetry_cli.py /dev/ttyACM0 --rate mcan=100 --rate threads=1000
+    telemetry_cli.py /dev/ttyACM0 --rate imu=10 --csv imu.csv --only imu
+"""
+
+import argparse
+import csv
+import sys
+import time
+
+import serial
+
+import manticore_telemetry as mt
+
+STREAMS = {
+    "imu": mt.STREAM_IMU,
+    "mcan": mt.STREAM_MCAN_STATS,
+    "threads": mt.STREAM_THREAD_STATS,
+}
+STREAM_NAMES = {v: k for k, v in STREAMS.items()}
+
+
+def _flatten(decoded):
+    row = {}
+    for key, value in decoded.items():
+        if isinstance(value, (tuple, list)):
+            for i, item in enumerate(value):
+                row[f"{key}{i}"] = item
+        else:
+            row[key] = value
+    return row
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=921600)
+    parser.add_argument("--rate", action="append", default=[], metavar="STREAM=MS",
+                        help="set a stream rate (imu, mcan, threads), 0 disables")
+    parser.add_argument("--ping", action="store_true", help="send a ping command and report round trip time")
+    parser.add_argument("--only", choices=STREAMS.keys(), action="append", help="only print these streams")
+    parser.add_argument("--csv", help="append decoded stream samples to a CSV file")
+    parser.add_argument("--text", action="store_true", help="echo console text")
+    parser.add_argument("--duration", type=float, default=0, help="stop after N seconds")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    splitter = mt.StreamSplitter()
+    seq = 0
+    ping_sent = {}
+
+    for rate in args.rate:
+        name, _, period = rate.partition("=")
+        port.write(mt.encode_stream_rate(STREAMS[name], int(period), seq))
+        seq += 1
+
+    if args.ping:
+        ping_sent[seq] = time.monotonic()
+        port.write(mt.encode_command(mt.CMD_PING, seq, b"manticore"))
+        seq += 1
+
+    only = {STREAMS[name] for name in args.only} if args.only else None
+    csv_file = open(args.csv, "a", newline="") if args.csv else None
+    writer = None
+    start = time.monotonic()
+
+    try:
+        while args.duration == 0 or time.monotonic() - start < args.duration:
+            for kind, item in splitter.feed(port.read(4096)):
+                if kind == "text":
+                    if args.text:
+                        sys.stdout.write(item.decode(errors="replace"))
+                    continue
+                if kind == "error":
+                    print(f"[frame error] {item}", file=sys.stderr)
+                    continue
+
+                decoded = item.decode()
+                if item.type == mt.FRAME_RESPONSE:
+                    rtt = ""
+                    if item.seq in ping_sent:
+                        rtt = f" rtt={(time.monotonic() - ping_sent.pop(item.seq)) * 1000:.1f}ms"
+                    print(f"[response cmd=0x{item.id:02X} seq={item.seq}] {decoded['status']}{rtt} {decoded['data']!r}")
+                    continue
+
+                if only is not None and item.id not in only:
+                    continue
+
+                name = STREAM_NAMES.get(item.id, f"0x{item.id:02X}")
+                print(f"[{item.timestamp:>10} {name:<7} #{item.seq:<5}] {decoded}")
+
+                if csv_file is not None and isinstance(decoded, dict):
+                    row = {"stream": name, "seq": item.seq, "timestamp": item.timestamp, **_flatten(decoded)}
+                    if writer is None:
+                        writer = csv.DictWriter(csv_file, fieldnames=list(row.keys()), extrasaction="ignore")
+                        writer.writeheader()
+                    writer.writerow(row)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(f"\nframes={splitter.frames} errors={splitter.errors} sequence_gaps={splitter.gaps}", file=sys.stderr)
+        if csv_file is not None:
+            csv_file.close()
+
+
+if __name__ == "__main__":
+    main()
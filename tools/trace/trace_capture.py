@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Capture the MantiCore streaming ThreadX trace and write a TraceX file.
+
+The target streams packets (see common/trace/trace.h):
+    ['T']['X'][type u8][seq u8][len u16][payload][fletcher16 u16]
+
+Header packets carry the core clock, the ThreadX trace control header and the
+object registry. Events packets carry raw 32-byte TX_TRACE_BUFFER_ENTRY
+records. This tool stitches every received entry into one linear trace buffer
+image, the same layout ThreadX keeps in RAM, which TraceX opens directly.
+
+Examples:
+    trace_capture.py /dev/ttyUSB1 -o vehicle.trx
+    trace_capture.py /dev/ttyUSB1 -o boot.trx --duration 10 --max-events 200000
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+MAGIC = b"TX"
+PKT_HEADER = 0x01
+PKT_EVENTS = 0x02
+PKT_LOST = 0x03
+
+PKT_PREFIX = struct.Struct("<2sBBH")
+TRACE_HEADER = struct.Struct("<IIIIHHIIIIIII")
+ENTRY_SIZE = 32
+TRACE_VALID = 0x54585442
+INVALID_EVENT = 0xFFFFFFFF
+
+
+def fletcher16(data: bytes) -> int:
+    sum1 = sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return sum1 | (sum2 << 8)
+
+
+class TraceStream:
+    def __init__(self, max_events):
+        self.buffer = bytearray()
+        self.max_events = max_events
+        self.core_clock = None
+        self.header = None
+        self.registry = b""
+        self.events = []
+        self.lost = 0
+        self.bad_packets = 0
+        self.seq_gaps = 0
+        self._last_seq = None
+
+    def feed(self, data: bytes):
+        self.buffer += data
+        while True:
+            start = self.buffer.find(MAGIC)
+            if start < 0:
+                del self.buffer[:-1]
+                return
+            del self.buffer[:start]
+            if len(self.buffer) < PKT_PREFIX.size:
+                return
+
+            _, pkt_type, seq, length = PKT_PREFIX.unpack_from(self.buffer)
+            total = PKT_PREFIX.size + length + 2
+            if len(self.buffer) < total:
+                return
+
+            body = bytes(self.buffer[2:PKT_PREFIX.size + length])
+            (checksum,) = struct.unpack_from("<H", self.buffer, PKT_PREFIX.size + length)
+            if fletcher16(body) != checksum:
+                # Not a packet boundary, skip this magic and resync
+                self.bad_packets += 1
+                del self.buffer[:1]
+                continue
+
+            del self.buffer[:total]
+            self._packet(pkt_type, seq, body[4:])
+
+    def _packet(self, pkt_type, seq, payload):
+        if self._last_seq is not None and seq != (self._last_seq + 1) & 0xFF:
+            self.seq_gaps += 1
+        self._last_seq = seq
+
+        if pkt_type == PKT_HEADER:
+            (self.core_clock,) = struct.unpack_from("<I", payload)
+            self.header = TRACE_HEADER.unpack_from(payload, 4)
+            self.registry = payload[4 + TRACE_HEADER.size:]
+        elif pkt_type == PKT_EVENTS:
+            for offset in range(0, len(payload) - ENTRY_SIZE + 1, ENTRY_SIZE):
+                entry = payload[offset:offset + ENTRY_SIZE]
+                thread_ptr, _, event_id = struct.unpack_from("<III", entry)
+                if thread_ptr == 0 or event_id == INVALID_EVENT:
+                    continue
+                self.events.append(entry)
+            if len(self.events) > self.max_events:
+                del self.events[:len(self.events) - self.max_events]
+        elif pkt_type == PKT_LOST:
+            (lost,) = struct.unpack_from("<I", payload)
+            self.lost += lost
+
+    def tracex_image(self) -> bytes:
+        """Linear trace buffer image: control header, object registry, entries oldest first."""
+        if self.header is None:
+            raise RuntimeError("no trace header received, is the target streaming?")
+
+        base = self.header[2]
+        timer_mask = self.header[1]
+        name_size = self.header[5]
+        registry_start = base + TRACE_HEADER.size
+        registry_end = registry_start + len(self.registry)
+        buffer_start = registry_end
+        buffer_end = buffer_start + len(self.events) * ENTRY_SIZE
+
+        header = TRACE_HEADER.pack(
+            TRACE_VALID, timer_mask, base, registry_start, 0, name_size, registry_end,
+            buffer_start, buffer_end, buffer_start, 0xAAAAAAAA, 0xBBBBBBBB, 0xCCCCCCCC)
+        return header + self.registry + b"".join(self.events)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=921600)
+    parser.add_argument("-o", "--output", default="manticore.trx")
+    parser.add_argument("--duration", type=float, default=0, help="stop after N seconds, default until Ctrl-C")
+    parser.add_argument("--max-events", type=int, default=1000000, help="keep only the newest N events")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    stream = TraceStream(args.max_events)
+    start = time.monotonic()
+    last_status = start
+
+    try:
+        while args.duration == 0 or time.monotonic() - start < args.duration:
+            stream.feed(port.read(8192))
+            if time.monotonic() - last_status >= 1.0:
+                last_status = time.monotonic()
+                print(f"\revents {len(stream.events)}  lost {stream.lost}  bad packets {stream.bad_packets}", end="", file=sys.stderr)
+    except KeyboardInterrupt:
+        pass
+
+    print(file=sys.stderr)
+    image = stream.tracex_image()
+    with open(args.output, "wb") as out:
+        out.write(image)
+
+    print(f"wrote {len(stream.events)} events to {args.output}")
+    print(f"lost {stream.lost} entries on target, {stream.seq_gaps} packet gaps, {stream.bad_packets} bad packets")
+    if stream.core_clock:
+        print(f"time stamps are DWT cycles: set TraceX ticks per microsecond to {stream.core_clock / 1e6:g}")
+
+
+if __name__ == "__main__":
+    main()